@@ -0,0 +1,174 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bench.h"
+
+/*
+ * Allocation counting. The benchmark binary is linked with
+ * -Wl,--wrap=malloc (calloc, realloc) so every allocation made by
+ * the library code ends up here.
+ */
+
+static uint64_t bench_allocations = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    ++bench_allocations;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size) {
+    ++bench_allocations;
+    return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    ++bench_allocations;
+    return __real_realloc(ptr, size);
+}
+
+static uint64_t bench_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void bench_start_timer(bench_context_t *ctx) {
+    if (ctx->running) return;
+    ctx->running = 1;
+    ctx->started_allocations = bench_allocations;
+    ctx->started_ns = bench_now_ns();
+}
+
+void bench_stop_timer(bench_context_t *ctx) {
+    if (!ctx->running) return;
+    ctx->elapsed_ns += bench_now_ns() - ctx->started_ns;
+    ctx->allocations += bench_allocations - ctx->started_allocations;
+    ctx->running = 0;
+}
+
+static volatile uint64_t bench_sink = 0;
+
+void bench_consume(uint64_t value) {
+    bench_sink += value;
+}
+
+int bench_create_member(uint32_t idx, pt_socklen_t address_len, cluster_member_t *result) {
+    pt_sockaddr_storage addr;
+    memset(&addr, 0, sizeof(pt_sockaddr_storage));
+    if (address_len == sizeof(pt_sockaddr_in6)) {
+        pt_sockaddr_in6 *addr_in6 = (pt_sockaddr_in6 *) &addr;
+        addr_in6->sin6_family = AF_INET6;
+        addr_in6->sin6_port = PT_HTONS(7000);
+        addr_in6->sin6_addr.s6_addr[0] = 0xfd;
+        uint32_t idx_n = PT_HTONL(idx);
+        memcpy(&addr_in6->sin6_addr.s6_addr[12], &idx_n, sizeof(uint32_t));
+    } else {
+        pt_sockaddr_in *addr_in = (pt_sockaddr_in *) &addr;
+        addr_in->sin_family = AF_INET;
+        addr_in->sin_port = PT_HTONS(7000);
+        addr_in->sin_addr.s_addr = PT_HTONL(0x0A000001 + idx);
+    }
+    return cluster_member_init(result, &addr, address_len);
+}
+
+static int bench_run(const bench_definition_t *bench, size_t size, uint64_t min_time_ns,
+                     bench_context_t *result) {
+    uint64_t iterations = 1;
+    while (1) {
+        memset(result, 0, sizeof(bench_context_t));
+        result->iterations = iterations;
+        bench_start_timer(result);
+        int bench_result = bench->func(result, size);
+        bench_stop_timer(result);
+        if (bench_result < 0) return bench_result;
+
+        if (result->elapsed_ns >= min_time_ns || iterations >= (1ULL << 32)) break;
+        // Predict the number of iterations required to reach the minimum time.
+        uint64_t per_op_ns = result->elapsed_ns / iterations + 1;
+        uint64_t predicted = min_time_ns / per_op_ns + min_time_ns / per_op_ns / 5;
+        if (predicted > iterations * 100) predicted = iterations * 100;
+        if (predicted <= iterations) predicted = iterations * 2;
+        iterations = predicted;
+    }
+    return 0;
+}
+
+static int bench_run_group(const bench_definition_t *benches, size_t benches_num,
+                           const char *filter, uint64_t min_time_ns, int *is_first) {
+    for (size_t i = 0; i < benches_num; ++i) {
+        const bench_definition_t *bench = &benches[i];
+        if (filter != NULL && strstr(bench->name, filter) == NULL) continue;
+        for (size_t j = 0; j < bench->sizes_num; ++j) {
+            bench_context_t result;
+            int run_result = bench_run(bench, bench->sizes[j], min_time_ns, &result);
+            if (run_result < 0) {
+                fprintf(stderr, "Benchmark %s/%zu failed: %d\n", bench->name, bench->sizes[j], run_result);
+                return run_result;
+            }
+            printf("%s\n    {\"name\": \"%s\", \"size\": %zu, \"iterations\": %llu, "
+                   "\"ns_per_op\": %.2f, \"allocs_per_op\": %.3f}",
+                   *is_first ? "" : ",", bench->name, bench->sizes[j],
+                   (unsigned long long) result.iterations,
+                   (double) result.elapsed_ns / result.iterations,
+                   (double) result.allocations / result.iterations);
+            fflush(stdout);
+            *is_first = 0;
+        }
+    }
+    return 0;
+}
+
+static void bench_usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -f FILTER  run only benchmarks whose name contains FILTER\n"
+            "  -t MS      minimum measurement time of each benchmark (default 500)\n", name);
+}
+
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    uint64_t min_time_ms = 500;
+
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "f:t:h")) != -1) {
+        switch (opt) {
+            case 'f': filter = optarg; break;
+            case 't': min_time_ms = strtoull(optarg, NULL, 10); break;
+            default:
+                bench_usage(argv[0]);
+                return opt == 'h' ? 0 : -1;
+        }
+    }
+
+    uint64_t min_time_ns = min_time_ms * 1000000ULL;
+    int is_first = 1;
+    int result = 0;
+    printf("{\"benchmarks\": [");
+    if (result == 0) result = bench_run_group(BENCH_MESSAGES, BENCH_MESSAGES_NUM, filter, min_time_ns, &is_first);
+    if (result == 0) result = bench_run_group(BENCH_MEMBERS, BENCH_MEMBERS_NUM, filter, min_time_ns, &is_first);
+    if (result == 0) result = bench_run_group(BENCH_VECTOR_CLOCK, BENCH_VECTOR_CLOCK_NUM, filter, min_time_ns, &is_first);
+    if (result == 0) result = bench_run_group(BENCH_QUEUE, BENCH_QUEUE_NUM, filter, min_time_ns, &is_first);
+    printf("\n]}\n");
+    return result < 0 ? -1 : 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef PITTACUS_BENCH_H
+#define PITTACUS_BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "member.h"
+
+/**
+ * A benchmark context. The timer is already running when the benchmark
+ * function is invoked. Setup and cleanup steps which must not be measured
+ * should be surrounded with bench_stop_timer() / bench_start_timer().
+ */
+typedef struct bench_context {
+    uint64_t iterations;
+    uint64_t elapsed_ns;
+    uint64_t allocations;
+
+    int running;
+    uint64_t started_ns;
+    uint64_t started_allocations;
+} bench_context_t;
+
+/**
+ * The definition of a benchmark function.
+ *
+ * @param ctx a benchmark context.
+ * @param size a benchmark parameter, its meaning depends on a benchmark.
+ * @return zero on success or negative value if the benchmark failed.
+ */
+typedef int (*bench_func_t)(bench_context_t *ctx, size_t size);
+
+typedef struct bench_definition {
+    const char *name;
+    bench_func_t func;
+    size_t sizes[4];
+    size_t sizes_num;
+} bench_definition_t;
+
+void bench_start_timer(bench_context_t *ctx);
+void bench_stop_timer(bench_context_t *ctx);
+
+/**
+ * Creates a cluster member with a unique address.
+ *
+ * @param idx a unique index of the member.
+ * @param address_len sizeof(pt_sockaddr_in) or sizeof(pt_sockaddr_in6).
+ * @param result a member instance to initialize.
+ * @return zero on success or negative value if the operation failed.
+ */
+int bench_create_member(uint32_t idx, pt_socklen_t address_len, cluster_member_t *result);
+
+/** Keeps the compiler from optimizing away the computed value. */
+void bench_consume(uint64_t value);
+
+extern const bench_definition_t BENCH_MESSAGES[];
+extern const size_t BENCH_MESSAGES_NUM;
+extern const bench_definition_t BENCH_MEMBERS[];
+extern const size_t BENCH_MEMBERS_NUM;
+extern const bench_definition_t BENCH_VECTOR_CLOCK[];
+extern const size_t BENCH_VECTOR_CLOCK_NUM;
+extern const bench_definition_t BENCH_QUEUE[];
+extern const size_t BENCH_QUEUE_NUM;
+
+#endif //PITTACUS_BENCH_H
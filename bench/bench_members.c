@@ -0,0 +1,136 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdlib.h>
+#include "bench.h"
+#include "config.h"
+#include "errors.h"
+
+#define PUT_BATCH_SIZE 64
+
+typedef struct bench_member_pool {
+    cluster_member_t *members;
+    size_t size;
+} bench_member_pool_t;
+
+static int bench_member_pool_init(bench_member_pool_t *pool, size_t size) {
+    pool->members = (cluster_member_t *) calloc(size, sizeof(cluster_member_t));
+    if (pool->members == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
+    pool->size = size;
+    for (size_t i = 0; i < size; ++i) {
+        int result = bench_create_member(i, sizeof(pt_sockaddr_in), &pool->members[i]);
+        if (result < 0) return result;
+    }
+    return PITTACUS_ERR_NONE;
+}
+
+static void bench_member_pool_destroy(bench_member_pool_t *pool) {
+    for (size_t i = 0; i < pool->size; ++i) {
+        if (pool->members[i].address != NULL) cluster_member_destroy(&pool->members[i]);
+    }
+    free(pool->members);
+}
+
+static int bench_member_set_init(cluster_member_set_t *set, bench_member_pool_t *pool, size_t size) {
+    int result = cluster_member_set_init(set);
+    if (result < 0) return result;
+    return cluster_member_set_put(set, pool->members, size);
+}
+
+static int bench_member_set_put(bench_context_t *ctx, size_t size) {
+    bench_stop_timer(ctx);
+    bench_member_pool_t pool;
+    cluster_member_set_t set;
+    int result = bench_member_pool_init(&pool, size + PUT_BATCH_SIZE);
+    if (result == 0) result = bench_member_set_init(&set, &pool, size);
+    if (result < 0) return result;
+
+    uint64_t done = 0;
+    while (done < ctx->iterations && result >= 0) {
+        uint64_t batch = ctx->iterations - done;
+        if (batch > PUT_BATCH_SIZE) batch = PUT_BATCH_SIZE;
+
+        // Each put inserts a member which doesn't exist in the set of the given size.
+        bench_start_timer(ctx);
+        for (uint64_t i = 0; i < batch && result >= 0; ++i) {
+            result = cluster_member_set_put(&set, &pool.members[size + i], 1);
+        }
+        bench_stop_timer(ctx);
+
+        for (uint64_t i = 0; i < batch; ++i) {
+            cluster_member_t *member = &pool.members[size + i];
+            cluster_member_set_remove_by_addr(&set, member->address, member->address_len);
+        }
+        done += batch;
+    }
+
+    cluster_member_set_destroy(&set);
+    bench_member_pool_destroy(&pool);
+    return result;
+}
+
+static int bench_member_set_find_by_addr(bench_context_t *ctx, size_t size) {
+    bench_stop_timer(ctx);
+    bench_member_pool_t pool;
+    cluster_member_set_t set;
+    int result = bench_member_pool_init(&pool, size);
+    if (result == 0) result = bench_member_set_init(&set, &pool, size);
+    if (result < 0) return result;
+    bench_start_timer(ctx);
+
+    size_t idx = 0;
+    for (uint64_t i = 0; i < ctx->iterations; ++i) {
+        // Walk through members in a pseudo random order.
+        idx = (idx + 7919) % size;
+        const cluster_member_t *member = &pool.members[idx];
+        cluster_member_t *found = cluster_member_set_find_by_addr(&set, member->address, member->address_len);
+        if (found == NULL) result = PITTACUS_ERR_NOT_FOUND;
+    }
+
+    bench_stop_timer(ctx);
+    cluster_member_set_destroy(&set);
+    bench_member_pool_destroy(&pool);
+    return result;
+}
+
+static int bench_member_set_random_members(bench_context_t *ctx, size_t size) {
+    bench_stop_timer(ctx);
+    bench_member_pool_t pool;
+    cluster_member_set_t set;
+    int result = bench_member_pool_init(&pool, size);
+    if (result == 0) result = bench_member_set_init(&set, &pool, size);
+    if (result < 0) return result;
+    cluster_member_t *reservoir[MESSAGE_RUMOR_FACTOR];
+    bench_start_timer(ctx);
+
+    for (uint64_t i = 0; i < ctx->iterations; ++i) {
+        size_t chosen = cluster_member_set_random_members(&set, reservoir, MESSAGE_RUMOR_FACTOR);
+        bench_consume(chosen);
+    }
+
+    bench_stop_timer(ctx);
+    cluster_member_set_destroy(&set);
+    bench_member_pool_destroy(&pool);
+    return result;
+}
+
+#define MEMBER_SET_SIZES { 16, 256, 4096 }, 3
+
+const bench_definition_t BENCH_MEMBERS[] = {
+    { "cluster_member_set_put", &bench_member_set_put, MEMBER_SET_SIZES },
+    { "cluster_member_set_find_by_addr", &bench_member_set_find_by_addr, MEMBER_SET_SIZES },
+    { "cluster_member_set_random_members", &bench_member_set_random_members, MEMBER_SET_SIZES }
+};
+const size_t BENCH_MEMBERS_NUM = sizeof(BENCH_MEMBERS) / sizeof(bench_definition_t);
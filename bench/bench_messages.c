@@ -0,0 +1,302 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string.h>
+#include "bench.h"
+#include "messages.h"
+#include "errors.h"
+
+#define RETURN_IF_FAILED(r) if ((r) < 0) return (r);
+
+static int bench_hello_encode(bench_context_t *ctx, size_t address_len) {
+    bench_stop_timer(ctx);
+    cluster_member_t member;
+    RETURN_IF_FAILED(bench_create_member(1, address_len, &member));
+    message_hello_t msg;
+    message_header_init(&msg.header, MESSAGE_HELLO_TYPE, 1);
+    msg.this_member = &member;
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    int result = 0;
+    bench_start_timer(ctx);
+
+    for (uint64_t i = 0; i < ctx->iterations && result >= 0; ++i) {
+        msg.header.sequence_num = i;
+        result = message_hello_encode(&msg, buffer, MESSAGE_MAX_SIZE);
+    }
+
+    bench_stop_timer(ctx);
+    cluster_member_destroy(&member);
+    return result;
+}
+
+static int bench_hello_decode(bench_context_t *ctx, size_t address_len) {
+    bench_stop_timer(ctx);
+    cluster_member_t member;
+    RETURN_IF_FAILED(bench_create_member(1, address_len, &member));
+    message_hello_t msg;
+    message_header_init(&msg.header, MESSAGE_HELLO_TYPE, 1);
+    msg.this_member = &member;
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    int encode_result = message_hello_encode(&msg, buffer, MESSAGE_MAX_SIZE);
+    cluster_member_destroy(&member);
+    RETURN_IF_FAILED(encode_result);
+    int result = 0;
+    bench_start_timer(ctx);
+
+    for (uint64_t i = 0; i < ctx->iterations && result >= 0; ++i) {
+        message_hello_t out_msg;
+        result = message_hello_decode(buffer, encode_result, &out_msg);
+        if (result >= 0) message_hello_destroy(&out_msg);
+    }
+    return result;
+}
+
+static int bench_welcome_encode(bench_context_t *ctx, size_t address_len) {
+    bench_stop_timer(ctx);
+    cluster_member_t member;
+    RETURN_IF_FAILED(bench_create_member(1, address_len, &member));
+    message_welcome_t msg;
+    message_header_init(&msg.header, MESSAGE_WELCOME_TYPE, 1);
+    msg.hello_sequence_num = 1;
+    msg.this_member = &member;
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    int result = 0;
+    bench_start_timer(ctx);
+
+    for (uint64_t i = 0; i < ctx->iterations && result >= 0; ++i) {
+        msg.header.sequence_num = i;
+        result = message_welcome_encode(&msg, buffer, MESSAGE_MAX_SIZE);
+    }
+
+    bench_stop_timer(ctx);
+    cluster_member_destroy(&member);
+    return result;
+}
+
+static int bench_welcome_decode(bench_context_t *ctx, size_t address_len) {
+    bench_stop_timer(ctx);
+    cluster_member_t member;
+    RETURN_IF_FAILED(bench_create_member(1, address_len, &member));
+    message_welcome_t msg;
+    message_header_init(&msg.header, MESSAGE_WELCOME_TYPE, 1);
+    msg.hello_sequence_num = 1;
+    msg.this_member = &member;
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    int encode_result = message_welcome_encode(&msg, buffer, MESSAGE_MAX_SIZE);
+    cluster_member_destroy(&member);
+    RETURN_IF_FAILED(encode_result);
+    int result = 0;
+    bench_start_timer(ctx);
+
+    for (uint64_t i = 0; i < ctx->iterations && result >= 0; ++i) {
+        message_welcome_t out_msg;
+        result = message_welcome_decode(buffer, encode_result, &out_msg);
+        if (result >= 0) message_welcome_destroy(&out_msg);
+    }
+    return result;
+}
+
+static int bench_member_list_prepare(size_t members_n, cluster_member_t *members, message_member_list_t *msg) {
+    for (size_t i = 0; i < members_n; ++i) {
+        RETURN_IF_FAILED(bench_create_member(i, sizeof(pt_sockaddr_in), &members[i]));
+    }
+    message_header_init(&msg->header, MESSAGE_MEMBER_LIST_TYPE, 1);
+    msg->members_n = members_n;
+    msg->members = members;
+    return PITTACUS_ERR_NONE;
+}
+
+static void bench_member_list_cleanup(size_t members_n, cluster_member_t *members) {
+    for (size_t i = 0; i < members_n; ++i) cluster_member_destroy(&members[i]);
+}
+
+static int bench_member_list_encode(bench_context_t *ctx, size_t members_n) {
+    bench_stop_timer(ctx);
+    cluster_member_t members[members_n];
+    message_member_list_t msg;
+    RETURN_IF_FAILED(bench_member_list_prepare(members_n, members, &msg));
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    int result = 0;
+    bench_start_timer(ctx);
+
+    for (uint64_t i = 0; i < ctx->iterations && result >= 0; ++i) {
+        msg.header.sequence_num = i;
+        result = message_member_list_encode(&msg, buffer, MESSAGE_MAX_SIZE);
+    }
+
+    bench_stop_timer(ctx);
+    bench_member_list_cleanup(members_n, members);
+    return result;
+}
+
+static int bench_member_list_decode(bench_context_t *ctx, size_t members_n) {
+    bench_stop_timer(ctx);
+    cluster_member_t members[members_n];
+    message_member_list_t msg;
+    RETURN_IF_FAILED(bench_member_list_prepare(members_n, members, &msg));
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    int encode_result = message_member_list_encode(&msg, buffer, MESSAGE_MAX_SIZE);
+    bench_member_list_cleanup(members_n, members);
+    RETURN_IF_FAILED(encode_result);
+    int result = 0;
+    bench_start_timer(ctx);
+
+    for (uint64_t i = 0; i < ctx->iterations && result >= 0; ++i) {
+        message_member_list_t out_msg;
+        result = message_member_list_decode(buffer, encode_result, &out_msg);
+        if (result >= 0) message_member_list_destroy(&out_msg);
+    }
+    return result;
+}
+
+static void bench_data_prepare(size_t data_size, uint8_t *data, message_data_t *msg) {
+    memset(data, 0xAB, data_size);
+    message_header_init(&msg->header, MESSAGE_DATA_TYPE, 1);
+    msg->data_version.member_id = 0x0102030405060708ULL;
+    msg->data_version.sequence_number = 1;
+    msg->data = data;
+    msg->data_size = data_size;
+}
+
+static int bench_data_encode(bench_context_t *ctx, size_t data_size) {
+    bench_stop_timer(ctx);
+    uint8_t data[data_size];
+    message_data_t msg;
+    bench_data_prepare(data_size, data, &msg);
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    int result = 0;
+    bench_start_timer(ctx);
+
+    for (uint64_t i = 0; i < ctx->iterations && result >= 0; ++i) {
+        msg.header.sequence_num = i;
+        result = message_data_encode(&msg, buffer, MESSAGE_MAX_SIZE);
+    }
+    return result;
+}
+
+static int bench_data_decode(bench_context_t *ctx, size_t data_size) {
+    bench_stop_timer(ctx);
+    uint8_t data[data_size];
+    message_data_t msg;
+    bench_data_prepare(data_size, data, &msg);
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    int encode_result = message_data_encode(&msg, buffer, MESSAGE_MAX_SIZE);
+    RETURN_IF_FAILED(encode_result);
+    int result = 0;
+    bench_start_timer(ctx);
+
+    for (uint64_t i = 0; i < ctx->iterations && result >= 0; ++i) {
+        message_data_t out_msg;
+        result = message_data_decode(buffer, encode_result, &out_msg);
+        bench_consume(out_msg.data_size);
+    }
+    return result;
+}
+
+static int bench_ack_encode(bench_context_t *ctx, size_t size) {
+    message_ack_t msg;
+    message_header_init(&msg.header, MESSAGE_ACK_TYPE, 1);
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    int result = 0;
+
+    for (uint64_t i = 0; i < ctx->iterations && result >= 0; ++i) {
+        msg.ack_sequence_num = i;
+        result = message_ack_encode(&msg, buffer, MESSAGE_MAX_SIZE);
+    }
+    return result;
+}
+
+static int bench_ack_decode(bench_context_t *ctx, size_t size) {
+    bench_stop_timer(ctx);
+    message_ack_t msg;
+    message_header_init(&msg.header, MESSAGE_ACK_TYPE, 1);
+    msg.ack_sequence_num = 1;
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    int encode_result = message_ack_encode(&msg, buffer, MESSAGE_MAX_SIZE);
+    RETURN_IF_FAILED(encode_result);
+    int result = 0;
+    bench_start_timer(ctx);
+
+    for (uint64_t i = 0; i < ctx->iterations && result >= 0; ++i) {
+        message_ack_t out_msg;
+        result = message_ack_decode(buffer, encode_result, &out_msg);
+        bench_consume(out_msg.ack_sequence_num);
+    }
+    return result;
+}
+
+static void bench_status_prepare(size_t clock_size, message_status_t *msg) {
+    message_header_init(&msg->header, MESSAGE_STATUS_TYPE, 1);
+    vector_clock_init(&msg->data_version);
+    for (size_t i = 0; i < clock_size; ++i) {
+        msg->data_version.records[i].member_id = i + 1;
+        msg->data_version.records[i].sequence_number = i + 1;
+    }
+    msg->data_version.size = clock_size;
+}
+
+static int bench_status_encode(bench_context_t *ctx, size_t clock_size) {
+    bench_stop_timer(ctx);
+    message_status_t msg;
+    bench_status_prepare(clock_size, &msg);
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    int result = 0;
+    bench_start_timer(ctx);
+
+    for (uint64_t i = 0; i < ctx->iterations && result >= 0; ++i) {
+        msg.header.sequence_num = i;
+        result = message_status_encode(&msg, buffer, MESSAGE_MAX_SIZE);
+    }
+    return result;
+}
+
+static int bench_status_decode(bench_context_t *ctx, size_t clock_size) {
+    bench_stop_timer(ctx);
+    message_status_t msg;
+    bench_status_prepare(clock_size, &msg);
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    int encode_result = message_status_encode(&msg, buffer, MESSAGE_MAX_SIZE);
+    RETURN_IF_FAILED(encode_result);
+    int result = 0;
+    bench_start_timer(ctx);
+
+    for (uint64_t i = 0; i < ctx->iterations && result >= 0; ++i) {
+        message_status_t out_msg;
+        result = message_status_decode(buffer, encode_result, &out_msg);
+        bench_consume(out_msg.data_version.size);
+    }
+    return result;
+}
+
+#define ADDRESS_SIZES { sizeof(pt_sockaddr_in), sizeof(pt_sockaddr_in6) }, 2
+#define MEMBER_LIST_SIZES { 1, 2, 3 }, 3
+#define DATA_SIZES { 16, 128, 480 }, 3
+#define STATUS_SIZES { 1, 10, MAX_VECTOR_SIZE }, 3
+
+const bench_definition_t BENCH_MESSAGES[] = {
+    { "message_hello_encode", &bench_hello_encode, ADDRESS_SIZES },
+    { "message_hello_decode", &bench_hello_decode, ADDRESS_SIZES },
+    { "message_welcome_encode", &bench_welcome_encode, ADDRESS_SIZES },
+    { "message_welcome_decode", &bench_welcome_decode, ADDRESS_SIZES },
+    { "message_member_list_encode", &bench_member_list_encode, MEMBER_LIST_SIZES },
+    { "message_member_list_decode", &bench_member_list_decode, MEMBER_LIST_SIZES },
+    { "message_data_encode", &bench_data_encode, DATA_SIZES },
+    { "message_data_decode", &bench_data_decode, DATA_SIZES },
+    { "message_ack_encode", &bench_ack_encode, { 1 }, 1 },
+    { "message_ack_decode", &bench_ack_decode, { 1 }, 1 },
+    { "message_status_encode", &bench_status_encode, STATUS_SIZES },
+    { "message_status_decode", &bench_status_decode, STATUS_SIZES }
+};
+const size_t BENCH_MESSAGES_NUM = sizeof(BENCH_MESSAGES) / sizeof(bench_definition_t);
@@ -0,0 +1,275 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string.h>
+#include "bench.h"
+#include "gossip.h"
+#include "messages.h"
+#include "errors.h"
+#include "sim_platform.h"
+
+/*
+ * Benchmarks of the outbound message queue. A gossip instance runs on top of
+ * the simulated platform, so no system calls are involved. The size of each
+ * benchmark is the number of envelopes that wait for acknowledgement in the
+ * outbound queue during the measurement.
+ */
+
+#define QUEUE_MEMBERS_NUM 64
+#define QUEUE_NODE_IDX 0
+#define QUEUE_BOOTSTRAP_IDX (QUEUE_MEMBERS_NUM + 1)
+#define QUEUE_BATCH_SIZE 16
+#define QUEUE_MAX_ACKS (QUEUE_BATCH_SIZE * MESSAGE_RUMOR_FACTOR)
+#define QUEUE_PAYLOAD_SIZE 64
+
+#define RETURN_IF_FAILED(r) if ((r) < 0) return (r);
+
+typedef struct bench_ack {
+    pt_sockaddr_in sender;
+    uint8_t buffer[sizeof(message_header_t) + sizeof(uint32_t)];
+    size_t buffer_size;
+} bench_ack_t;
+
+typedef struct bench_queue {
+    pittacus_gossip_t *gossip;
+    uint8_t payload[QUEUE_PAYLOAD_SIZE];
+    bench_ack_t acks[QUEUE_MAX_ACKS];
+    size_t acks_num;
+} bench_queue_t;
+
+static void bench_queue_drain_network() {
+    sim_event_t event;
+    while (sim_next_event(&event) == 0);
+}
+
+static int bench_queue_bootstrap(bench_queue_t *self) {
+    pt_sockaddr_in bootstrap_addr;
+    sim_socket_address(QUEUE_BOOTSTRAP_IDX, &bootstrap_addr);
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    for (uint32_t i = 1; i <= QUEUE_MEMBERS_NUM; ++i) {
+        // Open the member's socket, so that messages sent to it are retained.
+        pt_sockaddr_in member_addr;
+        sim_socket_address(i, &member_addr);
+        if (pt_socket_datagram((const pt_sockaddr_storage *) &member_addr, sizeof(pt_sockaddr_in)) < 0) {
+            return PITTACUS_ERR_INIT_FAILED;
+        }
+
+        cluster_member_t member;
+        RETURN_IF_FAILED(cluster_member_init(&member, (const pt_sockaddr_storage *) &member_addr,
+                                             sizeof(pt_sockaddr_in)));
+        message_member_list_t msg;
+        message_header_init(&msg.header, MESSAGE_MEMBER_LIST_TYPE, i);
+        msg.members_n = 1;
+        msg.members = &member;
+        int encode_result = message_member_list_encode(&msg, buffer, MESSAGE_MAX_SIZE);
+        cluster_member_destroy(&member);
+        RETURN_IF_FAILED(encode_result);
+
+        RETURN_IF_FAILED(sim_inject(QUEUE_NODE_IDX, &bootstrap_addr, buffer, encode_result));
+        RETURN_IF_FAILED(pittacus_gossip_process_receive(self->gossip));
+    }
+    RETURN_IF_FAILED(pittacus_gossip_process_send(self->gossip));
+    bench_queue_drain_network();
+    return PITTACUS_ERR_NONE;
+}
+
+static int bench_queue_init(bench_queue_t *self) {
+    memset(self, 0, sizeof(bench_queue_t));
+    sim_network_config_t network = { .latency_us = 0, .jitter_us = 0, .loss_rate = 0.0 };
+    RETURN_IF_FAILED(sim_platform_init(QUEUE_BOOTSTRAP_IDX + 1, 1, &network));
+
+    pt_sockaddr_in self_addr_in;
+    sim_socket_address(QUEUE_NODE_IDX, &self_addr_in);
+    pittacus_addr_t self_addr = {
+        .addr = (const pt_sockaddr *) &self_addr_in,
+        .addr_len = sizeof(pt_sockaddr_in)
+    };
+    self->gossip = pittacus_gossip_create(&self_addr, NULL, NULL);
+    if (self->gossip == NULL) return PITTACUS_ERR_INIT_FAILED;
+    RETURN_IF_FAILED(pittacus_gossip_join(self->gossip, NULL, 0));
+    return bench_queue_bootstrap(self);
+}
+
+static void bench_queue_destroy(bench_queue_t *self) {
+    if (self->gossip != NULL) pittacus_gossip_destroy(self->gossip);
+    sim_platform_destroy();
+}
+
+/**
+ * Reads all messages that have been delivered to members and prepares
+ * acknowledgements for them.
+ */
+static int bench_queue_collect_acks(bench_queue_t *self) {
+    self->acks_num = 0;
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    for (uint32_t i = 1; i <= QUEUE_MEMBERS_NUM; ++i) {
+        pt_sockaddr_storage addr;
+        pt_socklen_t addr_len = sizeof(pt_sockaddr_storage);
+        while (pt_recv_from(i, buffer, MESSAGE_MAX_SIZE, &addr, &addr_len) > 0) {
+            if (self->acks_num >= QUEUE_MAX_ACKS) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+            bench_ack_t *ack = &self->acks[self->acks_num++];
+            sim_socket_address(i, &ack->sender);
+
+            message_ack_t msg;
+            message_header_init(&msg.header, MESSAGE_ACK_TYPE, 0);
+            msg.ack_sequence_num = uint32_decode(buffer + sizeof(message_header_t) - sizeof(uint32_t));
+            int encode_result = message_ack_encode(&msg, ack->buffer, sizeof(ack->buffer));
+            RETURN_IF_FAILED(encode_result);
+            ack->buffer_size = encode_result;
+        }
+    }
+    return PITTACUS_ERR_NONE;
+}
+
+static void bench_queue_discard_delivered() {
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    for (uint32_t i = 1; i <= QUEUE_MEMBERS_NUM; ++i) {
+        pt_sockaddr_storage addr;
+        pt_socklen_t addr_len = sizeof(pt_sockaddr_storage);
+        while (pt_recv_from(i, buffer, MESSAGE_MAX_SIZE, &addr, &addr_len) > 0);
+    }
+}
+
+static int bench_queue_inject_acks(bench_queue_t *self) {
+    for (size_t i = 0; i < self->acks_num; ++i) {
+        bench_ack_t *ack = &self->acks[i];
+        RETURN_IF_FAILED(sim_inject(QUEUE_NODE_IDX, &ack->sender, ack->buffer, ack->buffer_size));
+    }
+    return PITTACUS_ERR_NONE;
+}
+
+static int bench_queue_send_data(bench_queue_t *self, size_t messages_num) {
+    for (size_t i = 0; i < messages_num; ++i) {
+        memcpy(self->payload, &i, sizeof(size_t));
+        RETURN_IF_FAILED(pittacus_gossip_send_data(self->gossip, self->payload, QUEUE_PAYLOAD_SIZE));
+    }
+    return PITTACUS_ERR_NONE;
+}
+
+static int bench_queue_flush(bench_queue_t *self) {
+    RETURN_IF_FAILED(pittacus_gossip_process_send(self->gossip));
+    bench_queue_drain_network();
+    return PITTACUS_ERR_NONE;
+}
+
+static int bench_queue_process_acks(bench_queue_t *self, size_t acks_num) {
+    for (size_t i = 0; i < acks_num; ++i) {
+        RETURN_IF_FAILED(pittacus_gossip_process_receive(self->gossip));
+    }
+    return PITTACUS_ERR_NONE;
+}
+
+static int bench_queue_prepare(bench_queue_t *self, size_t pending_num) {
+    RETURN_IF_FAILED(bench_queue_init(self));
+    // Fill in the queue with envelopes which are never going to be acknowledged.
+    RETURN_IF_FAILED(bench_queue_send_data(self, pending_num / MESSAGE_RUMOR_FACTOR));
+    RETURN_IF_FAILED(bench_queue_flush(self));
+    bench_queue_discard_delivered();
+    return PITTACUS_ERR_NONE;
+}
+
+static int bench_queue_enqueue(bench_context_t *ctx, size_t pending_num) {
+    bench_stop_timer(ctx);
+    bench_queue_t queue;
+    int result = bench_queue_prepare(&queue, pending_num);
+
+    uint64_t done = 0;
+    while (done < ctx->iterations && result >= 0) {
+        uint64_t batch = ctx->iterations - done;
+        if (batch > QUEUE_BATCH_SIZE) batch = QUEUE_BATCH_SIZE;
+
+        bench_start_timer(ctx);
+        result = bench_queue_send_data(&queue, batch);
+        bench_stop_timer(ctx);
+
+        // Acknowledge all new envelopes to restore the queue size.
+        if (result == 0) result = bench_queue_flush(&queue);
+        if (result == 0) result = bench_queue_collect_acks(&queue);
+        if (result == 0) result = bench_queue_inject_acks(&queue);
+        if (result == 0) result = bench_queue_process_acks(&queue, queue.acks_num);
+        done += batch;
+    }
+
+    bench_queue_destroy(&queue);
+    return result;
+}
+
+static int bench_queue_send(bench_context_t *ctx, size_t pending_num) {
+    bench_stop_timer(ctx);
+    bench_queue_t queue;
+    int result = bench_queue_prepare(&queue, pending_num);
+
+    uint64_t done = 0;
+    while (done < ctx->iterations && result >= 0) {
+        // Each operation is a single envelope written to the network.
+        if (result == 0) result = bench_queue_send_data(&queue, QUEUE_BATCH_SIZE);
+
+        bench_start_timer(ctx);
+        if (result == 0) result = pittacus_gossip_process_send(queue.gossip);
+        bench_stop_timer(ctx);
+        if (result > 0) {
+            done += result;
+            result = 0;
+        }
+
+        bench_queue_drain_network();
+        if (result == 0) result = bench_queue_collect_acks(&queue);
+        if (result == 0) result = bench_queue_inject_acks(&queue);
+        if (result == 0) result = bench_queue_process_acks(&queue, queue.acks_num);
+    }
+    // The number of iterations is adjusted to the number of envelopes actually sent.
+    ctx->iterations = done;
+
+    bench_queue_destroy(&queue);
+    return result;
+}
+
+static int bench_queue_ack(bench_context_t *ctx, size_t pending_num) {
+    bench_stop_timer(ctx);
+    bench_queue_t queue;
+    int result = bench_queue_prepare(&queue, pending_num);
+
+    uint64_t done = 0;
+    while (done < ctx->iterations && result >= 0) {
+        if (result == 0) result = bench_queue_send_data(&queue, QUEUE_BATCH_SIZE);
+        if (result == 0) result = bench_queue_flush(&queue);
+        if (result == 0) result = bench_queue_collect_acks(&queue);
+        if (result == 0) result = bench_queue_inject_acks(&queue);
+        if (result < 0) break;
+
+        uint64_t acks_num = ctx->iterations - done;
+        if (acks_num > queue.acks_num) acks_num = queue.acks_num;
+
+        bench_start_timer(ctx);
+        result = bench_queue_process_acks(&queue, acks_num);
+        bench_stop_timer(ctx);
+
+        // Process remaining acknowledgements that didn't fit into the measurement.
+        if (result == 0) result = bench_queue_process_acks(&queue, queue.acks_num - acks_num);
+        done += acks_num;
+    }
+
+    bench_queue_destroy(&queue);
+    return result;
+}
+
+#define QUEUE_SIZES { 0, 48, 192 }, 3
+
+const bench_definition_t BENCH_QUEUE[] = {
+    { "outbound_queue_enqueue", &bench_queue_enqueue, QUEUE_SIZES },
+    { "outbound_queue_send", &bench_queue_send, QUEUE_SIZES },
+    { "outbound_queue_ack", &bench_queue_ack, QUEUE_SIZES }
+};
+const size_t BENCH_QUEUE_NUM = sizeof(BENCH_QUEUE) / sizeof(bench_definition_t);
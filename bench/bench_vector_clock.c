@@ -0,0 +1,91 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "bench.h"
+#include "vector_clock.h"
+
+static void bench_vector_clock_prepare(vector_clock_t *clock, size_t size, uint32_t seq_num_offset) {
+    vector_clock_init(clock);
+    for (size_t i = 0; i < size; ++i) {
+        clock->records[i].member_id = (size - i) * 0x9E3779B97F4A7C15ULL;
+        clock->records[i].sequence_number = i + seq_num_offset;
+    }
+    clock->size = size;
+    clock->current_idx = size % MAX_VECTOR_SIZE;
+}
+
+static int bench_vector_clock_compare(bench_context_t *ctx, size_t size) {
+    bench_stop_timer(ctx);
+    vector_clock_t first;
+    vector_clock_t second;
+    bench_vector_clock_prepare(&first, size, 1);
+    bench_vector_clock_prepare(&second, size, 1);
+    // Make the last record of the second clock newer.
+    second.records[size - 1].sequence_number++;
+    bench_start_timer(ctx);
+
+    for (uint64_t i = 0; i < ctx->iterations; ++i) {
+        bench_consume(vector_clock_compare(&first, &second, PT_FALSE));
+    }
+    return 0;
+}
+
+static int bench_vector_clock_merge(bench_context_t *ctx, size_t size) {
+    bench_stop_timer(ctx);
+    vector_clock_t initial;
+    vector_clock_t second;
+    // The first half of the records is newer in the first clock, the second
+    // half is newer in the second clock.
+    bench_vector_clock_prepare(&initial, size, 1);
+    bench_vector_clock_prepare(&second, size, 1);
+    for (size_t i = 0; i < size; ++i) {
+        if (i < size / 2) {
+            initial.records[i].sequence_number++;
+        } else {
+            second.records[i].sequence_number++;
+        }
+    }
+    vector_clock_t first;
+    bench_start_timer(ctx);
+
+    for (uint64_t i = 0; i < ctx->iterations; ++i) {
+        vector_clock_copy(&first, &initial);
+        bench_consume(vector_clock_compare(&first, &second, PT_TRUE));
+    }
+    return 0;
+}
+
+static int bench_vector_clock_compare_with_record(bench_context_t *ctx, size_t size) {
+    bench_stop_timer(ctx);
+    vector_clock_t clock;
+    bench_vector_clock_prepare(&clock, size, 1);
+    vector_record_t record = clock.records[size - 1];
+    record.sequence_number++;
+    bench_start_timer(ctx);
+
+    for (uint64_t i = 0; i < ctx->iterations; ++i) {
+        bench_consume(vector_clock_compare_with_record(&clock, &record, PT_FALSE));
+    }
+    return 0;
+}
+
+#define VECTOR_CLOCK_SIZES { 1, 5, MAX_VECTOR_SIZE }, 3
+
+const bench_definition_t BENCH_VECTOR_CLOCK[] = {
+    { "vector_clock_compare", &bench_vector_clock_compare, VECTOR_CLOCK_SIZES },
+    { "vector_clock_merge", &bench_vector_clock_merge, VECTOR_CLOCK_SIZES },
+    { "vector_clock_compare_with_record", &bench_vector_clock_compare_with_record, VECTOR_CLOCK_SIZES }
+};
+const size_t BENCH_VECTOR_CLOCK_NUM = sizeof(BENCH_VECTOR_CLOCK) / sizeof(bench_definition_t);
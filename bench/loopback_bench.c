@@ -0,0 +1,616 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <arpa/inet.h>
+#include "gossip.h"
+#include "config.h"
+#include "errors.h"
+#include "member.h"
+#include "messages.h"
+
+/*
+ * End-to-end dissemination benchmark. N nodes run in a single process and
+ * talk to each other through real UDP sockets bound to 127.0.0.1. The first
+ * node is a seed node, every other node joins the cluster by sending Hello
+ * to the seed, just like demo_node does. Then payloads are injected from
+ * random nodes at the configured rate and the time from
+ * pittacus_gossip_send_data() to the data_receiver invocation on every node
+ * is recorded.
+ *
+ * A real seed node notifies every known member about each newcomer, which
+ * makes the join phase quadratic and overflows the seed's outbound queue long
+ * before the cluster reaches 1000 nodes. That's why the seed's side of the
+ * handshake is served by the benchmark itself: Hellos are answered on behalf
+ * of the seed node with a Welcome followed by a random partial view of the
+ * cluster, the same way the simulator bootstraps its nodes.
+ */
+
+#define MAX_RUNS 16
+#define MAX_RECEIVE_BATCH 64
+#define MAX_POLL_INTERVAL_MS 100
+#define MEMBER_LIST_CHUNK ((MESSAGE_MAX_SIZE - sizeof(message_header_t) - sizeof(uint16_t)) / CLUSTER_MEMBER_IPV4_SIZE)
+
+typedef struct bench_options {
+    uint32_t nodes_nums[MAX_RUNS];
+    size_t runs_num;
+    uint32_t messages_num;
+    double rate;
+    uint32_t payload_size;
+    uint32_t view_size;
+    uint32_t join_batch;
+    uint32_t join_timeout_ms;
+    uint32_t settle_ms;
+    uint32_t drain_ms;
+    uint32_t seed;
+} bench_options_t;
+
+typedef struct bench_cluster bench_cluster_t;
+
+typedef struct bench_node {
+    bench_cluster_t *cluster;
+    uint32_t idx;
+    pittacus_gossip_t *gossip;
+    uint64_t next_tick_ms;
+    uint64_t cpu_ns;
+} bench_node_t;
+
+typedef struct bench_message {
+    uint64_t sent_ns;
+    uint64_t last_delivery_ns;
+    uint32_t delivered_num;
+} bench_message_t;
+
+struct bench_cluster {
+    const bench_options_t *options;
+    uint32_t nodes_num;
+    bench_node_t *nodes;
+    cluster_member_t *members;
+    struct sockaddr_in *addresses;
+    int bootstrap_fd;
+    struct pollfd *poll_fds; // one per node plus the bootstrap socket.
+
+    bench_message_t *messages;
+    uint32_t messages_sent;
+    uint8_t *deliveries; // messages_num x nodes_num matrix of delivery counters.
+    uint64_t *latencies;
+    size_t latencies_num;
+    uint64_t duplicates;
+    uint64_t errors;
+};
+
+typedef struct bench_payload {
+    uint32_t message_idx;
+    uint64_t sent_ns;
+} __attribute__((packed)) bench_payload_t;
+
+static uint64_t bench_clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t bench_now_ns() {
+    return bench_clock_ns(CLOCK_MONOTONIC);
+}
+
+static uint64_t bench_now_ms() {
+    return bench_now_ns() / 1000000;
+}
+
+static void bench_data_receiver(void *context, pittacus_gossip_t *gossip,
+                                const uint8_t *buffer, size_t buffer_size) {
+    uint64_t now_ns = bench_now_ns();
+    bench_node_t *node = (bench_node_t *) context;
+    bench_cluster_t *cluster = node->cluster;
+    if (buffer_size < sizeof(bench_payload_t)) return;
+
+    bench_payload_t payload;
+    memcpy(&payload, buffer, sizeof(bench_payload_t));
+    if (payload.message_idx >= cluster->messages_sent) return;
+
+    uint8_t *delivery = &cluster->deliveries[(size_t) payload.message_idx * cluster->nodes_num + node->idx];
+    if (*delivery > 0) {
+        ++cluster->duplicates;
+        if (*delivery < UINT8_MAX) ++(*delivery);
+        return;
+    }
+    *delivery = 1;
+
+    bench_message_t *message = &cluster->messages[payload.message_idx];
+    ++message->delivered_num;
+    message->last_delivery_ns = now_ns;
+    cluster->latencies[cluster->latencies_num++] = now_ns - payload.sent_ns;
+}
+
+static void bench_cpu_start(uint64_t *started_ns) {
+    *started_ns = bench_clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+static void bench_cpu_stop(bench_node_t *node, uint64_t started_ns) {
+    node->cpu_ns += bench_clock_ns(CLOCK_THREAD_CPUTIME_ID) - started_ns;
+}
+
+static void bench_node_send(bench_cluster_t *cluster, bench_node_t *node) {
+    uint64_t started_ns = 0;
+    bench_cpu_start(&started_ns);
+    // Write failures (e.g. full socket buffers) are expected under load.
+    if (pittacus_gossip_process_send(node->gossip) < 0) ++cluster->errors;
+    bench_cpu_stop(node, started_ns);
+}
+
+static void bench_node_receive(bench_cluster_t *cluster, bench_node_t *node) {
+    uint64_t started_ns = 0;
+    bench_cpu_start(&started_ns);
+    for (int i = 0; i < MAX_RECEIVE_BATCH; ++i) {
+        int result = pittacus_gossip_process_receive(node->gossip);
+        if (result == PITTACUS_ERR_READ_FAILED) break;
+    }
+    bench_cpu_stop(node, started_ns);
+    bench_node_send(cluster, node);
+}
+
+static int bench_bootstrap_send(bench_cluster_t *cluster, const uint8_t *buffer, int buffer_size,
+                                const struct sockaddr_in *recipient) {
+    if (buffer_size < 0) return buffer_size;
+    ssize_t result = sendto(cluster->bootstrap_fd, buffer, buffer_size, 0,
+                            (const struct sockaddr *) recipient, sizeof(struct sockaddr_in));
+    return result < 0 ? PITTACUS_ERR_WRITE_FAILED : PITTACUS_ERR_NONE;
+}
+
+static int bench_bootstrap_welcome(bench_cluster_t *cluster, uint32_t node_idx, uint32_t hello_sequence_num) {
+    const struct sockaddr_in *recipient = &cluster->addresses[node_idx];
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+
+    message_welcome_t welcome_msg;
+    message_header_init(&welcome_msg.header, MESSAGE_WELCOME_TYPE, 0);
+    welcome_msg.hello_sequence_num = hello_sequence_num;
+    welcome_msg.this_member = &cluster->members[0];
+    int result = bench_bootstrap_send(cluster, buffer,
+                                      message_welcome_encode(&welcome_msg, buffer, MESSAGE_MAX_SIZE), recipient);
+    if (result < 0) return result;
+
+    // Choose distinct random members excluding the seed node and the newcomer itself.
+    uint32_t view_size = cluster->options->view_size;
+    if (view_size > cluster->nodes_num - 2) view_size = cluster->nodes_num - 2;
+    cluster_member_t view[view_size];
+    uint32_t chosen[view_size];
+    for (uint32_t i = 0; i < view_size; ++i) {
+        uint32_t candidate = 0;
+        int is_valid = 0;
+        while (!is_valid) {
+            candidate = 1 + random() % (cluster->nodes_num - 1);
+            is_valid = candidate != node_idx;
+            for (uint32_t j = 0; j < i && is_valid; ++j) {
+                if (chosen[j] == candidate) is_valid = 0;
+            }
+        }
+        chosen[i] = candidate;
+        view[i] = cluster->members[candidate];
+    }
+
+    // Loopback preserves the order of datagrams, so the newcomer is already
+    // connected by the time these Member List messages arrive.
+    for (uint32_t offset = 0; offset < view_size && result == 0; offset += MEMBER_LIST_CHUNK) {
+        message_member_list_t member_list_msg;
+        message_header_init(&member_list_msg.header, MESSAGE_MEMBER_LIST_TYPE, offset + 1);
+        uint32_t remaining = view_size - offset;
+        member_list_msg.members_n = remaining > MEMBER_LIST_CHUNK ? MEMBER_LIST_CHUNK : remaining;
+        member_list_msg.members = view + offset;
+        result = bench_bootstrap_send(cluster, buffer,
+                                      message_member_list_encode(&member_list_msg, buffer, MESSAGE_MAX_SIZE),
+                                      recipient);
+    }
+    return result;
+}
+
+static void bench_bootstrap_receive(bench_cluster_t *cluster) {
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    struct sockaddr_in sender;
+    socklen_t sender_len = sizeof(struct sockaddr_in);
+    ssize_t read_result = 0;
+    while ((read_result = recvfrom(cluster->bootstrap_fd, buffer, MESSAGE_MAX_SIZE, MSG_DONTWAIT,
+                                   (struct sockaddr *) &sender, &sender_len)) > 0) {
+        sender_len = sizeof(struct sockaddr_in);
+        // Acknowledgements of the Member List messages are ignored.
+        if (message_type_decode(buffer, read_result) != MESSAGE_HELLO_TYPE) continue;
+        message_hello_t hello_msg;
+        if (message_hello_decode(buffer, read_result, &hello_msg) < 0) continue;
+        uint32_t hello_sequence_num = hello_msg.header.sequence_num;
+        message_hello_destroy(&hello_msg);
+
+        for (uint32_t i = 1; i < cluster->nodes_num; ++i) {
+            if (cluster->addresses[i].sin_port == sender.sin_port) {
+                if (bench_bootstrap_welcome(cluster, i, hello_sequence_num) < 0) ++cluster->errors;
+                break;
+            }
+        }
+    }
+}
+
+static void bench_node_tick(bench_cluster_t *cluster, bench_node_t *node, uint64_t now_ms) {
+    uint64_t started_ns = 0;
+    bench_cpu_start(&started_ns);
+    int next_tick = pittacus_gossip_tick(node->gossip);
+    bench_cpu_stop(node, started_ns);
+    if (next_tick < 0) {
+        ++cluster->errors;
+        next_tick = GOSSIP_TICK_INTERVAL;
+    }
+    node->next_tick_ms = now_ms + next_tick;
+    bench_node_send(cluster, node);
+}
+
+static void bench_loop_once(bench_cluster_t *cluster, uint64_t deadline_ms) {
+    uint64_t now_ms = bench_now_ms();
+    uint64_t wake_up_ms = deadline_ms;
+    for (uint32_t i = 0; i < cluster->nodes_num; ++i) {
+        if (cluster->nodes[i].next_tick_ms < wake_up_ms) wake_up_ms = cluster->nodes[i].next_tick_ms;
+    }
+    int timeout = wake_up_ms > now_ms ? (int) (wake_up_ms - now_ms) : 0;
+    if (timeout > MAX_POLL_INTERVAL_MS) timeout = MAX_POLL_INTERVAL_MS;
+
+    int poll_result = poll(cluster->poll_fds, cluster->nodes_num + 1, timeout);
+    if (poll_result > 0) {
+        for (uint32_t i = 0; i < cluster->nodes_num; ++i) {
+            if (cluster->poll_fds[i].revents & POLLIN) bench_node_receive(cluster, &cluster->nodes[i]);
+            cluster->poll_fds[i].revents = 0;
+        }
+        if (cluster->poll_fds[cluster->nodes_num].revents & POLLIN) bench_bootstrap_receive(cluster);
+        cluster->poll_fds[cluster->nodes_num].revents = 0;
+    }
+
+    now_ms = bench_now_ms();
+    for (uint32_t i = 0; i < cluster->nodes_num; ++i) {
+        if (cluster->nodes[i].next_tick_ms <= now_ms) bench_node_tick(cluster, &cluster->nodes[i], now_ms);
+    }
+}
+
+static int bench_cluster_init(bench_cluster_t *cluster, const bench_options_t *options, uint32_t nodes_num) {
+    memset(cluster, 0, sizeof(bench_cluster_t));
+    cluster->options = options;
+    cluster->nodes_num = nodes_num;
+    cluster->bootstrap_fd = -1;
+    cluster->nodes = (bench_node_t *) calloc(nodes_num, sizeof(bench_node_t));
+    cluster->members = (cluster_member_t *) calloc(nodes_num, sizeof(cluster_member_t));
+    cluster->addresses = (struct sockaddr_in *) calloc(nodes_num + 1, sizeof(struct sockaddr_in));
+    cluster->poll_fds = (struct pollfd *) calloc(nodes_num + 1, sizeof(struct pollfd));
+    cluster->messages = (bench_message_t *) calloc(options->messages_num, sizeof(bench_message_t));
+    cluster->deliveries = (uint8_t *) calloc((size_t) options->messages_num * nodes_num, sizeof(uint8_t));
+    cluster->latencies = (uint64_t *) calloc((size_t) options->messages_num * nodes_num, sizeof(uint64_t));
+    if (cluster->nodes == NULL || cluster->members == NULL || cluster->addresses == NULL ||
+            cluster->poll_fds == NULL || cluster->messages == NULL ||
+            cluster->deliveries == NULL || cluster->latencies == NULL) {
+        return PITTACUS_ERR_ALLOCATION_FAILED;
+    }
+
+    struct sockaddr_in self_in;
+    memset(&self_in, 0, sizeof(struct sockaddr_in));
+    self_in.sin_family = AF_INET;
+    self_in.sin_port = 0; // pick up a random port.
+    inet_aton("127.0.0.1", &self_in.sin_addr);
+
+    for (uint32_t i = 0; i < nodes_num; ++i) {
+        bench_node_t *node = &cluster->nodes[i];
+        node->cluster = cluster;
+        node->idx = i;
+
+        pittacus_addr_t self_addr = {
+            .addr = (const pt_sockaddr *) &self_in,
+            .addr_len = sizeof(struct sockaddr_in)
+        };
+        node->gossip = pittacus_gossip_create(&self_addr, &bench_data_receiver, node);
+        if (node->gossip == NULL) {
+            fprintf(stderr, "Gossip initialization failed: %s\n", strerror(errno));
+            return PITTACUS_ERR_INIT_FAILED;
+        }
+        int fd = pittacus_gossip_socket_fd(node->gossip);
+        socklen_t addr_len = sizeof(struct sockaddr_in);
+        if (getsockname(fd, (struct sockaddr *) &cluster->addresses[i], &addr_len) < 0) {
+            return PITTACUS_ERR_INIT_FAILED;
+        }
+        int result = cluster_member_init(&cluster->members[i], (const pt_sockaddr_storage *) &cluster->addresses[i],
+                                         sizeof(struct sockaddr_in));
+        if (result < 0) return result;
+        cluster->poll_fds[i].fd = fd;
+        cluster->poll_fds[i].events = POLLIN;
+    }
+
+    // The socket which serves Hellos on behalf of the seed node.
+    cluster->bootstrap_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (cluster->bootstrap_fd < 0) return PITTACUS_ERR_INIT_FAILED;
+    socklen_t addr_len = sizeof(struct sockaddr_in);
+    if (bind(cluster->bootstrap_fd, (const struct sockaddr *) &self_in, sizeof(struct sockaddr_in)) < 0 ||
+            getsockname(cluster->bootstrap_fd, (struct sockaddr *) &cluster->addresses[nodes_num], &addr_len) < 0) {
+        return PITTACUS_ERR_INIT_FAILED;
+    }
+    cluster->poll_fds[nodes_num].fd = cluster->bootstrap_fd;
+    cluster->poll_fds[nodes_num].events = POLLIN;
+    return PITTACUS_ERR_NONE;
+}
+
+static void bench_cluster_destroy(bench_cluster_t *cluster) {
+    if (cluster->nodes != NULL) {
+        for (uint32_t i = 0; i < cluster->nodes_num; ++i) {
+            if (cluster->nodes[i].gossip != NULL) pittacus_gossip_destroy(cluster->nodes[i].gossip);
+        }
+    }
+    if (cluster->members != NULL) {
+        for (uint32_t i = 0; i < cluster->nodes_num; ++i) {
+            if (cluster->members[i].address != NULL) cluster_member_destroy(&cluster->members[i]);
+        }
+    }
+    if (cluster->bootstrap_fd >= 0) close(cluster->bootstrap_fd);
+    free(cluster->nodes);
+    free(cluster->members);
+    free(cluster->addresses);
+    free(cluster->poll_fds);
+    free(cluster->messages);
+    free(cluster->deliveries);
+    free(cluster->latencies);
+}
+
+static int bench_cluster_join(bench_cluster_t *cluster, uint64_t *join_time_ms) {
+    const bench_options_t *options = cluster->options;
+    uint64_t started_ms = bench_now_ms();
+
+    // The first node starts a new cluster.
+    int result = pittacus_gossip_join(cluster->nodes[0].gossip, NULL, 0);
+    if (result < 0) return result;
+
+    pittacus_addr_t seed_addr = {
+        .addr = (const pt_sockaddr *) &cluster->addresses[cluster->nodes_num],
+        .addr_len = sizeof(struct sockaddr_in)
+    };
+    // Remaining nodes join in batches.
+    uint32_t joined_num = 1;
+    uint32_t connected_num = 1;
+    uint64_t deadline_ms = started_ms + options->join_timeout_ms;
+    while (connected_num < cluster->nodes_num && bench_now_ms() < deadline_ms) {
+        for (uint32_t i = 0; i < options->join_batch && joined_num < cluster->nodes_num; ++i) {
+            bench_node_t *node = &cluster->nodes[joined_num++];
+            result = pittacus_gossip_join(node->gossip, &seed_addr, 1);
+            if (result < 0) return result;
+            bench_node_send(cluster, node);
+        }
+        bench_loop_once(cluster, bench_now_ms() + GOSSIP_TICK_INTERVAL);
+
+        connected_num = 0;
+        for (uint32_t i = 0; i < cluster->nodes_num; ++i) {
+            if (pittacus_gossip_state(cluster->nodes[i].gossip) == STATE_CONNECTED) ++connected_num;
+        }
+    }
+    *join_time_ms = bench_now_ms() - started_ms;
+    return connected_num;
+}
+
+static void bench_cluster_run_for(bench_cluster_t *cluster, uint32_t duration_ms) {
+    uint64_t deadline_ms = bench_now_ms() + duration_ms;
+    while (bench_now_ms() < deadline_ms) bench_loop_once(cluster, deadline_ms);
+}
+
+static void bench_cluster_inject(bench_cluster_t *cluster) {
+    const bench_options_t *options = cluster->options;
+    uint64_t interval_ns = (uint64_t) (1e9 / options->rate);
+    uint64_t next_ns = bench_now_ns();
+    uint8_t buffer[options->payload_size];
+    memset(buffer, 0, options->payload_size);
+
+    while (cluster->messages_sent < options->messages_num) {
+        if (bench_now_ns() >= next_ns) {
+            uint32_t message_idx = cluster->messages_sent++;
+            bench_node_t *node = &cluster->nodes[random() % cluster->nodes_num];
+
+            bench_payload_t payload = { .message_idx = message_idx, .sent_ns = bench_now_ns() };
+            memcpy(buffer, &payload, sizeof(bench_payload_t));
+            cluster->messages[message_idx].sent_ns = payload.sent_ns;
+            // The originator receives the message instantly.
+            bench_data_receiver(node, node->gossip, buffer, options->payload_size);
+
+            uint64_t started_ns = 0;
+            bench_cpu_start(&started_ns);
+            if (pittacus_gossip_send_data(node->gossip, buffer, options->payload_size) < 0) ++cluster->errors;
+            bench_cpu_stop(node, started_ns);
+            bench_node_send(cluster, node);
+            next_ns += interval_ns;
+        }
+        bench_loop_once(cluster, next_ns / 1000000 + 1);
+    }
+}
+
+static int bench_compare_uint64(const void *first, const void *second) {
+    uint64_t a = *(const uint64_t *) first;
+    uint64_t b = *(const uint64_t *) second;
+    return (a > b) - (a < b);
+}
+
+static double bench_percentile_ms(uint64_t *sorted, size_t size, double percentile) {
+    if (size == 0) return 0.0;
+    return sorted[(size_t) (percentile * (size - 1))] / 1e6;
+}
+
+static void bench_report(bench_cluster_t *cluster, uint32_t connected_num, uint64_t join_time_ms,
+                         uint64_t measured_ns, int is_first) {
+    const bench_options_t *options = cluster->options;
+    uint32_t nodes_num = cluster->nodes_num;
+
+    uint64_t dissemination[cluster->messages_sent];
+    size_t complete_num = 0;
+    for (uint32_t i = 0; i < cluster->messages_sent; ++i) {
+        const bench_message_t *message = &cluster->messages[i];
+        if (message->delivered_num == nodes_num) {
+            dissemination[complete_num++] = message->last_delivery_ns - message->sent_ns;
+        }
+    }
+    qsort(dissemination, complete_num, sizeof(uint64_t), &bench_compare_uint64);
+    qsort(cluster->latencies, cluster->latencies_num, sizeof(uint64_t), &bench_compare_uint64);
+
+    uint64_t cpu_total_ns = 0;
+    uint64_t cpu_max_ns = 0;
+    for (uint32_t i = 0; i < nodes_num; ++i) {
+        cpu_total_ns += cluster->nodes[i].cpu_ns;
+        if (cluster->nodes[i].cpu_ns > cpu_max_ns) cpu_max_ns = cluster->nodes[i].cpu_ns;
+    }
+    size_t expected = (size_t) cluster->messages_sent * nodes_num;
+    double loss = expected > 0 ? 1.0 - (double) cluster->latencies_num / expected : 0.0;
+
+    printf("%s\n    {\"nodes\": %u, \"connected\": %u, \"join_time_ms\": %llu, \"messages\": %u, "
+           "\"rate_per_s\": %.2f, \"payload_size\": %u, \"messages_complete\": %zu, "
+           "\"dissemination_p50_ms\": %.3f, \"dissemination_p99_ms\": %.3f, \"dissemination_max_ms\": %.3f, "
+           "\"delivery_p50_ms\": %.3f, \"delivery_p99_ms\": %.3f, \"delivery_max_ms\": %.3f, "
+           "\"loss\": %.6f, \"duplicates\": %llu, \"errors\": %llu, "
+           "\"cpu_per_node_mean_ms\": %.3f, \"cpu_per_node_max_ms\": %.3f, "
+           "\"cpu_utilization_per_node\": %.6f}",
+           is_first ? "" : ",", nodes_num, connected_num, (unsigned long long) join_time_ms,
+           cluster->messages_sent, options->rate, options->payload_size, complete_num,
+           bench_percentile_ms(dissemination, complete_num, 0.5),
+           bench_percentile_ms(dissemination, complete_num, 0.99),
+           bench_percentile_ms(dissemination, complete_num, 1.0),
+           bench_percentile_ms(cluster->latencies, cluster->latencies_num, 0.5),
+           bench_percentile_ms(cluster->latencies, cluster->latencies_num, 0.99),
+           bench_percentile_ms(cluster->latencies, cluster->latencies_num, 1.0),
+           loss, (unsigned long long) cluster->duplicates, (unsigned long long) cluster->errors,
+           cpu_total_ns / 1e6 / nodes_num, cpu_max_ns / 1e6,
+           measured_ns > 0 ? (double) cpu_total_ns / nodes_num / measured_ns : 0.0);
+    fflush(stdout);
+}
+
+static int bench_run(const bench_options_t *options, uint32_t nodes_num, int is_first) {
+    bench_cluster_t cluster;
+    int result = bench_cluster_init(&cluster, options, nodes_num);
+    uint64_t join_time_ms = 0;
+    int connected_num = 0;
+    if (result == 0) {
+        connected_num = bench_cluster_join(&cluster, &join_time_ms);
+        result = connected_num < 0 ? connected_num : 0;
+    }
+    if (result == 0) {
+        bench_cluster_run_for(&cluster, options->settle_ms);
+        // Only the dissemination phase is accounted.
+        for (uint32_t i = 0; i < nodes_num; ++i) cluster.nodes[i].cpu_ns = 0;
+        cluster.errors = 0;
+
+        uint64_t started_ns = bench_now_ns();
+        bench_cluster_inject(&cluster);
+        bench_cluster_run_for(&cluster, options->drain_ms);
+        bench_report(&cluster, connected_num, join_time_ms, bench_now_ns() - started_ns, is_first);
+    }
+    bench_cluster_destroy(&cluster);
+    return result;
+}
+
+static int bench_parse_nodes(const char *arg, bench_options_t *options) {
+    options->runs_num = 0;
+    char *copy = strdup(arg);
+    if (copy == NULL) return -1;
+    char *saveptr = NULL;
+    for (char *token = strtok_r(copy, ",", &saveptr); token != NULL; token = strtok_r(NULL, ",", &saveptr)) {
+        if (options->runs_num >= MAX_RUNS) break;
+        options->nodes_nums[options->runs_num++] = strtoul(token, NULL, 10);
+    }
+    free(copy);
+    return options->runs_num > 0 ? 0 : -1;
+}
+
+static void bench_usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -n N1,N2,..  cluster sizes (default 10,100,1000)\n"
+            "  -m MESSAGES  number of injected payloads (default 100)\n"
+            "  -r RATE      payloads per second (default 10)\n"
+            "  -b BYTES     payload size (default 64)\n"
+            "  -v VIEW      number of members each node learns about on join (default 32)\n"
+            "  -j NODES     nodes joining the cluster at once (default 10)\n"
+            "  -w MS        join timeout (default 60000)\n"
+            "  -S MS        settle time between join and injection (default 3000)\n"
+            "  -d MS        drain time after the last injection (default 5000)\n"
+            "  -s SEED      random seed (default 1)\n", name);
+}
+
+int main(int argc, char **argv) {
+    bench_options_t options = {
+        .nodes_nums = { 10, 100, 1000 },
+        .runs_num = 3,
+        .messages_num = 100,
+        .rate = 10.0,
+        .payload_size = 64,
+        .view_size = 32,
+        .join_batch = 10,
+        .join_timeout_ms = 60000,
+        .settle_ms = 3000,
+        .drain_ms = 5000,
+        .seed = 1
+    };
+
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "n:m:r:b:v:j:w:S:d:s:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                if (bench_parse_nodes(optarg, &options) < 0) {
+                    bench_usage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'm': options.messages_num = strtoul(optarg, NULL, 10); break;
+            case 'r': options.rate = strtod(optarg, NULL); break;
+            case 'b': options.payload_size = strtoul(optarg, NULL, 10); break;
+            case 'v': options.view_size = strtoul(optarg, NULL, 10); break;
+            case 'j': options.join_batch = strtoul(optarg, NULL, 10); break;
+            case 'w': options.join_timeout_ms = strtoul(optarg, NULL, 10); break;
+            case 'S': options.settle_ms = strtoul(optarg, NULL, 10); break;
+            case 'd': options.drain_ms = strtoul(optarg, NULL, 10); break;
+            case 's': options.seed = strtoul(optarg, NULL, 10); break;
+            default:
+                bench_usage(argv[0]);
+                return opt == 'h' ? 0 : -1;
+        }
+    }
+    if (options.messages_num == 0 || options.rate <= 0.0 || options.join_batch == 0 ||
+            options.payload_size < sizeof(bench_payload_t) || options.payload_size > MESSAGE_MAX_SIZE / 2) {
+        bench_usage(argv[0]);
+        return -1;
+    }
+    srandom(options.seed);
+
+    // Every node needs its own socket.
+    uint32_t max_nodes = 0;
+    for (size_t i = 0; i < options.runs_num; ++i) {
+        if (options.nodes_nums[i] > max_nodes) max_nodes = options.nodes_nums[i];
+    }
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < max_nodes + 64) {
+        limit.rlim_cur = max_nodes + 64;
+        if (limit.rlim_cur > limit.rlim_max) limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    printf("{\"loopback\": [");
+    int result = 0;
+    for (size_t i = 0; i < options.runs_num && result == 0; ++i) {
+        if (options.nodes_nums[i] < 2) continue;
+        result = bench_run(&options, options.nodes_nums[i], i == 0);
+        if (result < 0) fprintf(stderr, "Benchmark with %u nodes failed: %d\n", options.nodes_nums[i], result);
+    }
+    printf("\n]}\n");
+    return result < 0 ? -1 : 0;
+}
@@ -140,6 +140,11 @@ int main(int argc, char **argv) {
             pittacus_gossip_destroy(gossip);
             return -1;
         }
+        // Wake up for retries and paced messages too, not only for the next tick.
+        int64_t send_delay = pittacus_gossip_send_delay(gossip);
+        if (send_delay >= 0 && (send_delay + 999) / 1000 < poll_interval) {
+            poll_interval = (int) ((send_delay + 999) / 1000);
+        }
     }
     pittacus_gossip_destroy(gossip);
 
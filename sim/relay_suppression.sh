@@ -0,0 +1,59 @@
+#!/bin/sh
+#
+# Copyright 2016-2017 Iaroslav Zeigerman
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Compares the data relay suppression settings in the simulator: the number of
+# Data messages sent per node per payload versus the share of nodes reached by
+# the push 500 ms after the injection and the time until all nodes have the payload.
+#
+# Usage: sim/relay_suppression.sh [BUILD_DIR] [NODES...]
+#
+
+set -e
+
+SOURCE_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=${1:-relay_suppression_build}
+shift 2>/dev/null || true
+NODES=${*:-100 1000 10000}
+MESSAGES=3
+LOSS=0.01
+WARMUP_MS=2000
+
+VARIANTS="baseline:
+max_hops_4:DATA_RELAY_MAX_HOPS=4
+duplicates_1:DATA_RELAY_DUPLICATES=1
+duplicates_2:DATA_RELAY_DUPLICATES=2"
+
+json_field() {
+    sed -e "s/.*\"$1\": \([0-9.]*\).*/\1/"
+}
+
+printf "%-14s %6s %16s %14s %18s %12s\n" variant nodes data_per_payload push_coverage full_dissemination_ms suppressed
+echo "$VARIANTS" | while IFS=: read -r name definitions; do
+    cmake -S "$SOURCE_DIR" -B "$BUILD_DIR/$name" -DPITTACUS_SIM_DEFINITIONS="$definitions" > /dev/null
+    cmake --build "$BUILD_DIR/$name" --target pittacus_sim > /dev/null 2>&1
+    sim="$BUILD_DIR/$name/sim/pittacus_sim"
+    for nodes in $NODES; do
+        # The simulator fails if the payloads haven't reached every node by the time limit.
+        push=$("$sim" -n "$nodes" -m $MESSAGES -p $LOSS -t $((WARMUP_MS + 500)) -j || true)
+        full=$("$sim" -n "$nodes" -m $MESSAGES -p $LOSS -t $((WARMUP_MS + 20000)) -j)
+        data=$(echo "$full" | sed -e 's/.*"messages_by_type": {[^}]*"5": \([0-9]*\).*/\1/')
+        printf "%-14s %6s %16.2f %14.4f %18.1f %12s\n" "$name" "$nodes" \
+            "$(awk "BEGIN { print $data / $MESSAGES / $nodes }")" \
+            "$(echo "$push" | json_field coverage)" \
+            "$(echo "$full" | json_field dissemination_mean_ms)" \
+            "$(echo "$full" | json_field relays_suppressed)"
+    done
+done
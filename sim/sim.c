@@ -0,0 +1,740 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "gossip.h"
+#include "messages.h"
+#include "member.h"
+#include "config.h"
+#include "errors.h"
+#include "sim_platform.h"
+
+/*
+ * A discrete-event simulation of a Pittacus cluster. All nodes live in
+ * a single process and talk to each other through the simulated network
+ * from sim_platform.c. Nodes are bootstrapped with a random partial view
+ * of the cluster, then a number of data messages are injected from random
+ * nodes and the simulation runs until every node has received every message
+ * or the virtual time limit is reached.
+ *
+ * Some nodes can be crashed from the very beginning. In this case the
+ * simulation runs until the time limit to let the failure detector of
+ * the remaining nodes find and remove crashed members.
+ */
+
+#define SIM_WARMUP_MS (2 * GOSSIP_TICK_INTERVAL)
+#define SIM_MEMBER_LIST_CHUNK \
+    ((MESSAGE_MAX_SIZE - sizeof(message_header_t) - sizeof(uint16_t)) / (CLUSTER_MEMBER_IPV4_SIZE + CLUSTER_MEMBER_ZONE_SIZE))
+
+typedef struct sim_options {
+    uint32_t nodes_num;
+    uint32_t view_size;
+    uint32_t messages_num;
+    uint32_t failed_num;
+    uint32_t message_interval_ms;
+    uint32_t payload_size;
+    uint32_t max_time_ms;
+    uint32_t bridges_num; // bridge nodes per zone, zero if nodes don't know their zones.
+    uint64_t seed;
+    sim_network_config_t network;
+    int json;
+} sim_options_t;
+
+typedef struct sim_message {
+    uint64_t injected_us;
+    uint64_t completed_us;
+    uint32_t delivered_num;
+} sim_message_t;
+
+typedef struct sim_cluster {
+    const sim_options_t *options;
+    pittacus_gossip_t **nodes;
+    sim_message_t *messages;
+    uint64_t *delivered_us; // messages_num x nodes_num matrix.
+    uint8_t *failed;
+    uint64_t *next_tick_us; // the time of the latest scheduled tick of each node, 0 before the first tick.
+    uint64_t expected_removals; // the number of crashed members in views of live nodes.
+    uint64_t last_removal_us;
+    uint32_t messages_injected;
+    uint32_t messages_completed;
+    uint64_t duplicates;
+} sim_cluster_t;
+
+static sim_cluster_t cluster;
+
+static uint32_t sim_node_index(pittacus_gossip_t *gossip) {
+    pt_socket_fd fd = pittacus_gossip_socket_fd(gossip);
+    return (uint32_t) fd;
+}
+
+static void sim_data_receiver(void *context, pittacus_gossip_t *gossip,
+                              const uint8_t *buffer, size_t buffer_size) {
+    if (buffer_size < sizeof(uint32_t)) return;
+    uint32_t message_idx = 0;
+    memcpy(&message_idx, buffer, sizeof(uint32_t));
+    if (message_idx >= cluster.messages_injected) return;
+
+    uint32_t node_idx = sim_node_index(gossip);
+    uint64_t *delivered = &cluster.delivered_us[(size_t) message_idx * cluster.options->nodes_num + node_idx];
+    if (*delivered != 0) {
+        ++cluster.duplicates;
+        return;
+    }
+    *delivered = sim_now_us();
+
+    sim_message_t *message = &cluster.messages[message_idx];
+    if (++message->delivered_num == cluster.options->nodes_num - cluster.options->failed_num) {
+        message->completed_us = sim_now_us();
+        ++cluster.messages_completed;
+    }
+}
+
+static pt_bool_t sim_zone_labels(const sim_options_t *options) {
+    return options->network.zones_num > 1 && options->bridges_num > 0;
+}
+
+static void sim_zone_label(const sim_options_t *options, uint32_t node_idx, cluster_member_t *member) {
+    member->zone = node_idx % options->network.zones_num;
+    member->bridge = node_idx / options->network.zones_num < options->bridges_num;
+}
+
+static int sim_create_nodes(sim_cluster_t *self) {
+    uint32_t nodes_num = self->options->nodes_num;
+    self->nodes = (pittacus_gossip_t **) calloc(nodes_num, sizeof(pittacus_gossip_t *));
+    if (self->nodes == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
+
+    for (uint32_t i = 0; i < nodes_num; ++i) {
+        pt_sockaddr_in addr_in;
+        sim_socket_address(i, &addr_in);
+        pittacus_addr_t addr = {
+            .addr = (const pt_sockaddr *) &addr_in,
+            .addr_len = sizeof(pt_sockaddr_in)
+        };
+        self->nodes[i] = pittacus_gossip_create(&addr, &sim_data_receiver, self);
+        if (self->nodes[i] == NULL) return PITTACUS_ERR_INIT_FAILED;
+        if (sim_zone_labels(self->options)) {
+            cluster_member_t label;
+            sim_zone_label(self->options, i, &label);
+            int zone_result = pittacus_gossip_set_zone(self->nodes[i], label.zone, label.bridge);
+            if (zone_result < 0) return zone_result;
+        }
+        // Every node acts like a seed node. The membership is
+        // populated during the bootstrap phase.
+        int join_result = pittacus_gossip_join(self->nodes[i], NULL, 0);
+        if (join_result < 0) return join_result;
+    }
+    return PITTACUS_ERR_NONE;
+}
+
+static int sim_bootstrap_node(sim_cluster_t *self, uint32_t node_idx,
+                              cluster_member_t *all_members, uint32_t view_size) {
+    uint32_t nodes_num = self->options->nodes_num;
+    cluster_member_t view[view_size];
+    uint32_t chosen[view_size];
+
+    // Choose distinct random members of the cluster excluding the node itself.
+    for (uint32_t i = 0; i < view_size; ++i) {
+        uint32_t candidate = 0;
+        pt_bool_t is_valid = PT_FALSE;
+        while (!is_valid) {
+            candidate = sim_random() % nodes_num;
+            is_valid = candidate != node_idx;
+            for (uint32_t j = 0; j < i && is_valid; ++j) {
+                if (chosen[j] == candidate) is_valid = PT_FALSE;
+            }
+        }
+        chosen[i] = candidate;
+        view[i] = all_members[candidate];
+        if (!self->failed[node_idx] && self->failed[candidate]) ++self->expected_removals;
+    }
+
+    // Deliver the view in the same way the seed node does it: through a number
+    // of Member List messages.
+    pt_sockaddr_in bootstrap_addr;
+    sim_socket_address(nodes_num, &bootstrap_addr);
+    uint8_t buffer[MESSAGE_MAX_SIZE];
+    for (uint32_t offset = 0; offset < view_size; offset += SIM_MEMBER_LIST_CHUNK) {
+        message_member_list_t msg;
+        message_header_init(&msg.header, MESSAGE_MEMBER_LIST_TYPE, offset + 1);
+        if (sim_zone_labels(self->options)) msg.header.flags |= MESSAGE_FLAG_ZONES;
+        uint32_t remaining = view_size - offset;
+        msg.members_n = remaining > SIM_MEMBER_LIST_CHUNK ? SIM_MEMBER_LIST_CHUNK : remaining;
+        msg.members = view + offset;
+        int encode_result = message_member_list_encode(&msg, buffer, MESSAGE_MAX_SIZE);
+        if (encode_result < 0) return encode_result;
+
+        int inject_result = sim_inject(node_idx, &bootstrap_addr, buffer, encode_result);
+        if (inject_result < 0) return inject_result;
+        int receive_result = pittacus_gossip_process_receive(self->nodes[node_idx]);
+        if (receive_result < 0) return receive_result;
+    }
+    // Flush ACKs. They are addressed to nowhere and will be dropped.
+    int send_result = pittacus_gossip_process_send(self->nodes[node_idx]);
+    return send_result < 0 ? send_result : PITTACUS_ERR_NONE;
+}
+
+static int sim_bootstrap(sim_cluster_t *self) {
+    uint32_t nodes_num = self->options->nodes_num;
+    uint32_t view_size = self->options->view_size;
+    if (view_size >= nodes_num) view_size = nodes_num - 1;
+
+    cluster_member_t *all_members = (cluster_member_t *) calloc(nodes_num, sizeof(cluster_member_t));
+    if (all_members == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
+
+    int result = PITTACUS_ERR_NONE;
+    for (uint32_t i = 0; i < nodes_num && result == PITTACUS_ERR_NONE; ++i) {
+        pt_sockaddr_in addr_in;
+        sim_socket_address(i, &addr_in);
+        result = cluster_member_init(&all_members[i], (const pt_sockaddr_storage *) &addr_in,
+                                     sizeof(pt_sockaddr_in));
+        if (result == PITTACUS_ERR_NONE && sim_zone_labels(self->options)) {
+            sim_zone_label(self->options, i, &all_members[i]);
+        }
+    }
+    for (uint32_t i = 0; i < nodes_num && result == PITTACUS_ERR_NONE; ++i) {
+        result = sim_bootstrap_node(self, i, all_members, view_size);
+    }
+
+    for (uint32_t i = 0; i < nodes_num; ++i) {
+        if (all_members[i].address != NULL) cluster_member_destroy(&all_members[i]);
+    }
+    free(all_members);
+    return result;
+}
+
+static void sim_fail_nodes(sim_cluster_t *self) {
+    for (uint32_t i = 0; i < self->options->failed_num; ++i) {
+        uint32_t node_idx = sim_random() % self->options->nodes_num;
+        while (self->failed[node_idx]) node_idx = sim_random() % self->options->nodes_num;
+        self->failed[node_idx] = 1;
+    }
+}
+
+static int sim_schedule_tick(sim_cluster_t *self, uint32_t node_idx, uint64_t tick_us) {
+    self->next_tick_us[node_idx] = tick_us;
+    return sim_schedule(tick_us, SIM_EVENT_TICK, node_idx, NULL);
+}
+
+/** Like a real event loop, the node sleeps until the next tick or until it has something to send. */
+static uint64_t sim_wakeup_us(pittacus_gossip_t *node, int next_tick) {
+    // Make sure that the node doesn't spin if the tick is due right now.
+    if (next_tick == 0) next_tick = 1;
+    uint64_t wakeup_us = sim_now_us() + next_tick * 1000ULL;
+    int64_t send_delay = pittacus_gossip_send_delay(node);
+    if (send_delay == 0) send_delay = 1;
+    if (send_delay > 0 && sim_now_us() + send_delay < wakeup_us) wakeup_us = sim_now_us() + send_delay;
+    return wakeup_us;
+}
+
+static int sim_inject_message(sim_cluster_t *self) {
+    uint32_t message_idx = self->messages_injected++;
+    uint32_t node_idx = sim_random() % self->options->nodes_num;
+    while (self->failed[node_idx]) node_idx = sim_random() % self->options->nodes_num;
+    pittacus_gossip_t *node = self->nodes[node_idx];
+
+    uint32_t payload_size = self->options->payload_size;
+    uint8_t payload[payload_size];
+    memset(payload, 0, payload_size);
+    memcpy(payload, &message_idx, sizeof(uint32_t));
+
+    sim_message_t *message = &self->messages[message_idx];
+    message->injected_us = sim_now_us();
+    // The originator receives the message instantly.
+    sim_data_receiver(self, node, payload, payload_size);
+
+    int result = pittacus_gossip_send_data(node, payload, payload_size);
+    if (result < 0) return result;
+    result = pittacus_gossip_process_send(node);
+    if (result < 0) return result;
+    // The send rate limits may hold some of the messages back.
+    int64_t send_delay = pittacus_gossip_send_delay(node);
+    uint64_t send_us = sim_now_us() + (send_delay > 0 ? send_delay : 1);
+    if (send_delay >= 0 && send_us < self->next_tick_us[node_idx]) {
+        result = sim_schedule_tick(self, node_idx, send_us);
+    }
+    return result < 0 ? result : PITTACUS_ERR_NONE;
+}
+
+static int sim_handle_event(sim_cluster_t *self, const sim_event_t *event) {
+    int result = PITTACUS_ERR_NONE;
+    switch (event->type) {
+        case SIM_EVENT_DELIVER: {
+            pittacus_gossip_t *node = self->nodes[event->socket_idx];
+            if (self->failed[event->socket_idx]) {
+                // The node has crashed. Drop the datagram.
+                uint8_t buffer[MESSAGE_MAX_SIZE];
+                pt_sockaddr_storage addr;
+                pt_socklen_t addr_len = sizeof(pt_sockaddr_storage);
+                pt_recv_from(pittacus_gossip_socket_fd(node), buffer, MESSAGE_MAX_SIZE, &addr, &addr_len);
+                break;
+            }
+            // Failures like decoding errors or unexpected states are a part
+            // of the normal protocol flow. Just move on.
+            pittacus_gossip_process_receive(node);
+            result = pittacus_gossip_process_send(node);
+            if (result < 0 || self->next_tick_us[event->socket_idx] == 0) break;
+            // Like a real event loop, let the node reschedule its timers after each
+            // received datagram. Nodes that haven't started yet keep their initial
+            // tick, so that gossip rounds of different nodes don't get aligned.
+            int next_tick = pittacus_gossip_tick(node);
+            if (next_tick < 0) return next_tick;
+            result = pittacus_gossip_process_send(node);
+            if (result < 0) return result;
+            uint64_t tick_us = sim_wakeup_us(node, next_tick);
+            if (tick_us < self->next_tick_us[event->socket_idx]) {
+                result = sim_schedule_tick(self, event->socket_idx, tick_us);
+            }
+            break;
+        }
+        case SIM_EVENT_TICK: {
+            // The tick could have been rescheduled to an earlier time.
+            uint64_t next_tick_us = self->next_tick_us[event->socket_idx];
+            if (next_tick_us != 0 && sim_now_us() != next_tick_us) break;
+            pittacus_gossip_t *node = self->nodes[event->socket_idx];
+            int next_tick = pittacus_gossip_tick(node);
+            if (next_tick < 0) return next_tick;
+            result = pittacus_gossip_process_send(node);
+            if (result < 0) return result;
+            result = sim_schedule_tick(self, event->socket_idx, sim_wakeup_us(node, next_tick));
+            break;
+        }
+        case SIM_EVENT_USER:
+            if (self->messages_injected == 0) sim_socket_stats_reset();
+            result = sim_inject_message(self);
+            if (result < 0) return result;
+            if (self->messages_injected < self->options->messages_num) {
+                uint64_t next_ts = sim_now_us() + self->options->message_interval_ms * 1000ULL;
+                result = sim_schedule(next_ts, SIM_EVENT_USER, 0, NULL);
+            }
+            break;
+    }
+    return result < 0 ? result : PITTACUS_ERR_NONE;
+}
+
+static int sim_run(sim_cluster_t *self, uint64_t *events_num) {
+    uint64_t start_us = sim_now_us();
+    uint32_t nodes_num = self->options->nodes_num;
+    // Spread gossip ticks evenly across the tick interval.
+    for (uint32_t i = 0; i < nodes_num; ++i) {
+        if (self->failed[i]) continue;
+        uint64_t offset_us = sim_random() % (GOSSIP_TICK_INTERVAL * 1000ULL);
+        int result = sim_schedule(start_us + offset_us, SIM_EVENT_TICK, i, NULL);
+        if (result < 0) return result;
+    }
+    int result = sim_schedule(start_us + SIM_WARMUP_MS * 1000ULL, SIM_EVENT_USER, 0, NULL);
+    if (result < 0) return result;
+
+    uint64_t deadline_us = start_us + self->options->max_time_ms * 1000ULL;
+    sim_event_t event;
+    uint32_t failed_num = self->options->failed_num;
+    while ((self->messages_completed < self->options->messages_num || failed_num > 0) &&
+            sim_next_event(&event) == 0) {
+        if (event.ts > deadline_us) break;
+        ++(*events_num);
+        if (event.type == SIM_EVENT_USER) {
+            result = sim_handle_event(self, &event);
+            if (result < 0) return result;
+            continue;
+        }
+
+        // Keep track of the moment when the last dead member has been removed.
+        pittacus_gossip_stats_t stats_before;
+        pittacus_gossip_stats(self->nodes[event.socket_idx], &stats_before);
+        result = sim_handle_event(self, &event);
+        if (result < 0) return result;
+        pittacus_gossip_stats_t stats_after;
+        pittacus_gossip_stats(self->nodes[event.socket_idx], &stats_after);
+        if (stats_after.members_removed > stats_before.members_removed) self->last_removal_us = sim_now_us();
+    }
+    return PITTACUS_ERR_NONE;
+}
+
+static int sim_compare_uint64(const void *first, const void *second) {
+    uint64_t a = *(const uint64_t *) first;
+    uint64_t b = *(const uint64_t *) second;
+    return (a > b) - (a < b);
+}
+
+static double sim_percentile_ms(const uint64_t *sorted, size_t size, double percentile) {
+    if (size == 0) return 0.0;
+    size_t idx = (size_t) (percentile * (size - 1));
+    return sorted[idx] / 1000.0;
+}
+
+#define SIM_COORDINATE_SAMPLES 64
+
+/**
+ * Compares the round trip times estimated from network coordinates with the mean
+ * simulated round trip times for random pairs of nodes. Only pairs in which the first
+ * node has received the coordinate of the second one are estimated.
+ *
+ * @return the number of estimated pairs. The relative errors in millionths are
+ *         stored in the sorted array which must be freed by the caller.
+ */
+static size_t sim_coordinate_errors(const sim_cluster_t *self, uint64_t **errors) {
+    const sim_options_t *options = self->options;
+    const sim_network_config_t *network = &options->network;
+    size_t errors_size = 0;
+    *errors = (uint64_t *) malloc((size_t) options->nodes_num * SIM_COORDINATE_SAMPLES * sizeof(uint64_t));
+    if (*errors == NULL) return 0;
+    for (uint32_t n = 0; n < options->nodes_num; ++n) {
+        if (self->failed[n]) continue;
+        for (int s = 0; s < SIM_COORDINATE_SAMPLES; ++s) {
+            uint32_t other = sim_random() % options->nodes_num;
+            if (other == n) continue;
+            pt_sockaddr_in other_addr_in;
+            sim_socket_address(other, &other_addr_in);
+            pittacus_addr_t other_addr = {
+                .addr = (const pt_sockaddr *) &other_addr_in,
+                .addr_len = sizeof(pt_sockaddr_in)
+            };
+            uint64_t estimate_us = 0;
+            if (pittacus_gossip_estimate_rtt(self->nodes[n], &other_addr, &estimate_us) < 0) continue;
+
+            double rtt_us = 2.0 * network->latency_us + (network->jitter_us > 0 ? network->jitter_us - 1.0 : 0.0);
+            if (network->zones_num > 1 && n % network->zones_num != other % network->zones_num) {
+                rtt_us += 2.0 * network->zone_latency_us;
+            }
+            double error = (estimate_us - rtt_us) / rtt_us;
+            (*errors)[errors_size++] = (uint64_t) ((error < 0.0 ? -error : error) * 1000000.0);
+        }
+    }
+    qsort(*errors, errors_size, sizeof(uint64_t), &sim_compare_uint64);
+    return errors_size;
+}
+
+static void sim_report(const sim_cluster_t *self, double wall_time_s, uint64_t events_num) {
+    const sim_options_t *options = self->options;
+    uint32_t nodes_num = options->nodes_num;
+
+    // Collect delivery latencies of all messages to all nodes.
+    size_t latencies_size = 0;
+    uint64_t *latencies = (uint64_t *) malloc((size_t) self->messages_injected * nodes_num * sizeof(uint64_t));
+    uint64_t max_dissemination_us = 0;
+    uint64_t total_dissemination_us = 0;
+    for (uint32_t m = 0; m < self->messages_injected; ++m) {
+        const sim_message_t *message = &self->messages[m];
+        for (uint32_t n = 0; n < nodes_num && latencies != NULL; ++n) {
+            uint64_t delivered = self->delivered_us[(size_t) m * nodes_num + n];
+            if (delivered != 0) latencies[latencies_size++] = delivered - message->injected_us;
+        }
+        if (message->completed_us != 0) {
+            uint64_t dissemination_us = message->completed_us - message->injected_us;
+            total_dissemination_us += dissemination_us;
+            if (dissemination_us > max_dissemination_us) max_dissemination_us = dissemination_us;
+        }
+    }
+    if (latencies != NULL) qsort(latencies, latencies_size, sizeof(uint64_t), &sim_compare_uint64);
+
+    uint64_t messages_sent = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t messages_dropped = 0;
+    uint64_t messages_cross_zone = 0;
+    for (uint32_t n = 0; n < nodes_num; ++n) {
+        const sim_socket_stats_t *stats = sim_socket_stats(n);
+        messages_sent += stats->messages_sent;
+        bytes_sent += stats->bytes_sent;
+        messages_dropped += stats->messages_dropped;
+        messages_cross_zone += stats->messages_cross_zone;
+    }
+
+    // Protocol level counters reported by the nodes themselves.
+    pittacus_gossip_stats_t total_stats;
+    memset(&total_stats, 0, sizeof(pittacus_gossip_stats_t));
+    uint64_t fanout_sum = 0;
+    uint64_t tick_interval_sum = 0;
+    uint64_t members_sum = 0;
+    uint64_t passive_members_sum = 0;
+    pittacus_gossip_latency_t total_latency;
+    pittacus_histogram_init(&total_latency.hop_latency);
+    pittacus_histogram_init(&total_latency.propagation_age);
+    pittacus_histogram_init(&total_latency.ack_rtt);
+    for (uint32_t n = 0; n < nodes_num; ++n) {
+        pittacus_gossip_latency_t node_latency;
+        pittacus_gossip_latency(self->nodes[n], &node_latency);
+        pittacus_histogram_merge(&total_latency.hop_latency, &node_latency.hop_latency);
+        pittacus_histogram_merge(&total_latency.propagation_age, &node_latency.propagation_age);
+        pittacus_histogram_merge(&total_latency.ack_rtt, &node_latency.ack_rtt);
+
+        pittacus_gossip_stats_t node_stats;
+        pittacus_gossip_stats(self->nodes[n], &node_stats);
+        total_stats.retries += node_stats.retries;
+        total_stats.messages_expired += node_stats.messages_expired;
+        total_stats.buffer_evictions += node_stats.buffer_evictions;
+        total_stats.members_removed += node_stats.members_removed;
+        total_stats.members_suspected += node_stats.members_suspected;
+        total_stats.indirect_probes += node_stats.indirect_probes;
+        total_stats.suspicions_refuted += node_stats.suspicions_refuted;
+        total_stats.member_events_sent += node_stats.member_events_sent;
+        total_stats.member_log_events_sent += node_stats.member_log_events_sent;
+        total_stats.relays_suppressed += node_stats.relays_suppressed;
+        total_stats.sends_paced += node_stats.sends_paced;
+        fanout_sum += node_stats.fanout;
+        tick_interval_sum += node_stats.tick_interval;
+        members_sum += node_stats.members_num;
+        passive_members_sum += node_stats.passive_members_num;
+        total_stats.members_promoted += node_stats.members_promoted;
+    }
+
+    uint64_t *coordinate_errors = NULL;
+    size_t coordinate_errors_size = sim_coordinate_errors(self, &coordinate_errors);
+    // The errors are in millionths, so the percentiles in thousandths are the ratios.
+    double coordinate_error_p50 = sim_percentile_ms(coordinate_errors, coordinate_errors_size, 0.5) / 1000.0;
+    double coordinate_error_p90 = sim_percentile_ms(coordinate_errors, coordinate_errors_size, 0.9) / 1000.0;
+    free(coordinate_errors);
+
+    size_t expected_deliveries = (size_t) self->messages_injected * (nodes_num - options->failed_num);
+    double coverage = expected_deliveries > 0 ? (double) latencies_size / expected_deliveries : 0.0;
+    double mean_dissemination_ms = self->messages_completed > 0 ?
+                                   total_dissemination_us / 1000.0 / self->messages_completed : 0.0;
+
+    if (options->json) {
+        printf("{\"nodes\": %u, \"view_size\": %u, \"rumor_factor\": %d, \"tick_interval_ms\": %d, "
+               "\"latency_us\": %u, \"jitter_us\": %u, \"loss_rate\": %.4f, \"zones\": %u, "
+               "\"zone_latency_us\": %u, \"bridges\": %u, \"seed\": %llu, "
+               "\"messages\": %u, \"messages_completed\": %u, \"coverage\": %.6f, "
+               "\"dissemination_mean_ms\": %.3f, \"dissemination_max_ms\": %.3f, "
+               "\"delivery_p50_ms\": %.3f, \"delivery_p90_ms\": %.3f, \"delivery_p99_ms\": %.3f, "
+               "\"messages_per_node\": %.3f, \"bytes_per_node\": %.3f, \"cross_zone_per_node\": %.3f, "
+               "\"messages_dropped\": %llu, "
+               "\"duplicates\": %llu, \"retries\": %llu, \"messages_expired\": %llu, "
+               "\"buffer_evictions\": %llu, \"members_removed\": %llu, \"members_suspected\": %llu, "
+               "\"indirect_probes\": %llu, \"suspicions_refuted\": %llu, \"member_events_sent\": %llu, "
+               "\"member_log_events_sent\": %llu, \"relays_suppressed\": %llu, \"sends_paced\": %llu, \"fanout_mean\": %.3f, \"tick_interval_mean_ms\": %.3f, \"failed_nodes\": %u, "
+               "\"members_mean\": %.3f, \"passive_members_mean\": %.3f, \"members_promoted\": %llu, "
+               "\"expected_removals\": %llu, \"last_removal_ms\": %.3f, "
+               "\"hop_latency_p50_ms\": %.3f, \"hop_latency_p99_ms\": %.3f, "
+               "\"propagation_age_p50_ms\": %.3f, \"propagation_age_p99_ms\": %.3f, "
+               "\"ack_rtt_p50_ms\": %.3f, \"ack_rtt_p99_ms\": %.3f, \"coordinate_pairs\": %zu, "
+               "\"coordinate_error_p50\": %.4f, \"coordinate_error_p90\": %.4f, \"messages_by_type\": {",
+               nodes_num, options->view_size, MESSAGE_RUMOR_FACTOR, GOSSIP_TICK_INTERVAL,
+               options->network.latency_us, options->network.jitter_us, options->network.loss_rate,
+               options->network.zones_num, options->network.zone_latency_us, options->bridges_num,
+               (unsigned long long) options->seed,
+               self->messages_injected, self->messages_completed, coverage,
+               mean_dissemination_ms, max_dissemination_us / 1000.0,
+               sim_percentile_ms(latencies, latencies_size, 0.5),
+               sim_percentile_ms(latencies, latencies_size, 0.9),
+               sim_percentile_ms(latencies, latencies_size, 0.99),
+               (double) messages_sent / nodes_num, (double) bytes_sent / nodes_num,
+               (double) messages_cross_zone / nodes_num,
+               (unsigned long long) messages_dropped, (unsigned long long) self->duplicates,
+               (unsigned long long) total_stats.retries, (unsigned long long) total_stats.messages_expired,
+               (unsigned long long) total_stats.buffer_evictions, (unsigned long long) total_stats.members_removed,
+               (unsigned long long) total_stats.members_suspected, (unsigned long long) total_stats.indirect_probes,
+               (unsigned long long) total_stats.suspicions_refuted,
+               (unsigned long long) total_stats.member_events_sent,
+               (unsigned long long) total_stats.member_log_events_sent,
+               (unsigned long long) total_stats.relays_suppressed,
+               (unsigned long long) total_stats.sends_paced,
+               (double) fanout_sum / nodes_num, (double) tick_interval_sum / nodes_num, options->failed_num,
+               (double) members_sum / nodes_num, (double) passive_members_sum / nodes_num,
+               (unsigned long long) total_stats.members_promoted,
+               (unsigned long long) self->expected_removals, self->last_removal_us / 1000.0,
+               pittacus_histogram_percentile(&total_latency.hop_latency, 50.0) / 1000.0,
+               pittacus_histogram_percentile(&total_latency.hop_latency, 99.0) / 1000.0,
+               pittacus_histogram_percentile(&total_latency.propagation_age, 50.0) / 1000.0,
+               pittacus_histogram_percentile(&total_latency.propagation_age, 99.0) / 1000.0,
+               pittacus_histogram_percentile(&total_latency.ack_rtt, 50.0) / 1000.0,
+               pittacus_histogram_percentile(&total_latency.ack_rtt, 99.0) / 1000.0,
+               coordinate_errors_size, coordinate_error_p50, coordinate_error_p90);
+        const char *separator = "";
+        for (int type = 0; type <= UINT8_MAX; ++type) {
+            uint64_t count = sim_message_type_count(type);
+            if (count == 0) continue;
+            printf("%s\"%d\": %llu", separator, type, (unsigned long long) count);
+            separator = ", ";
+        }
+        printf("}, \"virtual_time_ms\": %.3f, \"events\": %llu, \"wall_time_s\": %.3f}\n",
+               (sim_now_us() / 1000.0), (unsigned long long) events_num, wall_time_s);
+    } else {
+        printf("nodes:                      %u (view size %u)\n", nodes_num, options->view_size);
+        printf("rumor factor / tick:        %d / %d ms\n", MESSAGE_RUMOR_FACTOR, GOSSIP_TICK_INTERVAL);
+        printf("fanout / tick at the end:   mean %.3f / %.3f ms%s\n", (double) fanout_sum / nodes_num,
+               (double) tick_interval_sum / nodes_num, GOSSIP_ADAPTIVE ? " (adaptive)" : "");
+        if (GOSSIP_PARTIAL_VIEW) {
+            printf("active / passive view:      mean %.3f / %.3f members, %llu promoted\n",
+                   (double) members_sum / nodes_num, (double) passive_members_sum / nodes_num,
+                   (unsigned long long) total_stats.members_promoted);
+        } else {
+            printf("members known:              mean %.3f\n", (double) members_sum / nodes_num);
+        }
+        printf("messages disseminated:      %u of %u (coverage %.4f%%)\n",
+               self->messages_completed, self->messages_injected, coverage * 100.0);
+        printf("time to full dissemination: mean %.3f ms, max %.3f ms\n",
+               mean_dissemination_ms, max_dissemination_us / 1000.0);
+        printf("delivery latency:           p50 %.3f ms, p90 %.3f ms, p99 %.3f ms\n",
+               sim_percentile_ms(latencies, latencies_size, 0.5),
+               sim_percentile_ms(latencies, latencies_size, 0.9),
+               sim_percentile_ms(latencies, latencies_size, 0.99));
+        printf("messages per node:          %.3f\n", (double) messages_sent / nodes_num);
+        printf("bytes per node:             %.3f\n", (double) bytes_sent / nodes_num);
+        if (options->network.zones_num > 1) {
+            printf("cross-zone per node:        %.3f (%u zones, %u bridges each)\n",
+                   (double) messages_cross_zone / nodes_num, options->network.zones_num, options->bridges_num);
+        }
+        printf("messages dropped:           %llu\n", (unsigned long long) messages_dropped);
+        printf("retries / expired:          %llu / %llu\n", (unsigned long long) total_stats.retries,
+               (unsigned long long) total_stats.messages_expired);
+        printf("buffer evictions:           %llu\n", (unsigned long long) total_stats.buffer_evictions);
+        printf("failed nodes:               %u\n", options->failed_num);
+        printf("members suspected:          %llu (%llu indirect probes, %llu refuted)\n",
+               (unsigned long long) total_stats.members_suspected,
+               (unsigned long long) total_stats.indirect_probes,
+               (unsigned long long) total_stats.suspicions_refuted);
+        printf("members removed:            %llu of %llu expected, last at %.3f ms\n",
+               (unsigned long long) total_stats.members_removed,
+               (unsigned long long) self->expected_removals, self->last_removal_us / 1000.0);
+        printf("member events sent:         %llu (%llu resent from the log)\n",
+               (unsigned long long) total_stats.member_events_sent,
+               (unsigned long long) total_stats.member_log_events_sent);
+        printf("relays suppressed:          %llu\n", (unsigned long long) total_stats.relays_suppressed);
+        printf("sends paced:                %llu\n", (unsigned long long) total_stats.sends_paced);
+        printf("hop latency (histogram):    p50 %.3f ms, p99 %.3f ms\n",
+               pittacus_histogram_percentile(&total_latency.hop_latency, 50.0) / 1000.0,
+               pittacus_histogram_percentile(&total_latency.hop_latency, 99.0) / 1000.0);
+        printf("propagation age:            p50 %.3f ms, p99 %.3f ms\n",
+               pittacus_histogram_percentile(&total_latency.propagation_age, 50.0) / 1000.0,
+               pittacus_histogram_percentile(&total_latency.propagation_age, 99.0) / 1000.0);
+        printf("ack round trip time:        p50 %.3f ms, p99 %.3f ms\n",
+               pittacus_histogram_percentile(&total_latency.ack_rtt, 50.0) / 1000.0,
+               pittacus_histogram_percentile(&total_latency.ack_rtt, 99.0) / 1000.0);
+        if (coordinate_errors_size > 0) {
+            printf("coordinate error:           p50 %.1f%%, p90 %.1f%% (%zu pairs)\n", coordinate_error_p50 * 100.0,
+                   coordinate_error_p90 * 100.0, coordinate_errors_size);
+        }
+        printf("simulated events:           %llu in %.3f s\n", (unsigned long long) events_num, wall_time_s);
+    }
+    free(latencies);
+}
+
+static void sim_usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -n NODES     number of nodes (default 1000)\n"
+            "  -v VIEW      number of members known by each node (default 32)\n"
+            "  -m MESSAGES  number of injected data messages (default 1)\n"
+            "  -f FAILED    number of nodes crashed from the beginning (default 0)\n"
+            "  -i MS        interval between injected messages (default 100)\n"
+            "  -b BYTES     payload size (default 64)\n"
+            "  -l US        one way network latency in microseconds (default 500)\n"
+            "  -r US        random network jitter in microseconds (default 500)\n"
+            "  -p RATE      datagram loss rate from 0 to 1 (default 0)\n"
+            "  -z ZONES     number of zones the nodes are spread over (default 1)\n"
+            "  -w US        one way latency added between zones in microseconds (default 40000)\n"
+            "  -g BRIDGES   bridge nodes per zone, 0 to leave nodes unaware of zones (default 0)\n"
+            "  -t MS        virtual time limit in milliseconds (default 60000)\n"
+            "  -s SEED      random seed (default 1)\n"
+            "  -j           print the report as JSON\n", name);
+}
+
+int main(int argc, char **argv) {
+    sim_options_t options = {
+        .nodes_num = 1000,
+        .view_size = 32,
+        .messages_num = 1,
+        .message_interval_ms = 100,
+        .payload_size = 64,
+        .max_time_ms = 60000,
+        .bridges_num = 0,
+        .seed = 1,
+        .network = { .latency_us = 500, .jitter_us = 500, .loss_rate = 0.0, .zones_num = 1,
+                     .zone_latency_us = 40000 },
+        .json = 0
+    };
+
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "n:v:m:f:i:b:l:r:p:z:w:g:t:s:jh")) != -1) {
+        switch (opt) {
+            case 'n': options.nodes_num = strtoul(optarg, NULL, 10); break;
+            case 'v': options.view_size = strtoul(optarg, NULL, 10); break;
+            case 'm': options.messages_num = strtoul(optarg, NULL, 10); break;
+            case 'f': options.failed_num = strtoul(optarg, NULL, 10); break;
+            case 'i': options.message_interval_ms = strtoul(optarg, NULL, 10); break;
+            case 'b': options.payload_size = strtoul(optarg, NULL, 10); break;
+            case 'l': options.network.latency_us = strtoul(optarg, NULL, 10); break;
+            case 'r': options.network.jitter_us = strtoul(optarg, NULL, 10); break;
+            case 'p': options.network.loss_rate = strtod(optarg, NULL); break;
+            case 'z': options.network.zones_num = strtoul(optarg, NULL, 10); break;
+            case 'w': options.network.zone_latency_us = strtoul(optarg, NULL, 10); break;
+            case 'g': options.bridges_num = strtoul(optarg, NULL, 10); break;
+            case 't': options.max_time_ms = strtoul(optarg, NULL, 10); break;
+            case 's': options.seed = strtoull(optarg, NULL, 10); break;
+            case 'j': options.json = 1; break;
+            default:
+                sim_usage(argv[0]);
+                return opt == 'h' ? 0 : -1;
+        }
+    }
+    if (options.nodes_num < 2 || options.messages_num == 0 || options.failed_num >= options.nodes_num ||
+            options.payload_size < sizeof(uint32_t) || options.payload_size > MESSAGE_MAX_SIZE * 3 / 4) {
+        sim_usage(argv[0]);
+        return -1;
+    }
+
+    if (sim_platform_init(options.nodes_num, options.seed, &options.network) < 0) {
+        fprintf(stderr, "Simulator initialization failed\n");
+        return -1;
+    }
+    cluster.options = &options;
+    cluster.messages = (sim_message_t *) calloc(options.messages_num, sizeof(sim_message_t));
+    cluster.delivered_us = (uint64_t *) calloc((size_t) options.messages_num * options.nodes_num,
+                                               sizeof(uint64_t));
+    cluster.failed = (uint8_t *) calloc(options.nodes_num, sizeof(uint8_t));
+    cluster.next_tick_us = (uint64_t *) calloc(options.nodes_num, sizeof(uint64_t));
+    if (cluster.messages == NULL || cluster.delivered_us == NULL || cluster.failed == NULL ||
+        cluster.next_tick_us == NULL) {
+        fprintf(stderr, "Simulator initialization failed\n");
+        return -1;
+    }
+
+    struct timespec wall_start;
+    struct timespec wall_end;
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+
+    uint64_t events_num = 0;
+    int result = sim_create_nodes(&cluster);
+    sim_fail_nodes(&cluster);
+    if (result == 0) result = sim_bootstrap(&cluster);
+    if (result == 0) result = sim_run(&cluster, &events_num);
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    double wall_time_s = (wall_end.tv_sec - wall_start.tv_sec) +
+                         (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+
+    if (result < 0) {
+        fprintf(stderr, "Simulation failed: %d\n", result);
+    } else {
+        sim_report(&cluster, wall_time_s, events_num);
+    }
+
+    for (uint32_t i = 0; i < options.nodes_num; ++i) {
+        if (cluster.nodes != NULL && cluster.nodes[i] != NULL) pittacus_gossip_destroy(cluster.nodes[i]);
+    }
+    free(cluster.nodes);
+    free(cluster.messages);
+    free(cluster.delivered_us);
+    free(cluster.failed);
+    free(cluster.next_tick_us);
+    sim_platform_destroy();
+
+    if (result < 0) return -1;
+    // Non-zero exit code indicates that the dissemination has not completed.
+    return cluster.messages_completed == options.messages_num ? 0 : 1;
+}
@@ -0,0 +1,347 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "sim_platform.h"
+#include "messages.h"
+#include "utils.h"
+#include "errors.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_BASE_ADDRESS 0x0A000001
+// The virtual clock starts a bit later than zero, since zero timestamps
+// have a special meaning for some parts of the library.
+#define SIM_EPOCH_US 1000000
+
+typedef struct sim_socket {
+    pt_bool_t is_open;
+    sim_datagram_t *inbox_head;
+    sim_datagram_t *inbox_tail;
+    sim_socket_stats_t stats;
+} sim_socket_t;
+
+typedef struct sim_event_heap {
+    sim_event_t *events;
+    size_t size;
+    size_t capacity;
+} sim_event_heap_t;
+
+typedef struct sim_platform {
+    uint64_t now_us;
+    uint64_t random_state;
+    uint64_t events_order;
+    sim_network_config_t network;
+
+    sim_socket_t *sockets;
+    uint32_t sockets_num;
+    uint64_t message_types[UINT8_MAX + 1];
+
+    sim_event_heap_t heap;
+} sim_platform_t;
+
+static sim_platform_t sim;
+
+static int sim_event_less(const sim_event_t *first, const sim_event_t *second) {
+    if (first->ts != second->ts) return first->ts < second->ts;
+    return first->order < second->order;
+}
+
+static int sim_heap_push(sim_event_heap_t *heap, const sim_event_t *event) {
+    if (heap->size == heap->capacity) {
+        size_t new_capacity = heap->capacity == 0 ? 1024 : heap->capacity * 2;
+        sim_event_t *new_events = (sim_event_t *) realloc(heap->events, new_capacity * sizeof(sim_event_t));
+        if (new_events == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
+        heap->events = new_events;
+        heap->capacity = new_capacity;
+    }
+    size_t idx = heap->size++;
+    while (idx > 0) {
+        size_t parent = (idx - 1) / 2;
+        if (!sim_event_less(event, &heap->events[parent])) break;
+        heap->events[idx] = heap->events[parent];
+        idx = parent;
+    }
+    heap->events[idx] = *event;
+    return PITTACUS_ERR_NONE;
+}
+
+static int sim_heap_pop(sim_event_heap_t *heap, sim_event_t *result) {
+    if (heap->size == 0) return PITTACUS_ERR_NOT_FOUND;
+    *result = heap->events[0];
+    sim_event_t last = heap->events[--heap->size];
+    size_t idx = 0;
+    while (PT_TRUE) {
+        size_t child = idx * 2 + 1;
+        if (child >= heap->size) break;
+        if (child + 1 < heap->size && sim_event_less(&heap->events[child + 1], &heap->events[child])) {
+            ++child;
+        }
+        if (!sim_event_less(&heap->events[child], &last)) break;
+        heap->events[idx] = heap->events[child];
+        idx = child;
+    }
+    if (heap->size > 0) heap->events[idx] = last;
+    return PITTACUS_ERR_NONE;
+}
+
+static void sim_inbox_push(sim_socket_t *socket, sim_datagram_t *datagram) {
+    datagram->next = NULL;
+    if (socket->inbox_tail == NULL) {
+        socket->inbox_head = datagram;
+    } else {
+        socket->inbox_tail->next = datagram;
+    }
+    socket->inbox_tail = datagram;
+}
+
+static sim_datagram_t *sim_inbox_pop(sim_socket_t *socket) {
+    sim_datagram_t *datagram = socket->inbox_head;
+    if (datagram == NULL) return NULL;
+    socket->inbox_head = datagram->next;
+    if (socket->inbox_head == NULL) socket->inbox_tail = NULL;
+    return datagram;
+}
+
+static void sim_inbox_clear(sim_socket_t *socket) {
+    sim_datagram_t *datagram = NULL;
+    while ((datagram = sim_inbox_pop(socket)) != NULL) free(datagram);
+}
+
+static sim_datagram_t *sim_datagram_create(const pt_sockaddr_in *sender,
+                                           const uint8_t *buffer, size_t buffer_size) {
+    sim_datagram_t *datagram = (sim_datagram_t *) malloc(sizeof(sim_datagram_t) + buffer_size);
+    if (datagram == NULL) return NULL;
+    memcpy(&datagram->sender, sender, sizeof(pt_sockaddr_in));
+    memcpy(datagram->buffer, buffer, buffer_size);
+    datagram->size = buffer_size;
+    datagram->next = NULL;
+    return datagram;
+}
+
+int sim_platform_init(uint32_t sockets_num, uint64_t seed, const sim_network_config_t *config) {
+    memset(&sim, 0, sizeof(sim_platform_t));
+    sim.sockets = (sim_socket_t *) calloc(sockets_num, sizeof(sim_socket_t));
+    if (sim.sockets == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
+    sim.sockets_num = sockets_num;
+    sim.now_us = SIM_EPOCH_US;
+    sim.random_state = seed;
+    sim.network = *config;
+    return PITTACUS_ERR_NONE;
+}
+
+void sim_platform_destroy() {
+    for (uint32_t i = 0; i < sim.sockets_num; ++i) {
+        sim_inbox_clear(&sim.sockets[i]);
+    }
+    for (size_t i = 0; i < sim.heap.size; ++i) {
+        free(sim.heap.events[i].datagram);
+    }
+    free(sim.heap.events);
+    free(sim.sockets);
+    memset(&sim, 0, sizeof(sim_platform_t));
+}
+
+uint64_t sim_now_us() {
+    return sim.now_us;
+}
+
+uint32_t sim_random() {
+    // SplitMix64 generator: tiny, fast and good enough for the simulation.
+    uint64_t z = (sim.random_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (uint32_t) ((z ^ (z >> 31)) >> 32);
+}
+
+void sim_socket_address(uint32_t socket_idx, pt_sockaddr_in *result) {
+    memset(result, 0, sizeof(pt_sockaddr_in));
+    result->sin_family = AF_INET;
+    result->sin_port = PT_HTONS(SIM_PORT);
+    result->sin_addr.s_addr = PT_HTONL(SIM_BASE_ADDRESS + socket_idx);
+}
+
+int sim_socket_index(const pt_sockaddr_storage *addr, pt_socklen_t addr_len) {
+    if (addr->ss_family != AF_INET || addr_len < sizeof(pt_sockaddr_in)) return PITTACUS_ERR_NOT_FOUND;
+    const pt_sockaddr_in *addr_in = (const pt_sockaddr_in *) addr;
+    uint32_t host_addr = PT_NTOHL(addr_in->sin_addr.s_addr);
+    if (host_addr < SIM_BASE_ADDRESS || host_addr - SIM_BASE_ADDRESS >= sim.sockets_num) {
+        return PITTACUS_ERR_NOT_FOUND;
+    }
+    return host_addr - SIM_BASE_ADDRESS;
+}
+
+const sim_socket_stats_t *sim_socket_stats(uint32_t socket_idx) {
+    return &sim.sockets[socket_idx].stats;
+}
+
+uint64_t sim_message_type_count(uint8_t message_type) {
+    return sim.message_types[message_type];
+}
+
+void sim_socket_stats_reset() {
+    memset(sim.message_types, 0, sizeof(sim.message_types));
+    for (uint32_t i = 0; i < sim.sockets_num; ++i) {
+        memset(&sim.sockets[i].stats, 0, sizeof(sim_socket_stats_t));
+    }
+}
+
+int sim_inject(uint32_t socket_idx, const pt_sockaddr_in *sender, const uint8_t *buffer, size_t buffer_size) {
+    if (socket_idx >= sim.sockets_num) return PITTACUS_ERR_NOT_FOUND;
+    sim_datagram_t *datagram = sim_datagram_create(sender, buffer, buffer_size);
+    if (datagram == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
+    sim_inbox_push(&sim.sockets[socket_idx], datagram);
+    return PITTACUS_ERR_NONE;
+}
+
+int sim_schedule(uint64_t ts, sim_event_type_t type, uint32_t socket_idx, sim_datagram_t *datagram) {
+    sim_event_t event = {
+        .ts = ts < sim.now_us ? sim.now_us : ts,
+        .order = sim.events_order++,
+        .type = type,
+        .socket_idx = socket_idx,
+        .datagram = datagram
+    };
+    return sim_heap_push(&sim.heap, &event);
+}
+
+int sim_next_event(sim_event_t *result) {
+    if (sim_heap_pop(&sim.heap, result) < 0) return PITTACUS_ERR_NOT_FOUND;
+    sim.now_us = result->ts;
+    if (result->type == SIM_EVENT_DELIVER) {
+        sim_socket_t *socket = &sim.sockets[result->socket_idx];
+        if (socket->is_open) {
+            socket->stats.messages_received++;
+            socket->stats.bytes_received += result->datagram->size;
+            sim_inbox_push(socket, result->datagram);
+        } else {
+            free(result->datagram);
+        }
+        result->datagram = NULL;
+    }
+    return PITTACUS_ERR_NONE;
+}
+
+/*
+ * The Pittacus platform layer.
+ */
+
+uint64_t pt_time() {
+    return sim.now_us / 1000;
+}
+
+uint64_t pt_time_us() {
+    return sim.now_us;
+}
+
+uint32_t pt_random() {
+    return sim_random();
+}
+
+pt_socket_fd pt_socket(int domain, int type) {
+    errno = EAFNOSUPPORT;
+    return -1;
+}
+
+pt_socket_fd pt_socket_datagram(const pt_sockaddr_storage *addr, socklen_t addr_len) {
+    int idx = sim_socket_index(addr, addr_len);
+    if (idx < 0 || sim.sockets[idx].is_open) {
+        errno = EADDRNOTAVAIL;
+        return -1;
+    }
+    sim.sockets[idx].is_open = PT_TRUE;
+    return idx;
+}
+
+int pt_bind(pt_socket_fd fd, const pt_sockaddr_storage *addr, pt_socklen_t addr_len) {
+    return 0;
+}
+
+ssize_t pt_recv_from(pt_socket_fd fd, uint8_t *buffer, size_t buffer_size,
+                     pt_sockaddr_storage *addr, pt_socklen_t *addr_len) {
+    sim_datagram_t *datagram = sim_inbox_pop(&sim.sockets[fd]);
+    if (datagram == NULL) {
+        errno = EAGAIN;
+        return -1;
+    }
+    size_t size = datagram->size > buffer_size ? buffer_size : datagram->size;
+    memcpy(buffer, datagram->buffer, size);
+    memcpy(addr, &datagram->sender, sizeof(pt_sockaddr_in));
+    *addr_len = sizeof(pt_sockaddr_in);
+    free(datagram);
+    return size;
+}
+
+ssize_t pt_send_to(pt_socket_fd fd, const uint8_t *buffer, size_t buffer_size,
+                   const pt_sockaddr_storage *addr, pt_socklen_t addr_len) {
+    sim_socket_stats_t *stats = &sim.sockets[fd].stats;
+    stats->messages_sent++;
+    stats->bytes_sent += buffer_size;
+    if (buffer_size > PROTOCOL_ID_LENGTH) sim.message_types[buffer[PROTOCOL_ID_LENGTH]]++;
+
+    int recipient_idx = sim_socket_index(addr, addr_len);
+    if (recipient_idx < 0) {
+        // Nobody lives at this address.
+        stats->messages_dropped++;
+        return buffer_size;
+    }
+    if (sim.network.loss_rate > 0.0 && sim_random() < sim.network.loss_rate * UINT32_MAX) {
+        stats->messages_dropped++;
+        return buffer_size;
+    }
+
+    pt_sockaddr_in sender;
+    sim_socket_address(fd, &sender);
+    sim_datagram_t *datagram = sim_datagram_create(&sender, buffer, buffer_size);
+    if (datagram == NULL) return -1;
+
+    uint64_t latency = sim.network.latency_us;
+    if (sim.network.jitter_us > 0) latency += sim_random() % sim.network.jitter_us;
+    if (sim.network.zones_num > 1 && fd % sim.network.zones_num != recipient_idx % sim.network.zones_num) {
+        stats->messages_cross_zone++;
+        latency += sim.network.zone_latency_us;
+    }
+    if (sim_schedule(sim.now_us + latency, SIM_EVENT_DELIVER, recipient_idx, datagram) < 0) {
+        free(datagram);
+        return -1;
+    }
+    return buffer_size;
+}
+
+ssize_t pt_send_iov(pt_socket_fd fd, const pt_iovec *iov, int iov_len,
+                    const pt_sockaddr_storage *addr, pt_socklen_t addr_len) {
+    // The simulated network keeps its own copy of each datagram, so gather it right away.
+    size_t size = 0;
+    for (int i = 0; i < iov_len; ++i) size += iov[i].iov_len;
+    uint8_t buffer[size > 0 ? size : 1];
+    uint8_t *cursor = buffer;
+    for (int i = 0; i < iov_len; ++i) {
+        memcpy(cursor, iov[i].iov_base, iov[i].iov_len);
+        cursor += iov[i].iov_len;
+    }
+    return pt_send_to(fd, buffer, size, addr, addr_len);
+}
+
+void pt_close(pt_socket_fd fd) {
+    sim.sockets[fd].is_open = PT_FALSE;
+    sim_inbox_clear(&sim.sockets[fd]);
+}
+
+int pt_get_sock_name(pt_socket_fd fd, pt_sockaddr_storage *addr, pt_socklen_t *addr_len) {
+    if (*addr_len < sizeof(pt_sockaddr_in)) return -1;
+    sim_socket_address(fd, (pt_sockaddr_in *) addr);
+    *addr_len = sizeof(pt_sockaddr_in);
+    return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef PITTACUS_SIM_PLATFORM_H
+#define PITTACUS_SIM_PLATFORM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "network.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A deterministic replacement of the Pittacus platform layer. The library
+ * compiled with PITTACUS_CUSTOM_PLATFORM picks up the virtual clock, the
+ * seeded random generator and the in-memory datagram network from here.
+ *
+ * Every simulated socket is identified by its index. The socket with
+ * index N is bound to the address 10.0.0.0 + N + 1 and SIM_PORT, so the
+ * destination of each datagram is resolved without any lookups.
+ */
+
+#define SIM_PORT 7000
+
+typedef enum sim_event_type {
+    SIM_EVENT_DELIVER, /**< a datagram arrives to the socket. */
+    SIM_EVENT_TICK, /**< a timer of the node that owns the socket expires. */
+    SIM_EVENT_USER /**< an arbitrary scenario event, socket_idx is a user value. */
+} sim_event_type_t;
+
+typedef struct sim_datagram {
+    pt_sockaddr_in sender;
+    size_t size;
+    struct sim_datagram *next;
+    uint8_t buffer[];
+} sim_datagram_t;
+
+typedef struct sim_event {
+    uint64_t ts;
+    uint64_t order;
+    sim_event_type_t type;
+    uint32_t socket_idx;
+    sim_datagram_t *datagram;
+} sim_event_t;
+
+typedef struct sim_socket_stats {
+    uint64_t messages_sent;
+    uint64_t bytes_sent;
+    uint64_t messages_received;
+    uint64_t bytes_received;
+    uint64_t messages_dropped;
+    uint64_t messages_cross_zone; /**< datagrams sent to a socket in another zone. */
+} sim_socket_stats_t;
+
+typedef struct sim_network_config {
+    uint32_t latency_us; /**< the minimum one way latency of each datagram. */
+    uint32_t jitter_us; /**< the random latency added on top of the minimum. */
+    double loss_rate; /**< the probability that a datagram is lost. */
+    uint32_t zones_num; /**< sockets are assigned to zones round robin. Zero means a single zone. */
+    uint32_t zone_latency_us; /**< the latency added to datagrams between zones. */
+} sim_network_config_t;
+
+int sim_platform_init(uint32_t sockets_num, uint64_t seed, const sim_network_config_t *config);
+void sim_platform_destroy();
+
+uint64_t sim_now_us();
+uint32_t sim_random();
+
+void sim_socket_address(uint32_t socket_idx, pt_sockaddr_in *result);
+int sim_socket_index(const pt_sockaddr_storage *addr, pt_socklen_t addr_len);
+const sim_socket_stats_t *sim_socket_stats(uint32_t socket_idx);
+/** Retrieves the number of sent messages of the given protocol message type. */
+uint64_t sim_message_type_count(uint8_t message_type);
+void sim_socket_stats_reset();
+
+/**
+ * Puts the datagram directly into the socket's receive queue bypassing
+ * the simulated network. The datagram is not accounted in statistics.
+ */
+int sim_inject(uint32_t socket_idx, const pt_sockaddr_in *sender, const uint8_t *buffer, size_t buffer_size);
+
+int sim_schedule(uint64_t ts, sim_event_type_t type, uint32_t socket_idx, sim_datagram_t *datagram);
+
+/**
+ * Pops the earliest pending event and advances the virtual clock to its
+ * timestamp. Delivery events are completed automatically: the datagram is
+ * moved to the recipient's receive queue before this function returns.
+ *
+ * @return zero if the event was retrieved or negative value if there are no events.
+ */
+int sim_next_event(sim_event_t *result);
+
+#ifdef  __cplusplus
+} // extern "C"
+#endif
+
+#endif //PITTACUS_SIM_PLATFORM_H
@@ -21,14 +21,42 @@ extern "C" {
 #endif
 
 #ifndef PROTOCOL_VERSION
-#define PROTOCOL_VERSION 0x01
+/**
+ * The version of the wire format. Messages and members encoded with another
+ * version are rejected. Version 2 covers all message types and header flags
+ * introduced since version 1, including the piggybacked membership events.
+ */
+#define PROTOCOL_VERSION 0x02
 #endif
 
 #ifndef MESSAGE_RETRY_INTERVAL
-/** The interval in milliseconds between retry attempts. */
+/** The upper bound of the interval in milliseconds between retry attempts. */
 #define MESSAGE_RETRY_INTERVAL 10000
 #endif
 
+#ifndef MESSAGE_RETRY_TIMEOUT_INITIAL
+/**
+ * The retransmission timeout in milliseconds used until the round trip time
+ * to the recipient is measured. Afterwards the timeout is derived from the
+ * smoothed round trip time and its variation. The timeout doubles with each
+ * unacknowledged attempt.
+ */
+#define MESSAGE_RETRY_TIMEOUT_INITIAL 1000
+#endif
+
+#ifndef MESSAGE_RETRY_TIMEOUT_MIN
+/** The lower bound of the retransmission timeout in milliseconds. */
+#define MESSAGE_RETRY_TIMEOUT_MIN 10
+#endif
+
+#ifndef MESSAGE_RETRY_JITTER
+/**
+ * The upper bound of a random delay added to each retransmission timeout, in percent
+ * of the timeout. Spreads the retries of messages that were sent at the same time.
+ */
+#define MESSAGE_RETRY_JITTER 25
+#endif
+
 #ifndef MESSAGE_RETRY_ATTEMPTS
 /** The maximum number of attempts to deliver a message. */
 #define MESSAGE_RETRY_ATTEMPTS 3
@@ -49,11 +77,381 @@ extern "C" {
 #define MAX_OUTPUT_MESSAGES 100
 #endif
 
+#ifndef OUTBOUND_HIGH_WATERMARK
+/**
+ * The number of occupied output buffers at which new data payloads are rejected
+ * with PITTACUS_ERR_WOULD_BLOCK instead of evicting queued messages. The remaining
+ * buffers are left for the protocol messages.
+ */
+#define OUTBOUND_HIGH_WATERMARK (MAX_OUTPUT_MESSAGES * 3 / 4)
+#endif
+
+#ifndef OUTBOUND_LOW_WATERMARK
+/**
+ * The number of occupied output buffers at which the queue becomes writable
+ * again after it reached OUTBOUND_HIGH_WATERMARK.
+ */
+#define OUTBOUND_LOW_WATERMARK (MAX_OUTPUT_MESSAGES / 2)
+#endif
+
+#ifndef OUTBOUND_SEND_BUDGET
+/**
+ * The maximum number of messages written to the socket by a single
+ * pittacus_gossip_process_send() invocation. Zero means no limit.
+ */
+#define OUTBOUND_SEND_BUDGET 0
+#endif
+
+#ifndef OUTBOUND_WEIGHT_CONTROL
+/**
+ * The number of control messages (Hello, Welcome, Ack and probes) sent per
+ * round of the weighted round robin over the outbound lanes.
+ */
+#define OUTBOUND_WEIGHT_CONTROL 8
+#endif
+
+#ifndef OUTBOUND_WEIGHT_MEMBERSHIP
+/** The number of membership messages sent per round of the weighted round robin. */
+#define OUTBOUND_WEIGHT_MEMBERSHIP 4
+#endif
+
+#ifndef OUTBOUND_WEIGHT_ANTI_ENTROPY
+/** The number of anti-entropy messages sent per round of the weighted round robin. */
+#define OUTBOUND_WEIGHT_ANTI_ENTROPY 2
+#endif
+
+#ifndef OUTBOUND_WEIGHT_DATA
+/** The number of data messages sent per round of the weighted round robin. */
+#define OUTBOUND_WEIGHT_DATA 1
+#endif
+
+#ifndef SEND_RATE_BYTES
+/**
+ * The maximum number of bytes per second sent by the node. Messages above the
+ * rate stay in the outbound queue until the token bucket is refilled.
+ * Zero means no limit.
+ */
+#define SEND_RATE_BYTES 0
+#endif
+
+#ifndef SEND_RATE_PACKETS
+/** The maximum number of datagrams per second sent by the node. Zero means no limit. */
+#define SEND_RATE_PACKETS 0
+#endif
+
+#ifndef PEER_SEND_RATE_BYTES
+/** The maximum number of bytes per second sent to a single member. Zero means no limit. */
+#define PEER_SEND_RATE_BYTES 0
+#endif
+
+#ifndef PEER_SEND_RATE_PACKETS
+/** The maximum number of datagrams per second sent to a single member. Zero means no limit. */
+#define PEER_SEND_RATE_PACKETS 0
+#endif
+
+#ifndef SEND_BURST_INTERVAL
+/**
+ * The send rate limits allow bursts of up to this number of milliseconds
+ * worth of traffic after a quiet period.
+ */
+#define SEND_BURST_INTERVAL 10
+#endif
+
 #ifndef GOSSIP_TICK_INTERVAL
 /** The time interval in milliseconds that determines how often the Gossip tick event should be triggered. */
 #define GOSSIP_TICK_INTERVAL 1000
 #endif
 
+#ifndef GOSSIP_ADAPTIVE
+/**
+ * Whether the fanout and the tick interval should adapt to the cluster. When enabled,
+ * messages are spread to ceil(ln(n)) + GOSSIP_FANOUT_CONSTANT random members instead
+ * of MESSAGE_RUMOR_FACTOR, where n is the cluster size, and the anti-entropy interval
+ * is shortened when Status messages reveal diverged nodes and lengthened when the
+ * cluster is quiet.
+ */
+#define GOSSIP_ADAPTIVE 0
+#endif
+
+#ifndef GOSSIP_FANOUT_CONSTANT
+/** The constant added to the logarithm of the cluster size in the adaptive mode. */
+#define GOSSIP_FANOUT_CONSTANT 1
+#endif
+
+#ifndef GOSSIP_FANOUT_MAX
+/** The upper bound of the fanout in the adaptive mode. */
+#define GOSSIP_FANOUT_MAX 16
+#endif
+
+#ifndef GOSSIP_TICK_INTERVAL_MIN
+/** The lower bound of the tick interval in milliseconds in the adaptive mode. */
+#define GOSSIP_TICK_INTERVAL_MIN 250
+#endif
+
+#ifndef GOSSIP_TICK_INTERVAL_MAX
+/** The upper bound of the tick interval in milliseconds in the adaptive mode. */
+#define GOSSIP_TICK_INTERVAL_MAX 4000
+#endif
+
+#ifndef GOSSIP_LATENCY_AWARE
+/**
+ * Whether the members that receive rumors and Status messages should be chosen with
+ * a probability inversely proportional to their round trip time instead of uniformly.
+ * Nearby members take the most of the traffic, which reduces the dissemination latency
+ * and the traffic between distant sites.
+ */
+#define GOSSIP_LATENCY_AWARE 0
+#endif
+
+#ifndef GOSSIP_RANDOM_PEERS_PERCENT
+/**
+ * The share of gossip targets in percent that are still chosen uniformly in
+ * the latency-aware mode, so that rumors keep crossing to distant members.
+ */
+#define GOSSIP_RANDOM_PEERS_PERCENT 20
+#endif
+
+#ifndef GOSSIP_COORDINATES
+/**
+ * Whether nodes should maintain Vivaldi network coordinates. Each node piggybacks
+ * its coordinate on Status messages and on acknowledgements of Status and Ping
+ * messages, and moves it according to the measured round trip times. So the latency
+ * to any member with a known coordinate can be estimated without measuring it.
+ * The coordinates require protocol version 2.
+ */
+#define GOSSIP_COORDINATES 1
+#endif
+
+#ifndef VIVALDI_DIMENSIONS
+/** The number of dimensions of network coordinates. Must be the same on all nodes. */
+#define VIVALDI_DIMENSIONS 8
+#endif
+
+#ifndef ZONE_BRIDGE_INTERVAL
+/**
+ * The time interval in milliseconds between the anti-entropy rounds of bridge nodes
+ * with other zones. Nodes without a zone label don't use it.
+ */
+#define ZONE_BRIDGE_INTERVAL GOSSIP_TICK_INTERVAL
+#endif
+
+#ifndef ZONE_BRIDGE_FANOUT
+/** The number of members of other zones a bridge node sends its Status message to each round. */
+#define ZONE_BRIDGE_FANOUT 1
+#endif
+
+#ifndef GOSSIP_PARTIAL_VIEW
+/**
+ * Whether each node should know only a partial view of the cluster (HyParView). Gossip,
+ * probes and membership events run over a small active view, while a larger passive
+ * view holds replacements for failed active members and is refreshed by random walks.
+ * Joins are announced by random walks too, so per-node state and the cost of a join
+ * grow logarithmically with the cluster size.
+ */
+#define GOSSIP_PARTIAL_VIEW 0
+#endif
+
+#ifndef ACTIVE_VIEW_SIZE
+/** The maximum number of members in the active view. Should be about log(n) + 1. */
+#define ACTIVE_VIEW_SIZE 5
+#endif
+
+#ifndef PASSIVE_VIEW_SIZE
+/** The maximum number of members in the passive view. */
+#define PASSIVE_VIEW_SIZE 30
+#endif
+
+#ifndef ACTIVE_RANDOM_WALK_LENGTH
+/** The number of hops of the Forward Join random walk which announces a newcomer. */
+#define ACTIVE_RANDOM_WALK_LENGTH 6
+#endif
+
+#ifndef PASSIVE_RANDOM_WALK_LENGTH
+/** The remaining number of hops at which the Forward Join walk adds a newcomer to the passive view. */
+#define PASSIVE_RANDOM_WALK_LENGTH 3
+#endif
+
+#ifndef SHUFFLE_INTERVAL
+/** The time interval in milliseconds between the Shuffle walks which refresh the passive view. */
+#define SHUFFLE_INTERVAL 2000
+#endif
+
+#ifndef SHUFFLE_ACTIVE_MEMBERS
+/** The number of active members in a Shuffle sample. */
+#define SHUFFLE_ACTIVE_MEMBERS 1
+#endif
+
+#ifndef SHUFFLE_PASSIVE_MEMBERS
+/** The number of passive members in a Shuffle sample. */
+#define SHUFFLE_PASSIVE_MEMBERS 2
+#endif
+
+#ifndef GOSSIP_MEMBER_LOG
+/**
+ * Whether Status messages should carry the version of the sender's membership log.
+ * A node that sees a newer version than the one it has applied requests the missing
+ * join and leave events since that version, so membership changes lost together with
+ * their piggybacked events are still delivered by anti-entropy.
+ */
+#define GOSSIP_MEMBER_LOG 1
+#endif
+
+#ifndef MEMBER_LOG_SIZE
+/**
+ * The number of the latest membership changes kept in the log. A peer that has
+ * missed more changes than that receives the whole list of members instead.
+ */
+#define MEMBER_LOG_SIZE 32
+#endif
+
+#ifndef MESSAGE_DATA_TIMESTAMPS
+/**
+ * Whether originated Data messages should carry timestamps which are used
+ * to measure the hop latency and the propagation age of payloads. Disabled by
+ * default, since the timestamps add to every Data message.
+ * Note: nodes built without timestamps support reject such messages, so every
+ * node of the cluster must be built with the same setting.
+ */
+#define MESSAGE_DATA_TIMESTAMPS 0
+#endif
+
+#ifndef PROBE_INTERVAL
+/**
+ * The failure detector's protocol period in milliseconds. Each period one member
+ * is probed, so the probe load of a node doesn't depend on the cluster size.
+ */
+#define PROBE_INTERVAL 1000
+#endif
+
+#ifndef PROBE_TIMEOUT
+/**
+ * The time in milliseconds to wait for an acknowledgement of a direct probe
+ * before asking other members to probe the same member indirectly.
+ * Must be less than PROBE_INTERVAL.
+ */
+#define PROBE_TIMEOUT 300
+#endif
+
+#ifndef PROBE_INDIRECT_MEMBERS
+/** The number of members that are asked to probe an unresponsive member. */
+#define PROBE_INDIRECT_MEMBERS 3
+#endif
+
+#ifndef MEMBER_SUSPECT_TIMEOUT
+/**
+ * The time in milliseconds after which a suspected member that didn't
+ * refute the suspicion is declared dead and removed.
+ */
+#define MEMBER_SUSPECT_TIMEOUT 5000
+#endif
+
+#ifndef PHI_THRESHOLD
+/**
+ * The phi accrual suspicion level at which a member is considered unresponsive.
+ * A phi of 8 means that the chance to receive a message from the member after
+ * such a long silence is 10^-8. Alive members that reach the threshold are probed
+ * out of turn, suspected members are declared dead.
+ */
+#define PHI_THRESHOLD 8
+#endif
+
+#ifndef PHI_WINDOW_SIZE
+/** The number of the latest inter-arrival times used to estimate phi. */
+#define PHI_WINDOW_SIZE 32
+#endif
+
+#ifndef PHI_MIN_SAMPLES
+/**
+ * The minimum number of inter-arrival times required to estimate phi. Until
+ * then the suspected member is declared dead after MEMBER_SUSPECT_TIMEOUT.
+ */
+#define PHI_MIN_SAMPLES 8
+#endif
+
+#ifndef PHI_MIN_INTERVAL
+/**
+ * Messages that arrive from the same member within this number of milliseconds
+ * are counted as a single arrival, so bursts don't skew the mean interval.
+ */
+#define PHI_MIN_INTERVAL 100
+#endif
+
+#ifndef MEMBER_EVENTS_SIZE
+/**
+ * The maximum number of recent membership events (joins, suspicions, deaths)
+ * that are piggybacked on outgoing Status, Data and Ack messages.
+ */
+#define MEMBER_EVENTS_SIZE 32
+#endif
+
+#ifndef MEMBER_EVENT_RETRANSMIT_FACTOR
+/**
+ * Each membership event is piggybacked on MEMBER_EVENT_RETRANSMIT_FACTOR * log2(n)
+ * outgoing messages, where n is the number of known members.
+ */
+#define MEMBER_EVENT_RETRANSMIT_FACTOR 3
+#endif
+
+#ifndef DATA_LAZY_PUSH_THRESHOLD
+/**
+ * Data payloads larger than this number of bytes are spread lazily: members
+ * receive only an announcement of the payload and pull its body from one
+ * of the announcers if they haven't seen it yet. The pull costs an extra round
+ * trip per hop. Zero disables the lazy push, so all payloads are pushed eagerly.
+ */
+#define DATA_LAZY_PUSH_THRESHOLD 0
+#endif
+
+#ifndef DATA_PULL_TIMEOUT
+/**
+ * The time in milliseconds to wait for the announced payload before requesting
+ * it from another announcer.
+ */
+#define DATA_PULL_TIMEOUT 500
+#endif
+
+#ifndef GOSSIP_BROADCAST_TREE
+/**
+ * Whether data payloads should be spread over a broadcast tree (Plumtree). Payloads are
+ * pushed eagerly only to the tree neighbours and announced to random members. A member
+ * that receives a duplicate payload prunes the link it came from, and a member that
+ * learns about a payload from an announcement but doesn't receive it in time grafts
+ * the link to the announcer back into the tree.
+ */
+#define GOSSIP_BROADCAST_TREE 0
+#endif
+
+#ifndef BROADCAST_TREE_GRAFT_TIMEOUT
+/**
+ * The time in milliseconds to wait for an announced payload to arrive over the
+ * broadcast tree before requesting it from the announcer.
+ */
+#define BROADCAST_TREE_GRAFT_TIMEOUT 200
+#endif
+
+#ifndef DATA_RELAY_MAX_HOPS
+/**
+ * The maximum number of hops a data payload makes through random relays. Members
+ * that receive the payload on the last hop deliver it but don't relay it further.
+ * Zero means no limit.
+ */
+#define DATA_RELAY_MAX_HOPS 0
+#endif
+
+#ifndef DATA_RELAY_DUPLICATES
+/**
+ * When non-zero, eagerly pushed data payloads are relayed after a random delay
+ * of up to DATA_RELAY_DELAY milliseconds, and the relay is cancelled if this number
+ * of duplicates arrives in the meantime. Zero disables the suppression.
+ */
+#define DATA_RELAY_DUPLICATES 0
+#endif
+
+#ifndef DATA_RELAY_DELAY
+/** The upper bound of the relay delay in milliseconds used by the duplicate suppression. */
+#define DATA_RELAY_DELAY 50
+#endif
+
 #ifndef DATA_LOG_SIZE
 #define DATA_LOG_SIZE 25
 #endif
@@ -29,7 +29,9 @@ typedef enum pittacus_error {
     PITTACUS_ERR_BUFFER_NOT_ENOUGH = -5,
     PITTACUS_ERR_NOT_FOUND = -6,
     PITTACUS_ERR_WRITE_FAILED = -7,
-    PITTACUS_ERR_READ_FAILED = -8
+    PITTACUS_ERR_READ_FAILED = -8,
+    PITTACUS_ERR_INVALID_ARGUMENT = -9,
+    PITTACUS_ERR_WOULD_BLOCK = -10
 } pittacus_error_t;
 
 #ifdef  __cplusplus
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "failure_detector.h"
+#include <string.h>
+
+// 1 / ln(10), turns the exponent of the exponential distribution into -log10.
+#define PHI_FACTOR 0.4342944819032518
+
+void failure_detector_init(failure_detector_t *detector) {
+    memset(detector, 0, sizeof(failure_detector_t));
+}
+
+void failure_detector_arrival(failure_detector_t *detector, uint64_t arrival_us) {
+    if (detector->last_arrival_us == 0) {
+        detector->last_arrival_us = arrival_us;
+        return;
+    }
+    if (arrival_us < detector->last_arrival_us + PHI_MIN_INTERVAL * 1000ULL) return;
+
+    uint64_t interval = arrival_us - detector->last_arrival_us;
+    if (interval > UINT32_MAX) interval = UINT32_MAX;
+    detector->last_arrival_us = arrival_us;
+
+    if (detector->size < PHI_WINDOW_SIZE) {
+        ++detector->size;
+    } else {
+        // The window is full. Replace the oldest interval.
+        detector->intervals_sum -= detector->intervals[detector->current_idx];
+    }
+    detector->intervals[detector->current_idx] = (uint32_t) interval;
+    detector->intervals_sum += interval;
+    if (++detector->current_idx >= PHI_WINDOW_SIZE) detector->current_idx = 0;
+}
+
+int failure_detector_is_ready(const failure_detector_t *detector) {
+    return detector->size >= PHI_MIN_SAMPLES;
+}
+
+double failure_detector_phi(const failure_detector_t *detector, uint64_t current_us) {
+    if (!failure_detector_is_ready(detector) || current_us <= detector->last_arrival_us) return 0.0;
+    double mean = (double) detector->intervals_sum / detector->size;
+    return PHI_FACTOR * (current_us - detector->last_arrival_us) / mean;
+}
+
+uint64_t failure_detector_deadline(const failure_detector_t *detector, double phi) {
+    if (!failure_detector_is_ready(detector)) return UINT64_MAX;
+    double mean = (double) detector->intervals_sum / detector->size;
+    return detector->last_arrival_us + (uint64_t) (phi * mean / PHI_FACTOR);
+}
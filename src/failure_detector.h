@@ -0,0 +1,75 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef PITTACUS_FAILURE_DETECTOR_H
+#define PITTACUS_FAILURE_DETECTOR_H
+
+#include <stdint.h>
+#include "config.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The phi accrual failure detector. Instead of a binary verdict it yields
+ * the suspicion level phi = -log10(P), where P is the probability that the
+ * next message from the member arrives even later than now, given the
+ * inter-arrival times observed so far.
+ *
+ * Arrivals are regular protocol messages rather than periodic heartbeats,
+ * so like in Cassandra the inter-arrival times are assumed to be
+ * exponentially distributed. In this case phi grows linearly with the
+ * time since the last arrival: phi = t / (mean * ln(10)).
+ */
+typedef struct failure_detector {
+    uint64_t last_arrival_us;
+    uint32_t intervals[PHI_WINDOW_SIZE]; /**< the latest inter-arrival times in microseconds. */
+    uint32_t size;
+    uint32_t current_idx;
+    uint64_t intervals_sum;
+} failure_detector_t;
+
+void failure_detector_init(failure_detector_t *detector);
+
+/**
+ * Records the arrival of a message. Arrivals that are closer than
+ * PHI_MIN_INTERVAL to the previous one are considered to be a part of
+ * the same burst and are ignored.
+ */
+void failure_detector_arrival(failure_detector_t *detector, uint64_t arrival_us);
+
+/** Checks whether enough arrivals have been observed to estimate phi. */
+int failure_detector_is_ready(const failure_detector_t *detector);
+
+/**
+ * Calculates the suspicion level at the given moment.
+ *
+ * @return the phi value or zero if the detector is not ready.
+ */
+double failure_detector_phi(const failure_detector_t *detector, uint64_t current_us);
+
+/**
+ * Calculates the moment when the suspicion level reaches the given threshold.
+ *
+ * @return the time in microseconds or UINT64_MAX if the detector is not ready.
+ */
+uint64_t failure_detector_deadline(const failure_detector_t *detector, double phi);
+
+#ifdef  __cplusplus
+} // extern "C"
+#endif
+
+#endif //PITTACUS_FAILURE_DETECTOR_H
@@ -17,6 +17,8 @@
 #include "messages.h"
 #include "member.h"
 #include "vector_clock.h"
+#include "histogram.h"
+#include "trace.h"
 #include "config.h"
 #include "errors.h"
 #include <stdlib.h>
@@ -24,6 +26,18 @@
 
 #define RETURN_IF_NOT_CONNECTED(state) if ((state) != STATE_CONNECTED) return PITTACUS_ERR_BAD_STATE;
 
+// Statistics are modified only by the thread that drives the instance, but can be read
+// concurrently by pittacus_gossip_stats(). A relaxed load followed by a relaxed store
+// compiles into plain memory operations and still rules out torn values. Gauges shadow
+// the state of the instance, which is written with plain stores, and are published with
+// STATS_SET before each public function returns to the driving thread.
+#define STATS_ADD(self, field, value) \
+    __atomic_store_n(&(self)->stats.field, __atomic_load_n(&(self)->stats.field, __ATOMIC_RELAXED) + (value), \
+                     __ATOMIC_RELAXED)
+#define STATS_INC(self, field) STATS_ADD(self, field, 1)
+#define STATS_SET(self, field, value) __atomic_store_n(&(self)->stats.field, (value), __ATOMIC_RELAXED)
+#define STATS_LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
 typedef struct message_envelope_in {
     const pt_sockaddr_storage *sender;
     pt_socklen_t sender_len;
@@ -32,17 +46,38 @@ typedef struct message_envelope_in {
     size_t buffer_size;
 } message_envelope_in_t;
 
+/**
+ * A data payload that is shared by the data log and outbound messages instead of
+ * being copied into each of them. Released once the last reference is dropped.
+ */
+typedef struct data_payload {
+    const uint8_t *data;
+    uint16_t data_size;
+    uint32_t refs;
+
+    uint8_t priority; /**< the priority of outbound messages that carry the payload. */
+
+    data_release_t release; /**< only for borrowed payloads. */
+    void *release_context;
+
+    uint8_t storage[]; /**< the gathered payload unless it's borrowed. */
+} data_payload_t;
+
 typedef struct message_envelope_out {
     pt_sockaddr_storage recipient;
     pt_socklen_t recipient_len;
 
     const uint8_t *buffer;
     size_t buffer_size;
+    data_payload_t *payload; /**< if not NULL, it's sent at payload_offset of the buffer. */
+    size_t payload_offset;
 
     uint32_t sequence_num;
-    uint64_t attempt_ts;
+    uint64_t attempt_us;
+    uint64_t retry_us; /**< when the last attempt is considered lost. */
     uint16_t attempt_num;
     uint16_t max_attempts;
+    uint8_t lane; /**< the priority of the message. */
 
     struct message_envelope_out *prev;
     struct message_envelope_out *next;
@@ -51,12 +86,13 @@ typedef struct message_envelope_out {
 typedef struct message_queue {
     message_envelope_out_t *head;
     message_envelope_out_t *tail;
+    uint32_t size;
 } message_queue_t;
 
 typedef struct data_log_record {
     vector_record_t version;
-    uint16_t data_size;
-    uint8_t data[MESSAGE_MAX_SIZE];
+    uint64_t origin_ts;
+    data_payload_t *payload;
 } data_log_record_t;
 
 typedef struct data_log {
@@ -65,6 +101,85 @@ typedef struct data_log {
     uint32_t current_idx;
 } data_log_t;
 
+typedef enum probe_stage {
+    PROBE_IDLE = 0,
+    PROBE_DIRECT = 1, /**< waiting for the acknowledgement of the Ping message. */
+    PROBE_INDIRECT = 2 /**< waiting for the acknowledgement relayed by other members. */
+} probe_stage_t;
+
+typedef struct probe {
+    probe_stage_t stage;
+    pt_sockaddr_storage target;
+    pt_socklen_t target_len;
+    uint32_t target_uid;
+
+    uint32_t ping_seq;
+    uint32_t ping_req_seq_first;
+    uint32_t ping_req_num;
+
+    uint64_t started_us;
+    uint64_t next_probe_us;
+    uint32_t member_idx;
+} probe_t;
+
+/** A Ping message sent on behalf of another member. */
+typedef struct probe_relay {
+    pt_sockaddr_storage requester;
+    pt_socklen_t requester_len;
+    uint32_t requester_seq;
+    uint32_t ping_seq;
+    uint64_t expires_us;
+} probe_relay_t;
+
+#define PROBE_RELAYS_SIZE 16
+
+/** A recent change of the membership that is piggybacked on outgoing messages. */
+typedef struct member_event {
+    uint8_t state;
+    uint32_t incarnation;
+    uint16_t version;
+    uint32_t uid;
+    pt_sockaddr_storage address;
+    pt_socklen_t address_len;
+    uint32_t transmissions; /**< the number of messages that carried this event so far. */
+} member_event_t;
+
+/** A membership change kept in the log for peers that missed its piggybacked event. */
+typedef struct member_log_record {
+    uint32_t log_version;
+    uint8_t state;
+    uint32_t incarnation;
+    uint16_t version;
+    uint32_t uid;
+    pt_sockaddr_storage address;
+    pt_socklen_t address_len;
+} member_log_record_t;
+
+/** A payload that was announced by other members and requested from one of them. */
+typedef struct data_pull {
+    vector_record_t version;
+    pt_sockaddr_storage alternative; /**< another member that announced the same payload. */
+    pt_socklen_t alternative_len;
+    uint64_t expires_us;
+} data_pull_t;
+
+#define DATA_PULLS_SIZE 16
+
+/** A received data payload whose relay is postponed until enough duplicates are counted. */
+typedef struct data_relay {
+    vector_record_t version;
+    uint32_t first_sequence_num; /**< the sequence number of the first relay envelope. */
+    uint32_t envelopes_num; /**< the relay envelopes have consecutive sequence numbers. */
+    uint32_t duplicates;
+    uint64_t relay_us;
+} data_relay_t;
+
+#define DATA_RELAYS_SIZE 16
+
+/** The largest payload that fits into a Data message with all optional fields. */
+#define DATA_PAYLOAD_MAX_SIZE (MESSAGE_MAX_SIZE - sizeof(message_header_t) - VECTOR_RECORD_SIZE - \
+                               sizeof(uint16_t) - sizeof(uint8_t) - MESSAGE_TIMESTAMPS_SIZE)
+
 #define INPUT_BUFFER_SIZE MESSAGE_MAX_SIZE
 #define OUTPUT_BUFFER_SIZE MAX_OUTPUT_MESSAGES * MESSAGE_MAX_SIZE
 struct pittacus_gossip {
@@ -73,34 +188,90 @@ struct pittacus_gossip {
     uint8_t input_buffer[INPUT_BUFFER_SIZE];
     uint8_t output_buffer[OUTPUT_BUFFER_SIZE];
     size_t output_buffer_offset;
+    uint8_t send_buffer[MESSAGE_MAX_SIZE]; /**< membership events piggybacked on the message being sent. */
 
-    message_queue_t outbound_messages;
+    message_queue_t outbound_messages[PITTACUS_PRIORITIES]; /**< a lane per priority. */
+    pacer_t pacer; /**< the send rate limits of this node. */
+    uint64_t next_send_us; /**< when the outbound queue has something to send, UINT64_MAX if it's idle. */
 
     uint32_t sequence_num;
     uint32_t data_counter;
     vector_clock_t data_version;
+    vivaldi_coord_t coord; /**< the network coordinate of this node. */
 
     pittacus_gossip_state_t state;
     cluster_member_t self_address;
-    cluster_member_set_t members;
+    cluster_member_set_t members; /**< the active view if GOSSIP_PARTIAL_VIEW is set. */
+    cluster_member_set_t passive; /**< the passive view, only used if GOSSIP_PARTIAL_VIEW is set. */
 
     data_log_t data_log;
 
     uint64_t last_gossip_ts;
+    uint64_t last_bridge_ts; /**< the time of the last anti-entropy round with other zones. */
+    uint64_t last_shuffle_ts; /**< the time of the last Shuffle walk started by this node. */
+    uint32_t gossip_interval; /**< the interval between anti-entropy rounds in milliseconds. */
+    pt_bool_t gossip_diverged; /**< whether Status messages revealed diverged nodes since the last round. */
+
+    probe_t probe;
+    probe_relay_t probe_relays[PROBE_RELAYS_SIZE];
+    uint32_t probe_relays_idx;
+
+    member_event_t member_events[MEMBER_EVENTS_SIZE];
+    uint32_t member_events_size;
+
+    member_log_record_t member_log[MEMBER_LOG_SIZE]; /**< the latest membership changes, a ring. */
+    uint32_t member_log_version; /**< the version of the latest change in the log. */
+
+    data_pull_t data_pulls[DATA_PULLS_SIZE];
+    uint32_t data_pulls_idx;
+    pt_bool_t broadcast_tree_formed; /**< whether the initial tree neighbours have been chosen. */
+
+    data_relay_t data_relays[DATA_RELAYS_SIZE];
+    uint32_t data_relays_idx;
 
     data_receiver_t data_receiver;
     void *data_receiver_context;
+
+    pt_bool_t send_blocked; /**< whether a payload was rejected since the queue became writable. */
+    writable_callback_t writable_callback;
+    void *writable_context;
+
+    pittacus_gossip_stats_t stats;
+    pittacus_gossip_latency_t latency;
 };
 
+static data_payload_t *gossip_data_payload_create(size_t storage_size) {
+    data_payload_t *payload = (data_payload_t *) malloc(sizeof(data_payload_t) + storage_size);
+    if (payload == NULL) return NULL;
+    payload->data = payload->storage;
+    payload->data_size = storage_size;
+    payload->refs = 1;
+    payload->priority = PRIORITY_DATA;
+    payload->release = NULL;
+    payload->release_context = NULL;
+    return payload;
+}
+
+static void gossip_data_payload_release(data_payload_t *payload) {
+    if (payload == NULL || --payload->refs > 0) return;
+    if (payload->release != NULL) payload->release(payload->release_context, payload->data, payload->data_size);
+    free(payload);
+}
+
 static int gossip_data_log_create_message(const data_log_record_t *record, message_data_t *msg) {
     message_header_init(&msg->header, MESSAGE_DATA_TYPE, 0);
     vector_clock_record_copy(&msg->data_version, &record->version);
-    msg->data = (uint8_t *) record->data;
-    msg->data_size = record->data_size;
+    msg->data = (uint8_t *) record->payload->data;
+    msg->data_size = record->payload->data_size;
+    msg->hops = 0;
+    msg->origin_ts = record->origin_ts;
+    msg->sent_ts = 0;
+    // Keep the timestamps only if the payload was originated with them.
+    if (record->origin_ts != 0) msg->header.flags |= MESSAGE_FLAG_TIMESTAMPS;
     return PITTACUS_ERR_NONE;
 }
 
-static int gossip_data_log(data_log_t *log, const message_data_t *msg) {
+static int gossip_data_log(data_log_t *log, const message_data_t *msg, data_payload_t *payload) {
     data_log_record_t *record = NULL;
     for (int i = 0; i < log->size; ++i) {
         // Save only the latest data message from each originator.
@@ -116,11 +287,17 @@ static int gossip_data_log(data_log_t *log, const message_data_t *msg) {
         record = &log->messages[new_idx];
         vector_clock_record_copy(&record->version, &msg->data_version);
 
-        if (log->size < DATA_LOG_SIZE) ++log->size;
+        if (log->size < DATA_LOG_SIZE) {
+            // A new record. Otherwise the oldest one is evicted together with its payload.
+            ++log->size;
+            record->payload = NULL;
+        }
         if (++log->current_idx >= DATA_LOG_SIZE) log->current_idx = 0;
     }
-    record->data_size = msg->data_size;
-    memcpy(record->data, msg->data, msg->data_size);
+    gossip_data_payload_release(record->payload);
+    record->payload = payload;
+    ++payload->refs;
+    record->origin_ts = (msg->header.flags & MESSAGE_FLAG_TIMESTAMPS) ? msg->origin_ts : 0;
 
     return PITTACUS_ERR_NONE;
 }
@@ -128,7 +305,8 @@ static int gossip_data_log(data_log_t *log, const message_data_t *msg) {
 static message_envelope_out_t *gossip_envelope_create(
         uint32_t sequence_number,
         const uint8_t *buffer, size_t buffer_size,
-        uint16_t max_attempts,
+        data_payload_t *payload, size_t payload_offset,
+        uint16_t max_attempts, uint8_t lane,
         const pt_sockaddr_storage *recipient, pt_socklen_t recipient_len) {
     message_envelope_out_t *envelope = (message_envelope_out_t *) malloc(sizeof(message_envelope_out_t));
     if (envelope == NULL) return NULL;
@@ -136,16 +314,22 @@ static message_envelope_out_t *gossip_envelope_create(
     envelope->next = NULL;
     envelope->prev = NULL;
     envelope->attempt_num = 0;
-    envelope->attempt_ts = 0;
+    envelope->attempt_us = 0;
+    envelope->retry_us = 0;
     envelope->buffer = buffer;
     envelope->buffer_size = buffer_size;
+    envelope->payload = payload;
+    envelope->payload_offset = payload_offset;
+    if (payload != NULL) ++payload->refs;
     memcpy(&envelope->recipient, recipient, recipient_len);
     envelope->recipient_len = recipient_len;
     envelope->max_attempts = max_attempts;
+    envelope->lane = lane;
     return envelope;
 }
 
 static void gossip_envelope_destroy(message_envelope_out_t *envelope) {
+    gossip_data_payload_release(envelope->payload);
     free(envelope);
 }
 
@@ -158,6 +342,7 @@ static void gossip_envelope_clear(message_queue_t *queue) {
     }
     queue->head = NULL;
     queue->tail = NULL;
+    queue->size = 0;
 }
 
 static int gossip_envelope_enqueue(message_queue_t *queue, message_envelope_out_t *envelope) {
@@ -170,6 +355,7 @@ static int gossip_envelope_enqueue(message_queue_t *queue, message_envelope_out_
         queue->tail->next = envelope;
         queue->tail = envelope;
     }
+    ++queue->size;
     return PITTACUS_ERR_NONE;
 }
 
@@ -186,6 +372,7 @@ static int gossip_envelope_remove(message_queue_t *queue, message_envelope_out_t
     } else {
         queue->head = next;
     }
+    --queue->size;
     gossip_envelope_destroy(envelope);
     return PITTACUS_ERR_NONE;
 }
@@ -199,21 +386,67 @@ static message_envelope_out_t *gossip_envelope_find_by_sequence_num(message_queu
     return NULL;
 }
 
+static message_envelope_out_t *gossip_outbound_find(pittacus_gossip_t *self, uint32_t sequence_num) {
+    for (int lane = 0; lane < PITTACUS_PRIORITIES; ++lane) {
+        message_envelope_out_t *envelope = gossip_envelope_find_by_sequence_num(&self->outbound_messages[lane],
+                                                                                sequence_num);
+        if (envelope != NULL) return envelope;
+    }
+    return NULL;
+}
+
+static void gossip_outbound_remove(pittacus_gossip_t *self, message_envelope_out_t *envelope) {
+    gossip_envelope_remove(&self->outbound_messages[envelope->lane], envelope);
+}
+
+static uint32_t gossip_outbound_size(pittacus_gossip_t *self) {
+    uint32_t size = 0;
+    for (int lane = 0; lane < PITTACUS_PRIORITIES; ++lane) size += self->outbound_messages[lane].size;
+    return size;
+}
+
+static uint8_t gossip_message_lane(uint8_t msg_type, const data_payload_t *payload) {
+    switch (msg_type) {
+        case MESSAGE_HELLO_TYPE:
+        case MESSAGE_WELCOME_TYPE:
+        case MESSAGE_ACK_TYPE:
+        case MESSAGE_PING_TYPE:
+        case MESSAGE_PING_REQ_TYPE:
+            return PRIORITY_CONTROL;
+        case MESSAGE_MEMBER_LIST_TYPE:
+        case MESSAGE_MEMBER_STATE_TYPE:
+        case MESSAGE_NEIGHBOR_TYPE:
+        case MESSAGE_DISCONNECT_TYPE:
+        case MESSAGE_FORWARD_JOIN_TYPE:
+        case MESSAGE_SHUFFLE_TYPE:
+        case MESSAGE_MEMBER_LOG_TYPE:
+            return PRIORITY_MEMBERSHIP;
+        case MESSAGE_STATUS_TYPE:
+            return PRIORITY_ANTI_ENTROPY;
+        case MESSAGE_DATA_TYPE:
+            return payload != NULL ? payload->priority : PRIORITY_DATA;
+        default:
+            return PRIORITY_DATA;
+    }
+}
+
 static const uint8_t *gossip_find_available_output_buffer(pittacus_gossip_t *self) {
     pt_bool_t buffer_is_occupied[MAX_OUTPUT_MESSAGES];
     memset(buffer_is_occupied, 0, MAX_OUTPUT_MESSAGES * sizeof(pt_bool_t));
 
     message_envelope_out_t *oldest_envelope = NULL;
-    message_envelope_out_t *head = self->outbound_messages.head;
-    while(head != NULL) {
-        if (oldest_envelope == NULL || head->attempt_num > oldest_envelope->attempt_num) {
-            oldest_envelope = head;
-        }
-        const uint8_t *buffer = head->buffer;
-        uint32_t index = (buffer - self->output_buffer) / MESSAGE_MAX_SIZE;
-        buffer_is_occupied[index] = PT_TRUE;
+    for (int lane = 0; lane < PITTACUS_PRIORITIES; ++lane) {
+        message_envelope_out_t *head = self->outbound_messages[lane].head;
+        while(head != NULL) {
+            if (oldest_envelope == NULL || head->attempt_num > oldest_envelope->attempt_num) {
+                oldest_envelope = head;
+            }
+            const uint8_t *buffer = head->buffer;
+            uint32_t index = (buffer - self->output_buffer) / MESSAGE_MAX_SIZE;
+            buffer_is_occupied[index] = PT_TRUE;
 
-        head = head->next;
+            head = head->next;
+        }
     }
 
     // Looking for a buffer that is not used by any message in the outbound queue.
@@ -225,17 +458,48 @@ static const uint8_t *gossip_find_available_output_buffer(pittacus_gossip_t *sel
     // to overwrite its buffer.
     const uint8_t *chosen_buffer = oldest_envelope->buffer;
     while (oldest_envelope != NULL && oldest_envelope->buffer == chosen_buffer) {
-        // Remove all messages that share the same buffer's region.
+        // Remove all messages that share the same buffer's region. They are all in the same lane.
         message_envelope_out_t *to_remove = oldest_envelope;
         oldest_envelope = oldest_envelope->next;
-        gossip_envelope_remove(&self->outbound_messages, to_remove);
+        PT_TRACE5(message__evict, self, message_type_decode(to_remove->buffer, to_remove->buffer_size),
+                  to_remove->sequence_num, to_remove->attempt_num, &to_remove->recipient);
+        gossip_outbound_remove(self, to_remove);
+        STATS_INC(self, buffer_evictions);
     }
     return chosen_buffer;
 }
 
+static uint32_t gossip_output_buffers_used(pittacus_gossip_t *self) {
+    pt_bool_t buffer_is_occupied[MAX_OUTPUT_MESSAGES];
+    memset(buffer_is_occupied, 0, MAX_OUTPUT_MESSAGES * sizeof(pt_bool_t));
+    uint32_t used = 0;
+    for (int lane = 0; lane < PITTACUS_PRIORITIES; ++lane) {
+        for (message_envelope_out_t *head = self->outbound_messages[lane].head; head != NULL; head = head->next) {
+            uint32_t index = (head->buffer - self->output_buffer) / MESSAGE_MAX_SIZE;
+            if (!buffer_is_occupied[index]) ++used;
+            buffer_is_occupied[index] = PT_TRUE;
+        }
+    }
+    return used;
+}
+
+static pt_bool_t gossip_outbound_is_full(pittacus_gossip_t *self) {
+    if (gossip_output_buffers_used(self) < OUTBOUND_HIGH_WATERMARK) return PT_FALSE;
+    // Evicting queued messages would lose data silently. Let the producer back off instead.
+    self->send_blocked = PT_TRUE;
+    STATS_INC(self, sends_blocked);
+    return PT_TRUE;
+}
+
+static void gossip_outbound_drained(pittacus_gossip_t *self) {
+    if (!self->send_blocked || gossip_output_buffers_used(self) > OUTBOUND_LOW_WATERMARK) return;
+    self->send_blocked = PT_FALSE;
+    if (self->writable_callback != NULL) self->writable_callback(self->writable_context, self);
+}
+
 static uint32_t gossip_update_output_buffer_offset(pittacus_gossip_t *self) {
     uint32_t offset = 0;
-    if (self->outbound_messages.head != NULL) {
+    if (gossip_outbound_size(self) > 0) {
         offset = gossip_find_available_output_buffer(self) - self->output_buffer;
     }
     self->output_buffer_offset = offset;
@@ -245,23 +509,61 @@ static uint32_t gossip_update_output_buffer_offset(pittacus_gossip_t *self) {
 static int gossip_enqueue_to_outbound(pittacus_gossip_t *self,
                                       const uint8_t *buffer,
                                       size_t buffer_size,
+                                      data_payload_t *payload,
+                                      size_t payload_offset,
                                       uint16_t max_attempts,
+                                      uint8_t lane,
                                       const pt_sockaddr_storage *receiver,
                                       pt_socklen_t receiver_size) {
     uint32_t seq_num = ++self->sequence_num;
     message_envelope_out_t *new_envelope = gossip_envelope_create(seq_num,
                                                                   buffer, buffer_size,
-                                                                  max_attempts,
+                                                                  payload, payload_offset,
+                                                                  max_attempts, lane,
                                                                   receiver, receiver_size);
     if (new_envelope == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
-    gossip_envelope_enqueue(&self->outbound_messages, new_envelope);
+    gossip_envelope_enqueue(&self->outbound_messages[lane], new_envelope);
+    self->next_send_us = 0;
+    PT_TRACE5(message__enqueue, self, message_type_decode(buffer, buffer_size), seq_num, buffer_size, receiver);
     return PITTACUS_ERR_NONE;
 }
 
+#define GOSSIP_RESERVOIR_SIZE (GOSSIP_FANOUT_MAX > MESSAGE_RUMOR_FACTOR ? GOSSIP_FANOUT_MAX : MESSAGE_RUMOR_FACTOR)
+
+static uint32_t gossip_fanout(uint32_t members_num) {
+    if (!GOSSIP_ADAPTIVE) return MESSAGE_RUMOR_FACTOR;
+    // ceil(ln(n)) + c members are enough for the rumor to reach every member
+    // with a high probability.
+    uint32_t cluster_size = members_num + 1;
+    uint32_t ln_n = 0;
+    for (double e_k = 1.0; e_k < cluster_size; e_k *= 2.718281828459045) ++ln_n;
+    uint32_t fanout = ln_n + GOSSIP_FANOUT_CONSTANT;
+    if (fanout < 1) fanout = 1;
+    return fanout > GOSSIP_FANOUT_MAX ? GOSSIP_FANOUT_MAX : fanout;
+}
+
+// The anti-entropy interval follows the Trickle algorithm: it drops to the minimum
+// as soon as an inconsistency is observed and doubles after each quiet round.
+static void gossip_divergence_detected(pittacus_gossip_t *self) {
+    if (!GOSSIP_ADAPTIVE) return;
+    self->gossip_diverged = PT_TRUE;
+    self->gossip_interval = GOSSIP_TICK_INTERVAL_MIN;
+}
+
+static void gossip_round_completed(pittacus_gossip_t *self) {
+    if (!GOSSIP_ADAPTIVE) return;
+    if (!self->gossip_diverged) {
+        self->gossip_interval *= 2;
+        if (self->gossip_interval > GOSSIP_TICK_INTERVAL_MAX) self->gossip_interval = GOSSIP_TICK_INTERVAL_MAX;
+    }
+    self->gossip_diverged = PT_FALSE;
+}
+
 typedef enum gossip_spreading_type {
     GOSSIP_DIRECT = 0,
     GOSSIP_RANDOM = 1,
-    GOSSIP_BROADCAST = 2
+    GOSSIP_BROADCAST = 2,
+    GOSSIP_TREE = 3 /**< to the broadcast tree neighbours except the given member. */
 } gossip_spreading_type_t;
 
 static int gossip_encode_message(uint8_t msg_type, const void *msg, uint8_t *buffer, uint16_t *max_attempts) {
@@ -299,41 +601,157 @@ static int gossip_encode_message(uint8_t msg_type, const void *msg, uint8_t *buf
             encode_result = message_status_encode((const message_status_t *) msg,
                                                   buffer, MESSAGE_MAX_SIZE);
             break;
+        case MESSAGE_PING_TYPE:
+            encode_result = message_ping_encode((const message_ping_t *) msg,
+                                                buffer, MESSAGE_MAX_SIZE);
+            // Probes are never retransmitted. The lack of acknowledgement
+            // is handled by the failure detector.
+            *max_attempts = 1;
+            break;
+        case MESSAGE_PING_REQ_TYPE:
+            encode_result = message_ping_req_encode((const message_ping_req_t *) msg,
+                                                    buffer, MESSAGE_MAX_SIZE);
+            *max_attempts = 1;
+            break;
+        case MESSAGE_MEMBER_STATE_TYPE:
+            encode_result = message_member_state_encode((const message_member_state_t *) msg,
+                                                        buffer, MESSAGE_MAX_SIZE);
+            break;
+        case MESSAGE_IHAVE_TYPE:
+            encode_result = message_ihave_encode((const message_ihave_t *) msg,
+                                                 buffer, MESSAGE_MAX_SIZE);
+            // Lost announcements are repaired by the anti-entropy.
+            *max_attempts = 1;
+            break;
+        case MESSAGE_IWANT_TYPE:
+            encode_result = message_iwant_encode((const message_iwant_t *) msg,
+                                                 buffer, MESSAGE_MAX_SIZE);
+            // Unanswered requests are repeated to another announcer.
+            *max_attempts = 1;
+            break;
+        case MESSAGE_PRUNE_TYPE:
+            encode_result = message_prune_encode((const message_prune_t *) msg,
+                                                 buffer, MESSAGE_MAX_SIZE);
+            // The next duplicate causes another Prune message.
+            *max_attempts = 1;
+            break;
+        case MESSAGE_GRAFT_TYPE:
+            encode_result = message_graft_encode((const message_graft_t *) msg,
+                                                 buffer, MESSAGE_MAX_SIZE);
+            *max_attempts = 1;
+            break;
+        case MESSAGE_NEIGHBOR_TYPE:
+            encode_result = message_neighbor_encode((const message_neighbor_t *) msg,
+                                                    buffer, MESSAGE_MAX_SIZE);
+            break;
+        case MESSAGE_DISCONNECT_TYPE:
+            encode_result = message_disconnect_encode((const message_disconnect_t *) msg,
+                                                      buffer, MESSAGE_MAX_SIZE);
+            break;
+        case MESSAGE_FORWARD_JOIN_TYPE:
+            encode_result = message_forward_join_encode((const message_forward_join_t *) msg,
+                                                        buffer, MESSAGE_MAX_SIZE);
+            break;
+        case MESSAGE_SHUFFLE_TYPE:
+            encode_result = message_shuffle_encode((const message_shuffle_t *) msg,
+                                                   buffer, MESSAGE_MAX_SIZE);
+            break;
+        case MESSAGE_MEMBER_LOG_TYPE:
+            encode_result = message_member_log_encode((const message_member_log_t *) msg,
+                                                      buffer, MESSAGE_MAX_SIZE);
+            break;
         default:
             return PITTACUS_ERR_INVALID_MESSAGE;
     }
     return encode_result;
 }
 
-static int gossip_enqueue_message(pittacus_gossip_t *self,
-                                  uint8_t msg_type,
-                                  const void *msg,
-                                  const pt_sockaddr_storage *recipient,
-                                  pt_socklen_t recipient_len,
-                                  gossip_spreading_type_t spreading_type) {
+static void gossip_broadcast_tree_init(pittacus_gossip_t *self) {
+    if (self->broadcast_tree_formed) return;
+    // Start with random tree neighbours. Redundant links are pruned later.
+    cluster_member_t *reservoir[GOSSIP_RESERVOIR_SIZE];
+    size_t members_num = cluster_member_set_random_members(&self->members, reservoir,
+                                                           gossip_fanout(self->members.size));
+    for (size_t i = 0; i < members_num; ++i) reservoir[i]->eager = 1;
+    self->broadcast_tree_formed = PT_TRUE;
+}
+
+static void gossip_broadcast_tree_link(pittacus_gossip_t *self,
+                                       const pt_sockaddr_storage *address, pt_socklen_t address_len,
+                                       uint8_t eager) {
+    cluster_member_t *member = cluster_member_set_find_by_addr(&self->members, address, address_len);
+    if (member != NULL) member->eager = eager;
+}
+
+static int gossip_enqueue_message_with_payload(pittacus_gossip_t *self,
+                                               uint8_t msg_type,
+                                               const void *msg,
+                                               data_payload_t *payload,
+                                               const pt_sockaddr_storage *recipient,
+                                               pt_socklen_t recipient_len,
+                                               gossip_spreading_type_t spreading_type) {
     uint32_t offset = gossip_update_output_buffer_offset(self);
     uint8_t *buffer = self->output_buffer + offset;
     uint16_t max_attempts = 0;
-    int encode_result = gossip_encode_message(msg_type, msg, buffer, &max_attempts);
+    size_t payload_offset = 0;
+    int encode_result = 0;
+    if (payload != NULL && msg_type == MESSAGE_DATA_TYPE) {
+        // The payload is not copied into the output buffer. It's sent from the shared buffer instead.
+        max_attempts = MESSAGE_RETRY_ATTEMPTS;
+        encode_result = message_data_encode_split((const message_data_t *) msg, buffer, MESSAGE_MAX_SIZE,
+                                                  &payload_offset);
+    } else {
+        payload = NULL;
+        encode_result = gossip_encode_message(msg_type, msg, buffer, &max_attempts);
+    }
     if (encode_result < 0) return encode_result;
+    uint8_t lane = gossip_message_lane(msg_type, payload);
 
     int result = PITTACUS_ERR_NONE;
     // Distribute the message.
     switch (spreading_type) {
         case GOSSIP_DIRECT:
             // Send message to a single recipient.
-            return gossip_enqueue_to_outbound(self, buffer, encode_result, max_attempts,
-                                              recipient, recipient_len);
+            return gossip_enqueue_to_outbound(self, buffer, encode_result, payload, payload_offset,
+                                              max_attempts, lane, recipient, recipient_len);
         case GOSSIP_RANDOM: {
             // Choose some number of random members to distribute the message.
-            cluster_member_t *reservoir[MESSAGE_RUMOR_FACTOR];
-            int receivers_num = cluster_member_set_random_members(&self->members,
-                                                                  reservoir, MESSAGE_RUMOR_FACTOR);
+            cluster_member_t *reservoir[GOSSIP_RESERVOIR_SIZE];
+            int receivers_num = 0;
+            if (self->self_address.zone != CLUSTER_MEMBER_ZONE_UNKNOWN) {
+                // Only bridge nodes talk to other zones, unless this node knows nobody in its own zone.
+                receivers_num = cluster_member_set_zone_members(&self->members, reservoir,
+                                                                gossip_fanout(self->members.size),
+                                                                self->self_address.zone, ZONE_LOCAL);
+            }
+            if (receivers_num == 0 && GOSSIP_LATENCY_AWARE) {
+                receivers_num = cluster_member_set_nearby_members(&self->members, reservoir,
+                                                                  gossip_fanout(self->members.size),
+                                                                  GOSSIP_RANDOM_PEERS_PERCENT,
+                                                                  GOSSIP_COORDINATES ? &self->coord : NULL);
+            } else if (receivers_num == 0) {
+                receivers_num = cluster_member_set_random_members(&self->members,
+                                                                  reservoir, gossip_fanout(self->members.size));
+            }
             for (int i = 0; i < receivers_num; ++i) {
                 // Create a new envelope for each recipient.
                 // Note: all created envelopes share the same buffer.
-                result = gossip_enqueue_to_outbound(self, buffer, encode_result, max_attempts,
-                                                    reservoir[i]->address, reservoir[i]->address_len);
+                result = gossip_enqueue_to_outbound(self, buffer, encode_result, payload, payload_offset,
+                                                    max_attempts, lane, reservoir[i]->address, reservoir[i]->address_len);
+                if (result < 0) return result;
+            }
+            break;
+        }
+        case GOSSIP_TREE: {
+            gossip_broadcast_tree_init(self);
+            for (int i = 0; i < self->members.size; ++i) {
+                // Note: all created envelopes share the same buffer.
+                cluster_member_t *member = self->members.set[i];
+                if (!member->eager) continue;
+                if (member->address_len == recipient_len &&
+                    memcmp(member->address, recipient, recipient_len) == 0) continue;
+                result = gossip_enqueue_to_outbound(self, buffer, encode_result, payload, payload_offset,
+                                                    max_attempts, lane, member->address, member->address_len);
                 if (result < 0) return result;
             }
             break;
@@ -344,8 +762,8 @@ static int gossip_enqueue_message(pittacus_gossip_t *self,
                 // Create a new envelope for each recipient.
                 // Note: all created envelopes share the same buffer.
                 cluster_member_t *member = self->members.set[i];
-                result = gossip_enqueue_to_outbound(self, buffer, encode_result, max_attempts,
-                                                    member->address, member->address_len);
+                result = gossip_enqueue_to_outbound(self, buffer, encode_result, payload, payload_offset,
+                                                    max_attempts, lane, member->address, member->address_len);
                 if (result < 0) return result;
             }
             break;
@@ -354,13 +772,33 @@ static int gossip_enqueue_message(pittacus_gossip_t *self,
     return result;
 }
 
+static int gossip_enqueue_message(pittacus_gossip_t *self,
+                                  uint8_t msg_type,
+                                  const void *msg,
+                                  const pt_sockaddr_storage *recipient,
+                                  pt_socklen_t recipient_len,
+                                  gossip_spreading_type_t spreading_type) {
+    return gossip_enqueue_message_with_payload(self, msg_type, msg, NULL, recipient, recipient_len, spreading_type);
+}
+
 static int gossip_enqueue_ack(pittacus_gossip_t *self,
                               uint32_t sequence_num,
                               const pt_sockaddr_storage *recipient,
-                              pt_socklen_t recipient_len) {
+                              pt_socklen_t recipient_len,
+                              pt_bool_t with_coordinate) {
     message_ack_t ack_msg;
     message_header_init(&ack_msg.header, MESSAGE_ACK_TYPE, 0);
     ack_msg.ack_sequence_num = sequence_num;
+    if (GOSSIP_COORDINATES && with_coordinate) {
+        ack_msg.header.flags |= MESSAGE_FLAG_COORDINATES;
+        ack_msg.coordinate = self->coord;
+    }
+    if (self->self_address.zone != CLUSTER_MEMBER_ZONE_UNKNOWN) {
+        // Members that have learned about this node from a membership event find out its zone.
+        ack_msg.header.flags |= MESSAGE_FLAG_ZONES;
+        ack_msg.zone = self->self_address.zone;
+        ack_msg.bridge = self->self_address.bridge;
+    }
     return gossip_enqueue_message(self, MESSAGE_ACK_TYPE, &ack_msg,
                                   recipient, recipient_len, GOSSIP_DIRECT);
 }
@@ -383,13 +821,208 @@ static int gossip_enqueue_hello(pittacus_gossip_t *self,
     message_hello_t hello_msg;
     message_header_init(&hello_msg.header, MESSAGE_HELLO_TYPE, 0);
     hello_msg.this_member = &self->self_address;
+    if (self->self_address.zone != CLUSTER_MEMBER_ZONE_UNKNOWN) hello_msg.header.flags |= MESSAGE_FLAG_ZONES;
     return gossip_enqueue_message(self, MESSAGE_HELLO_TYPE, &hello_msg,
                                   recipient, recipient_len, GOSSIP_DIRECT);
 }
 
-static int gossip_enqueue_data(pittacus_gossip_t *self,
-                               const uint8_t *data,
-                               uint16_t data_size) {
+static pt_bool_t gossip_data_is_lazy(uint16_t data_size) {
+    return DATA_LAZY_PUSH_THRESHOLD > 0 && data_size > DATA_LAZY_PUSH_THRESHOLD;
+}
+
+static int gossip_spread_data(pittacus_gossip_t *self, const message_data_t *msg, data_payload_t *payload,
+                              const pt_sockaddr_storage *sender, pt_socklen_t sender_len) {
+    if (GOSSIP_BROADCAST_TREE) {
+        message_data_t tree_msg = *msg;
+        tree_msg.header.flags |= MESSAGE_FLAG_TREE;
+        int result = gossip_enqueue_message_with_payload(self, MESSAGE_DATA_TYPE, &tree_msg, payload,
+                                                         sender, sender_len, GOSSIP_TREE);
+        if (result < 0) return result;
+        // Announcements to random members repair the tree.
+    } else if (!gossip_data_is_lazy(msg->data_size)) {
+        return gossip_enqueue_message_with_payload(self, MESSAGE_DATA_TYPE, msg, payload, NULL, 0, GOSSIP_RANDOM);
+    }
+    // Large payloads are only announced. Members that miss them will ask for the body.
+    message_ihave_t ihave_msg;
+    message_header_init(&ihave_msg.header, MESSAGE_IHAVE_TYPE, 0);
+    vector_clock_record_copy(&ihave_msg.data_version, &msg->data_version);
+    return gossip_enqueue_message(self, MESSAGE_IHAVE_TYPE, &ihave_msg, NULL, 0, GOSSIP_RANDOM);
+}
+
+static int gossip_enqueue_iwant(pittacus_gossip_t *self,
+                                const vector_record_t *data_version,
+                                const pt_sockaddr_storage *recipient,
+                                pt_socklen_t recipient_len) {
+    message_iwant_t iwant_msg;
+    message_header_init(&iwant_msg.header, MESSAGE_IWANT_TYPE, 0);
+    vector_clock_record_copy(&iwant_msg.data_version, data_version);
+    return gossip_enqueue_message(self, MESSAGE_IWANT_TYPE, &iwant_msg,
+                                  recipient, recipient_len, GOSSIP_DIRECT);
+}
+
+static int gossip_enqueue_graft(pittacus_gossip_t *self,
+                                const vector_record_t *data_version,
+                                const pt_sockaddr_storage *recipient,
+                                pt_socklen_t recipient_len) {
+    gossip_broadcast_tree_link(self, recipient, recipient_len, 1);
+    message_graft_t graft_msg;
+    message_header_init(&graft_msg.header, MESSAGE_GRAFT_TYPE, 0);
+    vector_clock_record_copy(&graft_msg.data_version, data_version);
+    return gossip_enqueue_message(self, MESSAGE_GRAFT_TYPE, &graft_msg,
+                                  recipient, recipient_len, GOSSIP_DIRECT);
+}
+
+static int gossip_enqueue_prune(pittacus_gossip_t *self,
+                                const pt_sockaddr_storage *recipient,
+                                pt_socklen_t recipient_len) {
+    gossip_broadcast_tree_link(self, recipient, recipient_len, 0);
+    message_prune_t prune_msg;
+    message_header_init(&prune_msg.header, MESSAGE_PRUNE_TYPE, 0);
+    return gossip_enqueue_message(self, MESSAGE_PRUNE_TYPE, &prune_msg,
+                                  recipient, recipient_len, GOSSIP_DIRECT);
+}
+
+static int gossip_enqueue_data_pull(pittacus_gossip_t *self,
+                                    const vector_record_t *data_version,
+                                    const pt_sockaddr_storage *recipient,
+                                    pt_socklen_t recipient_len) {
+    // In the broadcast tree mode the announcer becomes the tree neighbour.
+    if (GOSSIP_BROADCAST_TREE) return gossip_enqueue_graft(self, data_version, recipient, recipient_len);
+    return gossip_enqueue_iwant(self, data_version, recipient, recipient_len);
+}
+
+static int gossip_enqueue_data_record(pittacus_gossip_t *self,
+                                      const vector_record_t *data_version,
+                                      const pt_sockaddr_storage *recipient,
+                                      pt_socklen_t recipient_len) {
+    for (int i = 0; i < self->data_log.size; ++i) {
+        const data_log_record_t *record = &self->data_log.messages[i];
+        // The log keeps only the latest payload of each originator, which supersedes the requested one.
+        if (record->version.member_id == data_version->member_id &&
+            record->version.sequence_number >= data_version->sequence_number) {
+            message_data_t data_msg;
+            int result = gossip_data_log_create_message(record, &data_msg);
+            if (result < 0) return result;
+            return gossip_enqueue_message_with_payload(self, MESSAGE_DATA_TYPE, &data_msg, record->payload,
+                                                       recipient, recipient_len, GOSSIP_DIRECT);
+        }
+    }
+    return PITTACUS_ERR_NONE;
+}
+
+static data_pull_t *gossip_data_pull_find(pittacus_gossip_t *self, const vector_record_t *data_version) {
+    for (int i = 0; i < DATA_PULLS_SIZE; ++i) {
+        data_pull_t *pull = &self->data_pulls[i];
+        if (pull->expires_us != 0 && pull->version.member_id == data_version->member_id) return pull;
+    }
+    return NULL;
+}
+
+static void gossip_data_pull_complete(pittacus_gossip_t *self, const vector_record_t *data_version) {
+    data_pull_t *pull = gossip_data_pull_find(self, data_version);
+    if (pull != NULL && pull->version.sequence_number <= data_version->sequence_number) pull->expires_us = 0;
+}
+
+static int gossip_data_pull_tick(pittacus_gossip_t *self, uint64_t current_us, uint64_t *next_event_us) {
+    for (int i = 0; i < DATA_PULLS_SIZE; ++i) {
+        data_pull_t *pull = &self->data_pulls[i];
+        if (pull->expires_us == 0) continue;
+        if (pull->expires_us > current_us) {
+            if (pull->expires_us < *next_event_us) *next_event_us = pull->expires_us;
+            continue;
+        }
+        pull->expires_us = 0;
+        if (pull->alternative_len == 0 ||
+            vector_clock_compare_with_record(&self->data_version, &pull->version, PT_FALSE) != VC_BEFORE) {
+            continue;
+        }
+        // The payload didn't arrive in time. Ask an announcer that hasn't been asked yet.
+        int result = gossip_enqueue_data_pull(self, &pull->version, &pull->alternative, pull->alternative_len);
+        if (result < 0) return result;
+        pull->alternative_len = 0;
+        pull->expires_us = current_us + DATA_PULL_TIMEOUT * 1000ULL;
+        if (pull->expires_us < *next_event_us) *next_event_us = pull->expires_us;
+    }
+    return PITTACUS_ERR_NONE;
+}
+
+static int gossip_relay_data(pittacus_gossip_t *self, const message_data_t *msg, data_payload_t *payload,
+                             const pt_sockaddr_storage *sender, pt_socklen_t sender_len) {
+    if (GOSSIP_BROADCAST_TREE) return gossip_spread_data(self, msg, payload, sender, sender_len);
+    if (DATA_RELAY_MAX_HOPS > 0 && msg->hops + 1 >= DATA_RELAY_MAX_HOPS) {
+        // The payload has travelled far enough. Other members are reached by the anti-entropy.
+        STATS_INC(self, relays_suppressed);
+        return PITTACUS_ERR_NONE;
+    }
+    message_data_t relay_msg = *msg;
+    relay_msg.header.flags |= MESSAGE_FLAG_HOPS;
+    relay_msg.hops = msg->hops < UINT8_MAX ? msg->hops + 1 : UINT8_MAX;
+    uint32_t first_sequence_num = self->sequence_num + 1;
+    int result = gossip_spread_data(self, &relay_msg, payload, sender, sender_len);
+    // Only eager pushes are postponed. Large payloads are announced, so their bodies are not duplicated anyway.
+    if (result < 0 || DATA_RELAY_DUPLICATES == 0 || gossip_data_is_lazy(msg->data_size)) return result;
+    uint32_t envelopes_num = self->sequence_num + 1 - first_sequence_num;
+    if (envelopes_num == 0) return PITTACUS_ERR_NONE;
+
+    // Postpone the relay. The envelopes that have just been enqueued are at the tail of the data lane,
+    // since relayed payloads are always sent with the data priority.
+    uint64_t relay_us = pt_time_us() + (pt_random() % (DATA_RELAY_DELAY * 1000ULL + 1));
+    message_envelope_out_t *envelope = self->outbound_messages[PRIORITY_DATA].tail;
+    while (envelope != NULL && envelope->sequence_num - first_sequence_num < envelopes_num) {
+        envelope->attempt_us = relay_us;
+        envelope = envelope->prev;
+    }
+    data_relay_t *relay = &self->data_relays[self->data_relays_idx];
+    if (++self->data_relays_idx >= DATA_RELAYS_SIZE) self->data_relays_idx = 0;
+    vector_clock_record_copy(&relay->version, &msg->data_version);
+    relay->first_sequence_num = first_sequence_num;
+    relay->envelopes_num = envelopes_num;
+    relay->duplicates = 0;
+    relay->relay_us = relay_us;
+    return PITTACUS_ERR_NONE;
+}
+
+static void gossip_relay_duplicate(pittacus_gossip_t *self, const vector_record_t *data_version) {
+    uint64_t current_us = pt_time_us();
+    for (int i = 0; i < DATA_RELAYS_SIZE; ++i) {
+        data_relay_t *relay = &self->data_relays[i];
+        if (relay->relay_us <= current_us || relay->version.member_id != data_version->member_id ||
+            relay->version.sequence_number != data_version->sequence_number) {
+            continue;
+        }
+        if (++relay->duplicates < DATA_RELAY_DUPLICATES) return;
+
+        // Enough members have the payload already. Cancel the relay envelopes that haven't been sent yet.
+        message_queue_t *queue = &self->outbound_messages[PRIORITY_DATA];
+        message_envelope_out_t *envelope = queue->head;
+        while (envelope != NULL) {
+            message_envelope_out_t *current = envelope;
+            envelope = envelope->next;
+            if (current->sequence_num - relay->first_sequence_num < relay->envelopes_num &&
+                current->attempt_num == 0) {
+                gossip_envelope_remove(queue, current);
+            }
+        }
+        relay->relay_us = 0;
+        STATS_INC(self, relays_suppressed);
+        return;
+    }
+}
+
+static void gossip_relay_tick(pittacus_gossip_t *self, uint64_t current_us, uint64_t *next_event_us) {
+    for (int i = 0; i < DATA_RELAYS_SIZE; ++i) {
+        data_relay_t *relay = &self->data_relays[i];
+        if (relay->relay_us == 0) continue;
+        if (relay->relay_us <= current_us) {
+            // The relay is due. The envelopes are sent by the next process_send call.
+            relay->relay_us = 0;
+        } else if (relay->relay_us < *next_event_us) {
+            *next_event_us = relay->relay_us;
+        }
+    }
+}
+
+static int gossip_enqueue_data(pittacus_gossip_t *self, data_payload_t *payload) {
     // Update the local data version.
     uint32_t clock_counter = ++self->data_counter;
     vector_record_t *record = vector_clock_set(&self->data_version, &self->self_address,
@@ -398,69 +1031,327 @@ static int gossip_enqueue_data(pittacus_gossip_t *self,
     message_data_t data_msg;
     message_header_init(&data_msg.header, MESSAGE_DATA_TYPE, 0);
     vector_clock_record_copy(&data_msg.data_version, record);
-    data_msg.data = (uint8_t *) data;
-    data_msg.data_size = data_size;
+    data_msg.data = (uint8_t *) payload->data;
+    data_msg.data_size = payload->data_size;
+    data_msg.hops = 0;
+    data_msg.origin_ts = 0;
+    data_msg.sent_ts = 0;
+    if (MESSAGE_DATA_TIMESTAMPS) {
+        data_msg.header.flags |= MESSAGE_FLAG_TIMESTAMPS;
+        data_msg.origin_ts = pt_time_us();
+    }
 
-    // Add the data to our internal log.
-    gossip_data_log(&self->data_log, &data_msg);
+    // Add the data to our internal log. The log and outbound messages share the payload.
+    gossip_data_log(&self->data_log, &data_msg, payload);
 
-    return gossip_enqueue_message(self, MESSAGE_DATA_TYPE, &data_msg,
-                                  NULL, 0, GOSSIP_RANDOM);
+    return gossip_spread_data(self, &data_msg, payload, NULL, 0);
 }
 
 static int gossip_enqueue_status(pittacus_gossip_t *self,
+                                 uint32_t member_log_request,
                                  const pt_sockaddr_storage *recipient,
                                  pt_socklen_t recipient_len) {
     message_status_t status_msg;
     message_header_init(&status_msg.header, MESSAGE_STATUS_TYPE, 0);
     vector_clock_copy(&status_msg.data_version, &self->data_version);
+    if (GOSSIP_COORDINATES) {
+        status_msg.header.flags |= MESSAGE_FLAG_COORDINATES;
+        status_msg.coordinate = self->coord;
+    }
+    if (GOSSIP_MEMBER_LOG) {
+        status_msg.header.flags |= MESSAGE_FLAG_MEMBER_LOG;
+        status_msg.member_log_version = self->member_log_version;
+        status_msg.member_log_request = member_log_request;
+    }
 
     gossip_spreading_type_t spreading_type = recipient == NULL ? GOSSIP_RANDOM : GOSSIP_DIRECT;
     return gossip_enqueue_message(self, MESSAGE_STATUS_TYPE, &status_msg,
                                   recipient, recipient_len, spreading_type);
 }
 
-#define MEMBER_LIST_SYNC_SIZE (MESSAGE_MAX_SIZE / CLUSTER_MEMBER_SIZE)
+static int gossip_enqueue_ping(pittacus_gossip_t *self,
+                               const pt_sockaddr_storage *recipient,
+                               pt_socklen_t recipient_len,
+                               uint32_t *sequence_num) {
+    message_ping_t ping_msg;
+    message_header_init(&ping_msg.header, MESSAGE_PING_TYPE, 0);
+    int result = gossip_enqueue_message(self, MESSAGE_PING_TYPE, &ping_msg,
+                                        recipient, recipient_len, GOSSIP_DIRECT);
+    if (result < 0) return result;
+    *sequence_num = self->sequence_num;
+    return result;
+}
 
-static int gossip_enqueue_member_list(pittacus_gossip_t *self,
-                                      const pt_sockaddr_storage *recipient,
-                                      pt_socklen_t recipient_len) {
-    message_member_list_t member_list_msg;
-    message_header_init(&member_list_msg.header, MESSAGE_MEMBER_LIST_TYPE, 0);
+static int gossip_enqueue_ping_req(pittacus_gossip_t *self,
+                                   cluster_member_t *target,
+                                   const pt_sockaddr_storage *recipient,
+                                   pt_socklen_t recipient_len) {
+    message_ping_req_t ping_req_msg;
+    message_header_init(&ping_req_msg.header, MESSAGE_PING_REQ_TYPE, 0);
+    ping_req_msg.target = target;
+    return gossip_enqueue_message(self, MESSAGE_PING_REQ_TYPE, &ping_req_msg,
+                                  recipient, recipient_len, GOSSIP_DIRECT);
+}
 
-    const cluster_member_set_t *members = &self->members;
-    uint32_t members_num = (members->size > MEMBER_LIST_SYNC_SIZE) ? MEMBER_LIST_SYNC_SIZE : members->size;
-    if (members_num == 0) return PITTACUS_ERR_NONE;
+static int gossip_enqueue_member_state(pittacus_gossip_t *self,
+                                       uint8_t state, uint32_t incarnation,
+                                       cluster_member_t *member,
+                                       const pt_sockaddr_storage *recipient,
+                                       pt_socklen_t recipient_len) {
+    message_member_state_t member_state_msg;
+    message_header_init(&member_state_msg.header, MESSAGE_MEMBER_STATE_TYPE, 0);
+    member_state_msg.state = state;
+    member_state_msg.incarnation = incarnation;
+    member_state_msg.member = member;
+    return gossip_enqueue_message(self, MESSAGE_MEMBER_STATE_TYPE, &member_state_msg,
+                                  recipient, recipient_len, GOSSIP_DIRECT);
+}
 
-    // TODO: get rid of the redundant copying.
-    cluster_member_t *members_to_send = (cluster_member_t *) malloc(members_num * sizeof(cluster_member_t));
-    if (members_to_send == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
+static int gossip_enqueue_neighbor(pittacus_gossip_t *self, uint8_t priority,
+                                   const pt_sockaddr_storage *recipient,
+                                   pt_socklen_t recipient_len) {
+    message_neighbor_t neighbor_msg;
+    message_header_init(&neighbor_msg.header, MESSAGE_NEIGHBOR_TYPE, 0);
+    neighbor_msg.priority = priority;
+    neighbor_msg.this_member = &self->self_address;
+    return gossip_enqueue_message(self, MESSAGE_NEIGHBOR_TYPE, &neighbor_msg,
+                                  recipient, recipient_len, GOSSIP_DIRECT);
+}
 
-    int result = PITTACUS_ERR_NONE;
-    int to_send_idx = 0;
-    int member_idx = 0;
-    while (member_idx < members->size) {
-        // Send the list of all known members to a recipient.
+static int gossip_enqueue_disconnect(pittacus_gossip_t *self,
+                                     const pt_sockaddr_storage *recipient,
+                                     pt_socklen_t recipient_len) {
+    message_disconnect_t disconnect_msg;
+    message_header_init(&disconnect_msg.header, MESSAGE_DISCONNECT_TYPE, 0);
+    return gossip_enqueue_message(self, MESSAGE_DISCONNECT_TYPE, &disconnect_msg,
+                                  recipient, recipient_len, GOSSIP_DIRECT);
+}
+
+static int gossip_enqueue_forward_join(pittacus_gossip_t *self, uint8_t ttl,
+                                       cluster_member_t *member,
+                                       const pt_sockaddr_storage *recipient,
+                                       pt_socklen_t recipient_len) {
+    message_forward_join_t forward_join_msg;
+    message_header_init(&forward_join_msg.header, MESSAGE_FORWARD_JOIN_TYPE, 0);
+    forward_join_msg.ttl = ttl;
+    forward_join_msg.member = member;
+    return gossip_enqueue_message(self, MESSAGE_FORWARD_JOIN_TYPE, &forward_join_msg,
+                                  recipient, recipient_len, GOSSIP_DIRECT);
+}
+
+static void gossip_add_member_event(pittacus_gossip_t *self,
+                                    uint8_t state, uint32_t incarnation,
+                                    const cluster_member_t *member) {
+    member_event_t *event = NULL;
+    member_event_t *most_transmitted = NULL;
+    for (uint32_t i = 0; i < self->member_events_size; ++i) {
+        member_event_t *current = &self->member_events[i];
+        if (current->address_len == member->address_len &&
+                memcmp(&current->address, member->address, member->address_len) == 0) {
+            // The new event about the same member invalidates the old one.
+            event = current;
+            break;
+        }
+        if (most_transmitted == NULL || current->transmissions > most_transmitted->transmissions) {
+            most_transmitted = current;
+        }
+    }
+    if (event == NULL) {
+        // Replace the event that has been spread the most if the buffer is full.
+        event = self->member_events_size < MEMBER_EVENTS_SIZE ?
+                &self->member_events[self->member_events_size++] : most_transmitted;
+    }
+    event->state = state;
+    event->incarnation = incarnation;
+    event->version = member->version;
+    event->uid = member->uid;
+    memcpy(&event->address, member->address, member->address_len);
+    event->address_len = member->address_len;
+    event->transmissions = 0;
+
+    // Only joins and removals are logged. Suspicions and their refutations are
+    // transient and are resolved by the failure detector of each node anyway.
+    pt_bool_t is_join = state == MEMBER_ALIVE && incarnation == 0;
+    if (GOSSIP_MEMBER_LOG && (is_join || state == MEMBER_DEAD)) {
+        member_log_record_t *record = &self->member_log[self->member_log_version % MEMBER_LOG_SIZE];
+        record->log_version = ++self->member_log_version;
+        record->state = state;
+        record->incarnation = incarnation;
+        record->version = member->version;
+        record->uid = member->uid;
+        memcpy(&record->address, member->address, member->address_len);
+        record->address_len = member->address_len;
+    }
+}
+
+static uint32_t gossip_member_event_retransmit_limit(pittacus_gossip_t *self) {
+    // lambda * log2(n + 1), so the event reaches every member with a high probability.
+    uint32_t log_n = 0;
+    for (uint32_t n = self->members.size + 1; n > 1; n >>= 1) ++log_n;
+    return MEMBER_EVENT_RETRANSMIT_FACTOR * (log_n + 1);
+}
+
+static int gossip_piggyback_member_events(pittacus_gossip_t *self, size_t message_size) {
+    // Drop events that have been spread enough.
+    uint32_t limit = gossip_member_event_retransmit_limit(self);
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < self->member_events_size; ++i) {
+        if (self->member_events[i].transmissions < limit) {
+            if (size != i) self->member_events[size] = self->member_events[i];
+            ++size;
+        }
+    }
+    self->member_events_size = size;
+    if (size == 0) return 0;
+
+    // The least spread events go first.
+    member_event_t *order[MEMBER_EVENTS_SIZE];
+    for (uint32_t i = 0; i < size; ++i) {
+        member_event_t *event = &self->member_events[i];
+        uint32_t j = i;
+        for (; j > 0 && order[j - 1]->transmissions > event->transmissions; --j) order[j] = order[j - 1];
+        order[j] = event;
+    }
+
+    message_event_t events[MEMBER_EVENTS_SIZE];
+    uint8_t events_n = 0;
+    size_t total_size = message_size + MESSAGE_EVENTS_OVERHEAD;
+    for (uint32_t i = 0; i < size; ++i) {
+        member_event_t *event = order[i];
+        events[events_n] = (message_event_t) {
+            .state = event->state,
+            .incarnation = event->incarnation,
+            .member = {
+                .version = event->version,
+                .uid = event->uid,
+                .address_len = event->address_len,
+                .address = &event->address
+            }
+        };
+        size_t event_size = message_event_size(&events[events_n]);
+        if (total_size + event_size > MESSAGE_MAX_SIZE) continue;
+        total_size += event_size;
+        ++events_n;
+        ++event->transmissions;
+    }
+    if (events_n == 0) return 0;
+
+    int result = message_events_trailer_encode(events, events_n, self->send_buffer, MESSAGE_MAX_SIZE - message_size);
+    if (result > 0) STATS_ADD(self, member_events_sent, events_n);
+    return result;
+}
+
+/** The number of IPv4 members with zone labels that fit into a single Member List message. */
+#define MEMBER_LIST_SYNC_SIZE ((MESSAGE_MAX_SIZE - sizeof(message_header_t) - sizeof(uint16_t)) / \
+                               (CLUSTER_MEMBER_IPV4_SIZE + CLUSTER_MEMBER_ZONE_SIZE))
+
+static int gossip_enqueue_member_chunks(pittacus_gossip_t *self,
+                                        cluster_member_t **members, size_t members_n,
+                                        const pt_sockaddr_storage *recipient,
+                                        pt_socklen_t recipient_len) {
+    message_member_list_t member_list_msg;
+    cluster_member_t members_to_send[MEMBER_LIST_SYNC_SIZE];
+    size_t member_idx = 0;
+    while (member_idx < members_n) {
         // The list can be pretty big, so we split it into multiple messages.
-        while (to_send_idx < members_num && member_idx < members->size) {
-            memcpy(&members_to_send[to_send_idx], members->set[member_idx], sizeof(cluster_member_t));
-            ++to_send_idx;
+        // Members with addresses of other families take more space.
+        message_header_init(&member_list_msg.header, MESSAGE_MEMBER_LIST_TYPE, 0);
+        size_t message_size = sizeof(message_header_t) + sizeof(uint16_t);
+        size_t members_to_send_num = 0;
+        while (member_idx < members_n && members_to_send_num < MEMBER_LIST_SYNC_SIZE) {
+            cluster_member_t *member = members[member_idx];
+            size_t member_size = cluster_member_encoded_size(member) + CLUSTER_MEMBER_ZONE_SIZE;
+            if (message_size + member_size > MESSAGE_MAX_SIZE) break;
+            message_size += member_size;
+            memcpy(&members_to_send[members_to_send_num++], member, sizeof(cluster_member_t));
+            if (member->zone != CLUSTER_MEMBER_ZONE_UNKNOWN) member_list_msg.header.flags |= MESSAGE_FLAG_ZONES;
             ++member_idx;
         }
-        if (to_send_idx > 0) {
-            member_list_msg.members_n = to_send_idx;
-            member_list_msg.members = members_to_send;
-            result = gossip_enqueue_message(self, MESSAGE_MEMBER_LIST_TYPE, &member_list_msg,
+        member_list_msg.members_n = members_to_send_num;
+        member_list_msg.members = members_to_send;
+        int result = gossip_enqueue_message(self, MESSAGE_MEMBER_LIST_TYPE, &member_list_msg,
                                             recipient, recipient_len, GOSSIP_DIRECT);
-            if (result < 0) {
-                free(members_to_send);
-                return result;
+        if (result < 0) return result;
+    }
+    return PITTACUS_ERR_NONE;
+}
+
+static int gossip_enqueue_member_list(pittacus_gossip_t *self,
+                                      cluster_member_set_t *members,
+                                      const pt_sockaddr_storage *recipient,
+                                      pt_socklen_t recipient_len) {
+    // Send the list of all known members to a recipient.
+    return gossip_enqueue_member_chunks(self, members->set, members->size, recipient, recipient_len);
+}
+
+static int gossip_enqueue_member_sample(pittacus_gossip_t *self,
+                                        cluster_member_set_t *members, size_t sample_size,
+                                        const pt_sockaddr_storage *recipient,
+                                        pt_socklen_t recipient_len) {
+    cluster_member_t *reservoir[MEMBER_LIST_SYNC_SIZE];
+    if (sample_size > MEMBER_LIST_SYNC_SIZE) sample_size = MEMBER_LIST_SYNC_SIZE;
+    size_t members_num = cluster_member_set_random_members(members, reservoir, sample_size);
+    return gossip_enqueue_member_chunks(self, reservoir, members_num, recipient, recipient_len);
+}
+
+#define MEMBER_LOG_MESSAGE_HEADER_SIZE (sizeof(message_header_t) + sizeof(uint32_t) + sizeof(uint8_t))
+
+static int gossip_send_member_log(pittacus_gossip_t *self, uint32_t log_version,
+                                  message_event_t *events, uint8_t events_n,
+                                  const pt_sockaddr_storage *recipient, pt_socklen_t recipient_len) {
+    message_member_log_t member_log_msg;
+    message_header_init(&member_log_msg.header, MESSAGE_MEMBER_LOG_TYPE, 0);
+    member_log_msg.log_version = log_version;
+    member_log_msg.events_n = events_n;
+    member_log_msg.events = events;
+    int result = gossip_enqueue_message(self, MESSAGE_MEMBER_LOG_TYPE, &member_log_msg,
+                                        recipient, recipient_len, GOSSIP_DIRECT);
+    if (result >= 0) STATS_ADD(self, member_log_events_sent, events_n);
+    return result;
+}
+
+static int gossip_enqueue_member_log(pittacus_gossip_t *self,
+                                     uint32_t since_version,
+                                     const pt_sockaddr_storage *recipient,
+                                     pt_socklen_t recipient_len) {
+    if (since_version >= self->member_log_version) return PITTACUS_ERR_NONE;
+    if (self->member_log_version - since_version > MEMBER_LOG_SIZE) {
+        // Some of the changes have already left the log. Send the whole list of members
+        // instead, followed by the latest version, so the recipient doesn't request them again.
+        // Members that are gone are detected by the failure detector of the recipient.
+        int result = gossip_enqueue_member_list(self, &self->members, recipient, recipient_len);
+        if (result < 0) return result;
+        return gossip_send_member_log(self, self->member_log_version, NULL, 0, recipient, recipient_len);
+    }
+    uint32_t first_version = since_version + 1;
+
+    message_event_t events[MEMBER_LOG_SIZE];
+    uint8_t events_n = 0;
+    size_t message_size = MEMBER_LOG_MESSAGE_HEADER_SIZE;
+    for (uint32_t log_version = first_version; log_version <= self->member_log_version; ++log_version) {
+        member_log_record_t *record = &self->member_log[(log_version - 1) % MEMBER_LOG_SIZE];
+        message_event_t event = {
+            .state = record->state,
+            .incarnation = record->incarnation,
+            .member = {
+                .version = record->version,
+                .uid = record->uid,
+                .address_len = record->address_len,
+                .address = &record->address
             }
+        };
+        size_t event_size = message_event_size(&event);
+        if (message_size + event_size > MESSAGE_MAX_SIZE) {
+            // The message is full. Each message carries the last version it includes.
+            int result = gossip_send_member_log(self, log_version - 1, events, events_n, recipient, recipient_len);
+            if (result < 0) return result;
+            events_n = 0;
+            message_size = MEMBER_LOG_MESSAGE_HEADER_SIZE;
         }
-        to_send_idx = 0;
+        events[events_n++] = event;
+        message_size += event_size;
     }
-    free(members_to_send);
-    return result;
+    return gossip_send_member_log(self, self->member_log_version, events, events_n, recipient, recipient_len);
 }
 
 static int gossip_enqueue_data_log(pittacus_gossip_t *self,
@@ -476,19 +1367,436 @@ static int gossip_enqueue_data_log(pittacus_gossip_t *self,
             result = gossip_data_log_create_message(record, &data_msg);
             if (result < 0) return result;
 
-            result = gossip_enqueue_message(self, MESSAGE_DATA_TYPE, &data_msg,
-                                            recipient, recipient_len, GOSSIP_DIRECT);
+            result = gossip_enqueue_message_with_payload(self, MESSAGE_DATA_TYPE, &data_msg, record->payload,
+                                                         recipient, recipient_len, GOSSIP_DIRECT);
             if (result < 0) return result;
         }
     }
     return result;
 }
 
-static int gossip_handle_hello(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
-    RETURN_IF_NOT_CONNECTED(self->state);
-    message_hello_t msg;
-    int decode_result = message_hello_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
+static cluster_member_t *gossip_find_member(pittacus_gossip_t *self,
+                                            const pt_sockaddr_storage *address, pt_socklen_t address_len,
+                                            uint32_t uid) {
+    cluster_member_t *result = cluster_member_set_find_by_addr(&self->members, address, address_len);
+    // The same address may belong to a restarted instance of the node.
+    if (result != NULL && result->uid != uid) return NULL;
+    return result;
+}
+
+static pt_bool_t gossip_is_this_member(pittacus_gossip_t *self, const cluster_member_t *member) {
+    const cluster_member_t *this_member = &self->self_address;
+    return member->uid == this_member->uid && member->address_len == this_member->address_len &&
+            memcmp(member->address, this_member->address, member->address_len) == 0;
+}
+
+// Copies the member, so that the copy outlives the removal of the original from its set.
+static void gossip_member_snapshot(const cluster_member_t *member, pt_sockaddr_storage *address,
+                                   cluster_member_t *result) {
+    memcpy(address, member->address, member->address_len);
+    *result = *member;
+    result->address = address;
+    result->detector = NULL;
+    result->pacer = NULL;
+    result->rtt = NULL;
+    result->coord = NULL;
+}
+
+static void gossip_active_remove(pittacus_gossip_t *self, cluster_member_t *member) {
+    // Members that follow the removed one are shifted. Adjust the position of the
+    // next probe target, so none of them is skipped during the current round.
+    for (uint32_t i = 0; i < self->probe.member_idx && i < self->members.size; ++i) {
+        if (self->members.set[i] == member) {
+            --self->probe.member_idx;
+            break;
+        }
+    }
+    cluster_member_set_remove(&self->members, member);
+}
+
+static int gossip_passive_add(pittacus_gossip_t *self, cluster_member_t *member) {
+    if (gossip_is_this_member(self, member)) return PITTACUS_ERR_NONE;
+    if (cluster_member_set_find_by_addr(&self->members, member->address, member->address_len) != NULL) {
+        return PITTACUS_ERR_NONE;
+    }
+    cluster_member_t *known_member = cluster_member_set_find_by_addr(&self->passive, member->address,
+                                                                     member->address_len);
+    if (known_member != NULL) {
+        if (known_member->uid == member->uid) return PITTACUS_ERR_NONE;
+        // The node has been restarted since it was added.
+        cluster_member_set_remove(&self->passive, known_member);
+    } else if (self->passive.size >= PASSIVE_VIEW_SIZE) {
+        cluster_member_t *evicted = NULL;
+        cluster_member_set_random_members(&self->passive, &evicted, 1);
+        cluster_member_set_remove(&self->passive, evicted);
+    }
+    return cluster_member_set_put(&self->passive, member, 1);
+}
+
+// Moves the member from the active view to the passive one without declaring it dead.
+static int gossip_active_demote(pittacus_gossip_t *self, cluster_member_t *member) {
+    pt_sockaddr_storage address;
+    cluster_member_t demoted_member;
+    gossip_member_snapshot(member, &address, &demoted_member);
+    gossip_active_remove(self, member);
+    return gossip_passive_add(self, &demoted_member);
+}
+
+static int gossip_active_add(pittacus_gossip_t *self, cluster_member_t *member) {
+    if (gossip_is_this_member(self, member)) return PITTACUS_ERR_NONE;
+    if (cluster_member_set_find_by_addr(&self->members, member->address, member->address_len) != NULL) {
+        return PITTACUS_ERR_NONE;
+    }
+    if (self->members.size >= ACTIVE_VIEW_SIZE) {
+        // Make room by moving a random member to the passive view.
+        cluster_member_t *dropped = NULL;
+        cluster_member_set_random_members(&self->members, &dropped, 1);
+        int result = gossip_enqueue_disconnect(self, dropped->address, dropped->address_len);
+        if (result < 0) return result;
+        result = gossip_active_demote(self, dropped);
+        if (result < 0) return result;
+    }
+    int result = cluster_member_set_put(&self->members, member, 1);
+    if (result < 0) return result;
+    cluster_member_t *passive_member = cluster_member_set_find_by_addr(&self->passive, member->address,
+                                                                       member->address_len);
+    if (passive_member != NULL) cluster_member_set_remove(&self->passive, passive_member);
+    return PITTACUS_ERR_NONE;
+}
+
+// Fills the active view with members of the passive view. The new neighbours are asked
+// to add this node to their active views too.
+static int gossip_active_repair(pittacus_gossip_t *self) {
+    while (self->members.size < ACTIVE_VIEW_SIZE && self->passive.size > 0) {
+        cluster_member_t *candidate = NULL;
+        cluster_member_set_random_members(&self->passive, &candidate, 1);
+        // A node without active members can't be refused.
+        uint8_t priority = self->members.size == 0;
+
+        pt_sockaddr_storage address;
+        cluster_member_t promoted_member;
+        gossip_member_snapshot(candidate, &address, &promoted_member);
+        promoted_member.state = MEMBER_ALIVE;
+        promoted_member.state_ts = pt_time_us();
+        cluster_member_set_remove(&self->passive, candidate);
+
+        int result = gossip_active_add(self, &promoted_member);
+        if (result < 0) return result;
+        STATS_INC(self, members_promoted);
+        result = gossip_enqueue_neighbor(self, priority, &address, promoted_member.address_len);
+        if (result < 0) return result;
+    }
+    return PITTACUS_ERR_NONE;
+}
+
+// Chooses the next hop of a random walk among the active members other than the sender
+// and the given member.
+static cluster_member_t *gossip_random_walk_next(pittacus_gossip_t *self,
+                                                 const pt_sockaddr_storage *sender, pt_socklen_t sender_len,
+                                                 const cluster_member_t *excluded) {
+    cluster_member_t *reservoir[3];
+    size_t members_num = cluster_member_set_random_members(&self->members, reservoir, 3);
+    for (size_t i = 0; i < members_num; ++i) {
+        cluster_member_t *member = reservoir[i];
+        if (member->address_len == sender_len && memcmp(member->address, sender, sender_len) == 0) continue;
+        if (member->address_len == excluded->address_len &&
+                memcmp(member->address, excluded->address, excluded->address_len) == 0) continue;
+        return member;
+    }
+    return NULL;
+}
+
+static int gossip_remove_dead_member(pittacus_gossip_t *self, cluster_member_t *member) {
+    // Keep a copy of the member which outlives the removal.
+    pt_sockaddr_storage address;
+    cluster_member_t dead_member;
+    gossip_member_snapshot(member, &address, &dead_member);
+
+    gossip_active_remove(self, member);
+    STATS_INC(self, members_removed);
+
+    // Let other members know about the dead member.
+    gossip_add_member_event(self, MEMBER_DEAD, dead_member.incarnation, &dead_member);
+    // The failed active member is replaced right away.
+    if (GOSSIP_PARTIAL_VIEW) return gossip_active_repair(self);
+    return PITTACUS_ERR_NONE;
+}
+
+static int gossip_apply_member_state(pittacus_gossip_t *self, uint8_t state, uint32_t incarnation,
+                                     cluster_member_t *member,
+                                     const pt_sockaddr_storage *sender, pt_socklen_t sender_len) {
+    cluster_member_t *this_member = &self->self_address;
+    if (gossip_is_this_member(self, member)) {
+        // Someone suspects this node. Refute it by spreading the higher incarnation number.
+        if (state == MEMBER_ALIVE || incarnation < this_member->incarnation) return PITTACUS_ERR_NONE;
+        this_member->incarnation = incarnation + 1;
+        STATS_INC(self, suspicions_refuted);
+        // The sender of the suspicion is notified directly since it may be the only
+        // member that knows about this node.
+        gossip_add_member_event(self, MEMBER_ALIVE, this_member->incarnation, this_member);
+        return gossip_enqueue_member_state(self, MEMBER_ALIVE, this_member->incarnation, this_member,
+                                           sender, sender_len);
+    }
+
+    cluster_member_t *known_member = gossip_find_member(self, member->address, member->address_len, member->uid);
+    if (known_member == NULL && GOSSIP_PARTIAL_VIEW) {
+        // Members outside of the active view are only kept as candidates for it.
+        if (state == MEMBER_ALIVE) return gossip_passive_add(self, member);
+        cluster_member_t *passive_member = cluster_member_set_find_by_addr(&self->passive, member->address,
+                                                                           member->address_len);
+        if (state == MEMBER_DEAD && passive_member != NULL && passive_member->uid == member->uid) {
+            cluster_member_set_remove(&self->passive, passive_member);
+        }
+        return PITTACUS_ERR_NONE;
+    }
+    if (known_member == NULL) {
+        // A member that is alive but is missing locally: either a newcomer or a member
+        // that has been wrongly declared dead. Add it back, but spread the update further
+        // only in the former case: nodes that don't know about this member shouldn't
+        // learn about it from its refutation.
+        if (state != MEMBER_ALIVE) return PITTACUS_ERR_NONE;
+        member->incarnation = incarnation;
+        member->state_ts = pt_time_us();
+        int result = cluster_member_set_put(&self->members, member, 1);
+        if (result < 0) return result;
+        if (incarnation == 0) gossip_add_member_event(self, MEMBER_ALIVE, incarnation, member);
+        return PITTACUS_ERR_NONE;
+    }
+
+    // The update is stale. Don't spread it any further.
+    if (!cluster_member_state_overrides(known_member, state, incarnation)) return PITTACUS_ERR_NONE;
+    if (state == MEMBER_DEAD) return gossip_remove_dead_member(self, known_member);
+    known_member->state = state;
+    known_member->incarnation = incarnation;
+    known_member->state_ts = pt_time_us();
+    gossip_add_member_event(self, state, incarnation, member);
+    return PITTACUS_ERR_NONE;
+}
+
+static void gossip_store_coordinate(cluster_member_t *member, const vivaldi_coord_t *coord) {
+    if (member->coord == NULL) {
+        member->coord = (vivaldi_coord_t *) malloc(sizeof(vivaldi_coord_t));
+        if (member->coord == NULL) return;
+    }
+    *member->coord = *coord;
+}
+
+static void gossip_rtt_sample(pittacus_gossip_t *self, const pt_sockaddr_storage *address,
+                              pt_socklen_t address_len, uint64_t rtt_us,
+                              const vivaldi_coord_t *remote_coord) {
+    pittacus_histogram_record(&self->latency.ack_rtt, rtt_us);
+    cluster_member_t *member = cluster_member_set_find_by_addr(&self->members, address, address_len);
+    if (GOSSIP_COORDINATES) {
+        // The coordinate that came with the acknowledgement is the freshest one.
+        if (remote_coord == NULL && member != NULL) remote_coord = member->coord;
+        if (remote_coord != NULL) vivaldi_update(&self->coord, remote_coord, rtt_us);
+        if (remote_coord != NULL && member != NULL && remote_coord != member->coord) {
+            gossip_store_coordinate(member, remote_coord);
+        }
+    }
+    if (member == NULL) return;
+    if (member->rtt == NULL) {
+        member->rtt = (rtt_estimator_t *) malloc(sizeof(rtt_estimator_t));
+        if (member->rtt == NULL) return;
+        rtt_estimator_init(member->rtt);
+    }
+    rtt_estimator_sample(member->rtt, rtt_us);
+}
+
+static pt_bool_t gossip_probe_handle_ack(pittacus_gossip_t *self, const message_ack_t *ack) {
+    probe_t *probe = &self->probe;
+    uint32_t sequence_num = ack->ack_sequence_num;
+    if (probe->stage != PROBE_IDLE && sequence_num == probe->ping_seq) {
+        uint64_t rtt_us = pt_time_us() - probe->started_us;
+        gossip_rtt_sample(self, &probe->target, probe->target_len, rtt_us,
+                          (ack->header.flags & MESSAGE_FLAG_COORDINATES) ? &ack->coordinate : NULL);
+        PT_TRACE4(ack__match, self, sequence_num, 1, rtt_us);
+        probe->stage = PROBE_IDLE;
+        return PT_TRUE;
+    }
+    if (probe->stage == PROBE_INDIRECT && sequence_num - probe->ping_req_seq_first < probe->ping_req_num) {
+        // One of the members managed to reach out to the target.
+        probe->stage = PROBE_IDLE;
+        return PT_TRUE;
+    }
+
+    for (int i = 0; i < PROBE_RELAYS_SIZE; ++i) {
+        probe_relay_t *relay = &self->probe_relays[i];
+        if (relay->expires_us != 0 && relay->ping_seq == sequence_num) {
+            // Relay the acknowledgement to the member that requested the probe.
+            relay->expires_us = 0;
+            gossip_enqueue_ack(self, relay->requester_seq, &relay->requester, relay->requester_len, PT_FALSE);
+            return PT_TRUE;
+        }
+    }
+    return PT_FALSE;
+}
+
+static int gossip_probe_start(pittacus_gossip_t *self, cluster_member_t *target, uint64_t current_us) {
+    probe_t *probe = &self->probe;
+    if (target == NULL) {
+        // Members are probed in a round-robin fashion, so every member is probed
+        // at least once per (number of members * PROBE_INTERVAL) milliseconds.
+        if (probe->member_idx >= self->members.size) probe->member_idx = 0;
+        target = self->members.set[probe->member_idx++];
+        // Members of other zones are probed by their neighbours. Their failures arrive
+        // with the membership events relayed by bridge nodes.
+        for (uint32_t i = 0; i < self->members.size && !cluster_member_in_zone(target, self->self_address.zone); ++i) {
+            if (probe->member_idx >= self->members.size) probe->member_idx = 0;
+            target = self->members.set[probe->member_idx++];
+        }
+    }
+
+    memcpy(&probe->target, target->address, target->address_len);
+    probe->target_len = target->address_len;
+    probe->target_uid = target->uid;
+    probe->started_us = current_us;
+    probe->ping_req_num = 0;
+    probe->stage = PROBE_DIRECT;
+    return gossip_enqueue_ping(self, &probe->target, probe->target_len, &probe->ping_seq);
+}
+
+static int gossip_probe_indirect(pittacus_gossip_t *self) {
+    probe_t *probe = &self->probe;
+    cluster_member_t target = {
+        .version = PROTOCOL_VERSION,
+        .uid = probe->target_uid,
+        .address_len = probe->target_len,
+        .address = &probe->target
+    };
+
+    // Ask some random members to probe the target. The target itself may be chosen, so
+    // one extra member is requested.
+    cluster_member_t *reservoir[PROBE_INDIRECT_MEMBERS + 1];
+    size_t members_num = cluster_member_set_random_members(&self->members, reservoir, PROBE_INDIRECT_MEMBERS + 1);
+
+    probe->ping_req_seq_first = self->sequence_num + 1;
+    probe->ping_req_num = 0;
+    probe->stage = PROBE_INDIRECT;
+    for (size_t i = 0; i < members_num && probe->ping_req_num < PROBE_INDIRECT_MEMBERS; ++i) {
+        cluster_member_t *member = reservoir[i];
+        if (member->address_len == probe->target_len &&
+                memcmp(member->address, &probe->target, probe->target_len) == 0) continue;
+        int result = gossip_enqueue_ping_req(self, &target, member->address, member->address_len);
+        if (result < 0) return result;
+        ++probe->ping_req_num;
+    }
+    if (probe->ping_req_num > 0) STATS_INC(self, indirect_probes);
+    return PITTACUS_ERR_NONE;
+}
+
+static int gossip_probe_fail(pittacus_gossip_t *self, uint64_t current_us) {
+    probe_t *probe = &self->probe;
+    probe->stage = PROBE_IDLE;
+
+    cluster_member_t *target = gossip_find_member(self, &probe->target, probe->target_len, probe->target_uid);
+    if (target == NULL || target->state != MEMBER_ALIVE) return PITTACUS_ERR_NONE;
+
+    target->state = MEMBER_SUSPECT;
+    target->state_ts = current_us;
+    STATS_INC(self, members_suspected);
+    PT_TRACE4(member__suspect, self, target->address, target->address_len, target->incarnation);
+
+    // Notify the suspected member itself, so it has a chance to refute the suspicion,
+    // and spread the suspicion across the cluster.
+    gossip_add_member_event(self, MEMBER_SUSPECT, target->incarnation, target);
+    return gossip_enqueue_member_state(self, MEMBER_SUSPECT, target->incarnation, target,
+                                       target->address, target->address_len);
+}
+
+static uint64_t gossip_suspect_deadline(const cluster_member_t *member) {
+    if (member->detector == NULL || !failure_detector_is_ready(member->detector)) {
+        // Not enough history to judge about this member.
+        return member->state_ts + MEMBER_SUSPECT_TIMEOUT * 1000ULL;
+    }
+    // The member is dead once the silence is long enough for its own inter-arrival
+    // distribution, but it's given at least one protocol period to refute the suspicion.
+    uint64_t deadline_us = failure_detector_deadline(member->detector, PHI_THRESHOLD);
+    uint64_t min_deadline_us = member->state_ts + PROBE_INTERVAL * 1000ULL;
+    return deadline_us > min_deadline_us ? deadline_us : min_deadline_us;
+}
+
+static int gossip_probe_tick(pittacus_gossip_t *self) {
+    probe_t *probe = &self->probe;
+    uint64_t current_us = pt_time_us();
+    uint64_t next_event_us = current_us + GOSSIP_TICK_INTERVAL * 1000ULL;
+    int result = PITTACUS_ERR_NONE;
+
+    // Declare suspected members dead if they didn't refute the suspicion in time.
+    // Alive members with the highest suspicion level are probed out of turn.
+    cluster_member_t *overdue_member = NULL;
+    double overdue_phi = PHI_THRESHOLD;
+    int i = 0;
+    while (i < self->members.size) {
+        cluster_member_t *member = self->members.set[i];
+        if (member->state == MEMBER_SUSPECT) {
+            uint64_t deadline_us = gossip_suspect_deadline(member);
+            if (deadline_us <= current_us) {
+                result = gossip_remove_dead_member(self, member);
+                if (result < 0) return result;
+                // The next member has taken the place of the removed one.
+                continue;
+            }
+            if (deadline_us < next_event_us) next_event_us = deadline_us;
+        } else if (member->detector != NULL) {
+            double phi = failure_detector_phi(member->detector, current_us);
+            if (phi >= overdue_phi) {
+                overdue_member = member;
+                overdue_phi = phi;
+            }
+        }
+        ++i;
+    }
+
+    if (probe->stage == PROBE_DIRECT) {
+        uint64_t deadline_us = probe->started_us + PROBE_TIMEOUT * 1000ULL;
+        if (deadline_us <= current_us) {
+            result = gossip_probe_indirect(self);
+            if (result < 0) return result;
+        } else if (deadline_us < next_event_us) {
+            next_event_us = deadline_us;
+        }
+    }
+    if (probe->stage == PROBE_INDIRECT) {
+        uint64_t deadline_us = probe->started_us + PROBE_INTERVAL * 1000ULL;
+        if (deadline_us <= current_us) {
+            result = gossip_probe_fail(self, current_us);
+            if (result < 0) return result;
+        } else if (deadline_us < next_event_us) {
+            next_event_us = deadline_us;
+        }
+    }
+    if (probe->stage == PROBE_IDLE && self->members.size > 0) {
+        if (probe->next_probe_us <= current_us) {
+            result = gossip_probe_start(self, overdue_member, current_us);
+            if (result < 0) return result;
+            probe->next_probe_us = current_us + PROBE_INTERVAL * 1000ULL;
+            if (current_us + PROBE_TIMEOUT * 1000ULL < next_event_us) {
+                next_event_us = current_us + PROBE_TIMEOUT * 1000ULL;
+            }
+        }
+        if (probe->next_probe_us < next_event_us) next_event_us = probe->next_probe_us;
+    }
+
+    for (int j = 0; j < PROBE_RELAYS_SIZE; ++j) {
+        // Forget about relayed probes that were never acknowledged.
+        if (self->probe_relays[j].expires_us <= current_us) self->probe_relays[j].expires_us = 0;
+    }
+
+    gossip_relay_tick(self, current_us, &next_event_us);
+    result = gossip_data_pull_tick(self, current_us, &next_event_us);
+    if (result < 0) return result;
+
+    // Round up to make sure that the deadline has passed by the next tick.
+    return (next_event_us - current_us + 999) / 1000;
+}
+
+static int gossip_handle_hello(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
+    RETURN_IF_NOT_CONNECTED(self->state);
+    message_hello_t msg;
+    int decode_result = message_hello_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
     if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
         return decode_result;
     }
 
@@ -497,15 +1805,25 @@ static int gossip_handle_hello(pittacus_gossip_t *self, const message_envelope_i
 
     // Send the list of known members to a newcomer node.
     if (self->members.size > 0) {
-        gossip_enqueue_member_list(self, envelope_in->sender, envelope_in->sender_len);
+        gossip_enqueue_member_list(self, &self->members, envelope_in->sender, envelope_in->sender_len);
     }
 
-    // Notify other nodes about a newcomer.
-    message_member_list_t member_list_msg;
-    message_header_init(&member_list_msg.header, MESSAGE_MEMBER_LIST_TYPE, 0);
-    member_list_msg.members = msg.this_member;
-    member_list_msg.members_n = 1;
-    gossip_enqueue_message(self, MESSAGE_MEMBER_LIST_TYPE, &member_list_msg, NULL, 0, GOSSIP_BROADCAST);
+    if (GOSSIP_PARTIAL_VIEW) {
+        // Only the members along the random walks learn about a newcomer, so the cost
+        // of a join doesn't depend on the size of the cluster.
+        for (uint32_t i = 0; i < self->members.size; ++i) {
+            cluster_member_t *member = self->members.set[i];
+            gossip_enqueue_forward_join(self, ACTIVE_RANDOM_WALK_LENGTH, msg.this_member,
+                                        member->address, member->address_len);
+        }
+        gossip_active_add(self, msg.this_member);
+        message_hello_destroy(&msg);
+        return PITTACUS_ERR_NONE;
+    }
+
+    // Notify other nodes about a newcomer. The join event is piggybacked on regular
+    // messages, so it doesn't cost a message per known member.
+    gossip_add_member_event(self, MEMBER_ALIVE, msg.this_member->incarnation, msg.this_member);
 
     // Update our local storage with a new member.
     cluster_member_set_put(&self->members, msg.this_member, 1);
@@ -518,6 +1836,7 @@ static int gossip_handle_welcome(pittacus_gossip_t *self, const message_envelope
     message_welcome_t msg;
     int decode_result = message_welcome_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
     if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
         return decode_result;
     }
     self->state = STATE_CONNECTED;
@@ -528,9 +1847,9 @@ static int gossip_handle_welcome(pittacus_gossip_t *self, const message_envelope
 
     // Remove the hello message from the outbound queue.
     message_envelope_out_t *hello_envelope =
-            gossip_envelope_find_by_sequence_num(&self->outbound_messages,
+            gossip_envelope_find_by_sequence_num(&self->outbound_messages[PRIORITY_CONTROL],
                                                  msg.hello_sequence_num);
-    if (hello_envelope != NULL) gossip_envelope_remove(&self->outbound_messages, hello_envelope);
+    if (hello_envelope != NULL) gossip_outbound_remove(self, hello_envelope);
 
     message_welcome_destroy(&msg);
     return PITTACUS_ERR_NONE;
@@ -541,14 +1860,23 @@ static int gossip_handle_member_list(pittacus_gossip_t *self, const message_enve
     message_member_list_t msg;
     int decode_result = message_member_list_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
     if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
         return decode_result;
     };
 
     // Update our local collection of members with arrived records.
-    cluster_member_set_put(&self->members, msg.members, msg.members_n);
+    for (uint16_t i = 0; i < msg.members_n; ++i) {
+        // The full list sent on a member log overflow includes this node as well.
+        if (gossip_is_this_member(self, &msg.members[i])) continue;
+        if (GOSSIP_PARTIAL_VIEW) {
+            gossip_passive_add(self, &msg.members[i]);
+        } else {
+            cluster_member_set_put(&self->members, &msg.members[i], 1);
+        }
+    }
 
     // Send ACK message back to sender.
-    gossip_enqueue_ack(self, msg.header.sequence_num, envelope_in->sender, envelope_in->sender_len);
+    gossip_enqueue_ack(self, msg.header.sequence_num, envelope_in->sender, envelope_in->sender_len, PT_FALSE);
 
     message_member_list_destroy(&msg);
     return PITTACUS_ERR_NONE;
@@ -559,26 +1887,62 @@ static int gossip_handle_data(pittacus_gossip_t *self, const message_envelope_in
     message_data_t msg;
     int decode_result = message_data_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
     if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
         return decode_result;
     }
 
     // Send ACK message back to sender.
-    gossip_enqueue_ack(self, msg.header.sequence_num, envelope_in->sender, envelope_in->sender_len);
+    gossip_enqueue_ack(self, msg.header.sequence_num, envelope_in->sender, envelope_in->sender_len, PT_FALSE);
+
+    // Only payloads pushed over the broadcast tree change the tree.
+    pt_bool_t tree_push = (GOSSIP_BROADCAST_TREE && (msg.header.flags & MESSAGE_FLAG_TREE)) ? PT_TRUE : PT_FALSE;
+    msg.header.flags &= ~MESSAGE_FLAG_TREE;
+
+    uint64_t current_us = 0;
+    if (msg.header.flags & MESSAGE_FLAG_TIMESTAMPS) {
+        current_us = pt_time_us();
+        // Clocks of different nodes are not perfectly aligned. Negative values are truncated.
+        pittacus_histogram_record(&self->latency.hop_latency,
+                                  current_us > msg.sent_ts ? current_us - msg.sent_ts : 0);
+    }
 
     // Verify whether we saw the arrived message before.
     vector_clock_comp_res_t res = vector_clock_compare_with_record(&self->data_version,
                                                                    &msg.data_version, PT_TRUE);
 
     if (res == VC_BEFORE) {
+        if (msg.header.flags & MESSAGE_FLAG_TIMESTAMPS) {
+            pittacus_histogram_record(&self->latency.propagation_age,
+                                      current_us > msg.origin_ts ? current_us - msg.origin_ts : 0);
+        }
+        // The only copy of the arrived payload. The data log and relays refer to it.
+        data_payload_t *payload = gossip_data_payload_create(msg.data_size);
+        if (payload == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
+        memcpy(payload->storage, msg.data, msg.data_size);
+        msg.data = payload->storage;
+
         // Add the data to our internal log.
-        gossip_data_log(&self->data_log, &msg);
+        gossip_data_log(&self->data_log, &msg, payload);
 
+        PT_TRACE5(data__deliver, self, msg.data_version.member_id, msg.data_version.sequence_number,
+                  msg.data_size, current_us > msg.origin_ts ? current_us - msg.origin_ts : 0);
         if (self->data_receiver) {
             // Invoke the data receiver callback specified by the user.
             self->data_receiver(self->data_receiver_context, self, msg.data, msg.data_size);
         }
+        // The payload doesn't have to be pulled anymore.
+        gossip_data_pull_complete(self, &msg.data_version);
+        // The first copy of the payload arrived over the shortest path, keep it in the tree.
+        if (tree_push) gossip_broadcast_tree_link(self, envelope_in->sender, envelope_in->sender_len, 1);
         // Enqueue the same message to send it to N random members later.
-        return gossip_enqueue_message(self, MESSAGE_DATA_TYPE, &msg, NULL, 0, GOSSIP_RANDOM);
+        int result = gossip_relay_data(self, &msg, payload, envelope_in->sender, envelope_in->sender_len);
+        gossip_data_payload_release(payload);
+        return result;
+    }
+    if (DATA_RELAY_DUPLICATES > 0) gossip_relay_duplicate(self, &msg.data_version);
+    if (tree_push) {
+        // The payload has already arrived over another path. Remove the redundant link from the tree.
+        return gossip_enqueue_prune(self, envelope_in->sender, envelope_in->sender_len);
     }
     return PITTACUS_ERR_NONE;
 }
@@ -588,14 +1952,40 @@ static int gossip_handle_ack(pittacus_gossip_t *self, const message_envelope_in_
     message_ack_t msg;
     int decode_result = message_ack_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
     if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
         return decode_result;
     }
 
+    if (msg.header.flags & MESSAGE_FLAG_ZONES) {
+        cluster_member_t *member = cluster_member_set_find_by_addr(&self->members, envelope_in->sender,
+                                                                   envelope_in->sender_len);
+        if (member != NULL) {
+            member->zone = msg.zone;
+            member->bridge = msg.bridge;
+        }
+    }
+
+    // Acknowledgements of probes don't have a corresponding message in the outbound queue.
+    if (gossip_probe_handle_ack(self, &msg)) return PITTACUS_ERR_NONE;
+
     // Removing the processed message from the outbound queue.
-    message_envelope_out_t *ack_envelope =
-            gossip_envelope_find_by_sequence_num(&self->outbound_messages,
-                                                 msg.ack_sequence_num);
-    if (ack_envelope != NULL) gossip_envelope_remove(&self->outbound_messages, ack_envelope);
+    message_envelope_out_t *ack_envelope = gossip_outbound_find(self, msg.ack_sequence_num);
+    if (ack_envelope != NULL) {
+        // It's unknown which attempt is being acknowledged if the message was retransmitted,
+        // so the round trip time is only measured for messages that were sent once.
+        uint64_t rtt_us = 0;
+        if (ack_envelope->attempt_num == 1) {
+            uint64_t current_us = pt_time_us();
+            if (current_us >= ack_envelope->attempt_us) {
+                rtt_us = current_us - ack_envelope->attempt_us;
+                gossip_rtt_sample(self, &ack_envelope->recipient, ack_envelope->recipient_len, rtt_us,
+                                  (msg.header.flags & MESSAGE_FLAG_COORDINATES) ? &msg.coordinate : NULL);
+            }
+        }
+        PT_TRACE4(ack__match, self, ack_envelope->sequence_num, ack_envelope->attempt_num, rtt_us);
+        gossip_outbound_remove(self, ack_envelope);
+        gossip_outbound_drained(self);
+    }
     return PITTACUS_ERR_NONE;
 }
 
@@ -604,15 +1994,39 @@ static int gossip_handle_status(pittacus_gossip_t *self, const message_envelope_
     message_status_t msg;
     int decode_result = message_status_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
     if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
         return decode_result;
     }
 
-    // Acknowledge the arrived Status message.
-    gossip_enqueue_ack(self, msg.header.sequence_num, envelope_in->sender, envelope_in->sender_len);
+    // Acknowledge the arrived Status message. The acknowledgement carries the coordinate
+    // of this node, so the sender can update its own coordinate with the measured round trip.
+    gossip_enqueue_ack(self, msg.header.sequence_num, envelope_in->sender, envelope_in->sender_len, PT_TRUE);
+
+    cluster_member_t *member = cluster_member_set_find_by_addr(&self->members, envelope_in->sender,
+                                                               envelope_in->sender_len);
+    if (GOSSIP_COORDINATES && (msg.header.flags & MESSAGE_FLAG_COORDINATES) && member != NULL) {
+        gossip_store_coordinate(member, &msg.coordinate);
+    }
 
     int result = PITTACUS_ERR_NONE;
 
+    // Request the membership changes this node has missed since the last exchange with the sender.
+    uint32_t member_log_request = MESSAGE_MEMBER_LOG_NO_REQUEST;
+    if (GOSSIP_MEMBER_LOG && (msg.header.flags & MESSAGE_FLAG_MEMBER_LOG)) {
+        if (msg.member_log_request != MESSAGE_MEMBER_LOG_NO_REQUEST) {
+            result = gossip_enqueue_member_log(self, msg.member_log_request,
+                                               envelope_in->sender, envelope_in->sender_len);
+            if (result < 0) return result;
+        }
+        if (member != NULL && msg.member_log_version > member->log_version) {
+            member_log_request = member->log_version;
+        }
+    }
+
     vector_clock_comp_res_t comp_res = vector_clock_compare(&self->data_version, &msg.data_version, PT_FALSE);
+    // New payloads reach other nodes by rumors anyway. Only a node that has missed
+    // some of them speeds up the anti-entropy.
+    if (comp_res == VC_BEFORE || comp_res == VC_CONFLICT) gossip_divergence_detected(self);
     switch (comp_res) {
         case VC_AFTER:
             // The remote node is missing some of the data messages.
@@ -621,7 +2035,8 @@ static int gossip_handle_status(pittacus_gossip_t *self, const message_envelope_
             break;
         case VC_BEFORE:
             // This node is behind. Send back the Status message to request the data update.
-            result = gossip_enqueue_status(self, envelope_in->sender, envelope_in->sender_len);
+            result = gossip_enqueue_status(self, member_log_request, envelope_in->sender, envelope_in->sender_len);
+            member_log_request = MESSAGE_MEMBER_LOG_NO_REQUEST;
             break;
         case VC_CONFLICT:
             // The conflict occurred. Both nodes should exchange the data with each other.
@@ -630,18 +2045,352 @@ static int gossip_handle_status(pittacus_gossip_t *self, const message_envelope_
                                              envelope_in->sender, envelope_in->sender_len);
             if (result < 0) return result;
             // Request the data update.
-            result = gossip_enqueue_status(self, envelope_in->sender, envelope_in->sender_len);
+            result = gossip_enqueue_status(self, member_log_request, envelope_in->sender, envelope_in->sender_len);
+            member_log_request = MESSAGE_MEMBER_LOG_NO_REQUEST;
             break;
         default:
             break;
     }
+    if (result < 0) return result;
+
+    // A Status message that is itself a request isn't answered with another request,
+    // so two nodes that are behind each other don't keep requesting in turns.
+    if (member_log_request != MESSAGE_MEMBER_LOG_NO_REQUEST &&
+            msg.member_log_request == MESSAGE_MEMBER_LOG_NO_REQUEST) {
+        result = gossip_enqueue_status(self, member_log_request, envelope_in->sender, envelope_in->sender_len);
+    }
+
+    return result;
+}
+
+static int gossip_handle_member_log(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
+    RETURN_IF_NOT_CONNECTED(self->state);
+    message_member_log_t msg;
+    int decode_result = message_member_log_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
+    if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
+        return decode_result;
+    }
+
+    int result = gossip_enqueue_ack(self, msg.header.sequence_num, envelope_in->sender, envelope_in->sender_len,
+                                    PT_FALSE);
+    for (uint8_t i = 0; result >= 0 && i < msg.events_n; ++i) {
+        result = gossip_apply_member_state(self, msg.events[i].state, msg.events[i].incarnation,
+                                           &msg.events[i].member, envelope_in->sender, envelope_in->sender_len);
+    }
+
+    // Messages may arrive out of order. The missing ones are retransmitted until acknowledged.
+    cluster_member_t *member = cluster_member_set_find_by_addr(&self->members, envelope_in->sender,
+                                                               envelope_in->sender_len);
+    if (result >= 0 && member != NULL && msg.log_version > member->log_version) {
+        member->log_version = msg.log_version;
+    }
+
+    message_member_log_destroy(&msg);
+    return result;
+}
+
+static int gossip_handle_ping(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
+    RETURN_IF_NOT_CONNECTED(self->state);
+    message_ping_t msg;
+    int decode_result = message_ping_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
+    if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
+        return decode_result;
+    }
+
+    // Confirm that this node is alive.
+    return gossip_enqueue_ack(self, msg.header.sequence_num, envelope_in->sender, envelope_in->sender_len, PT_TRUE);
+}
+
+static int gossip_handle_ping_req(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
+    RETURN_IF_NOT_CONNECTED(self->state);
+    message_ping_req_t msg;
+    int decode_result = message_ping_req_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
+    if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
+        return decode_result;
+    }
+
+    // Probe the target on behalf of the sender. The acknowledgement will be relayed
+    // back to the sender once it arrives.
+    uint32_t ping_seq = 0;
+    int result = gossip_enqueue_ping(self, msg.target->address, msg.target->address_len, &ping_seq);
+    if (result >= 0) {
+        probe_relay_t *relay = &self->probe_relays[self->probe_relays_idx];
+        if (++self->probe_relays_idx >= PROBE_RELAYS_SIZE) self->probe_relays_idx = 0;
+        memcpy(&relay->requester, envelope_in->sender, envelope_in->sender_len);
+        relay->requester_len = envelope_in->sender_len;
+        relay->requester_seq = msg.header.sequence_num;
+        relay->ping_seq = ping_seq;
+        relay->expires_us = pt_time_us() + PROBE_INTERVAL * 1000ULL;
+    }
+
+    message_ping_req_destroy(&msg);
+    return result;
+}
+
+static int gossip_handle_member_state(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
+    RETURN_IF_NOT_CONNECTED(self->state);
+    message_member_state_t msg;
+    int decode_result = message_member_state_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
+    if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
+        return decode_result;
+    }
+
+    // Send ACK message back to sender.
+    gossip_enqueue_ack(self, msg.header.sequence_num, envelope_in->sender, envelope_in->sender_len, PT_FALSE);
+
+    int result = gossip_apply_member_state(self, msg.state, msg.incarnation, msg.member,
+                                           envelope_in->sender, envelope_in->sender_len);
+
+    message_member_state_destroy(&msg);
+    return result;
+}
+
+static int gossip_handle_ihave(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
+    RETURN_IF_NOT_CONNECTED(self->state);
+    message_ihave_t msg;
+    int decode_result = message_ihave_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
+    if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
+        return decode_result;
+    }
+
+    if (vector_clock_compare_with_record(&self->data_version, &msg.data_version, PT_FALSE) != VC_BEFORE) {
+        // The payload has been seen already.
+        return PITTACUS_ERR_NONE;
+    }
+
+    data_pull_t *pull = gossip_data_pull_find(self, &msg.data_version);
+    if (pull != NULL && pull->version.sequence_number >= msg.data_version.sequence_number) {
+        // The payload has been requested already. Remember the sender in case
+        // the first announcer doesn't respond.
+        if (pull->alternative_len == 0) {
+            memcpy(&pull->alternative, envelope_in->sender, envelope_in->sender_len);
+            pull->alternative_len = envelope_in->sender_len;
+        }
+        return PITTACUS_ERR_NONE;
+    }
+
+    if (pull == NULL) {
+        pull = &self->data_pulls[self->data_pulls_idx];
+        if (++self->data_pulls_idx >= DATA_PULLS_SIZE) self->data_pulls_idx = 0;
+    }
+    vector_clock_record_copy(&pull->version, &msg.data_version);
+    if (GOSSIP_BROADCAST_TREE) {
+        // Give the payload some time to arrive over the tree before requesting it.
+        memcpy(&pull->alternative, envelope_in->sender, envelope_in->sender_len);
+        pull->alternative_len = envelope_in->sender_len;
+        pull->expires_us = pt_time_us() + BROADCAST_TREE_GRAFT_TIMEOUT * 1000ULL;
+        return PITTACUS_ERR_NONE;
+    }
+
+    int result = gossip_enqueue_iwant(self, &msg.data_version, envelope_in->sender, envelope_in->sender_len);
+    if (result < 0) return result;
+    pull->alternative_len = 0;
+    pull->expires_us = pt_time_us() + DATA_PULL_TIMEOUT * 1000ULL;
+    return PITTACUS_ERR_NONE;
+}
+
+static int gossip_handle_iwant(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
+    RETURN_IF_NOT_CONNECTED(self->state);
+    message_iwant_t msg;
+    int decode_result = message_iwant_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
+    if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
+        return decode_result;
+    }
 
+    return gossip_enqueue_data_record(self, &msg.data_version, envelope_in->sender, envelope_in->sender_len);
+}
+
+static int gossip_handle_prune(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
+    RETURN_IF_NOT_CONNECTED(self->state);
+    message_prune_t msg;
+    int decode_result = message_prune_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
+    if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
+        return decode_result;
+    }
+
+    // The sender receives payloads over another path. Only announce them from now on.
+    gossip_broadcast_tree_link(self, envelope_in->sender, envelope_in->sender_len, 0);
+    return PITTACUS_ERR_NONE;
+}
+
+static int gossip_handle_graft(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
+    RETURN_IF_NOT_CONNECTED(self->state);
+    message_graft_t msg;
+    int decode_result = message_graft_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
+    if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
+        return decode_result;
+    }
+
+    // The sender missed a payload. Push the following payloads to it eagerly.
+    gossip_broadcast_tree_link(self, envelope_in->sender, envelope_in->sender_len, 1);
+    return gossip_enqueue_data_record(self, &msg.data_version, envelope_in->sender, envelope_in->sender_len);
+}
+
+static int gossip_handle_neighbor(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
+    RETURN_IF_NOT_CONNECTED(self->state);
+    message_neighbor_t msg;
+    int decode_result = message_neighbor_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
+    if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
+        return decode_result;
+    }
+
+    int result = gossip_enqueue_ack(self, msg.header.sequence_num, envelope_in->sender, envelope_in->sender_len,
+                                    PT_FALSE);
+    if (result >= 0 && GOSSIP_PARTIAL_VIEW) {
+        if (msg.priority || self->members.size < ACTIVE_VIEW_SIZE) {
+            result = gossip_active_add(self, msg.this_member);
+        } else if (cluster_member_set_find_by_addr(&self->members, envelope_in->sender,
+                                                   envelope_in->sender_len) == NULL) {
+            // The active view is full. Refuse, so the sender tries another member.
+            result = gossip_passive_add(self, msg.this_member);
+            if (result >= 0) result = gossip_enqueue_disconnect(self, envelope_in->sender, envelope_in->sender_len);
+        }
+    }
+
+    message_neighbor_destroy(&msg);
     return result;
 }
 
+static int gossip_handle_disconnect(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
+    RETURN_IF_NOT_CONNECTED(self->state);
+    message_disconnect_t msg;
+    int decode_result = message_disconnect_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
+    if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
+        return decode_result;
+    }
+
+    int result = gossip_enqueue_ack(self, msg.header.sequence_num, envelope_in->sender, envelope_in->sender_len,
+                                    PT_FALSE);
+    if (result < 0 || !GOSSIP_PARTIAL_VIEW) return result;
+    cluster_member_t *member = cluster_member_set_find_by_addr(&self->members, envelope_in->sender,
+                                                               envelope_in->sender_len);
+    if (member == NULL) return PITTACUS_ERR_NONE;
+    // The sender is still alive, so it remains a candidate for the active view.
+    return gossip_active_demote(self, member);
+}
+
+static int gossip_forward_join(pittacus_gossip_t *self, uint8_t ttl, cluster_member_t *newcomer,
+                               const pt_sockaddr_storage *sender, pt_socklen_t sender_len) {
+    cluster_member_t *next = ttl > 0 ? gossip_random_walk_next(self, sender, sender_len, newcomer) : NULL;
+    if (next == NULL) {
+        // The walk ends here. Become a neighbour of the newcomer.
+        if (cluster_member_set_find_by_addr(&self->members, newcomer->address, newcomer->address_len) != NULL) {
+            return PITTACUS_ERR_NONE;
+        }
+        int result = gossip_active_add(self, newcomer);
+        if (result < 0) return result;
+        return gossip_enqueue_neighbor(self, 1, newcomer->address, newcomer->address_len);
+    }
+    if (ttl == PASSIVE_RANDOM_WALK_LENGTH) {
+        int result = gossip_passive_add(self, newcomer);
+        if (result < 0) return result;
+    }
+    return gossip_enqueue_forward_join(self, ttl - 1, newcomer, next->address, next->address_len);
+}
+
+static int gossip_handle_forward_join(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
+    RETURN_IF_NOT_CONNECTED(self->state);
+    message_forward_join_t msg;
+    int decode_result = message_forward_join_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
+    if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
+        return decode_result;
+    }
+
+    int result = gossip_enqueue_ack(self, msg.header.sequence_num, envelope_in->sender, envelope_in->sender_len,
+                                    PT_FALSE);
+    if (result >= 0 && GOSSIP_PARTIAL_VIEW && !gossip_is_this_member(self, msg.member)) {
+        result = gossip_forward_join(self, msg.ttl, msg.member, envelope_in->sender, envelope_in->sender_len);
+    }
+
+    message_forward_join_destroy(&msg);
+    return result;
+}
+
+static int gossip_handle_shuffle(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
+    RETURN_IF_NOT_CONNECTED(self->state);
+    message_shuffle_t msg;
+    int decode_result = message_shuffle_decode(envelope_in->buffer, envelope_in->buffer_size, &msg);
+    if (decode_result < 0) {
+        STATS_INC(self, decode_failures);
+        return decode_result;
+    }
+
+    int result = gossip_enqueue_ack(self, msg.header.sequence_num, envelope_in->sender, envelope_in->sender_len,
+                                    PT_FALSE);
+    if (result >= 0 && GOSSIP_PARTIAL_VIEW && !gossip_is_this_member(self, msg.origin)) {
+        cluster_member_t *next = msg.ttl > 1 ?
+                gossip_random_walk_next(self, envelope_in->sender, envelope_in->sender_len, msg.origin) : NULL;
+        if (next != NULL) {
+            message_shuffle_t forward_msg = msg;
+            message_header_init(&forward_msg.header, MESSAGE_SHUFFLE_TYPE, 0);
+            --forward_msg.ttl;
+            result = gossip_enqueue_message(self, MESSAGE_SHUFFLE_TYPE, &forward_msg,
+                                            next->address, next->address_len, GOSSIP_DIRECT);
+        } else {
+            // The walk ends here. Send back a sample of the passive view before
+            // it's updated with the arrived one.
+            result = gossip_enqueue_member_sample(self, &self->passive, SHUFFLE_ACTIVE_MEMBERS + SHUFFLE_PASSIVE_MEMBERS,
+                                                  msg.origin->address, msg.origin->address_len);
+            for (uint16_t i = 0; result >= 0 && i < msg.members_n; ++i) {
+                result = gossip_passive_add(self, &msg.members[i]);
+            }
+            if (result >= 0) result = gossip_passive_add(self, msg.origin);
+        }
+    }
+
+    message_shuffle_destroy(&msg);
+    return result;
+}
+
+static int gossip_record_arrival(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
+    cluster_member_t *member = cluster_member_set_find_by_addr(&self->members,
+                                                               envelope_in->sender, envelope_in->sender_len);
+    if (member == NULL) return PITTACUS_ERR_NONE;
+    if (member->detector == NULL) {
+        member->detector = (failure_detector_t *) malloc(sizeof(failure_detector_t));
+        if (member->detector == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
+        failure_detector_init(member->detector);
+    }
+    failure_detector_arrival(member->detector, pt_time_us());
+    return PITTACUS_ERR_NONE;
+}
+
 static int gossip_handle_new_message(pittacus_gossip_t *self, const message_envelope_in_t *envelope_in) {
     int message_type = message_type_decode(envelope_in->buffer, envelope_in->buffer_size);
-    int result = 0;
+    PT_TRACE4(message__receive, self, message_type, envelope_in->buffer_size, envelope_in->sender);
+    if (message_type < 0 || message_type >= PITTACUS_STATS_MESSAGE_TYPES) {
+        STATS_INC(self, decode_failures);
+        return PITTACUS_ERR_INVALID_MESSAGE;
+    }
+    STATS_INC(self, messages_received[message_type]);
+    STATS_ADD(self, bytes_received, envelope_in->buffer_size);
+    // Any message is a sign of life of its sender.
+    int result = gossip_record_arrival(self, envelope_in);
+    if (result < 0) return result;
+
+    // Separate the piggybacked membership events from the message itself.
+    message_event_t events[MEMBER_EVENTS_SIZE];
+    uint8_t events_n = MEMBER_EVENTS_SIZE;
+    int trailer_size = message_events_decode(envelope_in->buffer, envelope_in->buffer_size, events, &events_n);
+    if (trailer_size < 0) {
+        STATS_INC(self, decode_failures);
+        return trailer_size;
+    }
+    message_envelope_in_t message_envelope = *envelope_in;
+    message_envelope.buffer_size -= trailer_size;
+    envelope_in = &message_envelope;
+
     switch(message_type) {
         case MESSAGE_HELLO_TYPE:
             result = gossip_handle_hello(self, envelope_in);
@@ -661,9 +2410,55 @@ static int gossip_handle_new_message(pittacus_gossip_t *self, const message_enve
         case MESSAGE_STATUS_TYPE:
             result = gossip_handle_status(self, envelope_in);
             break;
+        case MESSAGE_PING_TYPE:
+            result = gossip_handle_ping(self, envelope_in);
+            break;
+        case MESSAGE_PING_REQ_TYPE:
+            result = gossip_handle_ping_req(self, envelope_in);
+            break;
+        case MESSAGE_MEMBER_STATE_TYPE:
+            result = gossip_handle_member_state(self, envelope_in);
+            break;
+        case MESSAGE_IHAVE_TYPE:
+            result = gossip_handle_ihave(self, envelope_in);
+            break;
+        case MESSAGE_IWANT_TYPE:
+            result = gossip_handle_iwant(self, envelope_in);
+            break;
+        case MESSAGE_PRUNE_TYPE:
+            result = gossip_handle_prune(self, envelope_in);
+            break;
+        case MESSAGE_GRAFT_TYPE:
+            result = gossip_handle_graft(self, envelope_in);
+            break;
+        case MESSAGE_NEIGHBOR_TYPE:
+            result = gossip_handle_neighbor(self, envelope_in);
+            break;
+        case MESSAGE_DISCONNECT_TYPE:
+            result = gossip_handle_disconnect(self, envelope_in);
+            break;
+        case MESSAGE_FORWARD_JOIN_TYPE:
+            result = gossip_handle_forward_join(self, envelope_in);
+            break;
+        case MESSAGE_SHUFFLE_TYPE:
+            result = gossip_handle_shuffle(self, envelope_in);
+            break;
+        case MESSAGE_MEMBER_LOG_TYPE:
+            result = gossip_handle_member_log(self, envelope_in);
+            break;
         default:
+            STATS_INC(self, decode_failures);
             return PITTACUS_ERR_INVALID_MESSAGE;
     }
+    PT_TRACE4(message__dispatch, self, message_type,
+              uint32_decode(envelope_in->buffer + sizeof(message_header_t) - sizeof(uint32_t)), result);
+    if (result < 0 || self->state != STATE_CONNECTED) return result;
+
+    for (uint8_t i = 0; i < events_n; ++i) {
+        result = gossip_apply_member_state(self, events[i].state, events[i].incarnation, &events[i].member,
+                                           envelope_in->sender, envelope_in->sender_len);
+        if (result < 0) return result;
+    }
     return result;
 }
 
@@ -684,26 +2479,71 @@ static int pittacus_gossip_init(pittacus_gossip_t *self,
 
     self->output_buffer_offset = 0;
 
-    self->outbound_messages = (message_queue_t ) { .head = NULL, .tail = NULL };
+    for (int lane = 0; lane < PITTACUS_PRIORITIES; ++lane) {
+        self->outbound_messages[lane] = (message_queue_t ) { .head = NULL, .tail = NULL, .size = 0 };
+    }
+    pacer_init(&self->pacer, SEND_RATE_BYTES, SEND_RATE_PACKETS);
+    self->next_send_us = UINT64_MAX;
 
     self->sequence_num = 0;
     self->data_counter = 0;
     vector_clock_init(&self->data_version);
+    vivaldi_coord_init(&self->coord);
 
     self->state = STATE_INITIALIZED;
     cluster_member_init(&self->self_address, &updated_self_addr, updated_self_addr_size);
     cluster_member_set_init(&self->members);
+    cluster_member_set_init(&self->passive);
 
     self->data_log.current_idx = 0;
     self->data_log.size = 0;
 
     self->last_gossip_ts = 0;
+    self->last_bridge_ts = 0;
+    self->last_shuffle_ts = 0;
+    self->gossip_interval = GOSSIP_TICK_INTERVAL;
+    self->gossip_diverged = PT_FALSE;
+
+    memset(&self->probe, 0, sizeof(probe_t));
+    memset(self->probe_relays, 0, sizeof(self->probe_relays));
+    self->probe_relays_idx = 0;
+
+    memset(self->data_pulls, 0, sizeof(self->data_pulls));
+    self->data_pulls_idx = 0;
+    self->broadcast_tree_formed = PT_FALSE;
+
+    memset(self->data_relays, 0, sizeof(self->data_relays));
+    self->data_relays_idx = 0;
+    self->member_events_size = 0;
+    self->member_log_version = 0;
 
     self->data_receiver = data_receiver;
     self->data_receiver_context = data_receiver_context;
+
+    self->send_blocked = PT_FALSE;
+    self->writable_callback = NULL;
+    self->writable_context = NULL;
+
+    memset(&self->stats, 0, sizeof(pittacus_gossip_stats_t));
+    pittacus_histogram_init(&self->latency.hop_latency);
+    pittacus_histogram_init(&self->latency.propagation_age);
+    pittacus_histogram_init(&self->latency.ack_rtt);
     return PITTACUS_ERR_NONE;
 }
 
+static void gossip_stats_publish_gauges(pittacus_gossip_t *self) {
+    for (int lane = 0; lane < PITTACUS_PRIORITIES; ++lane) {
+        STATS_SET(self, outbound_lane_sizes[lane], self->outbound_messages[lane].size);
+    }
+    STATS_SET(self, outbound_queue_size, gossip_outbound_size(self));
+    STATS_SET(self, members_num, self->members.size);
+    STATS_SET(self, passive_members_num, self->passive.size);
+    STATS_SET(self, data_log_size, self->data_log.size);
+    STATS_SET(self, data_version_size, self->data_version.size);
+    STATS_SET(self, fanout, gossip_fanout(self->members.size));
+    STATS_SET(self, tick_interval, self->gossip_interval);
+}
+
 pittacus_gossip_t *pittacus_gossip_create(const pittacus_addr_t *self_addr,
                                           data_receiver_t data_receiver, void *data_receiver_context) {
     pittacus_gossip_t *result = (pittacus_gossip_t *) malloc(sizeof(pittacus_gossip_t));
@@ -714,23 +2554,34 @@ pittacus_gossip_t *pittacus_gossip_create(const pittacus_addr_t *self_addr,
         free(result);
         return NULL;
     }
+    gossip_stats_publish_gauges(result);
     return result;
 }
 
 int pittacus_gossip_destroy(pittacus_gossip_t *self) {
     pt_close(self->socket);
 
-    gossip_envelope_clear(&self->outbound_messages);
+    for (int lane = 0; lane < PITTACUS_PRIORITIES; ++lane) gossip_envelope_clear(&self->outbound_messages[lane]);
+    for (int i = 0; i < self->data_log.size; ++i) gossip_data_payload_release(self->data_log.messages[i].payload);
 
     self->state = STATE_DESTROYED;
     cluster_member_destroy(&self->self_address);
     cluster_member_set_destroy(&self->members);
+    cluster_member_set_destroy(&self->passive);
 
     free(self);
     return PITTACUS_ERR_NONE;
 }
 
-int pittacus_gossip_join(pittacus_gossip_t *self, const pittacus_addr_t *seed_nodes, uint16_t seed_nodes_len) {
+int pittacus_gossip_set_zone(pittacus_gossip_t *self, uint16_t zone, int bridge) {
+    if (self->state != STATE_INITIALIZED) return PITTACUS_ERR_BAD_STATE;
+    if (zone == CLUSTER_MEMBER_ZONE_UNKNOWN) return PITTACUS_ERR_INVALID_ARGUMENT;
+    self->self_address.zone = zone;
+    self->self_address.bridge = bridge ? 1 : 0;
+    return PITTACUS_ERR_NONE;
+}
+
+static int gossip_join(pittacus_gossip_t *self, const pittacus_addr_t *seed_nodes, uint16_t seed_nodes_len) {
     if (self->state != STATE_INITIALIZED) return PITTACUS_ERR_BAD_STATE;
     if (seed_nodes == NULL || seed_nodes_len == 0) {
         // No seed nodes were provided.
@@ -746,6 +2597,12 @@ int pittacus_gossip_join(pittacus_gossip_t *self, const pittacus_addr_t *seed_no
     return PITTACUS_ERR_NONE;
 }
 
+int pittacus_gossip_join(pittacus_gossip_t *self, const pittacus_addr_t *seed_nodes, uint16_t seed_nodes_len) {
+    int result = gossip_join(self, seed_nodes, seed_nodes_len);
+    gossip_stats_publish_gauges(self);
+    return result;
+}
+
 int pittacus_gossip_process_receive(pittacus_gossip_t *self) {
     if (self->state != STATE_JOINING && self->state != STATE_CONNECTED) return PITTACUS_ERR_BAD_STATE;
 
@@ -761,98 +2618,449 @@ int pittacus_gossip_process_receive(pittacus_gossip_t *self) {
     envelope.sender = &addr;
     envelope.sender_len = addr_len;
 
-    return gossip_handle_new_message(self, &envelope);
+    int result = gossip_handle_new_message(self, &envelope);
+    gossip_stats_publish_gauges(self);
+    return result;
 }
 
-int pittacus_gossip_process_send(pittacus_gossip_t *self) {
-    if (self->state != STATE_JOINING && self->state != STATE_CONNECTED) return PITTACUS_ERR_BAD_STATE;
-    message_envelope_out_t *head = self->outbound_messages.head;
-    int msg_sent = 0;
-    while (head != NULL) {
-        message_envelope_out_t *current = head;
-        head = head->next;
+static void gossip_iov_append(pt_iovec *iov, int *iov_len, const void *base, size_t len) {
+    if (len == 0) return;
+    iov[*iov_len].iov_base = (void *) base;
+    iov[*iov_len].iov_len = len;
+    ++*iov_len;
+}
 
-        if (current->attempt_num >= current->max_attempts) {
-            // The message exceeded the maximum number of attempts.
-
-            if (current->max_attempts > 1) {
-                // If the number of maximum attempts is more than 1, then
-                // the message required acknowledgement but we've never received it.
-                // Remove node from the list since it's unreachable.
-                cluster_member_set_remove_by_addr(&self->members,
-                                                  &current->recipient,
-                                                  current->recipient_len);
-                // Quite often the same recipient has several messages in a row.
-                // Check whether the next message should be removed as well.
-                message_envelope_out_t *next = current->next;
-                message_envelope_out_t *to_remove = NULL;
-                while (next != NULL && memcmp(&next->recipient, &current->recipient, next->recipient_len) == 0) {
-                    to_remove = next;
-                    next = next->next;
-                    gossip_envelope_remove(&self->outbound_messages, to_remove);
-                }
-                head = next;
-            }
-            // Remove this message from the queue.
-            gossip_envelope_remove(&self->outbound_messages, current);
-            continue;
-        }
+static void gossip_send_postpone(pittacus_gossip_t *self, uint64_t send_us) {
+    if (send_us < self->next_send_us) self->next_send_us = send_us;
+}
 
-        uint64_t current_ts = pt_time();
-        if (current->attempt_num != 0 && current->attempt_ts + MESSAGE_RETRY_INTERVAL > current_ts) {
-            // It's not yet time to retry this message.
-            continue;
+static pacer_t *gossip_peer_pacer(pittacus_gossip_t *self, const pt_sockaddr_storage *recipient,
+                                  pt_socklen_t recipient_len) {
+    if (PEER_SEND_RATE_BYTES == 0 && PEER_SEND_RATE_PACKETS == 0) return NULL;
+    // Only known members are paced. Seed nodes are contacted before they become members.
+    cluster_member_t *member = cluster_member_set_find_by_addr(&self->members, recipient, recipient_len);
+    if (member == NULL) return NULL;
+    if (member->pacer == NULL) {
+        member->pacer = (pacer_t *) malloc(sizeof(pacer_t));
+        if (member->pacer == NULL) return NULL;
+        pacer_init(member->pacer, PEER_SEND_RATE_BYTES, PEER_SEND_RATE_PACKETS);
+    }
+    return member->pacer;
+}
+
+static uint64_t gossip_retry_timeout(pittacus_gossip_t *self, const message_envelope_out_t *envelope) {
+    static const rtt_estimator_t unknown_rtt = { 0 };
+    cluster_member_t *member = cluster_member_set_find_by_addr(&self->members, &envelope->recipient,
+                                                               envelope->recipient_len);
+    const rtt_estimator_t *rtt = member != NULL && member->rtt != NULL ? member->rtt : &unknown_rtt;
+    uint64_t timeout_us = rtt_estimator_timeout(rtt, envelope->attempt_num);
+    if (MESSAGE_RETRY_JITTER > 0) timeout_us += pt_random() % (timeout_us * MESSAGE_RETRY_JITTER / 100 + 1);
+    if (timeout_us > MESSAGE_RETRY_INTERVAL * 1000ULL) timeout_us = MESSAGE_RETRY_INTERVAL * 1000ULL;
+    return timeout_us;
+}
+
+static int gossip_send_envelope(pittacus_gossip_t *self, message_envelope_out_t *current) {
+    if (current->attempt_num >= current->max_attempts) {
+        // The message exceeded the maximum number of attempts.
+        PT_TRACE5(message__expire, self, message_type_decode(current->buffer, current->buffer_size),
+                  current->sequence_num, current->attempt_num, &current->recipient);
+
+        if (current->max_attempts > 1) {
+            // If the number of maximum attempts is more than 1, then
+            // the message required acknowledgement but we've never received it.
+            // The recipient is kept though: a few lost datagrams don't mean
+            // that the node is down. This is decided by the failure detector.
+            STATS_INC(self, messages_expired);
         }
+        // Remove this message from the queue.
+        gossip_outbound_remove(self, current);
+        return 0;
+    }
 
-        // Update the sequence number in the buffer in order to correspond to
-        // a sequence number stored in envelope. This approach violates
-        // the protocol interface but prevents copying of the whole
-        // buffer each time when a single message has multiple recipients.
-        uint32_t seq_num_n = PT_HTONL(current->sequence_num);
-        uint32_t offset = sizeof(message_header_t) - sizeof(uint32_t);
-        uint8_t *seq_num_buf = (uint8_t *) current->buffer + offset;
-        memcpy(seq_num_buf, &seq_num_n, sizeof(uint32_t));
+    uint64_t current_us = pt_time_us();
+    if (current->attempt_num != 0 && current->retry_us > current_us) {
+        // It's not yet time to retry this message.
+        gossip_send_postpone(self, current->retry_us);
+        return 0;
+    }
+    if (current->attempt_num == 0 && current->attempt_us > current_us) {
+        // The first attempt has been postponed.
+        gossip_send_postpone(self, current->attempt_us);
+        return 0;
+    }
 
-        int write_result = pt_send_to(self->socket, current->buffer, current->buffer_size,
-                                      &current->recipient, current->recipient_len);
+    // Respect the send rate limits of this node and of the recipient. The piggybacked
+    // events are not known yet, but they only fill the remaining space of the datagram.
+    size_t payload_size = current->payload != NULL ? current->payload->data_size : 0;
+    pacer_t *peer_pacer = gossip_peer_pacer(self, &current->recipient, current->recipient_len);
+    uint64_t paced_us = pacer_deadline(&self->pacer, current->buffer_size + payload_size, current_us);
+    if (peer_pacer != NULL) {
+        uint64_t peer_paced_us = pacer_deadline(peer_pacer, current->buffer_size + payload_size, current_us);
+        if (peer_paced_us > paced_us) paced_us = peer_paced_us;
+    }
+    if (paced_us > current_us) {
+        STATS_INC(self, sends_paced);
+        gossip_send_postpone(self, paced_us);
+        return 0;
+    }
 
-        if (write_result < 0) {
-            return PITTACUS_ERR_WRITE_FAILED;
-        }
-        current->attempt_ts = current_ts;
-        ++current->attempt_num;
-        ++msg_sent;
-        if (current->max_attempts <= 1) {
-            // The message must be sent only once. Remove it immediately.
-            gossip_envelope_remove(&self->outbound_messages, current);
+    // The encoded message is shared by envelopes of all recipients and is never modified.
+    // The header with the envelope's sequence number, the sent timestamp and the membership
+    // events are gathered together with it into a single datagram instead.
+    uint8_t sent_ts[sizeof(uint64_t)];
+    size_t sent_ts_size = message_sent_ts_encode(current->buffer, current->buffer_size, current_us, sent_ts);
+    size_t body_end = current->buffer_size - sent_ts_size;
+    size_t payload_offset = current->payload != NULL ? current->payload_offset : body_end;
+
+    int events_size = 0;
+    int message_type = message_type_decode(current->buffer, current->buffer_size);
+    if (message_type == MESSAGE_STATUS_TYPE || message_type == MESSAGE_DATA_TYPE ||
+            message_type == MESSAGE_ACK_TYPE) {
+        // Piggyback recent membership events on the regular traffic.
+        int piggyback_result = gossip_piggyback_member_events(self, current->buffer_size + payload_size);
+        if (piggyback_result > 0) events_size = piggyback_result;
+    }
+
+    uint8_t header[sizeof(message_header_t)];
+    message_header_copy(current->buffer, current->buffer_size, current->sequence_num,
+                        events_size > 0 ? MESSAGE_FLAG_EVENTS : 0, header, sizeof(header));
+
+    pt_iovec iov[6];
+    int iov_len = 0;
+    gossip_iov_append(iov, &iov_len, header, sizeof(header));
+    gossip_iov_append(iov, &iov_len, current->buffer + sizeof(header), payload_offset - sizeof(header));
+    if (current->payload != NULL) gossip_iov_append(iov, &iov_len, current->payload->data, payload_size);
+    gossip_iov_append(iov, &iov_len, current->buffer + payload_offset, body_end - payload_offset);
+    gossip_iov_append(iov, &iov_len, sent_ts, sent_ts_size);
+    gossip_iov_append(iov, &iov_len, self->send_buffer, events_size);
+    size_t datagram_size = current->buffer_size + payload_size + events_size;
+
+    int write_result = pt_send_iov(self->socket, iov, iov_len, &current->recipient, current->recipient_len);
+
+    if (write_result < 0) {
+        STATS_INC(self, write_failures);
+        return PITTACUS_ERR_WRITE_FAILED;
+    }
+    if (message_type >= 0 && message_type < PITTACUS_STATS_MESSAGE_TYPES) {
+        STATS_INC(self, messages_sent[message_type]);
+    }
+    STATS_ADD(self, bytes_sent, datagram_size);
+    pacer_consume(&self->pacer, datagram_size);
+    if (peer_pacer != NULL) pacer_consume(peer_pacer, datagram_size);
+    if (current->attempt_num > 0) {
+        STATS_INC(self, retries);
+        PT_TRACE4(message__retry, self, message_type, current->sequence_num, current->attempt_num + 1);
+    }
+    PT_TRACE6(message__send, self, message_type, current->sequence_num, current->attempt_num + 1,
+              datagram_size, &current->recipient);
+    current->attempt_us = current_us;
+    if (current->max_attempts <= 1) {
+        // The message must be sent only once. Remove it immediately.
+        gossip_outbound_remove(self, current);
+        return 1;
+    }
+    // The retransmission timeout is derived from the round trip time to the recipient
+    // and backs off exponentially with each attempt.
+    current->retry_us = current_us + gossip_retry_timeout(self, current);
+    ++current->attempt_num;
+    if (current->attempt_num < current->max_attempts) gossip_send_postpone(self, current->retry_us);
+    return 1;
+}
+
+
+static const uint32_t gossip_lane_weights[PITTACUS_PRIORITIES] = {
+    OUTBOUND_WEIGHT_CONTROL,
+    OUTBOUND_WEIGHT_MEMBERSHIP,
+    OUTBOUND_WEIGHT_ANTI_ENTROPY,
+    OUTBOUND_WEIGHT_DATA
+};
+
+static int gossip_process_send(pittacus_gossip_t *self) {
+    if (self->state != STATE_JOINING && self->state != STATE_CONNECTED) return PITTACUS_ERR_BAD_STATE;
+    message_envelope_out_t *cursors[PITTACUS_PRIORITIES];
+    for (int lane = 0; lane < PITTACUS_PRIORITIES; ++lane) cursors[lane] = self->outbound_messages[lane].head;
+
+    // The deadline is recalculated from the messages that are skipped during this pass.
+    self->next_send_us = UINT64_MAX;
+    int msg_sent = 0;
+    pt_bool_t pending = PT_TRUE;
+    while (pending) {
+        pending = PT_FALSE;
+        // Each round every lane sends up to its weight of messages. Messages that
+        // are not due yet don't count.
+        for (int lane = 0; lane < PITTACUS_PRIORITIES; ++lane) {
+            uint32_t quantum = gossip_lane_weights[lane] > 0 ? gossip_lane_weights[lane] : 1;
+            while (quantum > 0 && cursors[lane] != NULL) {
+                if (OUTBOUND_SEND_BUDGET > 0 && msg_sent >= OUTBOUND_SEND_BUDGET) {
+                    self->next_send_us = 0;
+                    return msg_sent;
+                }
+                message_envelope_out_t *current = cursors[lane];
+                cursors[lane] = current->next;
+                int send_result = gossip_send_envelope(self, current);
+                if (send_result < 0) {
+                    self->next_send_us = 0;
+                    return send_result;
+                }
+                if (send_result > 0) {
+                    ++msg_sent;
+                    --quantum;
+                }
+            }
+            if (cursors[lane] != NULL) pending = PT_TRUE;
         }
     }
+    gossip_outbound_drained(self);
     return msg_sent;
 }
 
-int pittacus_gossip_send_data(pittacus_gossip_t *self, const uint8_t *data, uint32_t data_size) {
+int pittacus_gossip_process_send(pittacus_gossip_t *self) {
+    int result = gossip_process_send(self);
+    gossip_stats_publish_gauges(self);
+    return result;
+}
+
+static int gossip_send_datav(pittacus_gossip_t *self, const pt_iovec *iov, int iov_len, pittacus_priority_t priority) {
     RETURN_IF_NOT_CONNECTED(self->state);
-    return gossip_enqueue_data(self, data, data_size);
+    if (priority < 0 || priority >= PITTACUS_PRIORITIES) return PITTACUS_ERR_INVALID_ARGUMENT;
+    if (gossip_outbound_is_full(self)) return PITTACUS_ERR_WOULD_BLOCK;
+    size_t data_size = 0;
+    for (int i = 0; i < iov_len; ++i) data_size += iov[i].iov_len;
+    if (data_size > DATA_PAYLOAD_MAX_SIZE) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+
+    // The only copy of the payload. The data log and outbound messages refer to it.
+    data_payload_t *payload = gossip_data_payload_create(data_size);
+    if (payload == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
+    payload->priority = priority;
+    uint8_t *cursor = payload->storage;
+    for (int i = 0; i < iov_len; ++i) {
+        memcpy(cursor, iov[i].iov_base, iov[i].iov_len);
+        cursor += iov[i].iov_len;
+    }
+    int result = gossip_enqueue_data(self, payload);
+    gossip_data_payload_release(payload);
+    gossip_stats_publish_gauges(self);
+    return result;
 }
 
-int pittacus_gossip_tick(pittacus_gossip_t *self) {
+int pittacus_gossip_send_data(pittacus_gossip_t *self, const uint8_t *data, uint32_t data_size) {
+    return pittacus_gossip_send_data_priority(self, data, data_size, PRIORITY_DATA);
+}
+
+int pittacus_gossip_send_data_priority(pittacus_gossip_t *self, const uint8_t *data, uint32_t data_size,
+                                       pittacus_priority_t priority) {
+    pt_iovec iov = { .iov_base = (void *) data, .iov_len = data_size };
+    return gossip_send_datav(self, &iov, 1, priority);
+}
+
+int pittacus_gossip_send_datav(pittacus_gossip_t *self, const pt_iovec *iov, int iov_len) {
+    return gossip_send_datav(self, iov, iov_len, PRIORITY_DATA);
+}
+
+int pittacus_gossip_send_data_borrowed(pittacus_gossip_t *self, const uint8_t *data, uint32_t data_size,
+                                       data_release_t release, void *release_context) {
+    int result = PITTACUS_ERR_NONE;
+    data_payload_t *payload = NULL;
+    if (self->state != STATE_CONNECTED) {
+        result = PITTACUS_ERR_BAD_STATE;
+    } else if (data_size > DATA_PAYLOAD_MAX_SIZE) {
+        result = PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+    } else if (gossip_outbound_is_full(self)) {
+        result = PITTACUS_ERR_WOULD_BLOCK;
+    } else if ((payload = gossip_data_payload_create(0)) == NULL) {
+        result = PITTACUS_ERR_ALLOCATION_FAILED;
+    }
+    if (result < 0) {
+        // The buffer is released exactly once, no matter whether it has been accepted.
+        if (release != NULL) release(release_context, data, data_size);
+        return result;
+    }
+    payload->data = data;
+    payload->data_size = data_size;
+    payload->release = release;
+    payload->release_context = release_context;
+    result = gossip_enqueue_data(self, payload);
+    gossip_data_payload_release(payload);
+    gossip_stats_publish_gauges(self);
+    return result;
+}
+
+static int gossip_bridge_round(pittacus_gossip_t *self) {
+    // Exchange Status messages with the bridges of other zones, so each side pulls the data
+    // it's missing and spreads it within its own zone. Other members of remote zones are
+    // used only if no bridges are known.
+    cluster_member_t *reservoir[ZONE_BRIDGE_FANOUT];
+    size_t members_num = cluster_member_set_zone_members(&self->members, reservoir, ZONE_BRIDGE_FANOUT,
+                                                         self->self_address.zone, ZONE_REMOTE_BRIDGES);
+    if (members_num == 0) {
+        members_num = cluster_member_set_zone_members(&self->members, reservoir, ZONE_BRIDGE_FANOUT,
+                                                      self->self_address.zone, ZONE_REMOTE);
+    }
+    for (size_t i = 0; i < members_num; ++i) {
+        int result = gossip_enqueue_status(self, MESSAGE_MEMBER_LOG_NO_REQUEST,
+                                           reservoir[i]->address, reservoir[i]->address_len);
+        if (result < 0) return result;
+    }
+    return PITTACUS_ERR_NONE;
+}
+
+static int gossip_shuffle_round(pittacus_gossip_t *self) {
+    cluster_member_t *target = NULL;
+    if (cluster_member_set_random_members(&self->members, &target, 1) == 0) return PITTACUS_ERR_NONE;
+
+    // This node is the origin of the walk. It's sent separately from the sample
+    // of its active and passive views.
+    cluster_member_t *reservoir[SHUFFLE_ACTIVE_MEMBERS + SHUFFLE_PASSIVE_MEMBERS];
+    size_t members_num = cluster_member_set_random_members(&self->members, reservoir, SHUFFLE_ACTIVE_MEMBERS);
+    members_num += cluster_member_set_random_members(&self->passive, reservoir + members_num,
+                                                     SHUFFLE_PASSIVE_MEMBERS);
+
+    cluster_member_t members_to_send[SHUFFLE_ACTIVE_MEMBERS + SHUFFLE_PASSIVE_MEMBERS];
+    for (size_t i = 0; i < members_num; ++i) memcpy(&members_to_send[i], reservoir[i], sizeof(cluster_member_t));
+
+    message_shuffle_t shuffle_msg;
+    message_header_init(&shuffle_msg.header, MESSAGE_SHUFFLE_TYPE, 0);
+    shuffle_msg.ttl = PASSIVE_RANDOM_WALK_LENGTH;
+    shuffle_msg.origin = &self->self_address;
+    shuffle_msg.members_n = members_num;
+    shuffle_msg.members = members_to_send;
+    return gossip_enqueue_message(self, MESSAGE_SHUFFLE_TYPE, &shuffle_msg,
+                                  target->address, target->address_len, GOSSIP_DIRECT);
+}
+
+static int gossip_tick(pittacus_gossip_t *self) {
     if (self->state != STATE_CONNECTED) return GOSSIP_TICK_INTERVAL;
-    uint64_t next_gossip_ts = self->last_gossip_ts + GOSSIP_TICK_INTERVAL;
+    uint64_t next_gossip_ts = self->last_gossip_ts + self->gossip_interval;
     uint64_t current_ts = pt_time();
-    if (next_gossip_ts > current_ts) {
-        return next_gossip_ts - current_ts;
+    if (next_gossip_ts <= current_ts) {
+        if (GOSSIP_PARTIAL_VIEW) {
+            int repair_result = gossip_active_repair(self);
+            if (repair_result < 0) return repair_result;
+        }
+        int enqueue_result = gossip_enqueue_status(self, MESSAGE_MEMBER_LOG_NO_REQUEST, NULL, 0);
+        if (enqueue_result < 0) return enqueue_result;
+        gossip_round_completed(self);
+        self->last_gossip_ts = current_ts;
+        next_gossip_ts = current_ts + self->gossip_interval;
     }
-    int enqueue_result = gossip_enqueue_status(self, NULL, 0);
-    if (enqueue_result < 0) return enqueue_result;
-    self->last_gossip_ts = current_ts;
+    if (self->self_address.bridge) {
+        uint64_t next_bridge_ts = self->last_bridge_ts + ZONE_BRIDGE_INTERVAL;
+        if (next_bridge_ts <= current_ts) {
+            int enqueue_result = gossip_bridge_round(self);
+            if (enqueue_result < 0) return enqueue_result;
+            self->last_bridge_ts = current_ts;
+            next_bridge_ts = current_ts + ZONE_BRIDGE_INTERVAL;
+        }
+        if (next_bridge_ts < next_gossip_ts) next_gossip_ts = next_bridge_ts;
+    }
+    if (GOSSIP_PARTIAL_VIEW) {
+        uint64_t next_shuffle_ts = self->last_shuffle_ts + SHUFFLE_INTERVAL;
+        if (next_shuffle_ts <= current_ts) {
+            int enqueue_result = gossip_shuffle_round(self);
+            if (enqueue_result < 0) return enqueue_result;
+            self->last_shuffle_ts = current_ts;
+            next_shuffle_ts = current_ts + SHUFFLE_INTERVAL;
+        }
+        if (next_shuffle_ts < next_gossip_ts) next_gossip_ts = next_shuffle_ts;
+    }
+
+    int next_probe = gossip_probe_tick(self);
+    if (next_probe < 0) return next_probe;
+
+    int next_gossip = next_gossip_ts - current_ts;
+    return next_probe < next_gossip ? next_probe : next_gossip;
+}
 
-    return GOSSIP_TICK_INTERVAL;
+int pittacus_gossip_tick(pittacus_gossip_t *self) {
+    int result = gossip_tick(self);
+    gossip_stats_publish_gauges(self);
+    return result;
 }
 
 pittacus_gossip_state_t pittacus_gossip_state(pittacus_gossip_t *self) {
     return self->state;
 }
 
+int pittacus_gossip_stats(pittacus_gossip_t *self, pittacus_gossip_stats_t *result) {
+    const pittacus_gossip_stats_t *stats = &self->stats;
+    for (int i = 0; i < PITTACUS_STATS_MESSAGE_TYPES; ++i) {
+        result->messages_sent[i] = STATS_LOAD(stats->messages_sent[i]);
+        result->messages_received[i] = STATS_LOAD(stats->messages_received[i]);
+    }
+    result->bytes_sent = STATS_LOAD(stats->bytes_sent);
+    result->bytes_received = STATS_LOAD(stats->bytes_received);
+    result->retries = STATS_LOAD(stats->retries);
+    result->messages_expired = STATS_LOAD(stats->messages_expired);
+    result->buffer_evictions = STATS_LOAD(stats->buffer_evictions);
+    result->members_removed = STATS_LOAD(stats->members_removed);
+    result->members_suspected = STATS_LOAD(stats->members_suspected);
+    result->indirect_probes = STATS_LOAD(stats->indirect_probes);
+    result->suspicions_refuted = STATS_LOAD(stats->suspicions_refuted);
+    result->members_promoted = STATS_LOAD(stats->members_promoted);
+    result->member_events_sent = STATS_LOAD(stats->member_events_sent);
+    result->member_log_events_sent = STATS_LOAD(stats->member_log_events_sent);
+    result->relays_suppressed = STATS_LOAD(stats->relays_suppressed);
+    result->sends_paced = STATS_LOAD(stats->sends_paced);
+    result->sends_blocked = STATS_LOAD(stats->sends_blocked);
+    result->decode_failures = STATS_LOAD(stats->decode_failures);
+    result->write_failures = STATS_LOAD(stats->write_failures);
+
+    result->outbound_queue_size = STATS_LOAD(stats->outbound_queue_size);
+    for (int lane = 0; lane < PITTACUS_PRIORITIES; ++lane) {
+        result->outbound_lane_sizes[lane] = STATS_LOAD(stats->outbound_lane_sizes[lane]);
+    }
+    result->members_num = STATS_LOAD(stats->members_num);
+    result->passive_members_num = STATS_LOAD(stats->passive_members_num);
+    result->data_log_size = STATS_LOAD(stats->data_log_size);
+    result->data_version_size = STATS_LOAD(stats->data_version_size);
+    result->fanout = STATS_LOAD(stats->fanout);
+    result->tick_interval = STATS_LOAD(stats->tick_interval);
+    return PITTACUS_ERR_NONE;
+}
+
+int pittacus_gossip_latency(pittacus_gossip_t *self, pittacus_gossip_latency_t *result) {
+    pittacus_histogram_copy(&result->hop_latency, &self->latency.hop_latency);
+    pittacus_histogram_copy(&result->propagation_age, &self->latency.propagation_age);
+    pittacus_histogram_copy(&result->ack_rtt, &self->latency.ack_rtt);
+    return PITTACUS_ERR_NONE;
+}
+
+int pittacus_gossip_peer_stats(pittacus_gossip_t *self, const pittacus_addr_t *peer_addr,
+                               pittacus_peer_stats_t *result) {
+    cluster_member_t *member = cluster_member_set_find_by_addr(&self->members,
+                                                               (const pt_sockaddr_storage *) peer_addr->addr,
+                                                               peer_addr->addr_len);
+    if (member == NULL) return PITTACUS_ERR_NOT_FOUND;
+    rtt_estimator_t rtt;
+    rtt_estimator_init(&rtt);
+    if (member->rtt != NULL) rtt = *member->rtt;
+    result->srtt_us = rtt.srtt_us;
+    result->rttvar_us = rtt.rttvar_us;
+    result->rto_us = rtt_estimator_timeout(&rtt, 0);
+    result->rtt_samples = rtt.samples;
+    return PITTACUS_ERR_NONE;
+}
+
+int pittacus_gossip_estimate_rtt(pittacus_gossip_t *self, const pittacus_addr_t *peer_addr, uint64_t *rtt_us) {
+    cluster_member_t *member = cluster_member_set_find_by_addr(&self->members,
+                                                               (const pt_sockaddr_storage *) peer_addr->addr,
+                                                               peer_addr->addr_len);
+    if (member == NULL || member->coord == NULL) return PITTACUS_ERR_NOT_FOUND;
+    *rtt_us = (uint64_t) vivaldi_distance(&self->coord, member->coord);
+    return PITTACUS_ERR_NONE;
+}
+
+void pittacus_gossip_set_writable_callback(pittacus_gossip_t *self, writable_callback_t callback, void *context) {
+    self->writable_callback = callback;
+    self->writable_context = context;
+}
+
+int64_t pittacus_gossip_send_delay(pittacus_gossip_t *self) {
+    if (self->next_send_us == UINT64_MAX) return -1;
+    uint64_t current_us = pt_time_us();
+    return self->next_send_us > current_us ? (int64_t) (self->next_send_us - current_us) : 0;
+}
+
 pt_socket_fd pittacus_gossip_socket_fd(pittacus_gossip_t *self) {
     return self->socket;
 }
@@ -17,6 +17,7 @@
 #define PITTACUS_GOSSIP_H
 
 #include "network.h"
+#include "histogram.h"
 
 #ifdef  __cplusplus
 extern "C" {
@@ -33,6 +34,19 @@ typedef enum pittacus_gossip_state {
     STATE_DESTROYED
 } pittacus_gossip_state_t;
 
+/**
+ * Priorities of outbound messages. Each priority has its own lane in the outbound
+ * queue, so that acknowledgements and probes are not delayed by large broadcasts.
+ */
+typedef enum pittacus_priority {
+    PRIORITY_CONTROL, /**< Hello, Welcome, Ack and probes. */
+    PRIORITY_MEMBERSHIP, /**< member lists and member state updates. */
+    PRIORITY_ANTI_ENTROPY, /**< Status messages. */
+    PRIORITY_DATA /**< data payloads and their announcements. */
+} pittacus_priority_t;
+
+#define PITTACUS_PRIORITIES 4
+
 /**
  * The definition of the user's data receiver.
  *
@@ -47,6 +61,93 @@ typedef enum pittacus_gossip_state {
 typedef void (*data_receiver_t)(void *context, pittacus_gossip_t *gossip,
                                 const uint8_t *buffer, size_t buffer_size);
 
+/**
+ * A callback which is invoked once the library no longer references
+ * a payload passed to pittacus_gossip_send_data_borrowed().
+ *
+ * @param context a reference to the arbitrary context specified
+ *                by a user.
+ * @param buffer a reference to the released payload.
+ * @param buffer_size a size of the payload.
+ * @return Void.
+ */
+typedef void (*data_release_t)(void *context, const uint8_t *buffer, size_t buffer_size);
+
+/**
+ * A callback which is invoked once the outbound queue drains to OUTBOUND_LOW_WATERMARK
+ * occupied buffers or below after a send function returned PITTACUS_ERR_WOULD_BLOCK.
+ * It fires once no matter how many sends were rejected, on the thread that
+ * calls pittacus_gossip_process_receive() or pittacus_gossip_process_send().
+ *
+ * @param context a reference to the arbitrary context specified
+ *                by a user.
+ * @param gossip a reference to the gossip descriptor instance.
+ * @return Void.
+ */
+typedef void (*writable_callback_t)(void *context, pittacus_gossip_t *gossip);
+
+/** The number of slots reserved for per message type counters. */
+#define PITTACUS_STATS_MESSAGE_TYPES 19
+
+/**
+ * A snapshot of the runtime statistics of a gossip instance.
+ * Counters are monotonic and accumulate since the instance creation.
+ * Gauges reflect the state at the moment when the snapshot was taken.
+ */
+typedef struct pittacus_gossip_stats {
+    uint64_t messages_sent[PITTACUS_STATS_MESSAGE_TYPES]; /**< datagrams sent, indexed by message type. */
+    uint64_t messages_received[PITTACUS_STATS_MESSAGE_TYPES]; /**< datagrams received, indexed by message type. */
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    uint64_t retries; /**< repeated delivery attempts of unacknowledged messages. */
+    uint64_t messages_expired; /**< messages dropped after exceeding the maximum number of attempts. */
+    uint64_t buffer_evictions; /**< messages evicted from the queue to free up an output buffer. */
+    uint64_t members_removed; /**< members removed because they were declared dead. */
+    uint64_t members_suspected; /**< members suspected by this node after a failed probe. */
+    uint64_t indirect_probes; /**< probes that required help of other members. */
+    uint64_t suspicions_refuted; /**< suspicions about this node refuted by it. */
+    uint64_t members_promoted; /**< members moved from the passive view to the active one. */
+    uint64_t member_events_sent; /**< membership events piggybacked on outgoing messages. */
+    uint64_t member_log_events_sent; /**< membership changes resent to peers that requested them. */
+    uint64_t relays_suppressed; /**< data payloads that were not relayed due to the hop limit or duplicates. */
+    uint64_t sends_paced; /**< attempts to send a message that were postponed by the send rate limits. */
+    uint64_t sends_blocked; /**< data payloads rejected because the outbound queue was full. */
+    uint64_t decode_failures; /**< arrived datagrams that couldn't be decoded. */
+    uint64_t write_failures;
+
+    uint32_t outbound_queue_size; /**< messages waiting for delivery or acknowledgement. */
+    uint32_t outbound_lane_sizes[PITTACUS_PRIORITIES]; /**< the outbound queue size by priority. */
+    uint32_t members_num; /**< the size of the active view if the partial view is enabled. */
+    uint32_t passive_members_num; /**< the size of the passive view, zero if the partial view is disabled. */
+    uint32_t data_log_size;
+    uint32_t data_version_size; /**< the number of records in the data vector clock. */
+    uint32_t fanout; /**< the number of members that receive each rumor. */
+    uint32_t tick_interval; /**< the current interval between anti-entropy rounds in milliseconds. */
+} pittacus_gossip_stats_t;
+
+/**
+ * Latency distributions observed by a gossip instance. All values are in
+ * microseconds. The hop latency and the propagation age are derived from
+ * the sender's clock, so they are only meaningful when clocks of nodes are
+ * synchronized (e.g. with NTP).
+ */
+typedef struct pittacus_gossip_latency {
+    pittacus_histogram_t hop_latency; /**< from sending a Data message by the previous hop till its arrival. */
+    pittacus_histogram_t propagation_age; /**< from the payload origination till its first arrival. */
+    pittacus_histogram_t ack_rtt; /**< from sending a message till the arrival of its acknowledgement. */
+} pittacus_gossip_latency_t;
+
+/**
+ * The round trip time estimate of a single member. All values are in microseconds.
+ * The estimate is updated by acknowledgements of messages that were sent once.
+ */
+typedef struct pittacus_peer_stats {
+    uint64_t srtt_us; /**< the smoothed round trip time. */
+    uint64_t rttvar_us; /**< the round trip time variation. */
+    uint64_t rto_us; /**< the retransmission timeout of the first attempt. */
+    uint32_t rtt_samples; /**< zero if the round trip time hasn't been measured yet. */
+} pittacus_peer_stats_t;
+
 typedef struct pittacus_addr {
     const pt_sockaddr *addr; /**< pointer to the address instance. */
     socklen_t addr_len; /**< size of the address. */
@@ -77,6 +178,19 @@ pittacus_gossip_t *pittacus_gossip_create(const pittacus_addr_t *self_addr,
  */
 int pittacus_gossip_destroy(pittacus_gossip_t *self);
 
+/**
+ * Assigns this node to a zone, e.g. a data center. Nodes with a zone label gossip mostly
+ * with members of the same zone. Bridge nodes also exchange Status messages with other
+ * zones every ZONE_BRIDGE_INTERVAL milliseconds, so each zone needs at least one of them.
+ * Must be invoked before pittacus_gossip_join(). Nodes without a zone gossip with everyone.
+ *
+ * @param self a gossip descriptor instance.
+ * @param zone the zone label. The value 65535 is reserved.
+ * @param bridge whether this node exchanges updates with other zones.
+ * @return zero on success or negative value if the operation failed.
+ */
+int pittacus_gossip_set_zone(pittacus_gossip_t *self, uint16_t zone, int bridge);
+
 /**
  * Join the gossip cluster using the list of seed nodes.
  *
@@ -99,7 +213,10 @@ int pittacus_gossip_process_receive(pittacus_gossip_t *self);
 
 /**
  * Suggests Pittacus to write existing outbound messages to the socket.
- * All available messages will be written to the socket.
+ * All available messages will be written to the socket unless OUTBOUND_SEND_BUDGET
+ * limits the number of messages per invocation. Lanes of different priorities
+ * are drained in a weighted round robin, so the higher priorities go first
+ * but the lower ones still get their share.
  *
  * @param self a gossip descriptor instance.
  * @return a number of sent messages or negative value if the operation failed.
@@ -113,6 +230,10 @@ int pittacus_gossip_process_send(pittacus_gossip_t *self);
  * and will be sent to a cluster during the next pittacus_gossip_process_send()
  * invocation.
  *
+ * If OUTBOUND_HIGH_WATERMARK output buffers are occupied, the payload is rejected
+ * with PITTACUS_ERR_WOULD_BLOCK. The writable callback is invoked once the queue
+ * drains to OUTBOUND_LOW_WATERMARK. The same applies to the other send functions.
+ *
  * @param self a gossip descriptor instance.
  * @param data a payload.
  * @param data_size a payload size.
@@ -121,7 +242,75 @@ int pittacus_gossip_process_send(pittacus_gossip_t *self);
 int pittacus_gossip_send_data(pittacus_gossip_t *self, const uint8_t *data, uint32_t data_size);
 
 /**
- * Processes the Gossip tick event.
+ * Same as pittacus_gossip_send_data() but the outbound messages of this payload are
+ * sent with the given priority instead of PRIORITY_DATA. The priority is not
+ * propagated: other members relay the payload with PRIORITY_DATA.
+ *
+ * @param self a gossip descriptor instance.
+ * @param data a payload.
+ * @param data_size a payload size.
+ * @param priority the priority of the outbound messages.
+ * @return zero on success or negative value if the operation failed.
+ */
+int pittacus_gossip_send_data_priority(pittacus_gossip_t *self, const uint8_t *data, uint32_t data_size,
+                                       pittacus_priority_t priority);
+
+/**
+ * Spreads a payload which consists of several segments, e.g. a header,
+ * a body and a trailer. The segments are gathered into a single copy which
+ * is shared by the data log and all outbound messages.
+ *
+ * @param self a gossip descriptor instance.
+ * @param iov payload segments.
+ * @param iov_len the number of segments.
+ * @return zero on success or negative value if the operation failed.
+ */
+int pittacus_gossip_send_datav(pittacus_gossip_t *self, const pt_iovec *iov, int iov_len);
+
+/**
+ * Spreads the given data buffer without copying it. The buffer must stay
+ * unchanged until the library invokes the release callback, which happens
+ * once the payload is superseded in the data log and no outbound message
+ * refers to it anymore, or when the gossip instance is destroyed. The callback
+ * is invoked exactly once, even if the operation fails.
+ *
+ * @param self a gossip descriptor instance.
+ * @param data a payload.
+ * @param data_size a payload size.
+ * @param release a callback which is invoked when the buffer is no longer used. Can be NULL.
+ * @param release_context an arbitrary context which is passed to the release callback.
+ * @return zero on success or negative value if the operation failed.
+ */
+int pittacus_gossip_send_data_borrowed(pittacus_gossip_t *self, const uint8_t *data, uint32_t data_size,
+                                       data_release_t release, void *release_context);
+
+/**
+ * Calculates when pittacus_gossip_process_send() should be invoked next, so that
+ * the event loop can sleep until then: the next retry of an unacknowledged message,
+ * a postponed message, or the moment when the send rate limits allow the next
+ * message. The value is recalculated by each pittacus_gossip_process_send() invocation.
+ *
+ * @param self a gossip descriptor instance.
+ * @return the time interval in microseconds, zero if there are messages to send
+ *         right away, or -1 if there is nothing to send.
+ */
+int64_t pittacus_gossip_send_delay(pittacus_gossip_t *self);
+
+/**
+ * Sets the callback which is invoked when the outbound queue drains to
+ * OUTBOUND_LOW_WATERMARK after a send function returned PITTACUS_ERR_WOULD_BLOCK.
+ * The callback is invoked from pittacus_gossip_process_send() or
+ * pittacus_gossip_process_receive() and may send data.
+ *
+ * @param self a gossip descriptor instance.
+ * @param callback the callback or NULL.
+ * @param context an arbitrary context which is passed to the callback.
+ */
+void pittacus_gossip_set_writable_callback(pittacus_gossip_t *self, writable_callback_t callback, void *context);
+
+/**
+ * Processes the Gossip tick event. Besides the anti-entropy this drives
+ * the failure detector: probes of members, their timeouts and suspicions.
  * Note: no actions will be performed if the time for the next tick
  * has not yet come. However the return value will be recalculated according
  * to the time that has passed since the last tick.
@@ -140,6 +329,59 @@ int pittacus_gossip_tick(pittacus_gossip_t *self);
  */
 pittacus_gossip_state_t pittacus_gossip_state(pittacus_gossip_t *self);
 
+/**
+ * Takes a snapshot of this node's runtime statistics.
+ * Note: this function doesn't acquire any locks and can be invoked
+ * from a thread other than the one that drives this instance. In that
+ * case individual values are consistent, but the snapshot as a whole
+ * is not atomic. Gauges are updated when a function of this instance
+ * returns to the driving thread, so they don't reflect the changes made
+ * by a call that is still in progress (e.g. inside the data receiver).
+ *
+ * @param self a gossip descriptor instance.
+ * @param result a statistics instance to fill in.
+ * @return zero on success or negative value if the operation failed.
+ */
+int pittacus_gossip_stats(pittacus_gossip_t *self, pittacus_gossip_stats_t *result);
+
+/**
+ * Takes a snapshot of the latency histograms of this node. Like
+ * pittacus_gossip_stats() this function can be invoked from any thread.
+ *
+ * @param self a gossip descriptor instance.
+ * @param result a latency instance to fill in.
+ * @return zero on success or negative value if the operation failed.
+ */
+int pittacus_gossip_latency(pittacus_gossip_t *self, pittacus_gossip_latency_t *result);
+
+/**
+ * Retrieves the round trip time estimate of the member with the given address.
+ * Unlike pittacus_gossip_stats() this function must be invoked from the thread
+ * that drives this instance.
+ *
+ * @param self a gossip descriptor instance.
+ * @param peer_addr the address of the member.
+ * @param result a statistics instance to fill in.
+ * @return zero on success, PITTACUS_ERR_NOT_FOUND if the member is unknown
+ *         or negative value if the operation failed.
+ */
+int pittacus_gossip_peer_stats(pittacus_gossip_t *self, const pittacus_addr_t *peer_addr,
+                               pittacus_peer_stats_t *result);
+
+/**
+ * Estimates the round trip time to the member with the given address from the network
+ * coordinates of both nodes. Unlike the measured round trip time the estimate is available
+ * for every member whose coordinate has arrived with a Status message or an acknowledgement,
+ * and it's computed in constant time. Must be invoked from the thread that drives this instance.
+ *
+ * @param self a gossip descriptor instance.
+ * @param peer_addr the address of the member.
+ * @param rtt_us the estimated round trip time in microseconds.
+ * @return zero on success, PITTACUS_ERR_NOT_FOUND if the member or its coordinate
+ *         is unknown or negative value if the operation failed.
+ */
+int pittacus_gossip_estimate_rtt(pittacus_gossip_t *self, const pittacus_addr_t *peer_addr, uint64_t *rtt_us);
+
 /**
  * Retrieves gossip socket descriptor.
  *
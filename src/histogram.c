@@ -0,0 +1,97 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "histogram.h"
+#include <string.h>
+
+#define LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define STORE(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+
+static uint32_t histogram_bucket_index(uint64_t value) {
+    if (value < PITTACUS_HISTOGRAM_SUB_BUCKETS) return value;
+    uint32_t exponent = 63 - __builtin_clzll(value);
+    if (exponent > PITTACUS_HISTOGRAM_MAX_EXPONENT) return PITTACUS_HISTOGRAM_BUCKETS - 1;
+    uint32_t shift = exponent - PITTACUS_HISTOGRAM_SUB_BUCKETS_BITS;
+    uint32_t sub_bucket = (value >> shift) & (PITTACUS_HISTOGRAM_SUB_BUCKETS - 1);
+    return PITTACUS_HISTOGRAM_SUB_BUCKETS * (shift + 1) + sub_bucket;
+}
+
+static uint64_t histogram_bucket_upper_bound(uint32_t index) {
+    if (index < PITTACUS_HISTOGRAM_SUB_BUCKETS) return index;
+    uint32_t shift = index / PITTACUS_HISTOGRAM_SUB_BUCKETS - 1;
+    uint64_t sub_bucket = index % PITTACUS_HISTOGRAM_SUB_BUCKETS + PITTACUS_HISTOGRAM_SUB_BUCKETS;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+void pittacus_histogram_init(pittacus_histogram_t *histogram) {
+    memset(histogram, 0, sizeof(pittacus_histogram_t));
+    histogram->min = UINT64_MAX;
+}
+
+void pittacus_histogram_record(pittacus_histogram_t *histogram, uint64_t value) {
+    uint32_t index = histogram_bucket_index(value);
+    STORE(histogram->buckets[index], LOAD(histogram->buckets[index]) + 1);
+    STORE(histogram->sum, LOAD(histogram->sum) + value);
+    if (value < LOAD(histogram->min)) STORE(histogram->min, value);
+    if (value > LOAD(histogram->max)) STORE(histogram->max, value);
+    // The count is released last and acquired first by the reader, so a concurrent
+    // reader never sees more values than buckets contain.
+    __atomic_store_n(&histogram->count, LOAD(histogram->count) + 1, __ATOMIC_RELEASE);
+}
+
+void pittacus_histogram_copy(pittacus_histogram_t *dst, const pittacus_histogram_t *src) {
+    dst->count = __atomic_load_n(&src->count, __ATOMIC_ACQUIRE);
+    dst->sum = LOAD(src->sum);
+    dst->min = LOAD(src->min);
+    dst->max = LOAD(src->max);
+    for (int i = 0; i < PITTACUS_HISTOGRAM_BUCKETS; ++i) {
+        dst->buckets[i] = LOAD(src->buckets[i]);
+    }
+}
+
+void pittacus_histogram_merge(pittacus_histogram_t *dst, const pittacus_histogram_t *src) {
+    if (src->count == 0) return;
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+    for (int i = 0; i < PITTACUS_HISTOGRAM_BUCKETS; ++i) {
+        dst->buckets[i] += src->buckets[i];
+    }
+}
+
+uint64_t pittacus_histogram_percentile(const pittacus_histogram_t *histogram, double percentile) {
+    if (histogram->count == 0) return 0;
+    if (percentile > 100.0) percentile = 100.0;
+    uint64_t target = (uint64_t) (percentile / 100.0 * histogram->count + 0.5);
+    if (target == 0) target = 1;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < PITTACUS_HISTOGRAM_BUCKETS; ++i) {
+        seen += histogram->buckets[i];
+        if (seen >= target) {
+            // The last bucket is unbounded.
+            if (i == PITTACUS_HISTOGRAM_BUCKETS - 1) break;
+            uint64_t result = histogram_bucket_upper_bound(i);
+            return result < histogram->max ? result : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+double pittacus_histogram_mean(const pittacus_histogram_t *histogram) {
+    if (histogram->count == 0) return 0.0;
+    return (double) histogram->sum / histogram->count;
+}
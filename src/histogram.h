@@ -0,0 +1,77 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef PITTACUS_HISTOGRAM_H
+#define PITTACUS_HISTOGRAM_H
+
+#include <stdint.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A log-linear histogram in the spirit of HdrHistogram. Values below
+ * PITTACUS_HISTOGRAM_SUB_BUCKETS are stored exactly. Each further power of two
+ * is split into PITTACUS_HISTOGRAM_SUB_BUCKETS linear sub-buckets, which keeps
+ * the relative error of every recorded value below 1/PITTACUS_HISTOGRAM_SUB_BUCKETS.
+ * Values above 2^PITTACUS_HISTOGRAM_MAX_EXPONENT are accounted in the last bucket.
+ */
+
+#define PITTACUS_HISTOGRAM_SUB_BUCKETS_BITS 3
+#define PITTACUS_HISTOGRAM_SUB_BUCKETS (1 << PITTACUS_HISTOGRAM_SUB_BUCKETS_BITS)
+#define PITTACUS_HISTOGRAM_MAX_EXPONENT 40
+#define PITTACUS_HISTOGRAM_BUCKETS \
+    (PITTACUS_HISTOGRAM_SUB_BUCKETS * (PITTACUS_HISTOGRAM_MAX_EXPONENT - PITTACUS_HISTOGRAM_SUB_BUCKETS_BITS + 2))
+
+typedef struct pittacus_histogram {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[PITTACUS_HISTOGRAM_BUCKETS];
+} pittacus_histogram_t;
+
+void pittacus_histogram_init(pittacus_histogram_t *histogram);
+
+/**
+ * Records a new value. The histogram is updated with relaxed atomic
+ * stores, so a single writer can update it while other threads are
+ * taking snapshots using pittacus_histogram_copy().
+ */
+void pittacus_histogram_record(pittacus_histogram_t *histogram, uint64_t value);
+
+void pittacus_histogram_copy(pittacus_histogram_t *dst, const pittacus_histogram_t *src);
+
+/** Adds all values recorded in the source histogram to the destination one. */
+void pittacus_histogram_merge(pittacus_histogram_t *dst, const pittacus_histogram_t *src);
+
+/**
+ * Estimates the value at the given percentile.
+ *
+ * @param histogram a histogram instance.
+ * @param percentile a percentile from 0.0 to 100.0.
+ * @return the highest value that is equivalent to the value at the given
+ *         percentile or zero if the histogram is empty.
+ */
+uint64_t pittacus_histogram_percentile(const pittacus_histogram_t *histogram, double percentile);
+
+double pittacus_histogram_mean(const pittacus_histogram_t *histogram);
+
+#ifdef  __cplusplus
+} // extern "C"
+#endif
+
+#endif //PITTACUS_HISTOGRAM_H
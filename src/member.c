@@ -18,6 +18,7 @@
 #include "member.h"
 #include "config.h"
 #include "utils.h"
+#include "trace.h"
 #include "errors.h"
 
 static const uint32_t MEMBERS_INITIAL_CAPACITY = 32;
@@ -28,6 +29,17 @@ int cluster_member_init(cluster_member_t *result, const pt_sockaddr_storage *add
     result->uid = pt_time() / 1000;
     result->version = PROTOCOL_VERSION;
     result->address_len = address_len;
+    result->state = MEMBER_ALIVE;
+    result->incarnation = 0;
+    result->state_ts = 0;
+    result->detector = NULL;
+    result->eager = 0;
+    result->pacer = NULL;
+    result->rtt = NULL;
+    result->coord = NULL;
+    result->zone = CLUSTER_MEMBER_ZONE_UNKNOWN;
+    result->bridge = 0;
+    result->log_version = 0;
     result->address = (pt_sockaddr_storage *) malloc(address_len);
     if (result->address == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
     memcpy(result->address, address, address_len);
@@ -38,6 +50,18 @@ static int cluster_member_copy(cluster_member_t *dst, cluster_member_t *src) {
     dst->uid = src->uid;
     dst->version = src->version;
     dst->address_len = src->address_len;
+    dst->state = src->state;
+    dst->incarnation = src->incarnation;
+    dst->state_ts = src->state_ts;
+    // The arrival history stays with the original member.
+    dst->detector = NULL;
+    dst->eager = src->eager;
+    dst->pacer = NULL;
+    dst->rtt = NULL;
+    dst->coord = NULL;
+    dst->zone = src->zone;
+    dst->bridge = src->bridge;
+    dst->log_version = src->log_version;
     dst->address = (pt_sockaddr_storage *) malloc(src->address_len);
     if (dst->address == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
     memcpy(dst->address, src->address, src->address_len);
@@ -51,40 +75,200 @@ int cluster_member_equals(cluster_member_t *first, cluster_member_t *second) {
             memcmp(first->address, second->address, first->address_len) == 0;
 }
 
+int cluster_member_state_overrides(const cluster_member_t *member, uint8_t state, uint32_t incarnation) {
+    if (incarnation != member->incarnation) return incarnation > member->incarnation;
+    // Within the same incarnation Dead overrides Suspect and Suspect overrides Alive.
+    return state > member->state;
+}
+
 void cluster_member_destroy(cluster_member_t *result) {
     free(result->address);
+    free(result->detector);
+    free(result->pacer);
+    free(result->rtt);
+    free(result->coord);
+}
+
+#define CLUSTER_MEMBER_ADDRESS_RAW 0x00
+#define CLUSTER_MEMBER_ADDRESS_IPV4 0x04
+#define CLUSTER_MEMBER_ADDRESS_IPV6 0x06
+
+// Restores the socket address from its address and port bytes, both in the network byte order.
+static pt_socklen_t cluster_member_address_restore(uint8_t family, const uint8_t *address, const uint8_t *port,
+                                                   pt_sockaddr_storage *result) {
+    memset(result, 0, sizeof(pt_sockaddr_storage));
+    if (family == CLUSTER_MEMBER_ADDRESS_IPV4) {
+        pt_sockaddr_in *addr_in = (pt_sockaddr_in *) result;
+#ifdef SIN6_LEN
+        addr_in->sin_len = sizeof(pt_sockaddr_in);
+#endif
+        addr_in->sin_family = AF_INET;
+        memcpy(&addr_in->sin_addr, address, 4);
+        memcpy(&addr_in->sin_port, port, sizeof(uint16_t));
+        return sizeof(pt_sockaddr_in);
+    }
+    pt_sockaddr_in6 *addr_in6 = (pt_sockaddr_in6 *) result;
+#ifdef SIN6_LEN
+    addr_in6->sin6_len = sizeof(pt_sockaddr_in6);
+#endif
+    addr_in6->sin6_family = AF_INET6;
+    memcpy(&addr_in6->sin6_addr, address, 16);
+    memcpy(&addr_in6->sin6_port, port, sizeof(uint16_t));
+    return sizeof(pt_sockaddr_in6);
+}
+
+static uint8_t cluster_member_address_family(const cluster_member_t *member) {
+    const pt_sockaddr_storage *addr = member->address;
+    const uint8_t *address = NULL;
+    const uint8_t *port = NULL;
+    uint8_t family = CLUSTER_MEMBER_ADDRESS_RAW;
+    if (addr->ss_family == AF_INET && member->address_len == sizeof(pt_sockaddr_in)) {
+        const pt_sockaddr_in *addr_in = (const pt_sockaddr_in *) addr;
+        family = CLUSTER_MEMBER_ADDRESS_IPV4;
+        address = (const uint8_t *) &addr_in->sin_addr;
+        port = (const uint8_t *) &addr_in->sin_port;
+    } else if (addr->ss_family == AF_INET6 && member->address_len == sizeof(pt_sockaddr_in6)) {
+        const pt_sockaddr_in6 *addr_in6 = (const pt_sockaddr_in6 *) addr;
+        family = CLUSTER_MEMBER_ADDRESS_IPV6;
+        address = (const uint8_t *) &addr_in6->sin6_addr;
+        port = (const uint8_t *) &addr_in6->sin6_port;
+    } else {
+        return CLUSTER_MEMBER_ADDRESS_RAW;
+    }
+    // The address and the port are enough only if the rest of the structure
+    // (padding, flow info and scope) is restored exactly as it was.
+    pt_sockaddr_storage restored;
+    cluster_member_address_restore(family, address, port, &restored);
+    return memcmp(&restored, addr, member->address_len) == 0 ? family : CLUSTER_MEMBER_ADDRESS_RAW;
+}
+
+static size_t cluster_member_family_encoded_size(const cluster_member_t *member, uint8_t family) {
+    switch (family) {
+        case CLUSTER_MEMBER_ADDRESS_IPV4:
+            return CLUSTER_MEMBER_IPV4_SIZE;
+        case CLUSTER_MEMBER_ADDRESS_IPV6:
+            return CLUSTER_MEMBER_IPV6_SIZE;
+        default:
+            return CLUSTER_MEMBER_HEADER_SIZE + sizeof(uint8_t) + member->address_len;
+    }
+}
+
+size_t cluster_member_encoded_size(const cluster_member_t *member) {
+    return cluster_member_family_encoded_size(member, cluster_member_address_family(member));
 }
 
-int cluster_member_decode(const uint8_t *buffer, size_t buffer_size, cluster_member_t *member) {
-    if (buffer_size < 2 * sizeof(uint32_t) + sizeof(uint16_t)) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+int cluster_member_decode(const uint8_t *buffer, size_t buffer_size, cluster_member_t *member,
+                          pt_sockaddr_storage *address) {
+    if (buffer_size < CLUSTER_MEMBER_HEADER_SIZE) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
     const uint8_t *cursor = buffer;
+    const uint8_t *buffer_end = buffer + buffer_size;
     member->version = uint16_decode(cursor);
+    if (member->version != PROTOCOL_VERSION) return PITTACUS_ERR_INVALID_MESSAGE;
     cursor += sizeof(uint16_t);
     member->uid = uint32_decode(cursor);
     cursor += sizeof(uint32_t);
-    member->address_len = uint32_decode(cursor);
-    cursor += sizeof(uint32_t);
-    member->address = (pt_sockaddr_storage *) cursor;
-    cursor += member->address_len;
+    uint8_t family = *cursor;
+    cursor += sizeof(uint8_t);
+
+    size_t address_size = 0;
+    switch (family) {
+        case CLUSTER_MEMBER_ADDRESS_IPV4:
+            address_size = 4;
+            break;
+        case CLUSTER_MEMBER_ADDRESS_IPV6:
+            address_size = 16;
+            break;
+        case CLUSTER_MEMBER_ADDRESS_RAW:
+            if (cursor == buffer_end) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+            address_size = *cursor;
+            cursor += sizeof(uint8_t);
+            if (address_size > sizeof(pt_sockaddr_storage)) return PITTACUS_ERR_INVALID_MESSAGE;
+            if ((size_t) (buffer_end - cursor) < address_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+            memcpy(address, cursor, address_size);
+            cursor += address_size;
+            member->address_len = address_size;
+            break;
+        default:
+            return PITTACUS_ERR_INVALID_MESSAGE;
+    }
+    if (family != CLUSTER_MEMBER_ADDRESS_RAW) {
+        if ((size_t) (buffer_end - cursor) < address_size + sizeof(uint16_t)) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+        member->address_len = cluster_member_address_restore(family, cursor, cursor + address_size, address);
+        cursor += address_size + sizeof(uint16_t);
+    }
+    member->address = address;
+
+    member->state = MEMBER_ALIVE;
+    member->incarnation = 0;
+    member->state_ts = 0;
+    member->detector = NULL;
+    member->eager = 0;
+    member->pacer = NULL;
+    member->rtt = NULL;
+    member->coord = NULL;
+    member->zone = CLUSTER_MEMBER_ZONE_UNKNOWN;
+    member->bridge = 0;
+    member->log_version = 0;
     return cursor - buffer;
 }
 
 int cluster_member_encode(const cluster_member_t *member, uint8_t *buffer, size_t buffer_size) {
-    if (buffer_size < 2 * sizeof(uint32_t) + sizeof(uint16_t) + member->address_len) {
-        return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
-    }
+    uint8_t family = cluster_member_address_family(member);
+    if (buffer_size < cluster_member_family_encoded_size(member, family)) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
     uint8_t *cursor = buffer;
     uint16_encode(member->version, cursor);
     cursor += sizeof(uint16_t);
     uint32_encode(member->uid, cursor);
     cursor += sizeof(uint32_t);
-    uint32_encode(member->address_len, cursor);
-    cursor += sizeof(uint32_t);
-    memcpy(cursor, member->address, member->address_len);
-    cursor += member->address_len;
+    *cursor = family;
+    cursor += sizeof(uint8_t);
+
+    switch (family) {
+        case CLUSTER_MEMBER_ADDRESS_IPV4: {
+            const pt_sockaddr_in *addr_in = (const pt_sockaddr_in *) member->address;
+            memcpy(cursor, &addr_in->sin_addr, 4);
+            cursor += 4;
+            memcpy(cursor, &addr_in->sin_port, sizeof(uint16_t));
+            cursor += sizeof(uint16_t);
+            break;
+        }
+        case CLUSTER_MEMBER_ADDRESS_IPV6: {
+            const pt_sockaddr_in6 *addr_in6 = (const pt_sockaddr_in6 *) member->address;
+            memcpy(cursor, &addr_in6->sin6_addr, 16);
+            cursor += 16;
+            memcpy(cursor, &addr_in6->sin6_port, sizeof(uint16_t));
+            cursor += sizeof(uint16_t);
+            break;
+        }
+        default:
+            *cursor = member->address_len;
+            cursor += sizeof(uint8_t);
+            memcpy(cursor, member->address, member->address_len);
+            cursor += member->address_len;
+            break;
+    }
     return cursor - buffer;
 }
 
+int cluster_member_zone_decode(const uint8_t *buffer, size_t buffer_size, uint16_t *zone, uint8_t *bridge) {
+    if (buffer_size < CLUSTER_MEMBER_ZONE_SIZE) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+    *zone = uint16_decode(buffer);
+    *bridge = buffer[sizeof(uint16_t)] & 0x1;
+    return CLUSTER_MEMBER_ZONE_SIZE;
+}
+
+int cluster_member_zone_encode(uint16_t zone, uint8_t bridge, uint8_t *buffer, size_t buffer_size) {
+    if (buffer_size < CLUSTER_MEMBER_ZONE_SIZE) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+    uint16_encode(zone, buffer);
+    buffer[sizeof(uint16_t)] = bridge ? 0x1 : 0x0;
+    return CLUSTER_MEMBER_ZONE_SIZE;
+}
+
+int cluster_member_in_zone(const cluster_member_t *member, uint16_t zone) {
+    return zone == CLUSTER_MEMBER_ZONE_UNKNOWN || member->zone == CLUSTER_MEMBER_ZONE_UNKNOWN ||
+            member->zone == zone;
+}
+
 static cluster_member_set_t *cluster_member_set_extend(cluster_member_set_t *members, uint32_t required_size) {
     uint32_t new_capacity = members->capacity;
     while (required_size >= new_capacity * MEMBERS_LOAD_FACTOR) new_capacity *= MEMBERS_EXTENSION_FACTOR;
@@ -127,6 +311,11 @@ int cluster_member_set_put(cluster_member_set_t *members, cluster_member_t *new_
         for (int i = 0; i < members->size; ++i) {
             if (cluster_member_equals(members->set[i], current)) {
                 exists = PT_TRUE;
+                // The zone of a known member may have arrived only now.
+                if (current->zone != CLUSTER_MEMBER_ZONE_UNKNOWN) {
+                    members->set[i]->zone = current->zone;
+                    members->set[i]->bridge = current->bridge;
+                }
                 break;
             }
         }
@@ -138,6 +327,7 @@ int cluster_member_set_put(cluster_member_set_t *members, cluster_member_t *new_
             cluster_member_copy(new_member, current);
             members->set[members->size] = new_member;
             ++members->size;
+            PT_TRACE4(member__add, members, new_member->address, new_member->address_len, new_member->uid);
         }
     }
     return PITTACUS_ERR_NONE;
@@ -150,6 +340,60 @@ static void cluster_member_set_item_destroy(cluster_member_t *member) {
     }
 }
 
+#define MEMBER_PROXIMITY_SCALE 1000000000ULL
+
+static uint64_t cluster_member_proximity(const cluster_member_t *member, const vivaldi_coord_t *origin) {
+    uint64_t rtt_us = MESSAGE_RETRY_TIMEOUT_INITIAL * 1000ULL;
+    if (member->rtt != NULL && member->rtt->samples > 0) {
+        rtt_us = member->rtt->srtt_us;
+    } else if (origin != NULL && member->coord != NULL) {
+        rtt_us = (uint64_t) vivaldi_distance(origin, member->coord);
+    }
+    return MEMBER_PROXIMITY_SCALE / (rtt_us + 1) + 1;
+}
+
+static pt_bool_t cluster_member_is_chosen(cluster_member_t *member, cluster_member_t **reservoir,
+                                          size_t reservoir_size) {
+    for (size_t i = 0; i < reservoir_size; ++i) {
+        if (reservoir[i] == member) return PT_TRUE;
+    }
+    return PT_FALSE;
+}
+
+size_t cluster_member_set_nearby_members(cluster_member_set_t *members,
+                                         cluster_member_t **reservoir, size_t reservoir_size,
+                                         uint32_t random_percent, const vivaldi_coord_t *origin) {
+    // There is nothing to choose from.
+    if (members->size <= reservoir_size) return cluster_member_set_random_members(members, reservoir, reservoir_size);
+
+    for (size_t reservoir_idx = 0; reservoir_idx < reservoir_size; ++reservoir_idx) {
+        cluster_member_t *chosen = NULL;
+        if (pt_random() % 100 < random_percent) {
+            // Keep the mixing properties of the uniform gossip.
+            do {
+                chosen = members->set[pt_random() % members->size];
+            } while (cluster_member_is_chosen(chosen, reservoir, reservoir_idx));
+        } else {
+            // Roulette wheel selection among the members that haven't been chosen yet.
+            uint64_t total = 0;
+            for (uint32_t i = 0; i < members->size; ++i) {
+                if (cluster_member_is_chosen(members->set[i], reservoir, reservoir_idx)) continue;
+                total += cluster_member_proximity(members->set[i], origin);
+            }
+            uint64_t point = (((uint64_t) pt_random() << 32) | pt_random()) % total;
+            for (uint32_t i = 0; i < members->size; ++i) {
+                if (cluster_member_is_chosen(members->set[i], reservoir, reservoir_idx)) continue;
+                chosen = members->set[i];
+                uint64_t proximity = cluster_member_proximity(chosen, origin);
+                if (point < proximity) break;
+                point -= proximity;
+            }
+        }
+        reservoir[reservoir_idx] = chosen;
+    }
+    return reservoir_size;
+}
+
 void cluster_member_set_destroy(cluster_member_set_t *members) {
     for (int i = 0; i < members->size; ++i) {
         cluster_member_set_item_destroy(members->set[i]);
@@ -167,6 +411,7 @@ static void cluster_member_set_shift(cluster_member_set_t *members, uint32_t idx
 int cluster_member_set_remove(cluster_member_set_t *members, cluster_member_t *member) {
     for (int i = 0; i < members->size; ++i) {
         if (members->set[i] == member) {
+            PT_TRACE4(member__remove, members, member->address, member->address_len, member->uid);
             cluster_member_set_item_destroy(member);
             cluster_member_set_shift(members, i);
             return PT_TRUE;
@@ -189,7 +434,9 @@ int cluster_member_set_remove_by_addr(cluster_member_set_t *members,
                                       pt_socklen_t addr_size) {
     for (int i = 0; i < members->size; ++i) {
         if (memcmp(members->set[i]->address, addr, addr_size) == 0) {
-            cluster_member_set_item_destroy(members->set[i]);
+            cluster_member_t *member = members->set[i];
+            PT_TRACE4(member__remove, members, member->address, member->address_len, member->uid);
+            cluster_member_set_item_destroy(member);
             cluster_member_set_shift(members, i);
             return PT_TRUE;
         }
@@ -226,3 +473,35 @@ size_t cluster_member_set_random_members(cluster_member_set_t *members,
 
     return actual_reservoir_size;
 }
+
+static int cluster_member_zone_matches(const cluster_member_t *member, uint16_t zone,
+                                       cluster_member_zone_filter_t filter) {
+    switch (filter) {
+        case ZONE_LOCAL:
+            return cluster_member_in_zone(member, zone);
+        case ZONE_REMOTE:
+            return !cluster_member_in_zone(member, zone);
+        case ZONE_REMOTE_BRIDGES:
+            return !cluster_member_in_zone(member, zone) && member->bridge;
+    }
+    return 0;
+}
+
+size_t cluster_member_set_zone_members(cluster_member_set_t *members,
+                                       cluster_member_t **reservoir, size_t reservoir_size,
+                                       uint16_t zone, cluster_member_zone_filter_t filter) {
+    // The same reservoir sampling as above, but only the matching members are counted.
+    size_t matched = 0;
+    for (uint32_t i = 0; i < members->size; ++i) {
+        cluster_member_t *member = members->set[i];
+        if (!cluster_member_zone_matches(member, zone, filter)) continue;
+        if (matched < reservoir_size) {
+            reservoir[matched] = member;
+        } else {
+            size_t random_idx = pt_random() % (matched + 1);
+            if (random_idx < reservoir_size) reservoir[random_idx] = member;
+        }
+        ++matched;
+    }
+    return matched < reservoir_size ? matched : reservoir_size;
+}
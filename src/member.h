@@ -18,26 +18,79 @@
 
 #include <stdint.h>
 #include "network.h"
+#include "failure_detector.h"
+#include "pacer.h"
+#include "rtt_estimator.h"
+#include "vivaldi.h"
 
 #ifdef  __cplusplus
 extern "C" {
 #endif
 
-#define CLUSTER_MEMBER_SIZE (sizeof(uint16_t) + sizeof(uint32_t) + sizeof(pt_socklen_t) + sizeof(pt_sockaddr_storage))
+/** The size of the encoded member without the address and the port. */
+#define CLUSTER_MEMBER_HEADER_SIZE (sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint8_t))
+/** The size of the encoded member with an IPv4 address. */
+#define CLUSTER_MEMBER_IPV4_SIZE (CLUSTER_MEMBER_HEADER_SIZE + 4 + sizeof(uint16_t))
+/** The size of the encoded member with an IPv6 address. */
+#define CLUSTER_MEMBER_IPV6_SIZE (CLUSTER_MEMBER_HEADER_SIZE + 16 + sizeof(uint16_t))
+/** The largest size of the encoded member: an address of another family is copied as is. */
+#define CLUSTER_MEMBER_SIZE (CLUSTER_MEMBER_HEADER_SIZE + sizeof(uint8_t) + sizeof(pt_sockaddr_storage))
+/** The size of the encoded zone label together with the bridge flag. */
+#define CLUSTER_MEMBER_ZONE_SIZE (sizeof(uint16_t) + sizeof(uint8_t))
+/** The zone of members that haven't announced it. Such members belong to every zone. */
+#define CLUSTER_MEMBER_ZONE_UNKNOWN 0xFFFF
+
+/** The liveness state of a member as seen by the failure detector. */
+typedef enum cluster_member_state {
+    MEMBER_ALIVE = 0,
+    MEMBER_SUSPECT = 1,
+    MEMBER_DEAD = 2
+} cluster_member_state_t;
 
 typedef struct cluster_member {
     uint16_t version;
     uint32_t uid;
     pt_socklen_t address_len;
     pt_sockaddr_storage *address;
+
+    // The failure detector's view of this member. Not a part of the member's encoding.
+    uint8_t state;
+    uint32_t incarnation;
+    uint64_t state_ts; /**< the time in microseconds when the state was changed. */
+    failure_detector_t *detector; /**< allocated after the first message from this member. */
+    uint8_t eager; /**< whether data payloads are pushed to this member in the broadcast tree mode. */
+    pacer_t *pacer; /**< allocated on the first send if the per-member pacing is enabled. */
+    rtt_estimator_t *rtt; /**< allocated after the first round trip time sample. */
+    vivaldi_coord_t *coord; /**< the network coordinate from the latest Status message of this member. */
+    uint16_t zone; /**< the zone label announced by this member. */
+    uint8_t bridge; /**< whether this member exchanges updates with other zones. */
+    uint32_t log_version; /**< the version of this member's membership log applied locally. */
 } cluster_member_t;
 
 int cluster_member_init(cluster_member_t *result, const pt_sockaddr_storage *address, pt_socklen_t address_len);
 int cluster_member_equals(cluster_member_t *first, cluster_member_t *second);
+
+/**
+ * Checks whether the given state update takes precedence over the current
+ * state of the member according to the SWIM rules: a higher incarnation
+ * number always wins, within the same incarnation Dead overrides Suspect
+ * and Suspect overrides Alive.
+ */
+int cluster_member_state_overrides(const cluster_member_t *member, uint8_t state, uint32_t incarnation);
 void cluster_member_destroy(cluster_member_t *result);
 
-int cluster_member_decode(const uint8_t *buffer, size_t buffer_size, cluster_member_t *member);
+/**
+ * Decodes the member. IPv4 and IPv6 addresses are encoded as the address and the port only,
+ * so the decoded address is written into the given storage, which must outlive the member.
+ */
+int cluster_member_decode(const uint8_t *buffer, size_t buffer_size, cluster_member_t *member,
+                          pt_sockaddr_storage *address);
 int cluster_member_encode(const cluster_member_t *member, uint8_t *buffer, size_t buffer_size);
+size_t cluster_member_encoded_size(const cluster_member_t *member);
+
+int cluster_member_zone_decode(const uint8_t *buffer, size_t buffer_size, uint16_t *zone, uint8_t *bridge);
+int cluster_member_zone_encode(uint16_t zone, uint8_t bridge, uint8_t *buffer, size_t buffer_size);
+int cluster_member_in_zone(const cluster_member_t *member, uint16_t zone);
 
 typedef struct cluster_member_set {
     cluster_member_t **set;
@@ -56,6 +109,33 @@ int cluster_member_set_remove_by_addr(cluster_member_set_t *members,
                                       pt_socklen_t addr_size);
 size_t cluster_member_set_random_members(cluster_member_set_t *members,
                                          cluster_member_t **reservoir, size_t reservoir_size);
+
+/**
+ * Randomly chooses the specified number of distinct members, preferring the nearby ones.
+ * Each member is chosen with a probability inversely proportional to its round trip
+ * time. For members which haven't been measured yet the round trip time is estimated
+ * from the network coordinates if the origin coordinate is not NULL, otherwise they
+ * are treated as distant. Every choice is uniform with the probability of random_percent
+ * instead.
+ */
+size_t cluster_member_set_nearby_members(cluster_member_set_t *members,
+                                         cluster_member_t **reservoir, size_t reservoir_size,
+                                         uint32_t random_percent, const vivaldi_coord_t *origin);
+
+typedef enum cluster_member_zone_filter {
+    ZONE_LOCAL = 0, /**< members of the given zone and members with an unknown zone. */
+    ZONE_REMOTE = 1, /**< members of other zones. */
+    ZONE_REMOTE_BRIDGES = 2 /**< bridge members of other zones. */
+} cluster_member_zone_filter_t;
+
+/**
+ * Randomly chooses the specified number of distinct members that match the filter
+ * relative to the given zone.
+ */
+size_t cluster_member_set_zone_members(cluster_member_set_t *members,
+                                       cluster_member_t **reservoir, size_t reservoir_size,
+                                       uint16_t zone, cluster_member_zone_filter_t filter);
+
 void cluster_member_set_destroy(cluster_member_set_t *members);
 
 #ifdef  __cplusplus
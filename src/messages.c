@@ -24,7 +24,18 @@
 
 #define RETURN_IF_INVALID_PAYLOAD(t, r) if (!message_is_payload_valid(buffer, buffer_size, (t))) return r;
 
-const char PROTOCOL_ID[PROTOCOL_ID_LENGTH] = { 'p', 't', 'c', 's', '\0' };
+// The last byte of the protocol id is the version of the wire format.
+const char PROTOCOL_ID[PROTOCOL_ID_LENGTH] = { 'p', 't', 'c', 's', PROTOCOL_VERSION };
+
+// Decoded members are followed by the storage of their addresses in the same block,
+// so they are released with a single free().
+static cluster_member_t *message_members_alloc(size_t members_n) {
+    return (cluster_member_t *) malloc(members_n * (sizeof(cluster_member_t) + sizeof(pt_sockaddr_storage)));
+}
+
+static pt_sockaddr_storage *message_member_address(cluster_member_t *members, size_t members_n, size_t idx) {
+    return (pt_sockaddr_storage *) (members + members_n) + idx;
+}
 
 int message_type_decode(const uint8_t *buffer, size_t buffer_size) {
     if (buffer_size < sizeof(message_header_t)) {
@@ -33,6 +44,127 @@ int message_type_decode(const uint8_t *buffer, size_t buffer_size) {
     return *(buffer + PROTOCOL_ID_LENGTH);
 }
 
+int message_header_copy(const uint8_t *message, size_t message_size, uint32_t sequence_num, uint16_t flags,
+                        uint8_t *buffer, size_t buffer_size) {
+    if (message_size < sizeof(message_header_t) || buffer_size < sizeof(message_header_t)) {
+        return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+    }
+    memcpy(buffer, message, sizeof(message_header_t));
+    uint8_t *flags_cursor = buffer + PROTOCOL_ID_LENGTH + sizeof(uint8_t);
+    uint16_encode(uint16_decode(flags_cursor) | flags, flags_cursor);
+    uint32_encode(sequence_num, flags_cursor + sizeof(uint16_t));
+    return sizeof(message_header_t);
+}
+
+size_t message_sent_ts_encode(const uint8_t *message, size_t message_size, uint64_t sent_ts, uint8_t *buffer) {
+    if (message_size < sizeof(message_header_t) + MESSAGE_TIMESTAMPS_SIZE) return 0;
+    uint16_t flags = uint16_decode(message + PROTOCOL_ID_LENGTH + sizeof(uint8_t));
+    if (!(flags & MESSAGE_FLAG_TIMESTAMPS)) return 0;
+    uint64_encode(sent_ts, buffer);
+    return sizeof(uint64_t);
+}
+
+size_t message_event_size(const message_event_t *event) {
+    return sizeof(uint8_t) + sizeof(uint32_t) + cluster_member_encoded_size(&event->member);
+}
+
+static size_t message_events_size(const message_event_t *events, uint8_t events_n) {
+    size_t result = 0;
+    for (int i = 0; i < events_n; ++i) result += message_event_size(&events[i]);
+    return result;
+}
+
+// The caller must make sure that the events fit into the buffer.
+static int message_events_list_encode(const message_event_t *events, uint8_t events_n,
+                                      uint8_t *buffer, size_t buffer_size) {
+    uint8_t *cursor = buffer;
+    const uint8_t *buffer_end = buffer + buffer_size;
+    for (int i = 0; i < events_n; ++i) {
+        *cursor = events[i].state;
+        cursor += sizeof(uint8_t);
+        uint32_encode(events[i].incarnation, cursor);
+        cursor += sizeof(uint32_t);
+        cursor += cluster_member_encode(&events[i].member, cursor, buffer_end - cursor);
+    }
+    return cursor - buffer;
+}
+
+static int message_events_list_decode(const uint8_t *buffer, size_t buffer_size,
+                                      message_event_t *events, uint8_t events_n) {
+    const uint8_t *cursor = buffer;
+    const uint8_t *buffer_end = buffer + buffer_size;
+    for (int i = 0; i < events_n; ++i) {
+        if (buffer_end - cursor < MESSAGE_EVENT_HEADER_SIZE) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+        events[i].state = *cursor;
+        cursor += sizeof(uint8_t);
+        if (events[i].state > MEMBER_DEAD) return PITTACUS_ERR_INVALID_MESSAGE;
+        events[i].incarnation = uint32_decode(cursor);
+        cursor += sizeof(uint32_t);
+
+        int decode_result = cluster_member_decode(cursor, buffer_end - cursor, &events[i].member,
+                                                  &events[i].address);
+        if (decode_result < 0) return decode_result;
+        if (cursor + decode_result > buffer_end) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+        cursor += decode_result;
+    }
+    return cursor - buffer;
+}
+
+int message_events_trailer_encode(const message_event_t *events, uint8_t events_n,
+                                  uint8_t *buffer, size_t buffer_size) {
+    size_t expected_size = MESSAGE_EVENTS_OVERHEAD + message_events_size(events, events_n);
+    if (buffer_size < expected_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+
+    uint8_t *cursor = buffer;
+    *cursor = events_n;
+    cursor += sizeof(uint8_t);
+    cursor += message_events_list_encode(events, events_n, cursor, buffer_size - sizeof(uint8_t));
+    uint16_encode(expected_size, cursor);
+    cursor += sizeof(uint16_t);
+    return cursor - buffer;
+}
+
+int message_events_encode(const message_event_t *events, uint8_t events_n,
+                          uint8_t *buffer, size_t message_size, size_t buffer_size) {
+    if (message_size < sizeof(message_header_t) || buffer_size < message_size) {
+        return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+    }
+    int trailer_size = message_events_trailer_encode(events, events_n, buffer + message_size,
+                                                     buffer_size - message_size);
+    if (trailer_size < 0) return trailer_size;
+
+    uint8_t *flags_cursor = buffer + PROTOCOL_ID_LENGTH + sizeof(uint8_t);
+    uint16_encode(uint16_decode(flags_cursor) | MESSAGE_FLAG_EVENTS, flags_cursor);
+    return message_size + trailer_size;
+}
+
+int message_events_decode(const uint8_t *buffer, size_t buffer_size, message_event_t *events, uint8_t *events_n) {
+    uint8_t max_events = *events_n;
+    *events_n = 0;
+    if (buffer_size < sizeof(message_header_t)) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+    uint16_t flags = uint16_decode(buffer + PROTOCOL_ID_LENGTH + sizeof(uint8_t));
+    if (!(flags & MESSAGE_FLAG_EVENTS)) return 0;
+
+    if (buffer_size < sizeof(message_header_t) + MESSAGE_EVENTS_OVERHEAD) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+    uint16_t trailer_size = uint16_decode(buffer + buffer_size - sizeof(uint16_t));
+    if (trailer_size < MESSAGE_EVENTS_OVERHEAD || trailer_size > buffer_size - sizeof(message_header_t)) {
+        return PITTACUS_ERR_INVALID_MESSAGE;
+    }
+
+    const uint8_t *cursor = buffer + buffer_size - trailer_size;
+    const uint8_t *events_end = buffer + buffer_size - sizeof(uint16_t);
+    uint8_t events_num = *cursor;
+    cursor += sizeof(uint8_t);
+    if (events_num > max_events) return PITTACUS_ERR_INVALID_MESSAGE;
+
+    int decode_result = message_events_list_decode(cursor, events_end - cursor, events, events_num);
+    if (decode_result < 0) return decode_result;
+    cursor += decode_result;
+    if (cursor != events_end) return PITTACUS_ERR_INVALID_MESSAGE;
+    *events_n = events_num;
+    return trailer_size;
+}
+
 static int message_is_payload_valid(const uint8_t *buffer, size_t buffer_size, uint8_t type) {
     return message_type_decode(buffer, buffer_size) == type &&
             memcmp(buffer, PROTOCOL_ID, PROTOCOL_ID_LENGTH) == 0;
@@ -41,7 +173,7 @@ static int message_is_payload_valid(const uint8_t *buffer, size_t buffer_size, u
 void message_header_init(message_header_t *header, uint8_t message_type, uint32_t sequence_number) {
     memcpy(header->protocol_id, PROTOCOL_ID, PROTOCOL_ID_LENGTH);
     header->message_type = message_type;
-    header->reserved = 0;
+    header->flags = 0;
     header->sequence_num = sequence_number;
 }
 
@@ -53,7 +185,7 @@ static int message_header_encode(const message_header_t *msg, uint8_t *buffer, s
     *cursor = msg->message_type;
     cursor += sizeof(uint8_t);
 
-    uint16_encode(msg->reserved, cursor);
+    uint16_encode(msg->flags, cursor);
     cursor += sizeof(uint16_t);
 
     uint32_encode(msg->sequence_num, cursor);
@@ -71,7 +203,8 @@ static int message_header_decode(const uint8_t *buffer, size_t buffer_size, mess
     result->message_type = *cursor;
     cursor += sizeof(uint8_t);
 
-    result->reserved = uint16_decode(cursor);
+    // The events trailer is not a part of the message itself.
+    result->flags = uint16_decode(cursor) & ~MESSAGE_FLAG_EVENTS;
     cursor += sizeof(uint16_t);
 
     result->sequence_num = uint32_decode(cursor);
@@ -80,23 +213,38 @@ static int message_header_decode(const uint8_t *buffer, size_t buffer_size, mess
 
 int message_hello_decode(const uint8_t *buffer, size_t buffer_size, message_hello_t *result) {
     RETURN_IF_INVALID_PAYLOAD(MESSAGE_HELLO_TYPE, PITTACUS_ERR_INVALID_MESSAGE);
-    size_t min_size = sizeof(message_header_t) + sizeof(cluster_member_t) - sizeof(pt_sockaddr_storage *);
+    size_t min_size = sizeof(message_header_t) + CLUSTER_MEMBER_HEADER_SIZE;
     if (buffer_size < min_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
 
     message_header_decode(buffer, buffer_size, &result->header);
-    result->this_member = (cluster_member_t *) malloc(sizeof(cluster_member_t));
+    result->this_member = message_members_alloc(1);
     if (result->this_member == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
 
     int member_bytes = cluster_member_decode(buffer + sizeof(message_header_t),
                                              buffer_size - sizeof(message_header_t),
-                                             result->this_member);
-    if (member_bytes < 0) return member_bytes;
-    return sizeof(message_header_t) + member_bytes;
+                                             result->this_member, message_member_address(result->this_member, 1, 0));
+    if (member_bytes < 0) {
+        free(result->this_member);
+        return member_bytes;
+    }
+
+    const uint8_t *cursor = buffer + sizeof(message_header_t) + member_bytes;
+    if (result->header.flags & MESSAGE_FLAG_ZONES) {
+        int zone_bytes = cluster_member_zone_decode(cursor, buffer + buffer_size - cursor,
+                                                    &result->this_member->zone, &result->this_member->bridge);
+        // The zone label is optional. The message is still valid without it.
+        if (zone_bytes < 0) {
+            result->header.flags &= ~MESSAGE_FLAG_ZONES;
+        } else {
+            cursor += zone_bytes;
+        }
+    }
+    return cursor - buffer;
 }
 
 int message_hello_encode(const message_hello_t *msg, uint8_t *buffer, size_t buffer_size) {
-    size_t expected_size = sizeof(message_header_t) + sizeof(cluster_member_t) -
-            sizeof(pt_sockaddr_storage *) + msg->this_member->address_len;
+    size_t expected_size = sizeof(message_header_t) + cluster_member_encoded_size(msg->this_member);
+    if (msg->header.flags & MESSAGE_FLAG_ZONES) expected_size += CLUSTER_MEMBER_ZONE_SIZE;
     if (buffer_size < expected_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
 
     int encode_result = message_header_encode(&msg->header, buffer, buffer_size);
@@ -105,6 +253,10 @@ int message_hello_encode(const message_hello_t *msg, uint8_t *buffer, size_t buf
     uint8_t *cursor = buffer + encode_result;
     const uint8_t *buffer_end = buffer + buffer_size;
     cursor += cluster_member_encode(msg->this_member, cursor, buffer_end - cursor);
+    if (msg->header.flags & MESSAGE_FLAG_ZONES) {
+        cursor += cluster_member_zone_encode(msg->this_member->zone, msg->this_member->bridge,
+                                             cursor, buffer_end - cursor);
+    }
 
     return cursor - buffer;
 }
@@ -115,8 +267,7 @@ void message_hello_destroy(const message_hello_t *msg) {
 
 int message_welcome_decode(const uint8_t *buffer, size_t buffer_size, message_welcome_t *result) {
     RETURN_IF_INVALID_PAYLOAD(MESSAGE_WELCOME_TYPE, PITTACUS_ERR_INVALID_MESSAGE);
-    size_t min_size = sizeof(message_header_t) + sizeof(uint32_t) +
-                      sizeof(cluster_member_t) - sizeof(pt_sockaddr_storage *);
+    size_t min_size = sizeof(message_header_t) + sizeof(uint32_t) + CLUSTER_MEMBER_HEADER_SIZE;
     if (buffer_size < min_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
 
     int decode_result = message_header_decode(buffer, buffer_size, &result->header);
@@ -127,19 +278,23 @@ int message_welcome_decode(const uint8_t *buffer, size_t buffer_size, message_we
     result->hello_sequence_num = uint32_decode(cursor);
     cursor += sizeof(uint32_t);
 
-    result->this_member = (cluster_member_t *) malloc(sizeof(cluster_member_t));
+    result->this_member = message_members_alloc(1);
     if (result->this_member == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
 
-    decode_result = cluster_member_decode(cursor, buffer_end - cursor, result->this_member);
-    if (decode_result < 0) return decode_result;
+    decode_result = cluster_member_decode(cursor, buffer_end - cursor, result->this_member,
+                                          message_member_address(result->this_member, 1, 0));
+    if (decode_result < 0) {
+        free(result->this_member);
+        return decode_result;
+    }
     cursor += decode_result;
 
     return cursor - buffer;
 }
 
 int message_welcome_encode(const message_welcome_t *msg, uint8_t *buffer, size_t buffer_size) {
-    size_t expected_size = sizeof(message_header_t) + sizeof(uint32_t) + sizeof(cluster_member_t) -
-                           sizeof(pt_sockaddr_storage *) + msg->this_member->address_len;
+    size_t expected_size = sizeof(message_header_t) + sizeof(uint32_t) +
+                           cluster_member_encoded_size(msg->this_member);
     if (buffer_size < expected_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
     int encode_result = message_header_encode(&msg->header, buffer, buffer_size);
 
@@ -176,17 +331,37 @@ int message_data_decode(const uint8_t *buffer, size_t buffer_size, message_data_
 
     size_t base_size = sizeof(message_header_t) + VECTOR_RECORD_SIZE + sizeof(uint16_t);
     size_t expected_size = base_size + result->data_size;
+    if (result->header.flags & MESSAGE_FLAG_HOPS) expected_size += sizeof(uint8_t);
+    if (result->header.flags & MESSAGE_FLAG_TIMESTAMPS) expected_size += MESSAGE_TIMESTAMPS_SIZE;
     if (buffer_size != expected_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
 
     uint8_t *data_cursor = result->data_size > 0 ? (uint8_t *) cursor : NULL;
     result->data = data_cursor;
     cursor += result->data_size;
 
+    result->hops = 0;
+    if (result->header.flags & MESSAGE_FLAG_HOPS) {
+        result->hops = *cursor;
+        cursor += sizeof(uint8_t);
+    }
+
+    result->origin_ts = 0;
+    result->sent_ts = 0;
+    if (result->header.flags & MESSAGE_FLAG_TIMESTAMPS) {
+        result->origin_ts = uint64_decode(cursor);
+        cursor += sizeof(uint64_t);
+        result->sent_ts = uint64_decode(cursor);
+        cursor += sizeof(uint64_t);
+    }
+
     return cursor - buffer;
 }
 
-int message_data_encode(const message_data_t *msg, uint8_t *buffer, size_t buffer_size) {
+static int message_data_encode_parts(const message_data_t *msg, uint8_t *buffer, size_t buffer_size,
+                                     size_t *payload_offset) {
     size_t min_size = sizeof(message_header_t) + VECTOR_RECORD_SIZE + sizeof(uint16_t) + msg->data_size;
+    if (msg->header.flags & MESSAGE_FLAG_HOPS) min_size += sizeof(uint8_t);
+    if (msg->header.flags & MESSAGE_FLAG_TIMESTAMPS) min_size += MESSAGE_TIMESTAMPS_SIZE;
     if (buffer_size < min_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
 
     uint8_t *cursor = buffer;
@@ -203,12 +378,37 @@ int message_data_encode(const message_data_t *msg, uint8_t *buffer, size_t buffe
     uint16_encode(msg->data_size, cursor);
     cursor += sizeof(uint16_t);
 
-    memcpy(cursor, msg->data, msg->data_size);
-    cursor += msg->data_size;
+    if (payload_offset != NULL) {
+        *payload_offset = cursor - buffer;
+    } else {
+        memcpy(cursor, msg->data, msg->data_size);
+        cursor += msg->data_size;
+    }
+
+    if (msg->header.flags & MESSAGE_FLAG_HOPS) {
+        *cursor = msg->hops;
+        cursor += sizeof(uint8_t);
+    }
+
+    if (msg->header.flags & MESSAGE_FLAG_TIMESTAMPS) {
+        uint64_encode(msg->origin_ts, cursor);
+        cursor += sizeof(uint64_t);
+        uint64_encode(msg->sent_ts, cursor);
+        cursor += sizeof(uint64_t);
+    }
 
     return cursor - buffer;
 }
 
+int message_data_encode(const message_data_t *msg, uint8_t *buffer, size_t buffer_size) {
+    return message_data_encode_parts(msg, buffer, buffer_size, NULL);
+}
+
+int message_data_encode_split(const message_data_t *msg, uint8_t *buffer, size_t buffer_size,
+                              size_t *payload_offset) {
+    return message_data_encode_parts(msg, buffer, buffer_size, payload_offset);
+}
+
 int message_member_list_decode(const uint8_t *buffer, size_t buffer_size, message_member_list_t *result) {
     RETURN_IF_INVALID_PAYLOAD(MESSAGE_MEMBER_LIST_TYPE, PITTACUS_ERR_INVALID_MESSAGE);
     if (buffer_size < sizeof(message_header_t) + sizeof(uint16_t)) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
@@ -223,21 +423,38 @@ int message_member_list_decode(const uint8_t *buffer, size_t buffer_size, messag
     result->members_n = uint16_decode(cursor);
     cursor += sizeof(uint16_t);
 
-    result->members = (cluster_member_t *) malloc(result->members_n * sizeof(cluster_member_t));
+    result->members = message_members_alloc(result->members_n);
     if (result->members == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
 
     for (int i = 0; i < result->members_n; ++i) {
-        decode_result = cluster_member_decode(cursor, buffer_end - cursor, &result->members[i]);
-        if (decode_result < 0) return decode_result;
+        decode_result = cluster_member_decode(cursor, buffer_end - cursor, &result->members[i],
+                                              message_member_address(result->members, result->members_n, i));
+        if (decode_result < 0) {
+            free(result->members);
+            return decode_result;
+        }
         cursor += decode_result;
     }
 
+    if (result->header.flags & MESSAGE_FLAG_ZONES) {
+        if ((size_t) (buffer_end - cursor) < result->members_n * CLUSTER_MEMBER_ZONE_SIZE) {
+            // The zone labels are optional. The message is still valid without them.
+            result->header.flags &= ~MESSAGE_FLAG_ZONES;
+        } else {
+            for (int i = 0; i < result->members_n; ++i) {
+                cursor += cluster_member_zone_decode(cursor, buffer_end - cursor,
+                                                     &result->members[i].zone, &result->members[i].bridge);
+            }
+        }
+    }
+
     return cursor - buffer;
 }
 
 int message_member_list_encode(const message_member_list_t *msg, uint8_t *buffer, size_t buffer_size) {
     uint32_t expected_size = sizeof(message_header_t) + sizeof(uint16_t);
-    expected_size += msg->members_n * CLUSTER_MEMBER_SIZE;
+    for (int i = 0; i < msg->members_n; ++i) expected_size += cluster_member_encoded_size(&msg->members[i]);
+    if (msg->header.flags & MESSAGE_FLAG_ZONES) expected_size += msg->members_n * CLUSTER_MEMBER_ZONE_SIZE;
     if (buffer_size < expected_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
 
     int encode_result = message_header_encode(&msg->header, buffer, buffer_size);
@@ -251,6 +468,12 @@ int message_member_list_encode(const message_member_list_t *msg, uint8_t *buffer
     for (int i = 0; i < msg->members_n; ++i) {
         cursor += cluster_member_encode(&msg->members[i], cursor, buffer_end - cursor);
     }
+    if (msg->header.flags & MESSAGE_FLAG_ZONES) {
+        for (int i = 0; i < msg->members_n; ++i) {
+            cursor += cluster_member_zone_encode(msg->members[i].zone, msg->members[i].bridge,
+                                                 cursor, buffer_end - cursor);
+        }
+    }
     return cursor - buffer;
 }
 
@@ -270,11 +493,32 @@ int message_ack_decode(const uint8_t *buffer, size_t buffer_size, message_ack_t
     result->ack_sequence_num = uint32_decode(cursor);
     cursor += sizeof(uint32_t);
 
+    if (result->header.flags & MESSAGE_FLAG_COORDINATES) {
+        int decode_result = vivaldi_coord_decode(cursor, buffer + buffer_size - cursor, &result->coordinate);
+        if (decode_result < 0) {
+            result->header.flags &= ~MESSAGE_FLAG_COORDINATES;
+        } else {
+            cursor += decode_result;
+        }
+    }
+    if (result->header.flags & MESSAGE_FLAG_ZONES) {
+        int decode_result = cluster_member_zone_decode(cursor, buffer + buffer_size - cursor,
+                                                       &result->zone, &result->bridge);
+        if (decode_result < 0) {
+            result->header.flags &= ~MESSAGE_FLAG_ZONES;
+        } else {
+            cursor += decode_result;
+        }
+    }
+
     return cursor - buffer;
 }
 
 int message_ack_encode(const message_ack_t *msg, uint8_t *buffer, size_t buffer_size) {
-    if (buffer_size < sizeof(message_header_t) + sizeof(uint32_t)) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+    uint32_t expected_size = sizeof(message_header_t) + sizeof(uint32_t);
+    if (msg->header.flags & MESSAGE_FLAG_COORDINATES) expected_size += VIVALDI_COORD_SIZE;
+    if (msg->header.flags & MESSAGE_FLAG_ZONES) expected_size += CLUSTER_MEMBER_ZONE_SIZE;
+    if (buffer_size < expected_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
 
     int encode_result = message_header_encode(&msg->header, buffer, buffer_size);
     if (encode_result < 0) return encode_result;
@@ -283,6 +527,15 @@ int message_ack_encode(const message_ack_t *msg, uint8_t *buffer, size_t buffer_
     uint32_encode(msg->ack_sequence_num, cursor);
     cursor += sizeof(uint32_t);
 
+    if (msg->header.flags & MESSAGE_FLAG_COORDINATES) {
+        encode_result = vivaldi_coord_encode(&msg->coordinate, cursor, buffer + buffer_size - cursor);
+        if (encode_result < 0) return encode_result;
+        cursor += encode_result;
+    }
+    if (msg->header.flags & MESSAGE_FLAG_ZONES) {
+        cursor += cluster_member_zone_encode(msg->zone, msg->bridge, cursor, buffer + buffer_size - cursor);
+    }
+
     return cursor - buffer;
 }
 
@@ -300,11 +553,35 @@ int message_status_decode(const uint8_t *buffer, size_t buffer_size, message_sta
     if (decode_result < 0) return decode_result;
     cursor += decode_result;
 
+    if (result->header.flags & MESSAGE_FLAG_COORDINATES) {
+        decode_result = vivaldi_coord_decode(cursor, buffer_end - cursor, &result->coordinate);
+        if (decode_result < 0) {
+            // The coordinate is optional. The message is still valid without it.
+            result->header.flags &= ~MESSAGE_FLAG_COORDINATES;
+        } else {
+            cursor += decode_result;
+        }
+    }
+
+    if (result->header.flags & MESSAGE_FLAG_MEMBER_LOG) {
+        if ((size_t) (buffer_end - cursor) < MESSAGE_MEMBER_LOG_SIZE) {
+            // The membership log versions are optional. The message is still valid without them.
+            result->header.flags &= ~MESSAGE_FLAG_MEMBER_LOG;
+        } else {
+            result->member_log_version = uint32_decode(cursor);
+            cursor += sizeof(uint32_t);
+            result->member_log_request = uint32_decode(cursor);
+            cursor += sizeof(uint32_t);
+        }
+    }
+
     return cursor - buffer;
 }
 
 int message_status_encode(const message_status_t *msg, uint8_t *buffer, size_t buffer_size) {
     uint32_t expected_size = sizeof(message_header_t) + sizeof(uint16_t) + msg->data_version.size * VECTOR_RECORD_SIZE;
+    if (msg->header.flags & MESSAGE_FLAG_COORDINATES) expected_size += VIVALDI_COORD_SIZE;
+    if (msg->header.flags & MESSAGE_FLAG_MEMBER_LOG) expected_size += MESSAGE_MEMBER_LOG_SIZE;
     if (buffer_size < expected_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
 
     int encode_result = message_header_encode(&msg->header, buffer, buffer_size);
@@ -317,5 +594,383 @@ int message_status_encode(const message_status_t *msg, uint8_t *buffer, size_t b
     if (encode_result < 0) return encode_result;
     cursor += encode_result;
 
+    if (msg->header.flags & MESSAGE_FLAG_COORDINATES) {
+        encode_result = vivaldi_coord_encode(&msg->coordinate, cursor, buffer_end - cursor);
+        if (encode_result < 0) return encode_result;
+        cursor += encode_result;
+    }
+
+    if (msg->header.flags & MESSAGE_FLAG_MEMBER_LOG) {
+        uint32_encode(msg->member_log_version, cursor);
+        cursor += sizeof(uint32_t);
+        uint32_encode(msg->member_log_request, cursor);
+        cursor += sizeof(uint32_t);
+    }
+
+    return cursor - buffer;
+}
+
+int message_ping_decode(const uint8_t *buffer, size_t buffer_size, message_ping_t *result) {
+    RETURN_IF_INVALID_PAYLOAD(MESSAGE_PING_TYPE, PITTACUS_ERR_INVALID_MESSAGE);
+    return message_header_decode(buffer, buffer_size, &result->header);
+}
+
+int message_ping_encode(const message_ping_t *msg, uint8_t *buffer, size_t buffer_size) {
+    return message_header_encode(&msg->header, buffer, buffer_size);
+}
+
+int message_ping_req_decode(const uint8_t *buffer, size_t buffer_size, message_ping_req_t *result) {
+    RETURN_IF_INVALID_PAYLOAD(MESSAGE_PING_REQ_TYPE, PITTACUS_ERR_INVALID_MESSAGE);
+    if (buffer_size < sizeof(message_header_t) + CLUSTER_MEMBER_HEADER_SIZE) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+
+    message_header_decode(buffer, buffer_size, &result->header);
+    result->target = message_members_alloc(1);
+    if (result->target == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
+
+    int member_bytes = cluster_member_decode(buffer + sizeof(message_header_t),
+                                             buffer_size - sizeof(message_header_t),
+                                             result->target, message_member_address(result->target, 1, 0));
+    if (member_bytes < 0) {
+        free(result->target);
+        return member_bytes;
+    }
+    return sizeof(message_header_t) + member_bytes;
+}
+
+int message_ping_req_encode(const message_ping_req_t *msg, uint8_t *buffer, size_t buffer_size) {
+    size_t expected_size = sizeof(message_header_t) + cluster_member_encoded_size(msg->target);
+    if (buffer_size < expected_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+
+    int encode_result = message_header_encode(&msg->header, buffer, buffer_size);
+    if (encode_result < 0) return encode_result;
+
+    uint8_t *cursor = buffer + encode_result;
+    const uint8_t *buffer_end = buffer + buffer_size;
+    cursor += cluster_member_encode(msg->target, cursor, buffer_end - cursor);
+
+    return cursor - buffer;
+}
+
+void message_ping_req_destroy(const message_ping_req_t *msg) {
+    free(msg->target);
+}
+
+int message_member_state_decode(const uint8_t *buffer, size_t buffer_size, message_member_state_t *result) {
+    RETURN_IF_INVALID_PAYLOAD(MESSAGE_MEMBER_STATE_TYPE, PITTACUS_ERR_INVALID_MESSAGE);
+    size_t min_size = sizeof(message_header_t) + sizeof(uint8_t) + sizeof(uint32_t) + CLUSTER_MEMBER_HEADER_SIZE;
+    if (buffer_size < min_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+
+    int decode_result = message_header_decode(buffer, buffer_size, &result->header);
+
+    const uint8_t *cursor = buffer + decode_result;
+    const uint8_t *buffer_end = buffer + buffer_size;
+
+    result->state = *cursor;
+    cursor += sizeof(uint8_t);
+    if (result->state > MEMBER_DEAD) return PITTACUS_ERR_INVALID_MESSAGE;
+
+    result->incarnation = uint32_decode(cursor);
+    cursor += sizeof(uint32_t);
+
+    result->member = message_members_alloc(1);
+    if (result->member == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
+
+    decode_result = cluster_member_decode(cursor, buffer_end - cursor, result->member,
+                                          message_member_address(result->member, 1, 0));
+    if (decode_result < 0) {
+        free(result->member);
+        return decode_result;
+    }
+    cursor += decode_result;
+
     return cursor - buffer;
 }
+
+int message_member_state_encode(const message_member_state_t *msg, uint8_t *buffer, size_t buffer_size) {
+    size_t expected_size = sizeof(message_header_t) + sizeof(uint8_t) + sizeof(uint32_t) +
+                           cluster_member_encoded_size(msg->member);
+    if (buffer_size < expected_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+
+    int encode_result = message_header_encode(&msg->header, buffer, buffer_size);
+    if (encode_result < 0) return encode_result;
+
+    uint8_t *cursor = buffer + encode_result;
+    const uint8_t *buffer_end = buffer + buffer_size;
+
+    *cursor = msg->state;
+    cursor += sizeof(uint8_t);
+
+    uint32_encode(msg->incarnation, cursor);
+    cursor += sizeof(uint32_t);
+
+    cursor += cluster_member_encode(msg->member, cursor, buffer_end - cursor);
+
+    return cursor - buffer;
+}
+
+void message_member_state_destroy(const message_member_state_t *msg) {
+    free(msg->member);
+}
+
+static int message_data_version_decode(const uint8_t *buffer, size_t buffer_size,
+                                       message_header_t *header, vector_record_t *data_version) {
+    if (buffer_size < sizeof(message_header_t) + VECTOR_RECORD_SIZE) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+
+    int decode_result = message_header_decode(buffer, buffer_size, header);
+    if (decode_result < 0) return decode_result;
+    const uint8_t *cursor = buffer + decode_result;
+
+    decode_result = vector_clock_record_decode(cursor, buffer_size - sizeof(message_header_t), data_version);
+    if (decode_result < 0) return decode_result;
+    cursor += decode_result;
+
+    return cursor - buffer;
+}
+
+static int message_data_version_encode(const message_header_t *header, const vector_record_t *data_version,
+                                       uint8_t *buffer, size_t buffer_size) {
+    if (buffer_size < sizeof(message_header_t) + VECTOR_RECORD_SIZE) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+
+    int encode_result = message_header_encode(header, buffer, buffer_size);
+    if (encode_result < 0) return encode_result;
+    uint8_t *cursor = buffer + encode_result;
+
+    encode_result = vector_clock_record_encode(data_version, cursor, buffer_size - sizeof(message_header_t));
+    if (encode_result < 0) return encode_result;
+    cursor += encode_result;
+
+    return cursor - buffer;
+}
+
+int message_ihave_decode(const uint8_t *buffer, size_t buffer_size, message_ihave_t *result) {
+    RETURN_IF_INVALID_PAYLOAD(MESSAGE_IHAVE_TYPE, PITTACUS_ERR_INVALID_MESSAGE);
+    return message_data_version_decode(buffer, buffer_size, &result->header, &result->data_version);
+}
+
+int message_ihave_encode(const message_ihave_t *msg, uint8_t *buffer, size_t buffer_size) {
+    return message_data_version_encode(&msg->header, &msg->data_version, buffer, buffer_size);
+}
+
+int message_iwant_decode(const uint8_t *buffer, size_t buffer_size, message_iwant_t *result) {
+    RETURN_IF_INVALID_PAYLOAD(MESSAGE_IWANT_TYPE, PITTACUS_ERR_INVALID_MESSAGE);
+    return message_data_version_decode(buffer, buffer_size, &result->header, &result->data_version);
+}
+
+int message_iwant_encode(const message_iwant_t *msg, uint8_t *buffer, size_t buffer_size) {
+    return message_data_version_encode(&msg->header, &msg->data_version, buffer, buffer_size);
+}
+
+int message_prune_decode(const uint8_t *buffer, size_t buffer_size, message_prune_t *result) {
+    RETURN_IF_INVALID_PAYLOAD(MESSAGE_PRUNE_TYPE, PITTACUS_ERR_INVALID_MESSAGE);
+    return message_header_decode(buffer, buffer_size, &result->header);
+}
+
+int message_prune_encode(const message_prune_t *msg, uint8_t *buffer, size_t buffer_size) {
+    return message_header_encode(&msg->header, buffer, buffer_size);
+}
+
+int message_graft_decode(const uint8_t *buffer, size_t buffer_size, message_graft_t *result) {
+    RETURN_IF_INVALID_PAYLOAD(MESSAGE_GRAFT_TYPE, PITTACUS_ERR_INVALID_MESSAGE);
+    return message_data_version_decode(buffer, buffer_size, &result->header, &result->data_version);
+}
+
+int message_graft_encode(const message_graft_t *msg, uint8_t *buffer, size_t buffer_size) {
+    return message_data_version_encode(&msg->header, &msg->data_version, buffer, buffer_size);
+}
+
+static int message_member_with_byte_decode(const uint8_t *buffer, size_t buffer_size,
+                                           message_header_t *header, uint8_t *value, cluster_member_t **member) {
+    if (buffer_size < sizeof(message_header_t) + sizeof(uint8_t) + CLUSTER_MEMBER_HEADER_SIZE) {
+        return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+    }
+
+    int decode_result = message_header_decode(buffer, buffer_size, header);
+    const uint8_t *cursor = buffer + decode_result;
+    const uint8_t *buffer_end = buffer + buffer_size;
+
+    *value = *cursor;
+    cursor += sizeof(uint8_t);
+
+    *member = message_members_alloc(1);
+    if (*member == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
+
+    decode_result = cluster_member_decode(cursor, buffer_end - cursor, *member, message_member_address(*member, 1, 0));
+    if (decode_result < 0) {
+        free(*member);
+        return decode_result;
+    }
+    cursor += decode_result;
+
+    return cursor - buffer;
+}
+
+static int message_member_with_byte_encode(const message_header_t *header, uint8_t value,
+                                           const cluster_member_t *member, uint8_t *buffer, size_t buffer_size) {
+    size_t expected_size = sizeof(message_header_t) + sizeof(uint8_t) +
+                           cluster_member_encoded_size(member);
+    if (buffer_size < expected_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+
+    int encode_result = message_header_encode(header, buffer, buffer_size);
+    if (encode_result < 0) return encode_result;
+
+    uint8_t *cursor = buffer + encode_result;
+    const uint8_t *buffer_end = buffer + buffer_size;
+
+    *cursor = value;
+    cursor += sizeof(uint8_t);
+
+    cursor += cluster_member_encode(member, cursor, buffer_end - cursor);
+
+    return cursor - buffer;
+}
+
+int message_neighbor_decode(const uint8_t *buffer, size_t buffer_size, message_neighbor_t *result) {
+    RETURN_IF_INVALID_PAYLOAD(MESSAGE_NEIGHBOR_TYPE, PITTACUS_ERR_INVALID_MESSAGE);
+    return message_member_with_byte_decode(buffer, buffer_size, &result->header,
+                                           &result->priority, &result->this_member);
+}
+
+int message_neighbor_encode(const message_neighbor_t *msg, uint8_t *buffer, size_t buffer_size) {
+    return message_member_with_byte_encode(&msg->header, msg->priority, msg->this_member, buffer, buffer_size);
+}
+
+void message_neighbor_destroy(const message_neighbor_t *msg) {
+    free(msg->this_member);
+}
+
+int message_disconnect_decode(const uint8_t *buffer, size_t buffer_size, message_disconnect_t *result) {
+    RETURN_IF_INVALID_PAYLOAD(MESSAGE_DISCONNECT_TYPE, PITTACUS_ERR_INVALID_MESSAGE);
+    return message_header_decode(buffer, buffer_size, &result->header);
+}
+
+int message_disconnect_encode(const message_disconnect_t *msg, uint8_t *buffer, size_t buffer_size) {
+    return message_header_encode(&msg->header, buffer, buffer_size);
+}
+
+int message_forward_join_decode(const uint8_t *buffer, size_t buffer_size, message_forward_join_t *result) {
+    RETURN_IF_INVALID_PAYLOAD(MESSAGE_FORWARD_JOIN_TYPE, PITTACUS_ERR_INVALID_MESSAGE);
+    return message_member_with_byte_decode(buffer, buffer_size, &result->header, &result->ttl, &result->member);
+}
+
+int message_forward_join_encode(const message_forward_join_t *msg, uint8_t *buffer, size_t buffer_size) {
+    return message_member_with_byte_encode(&msg->header, msg->ttl, msg->member, buffer, buffer_size);
+}
+
+void message_forward_join_destroy(const message_forward_join_t *msg) {
+    free(msg->member);
+}
+
+int message_shuffle_decode(const uint8_t *buffer, size_t buffer_size, message_shuffle_t *result) {
+    RETURN_IF_INVALID_PAYLOAD(MESSAGE_SHUFFLE_TYPE, PITTACUS_ERR_INVALID_MESSAGE);
+    int decode_result = message_member_with_byte_decode(buffer, buffer_size, &result->header,
+                                                        &result->ttl, &result->origin);
+    if (decode_result < 0) return decode_result;
+
+    const uint8_t *cursor = buffer + decode_result;
+    const uint8_t *buffer_end = buffer + buffer_size;
+    if ((size_t) (buffer_end - cursor) < sizeof(uint16_t)) {
+        free(result->origin);
+        return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+    }
+    result->members_n = uint16_decode(cursor);
+    cursor += sizeof(uint16_t);
+
+    result->members = message_members_alloc(result->members_n);
+    if (result->members == NULL) {
+        free(result->origin);
+        return PITTACUS_ERR_ALLOCATION_FAILED;
+    }
+
+    for (int i = 0; i < result->members_n; ++i) {
+        decode_result = cluster_member_decode(cursor, buffer_end - cursor, &result->members[i],
+                                              message_member_address(result->members, result->members_n, i));
+        if (decode_result < 0) {
+            message_shuffle_destroy(result);
+            return decode_result;
+        }
+        cursor += decode_result;
+    }
+
+    return cursor - buffer;
+}
+
+int message_shuffle_encode(const message_shuffle_t *msg, uint8_t *buffer, size_t buffer_size) {
+    size_t expected_size = sizeof(message_header_t) + sizeof(uint8_t) + sizeof(uint16_t) +
+                           cluster_member_encoded_size(msg->origin);
+    for (int i = 0; i < msg->members_n; ++i) {
+        expected_size += cluster_member_encoded_size(&msg->members[i]);
+    }
+    if (buffer_size < expected_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+
+    int encode_result = message_member_with_byte_encode(&msg->header, msg->ttl, msg->origin, buffer, buffer_size);
+    if (encode_result < 0) return encode_result;
+
+    uint8_t *cursor = buffer + encode_result;
+    const uint8_t *buffer_end = buffer + buffer_size;
+
+    uint16_encode(msg->members_n, cursor);
+    cursor += sizeof(uint16_t);
+
+    for (int i = 0; i < msg->members_n; ++i) {
+        cursor += cluster_member_encode(&msg->members[i], cursor, buffer_end - cursor);
+    }
+    return cursor - buffer;
+}
+
+void message_shuffle_destroy(const message_shuffle_t *msg) {
+    free(msg->origin);
+    free(msg->members);
+}
+
+int message_member_log_decode(const uint8_t *buffer, size_t buffer_size, message_member_log_t *result) {
+    RETURN_IF_INVALID_PAYLOAD(MESSAGE_MEMBER_LOG_TYPE, PITTACUS_ERR_INVALID_MESSAGE);
+    if (buffer_size < sizeof(message_header_t) + sizeof(uint32_t) + sizeof(uint8_t)) {
+        return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+    }
+
+    int decode_result = message_header_decode(buffer, buffer_size, &result->header);
+    const uint8_t *cursor = buffer + decode_result;
+    const uint8_t *buffer_end = buffer + buffer_size;
+
+    result->log_version = uint32_decode(cursor);
+    cursor += sizeof(uint32_t);
+    result->events_n = *cursor;
+    cursor += sizeof(uint8_t);
+
+    // A log without events only carries the latest version.
+    result->events = NULL;
+    if (result->events_n == 0) return cursor - buffer;
+    result->events = (message_event_t *) malloc(result->events_n * sizeof(message_event_t));
+    if (result->events == NULL) return PITTACUS_ERR_ALLOCATION_FAILED;
+
+    decode_result = message_events_list_decode(cursor, buffer_end - cursor, result->events, result->events_n);
+    if (decode_result < 0) {
+        free(result->events);
+        return decode_result;
+    }
+    cursor += decode_result;
+
+    return cursor - buffer;
+}
+
+int message_member_log_encode(const message_member_log_t *msg, uint8_t *buffer, size_t buffer_size) {
+    size_t expected_size = sizeof(message_header_t) + sizeof(uint32_t) + sizeof(uint8_t) +
+                           message_events_size(msg->events, msg->events_n);
+    if (buffer_size < expected_size) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+
+    int encode_result = message_header_encode(&msg->header, buffer, buffer_size);
+    if (encode_result < 0) return encode_result;
+
+    uint8_t *cursor = buffer + encode_result;
+    uint32_encode(msg->log_version, cursor);
+    cursor += sizeof(uint32_t);
+    *cursor = msg->events_n;
+    cursor += sizeof(uint8_t);
+    cursor += message_events_list_encode(msg->events, msg->events_n, cursor, buffer + buffer_size - cursor);
+
+    return cursor - buffer;
+}
+
+void message_member_log_destroy(const message_member_log_t *msg) {
+    free(msg->events);
+}
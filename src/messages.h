@@ -29,10 +29,73 @@ extern "C" {
 typedef struct message_header {
     char protocol_id[PROTOCOL_ID_LENGTH];
     uint8_t message_type;
-    uint16_t reserved;
+    uint16_t flags;
     uint32_t sequence_num;
 } message_header_t;
 
+/**
+ * The message is followed by the timestamps trailer: the time in microseconds
+ * when the payload was originated followed by the time when this particular
+ * copy of the message was sent. Only Data messages carry this trailer.
+ */
+#define MESSAGE_FLAG_TIMESTAMPS 0x0001
+#define MESSAGE_TIMESTAMPS_SIZE (2 * sizeof(uint64_t))
+
+/**
+ * The message is followed by the membership events trailer: the number of events,
+ * the events themselves and the size of the whole trailer in the last 2 bytes.
+ * The trailer is appended to already encoded Status, Data and Ack messages right
+ * before sending them, so message decoders never report this flag.
+ */
+#define MESSAGE_FLAG_EVENTS 0x0002
+#define MESSAGE_EVENTS_OVERHEAD (sizeof(uint8_t) + sizeof(uint16_t))
+
+/**
+ * The Data message was pushed over the broadcast tree rather than sent
+ * in response to a Status, Iwant or Graft message.
+ */
+#define MESSAGE_FLAG_TREE 0x0004
+
+/**
+ * The payload of the Data message is followed by the number of times the message
+ * has been relayed since its origination. The absent counter means zero.
+ */
+#define MESSAGE_FLAG_HOPS 0x0008
+
+/**
+ * The Status or Ack message is followed by the network coordinate of the sender.
+ * Requires protocol version 2.
+ */
+#define MESSAGE_FLAG_COORDINATES 0x0010
+
+/**
+ * The members of the Hello or Member List message are followed by their zone labels,
+ * and the Ack message is followed by the zone label of the sender. Requires protocol
+ * version 2.
+ */
+#define MESSAGE_FLAG_ZONES 0x0020
+
+/**
+ * The Status message is followed by the version of the sender's membership log
+ * and the version of the recipient's log after which the sender requests the changes.
+ * Requires protocol version 2.
+ */
+#define MESSAGE_FLAG_MEMBER_LOG 0x0040
+#define MESSAGE_MEMBER_LOG_SIZE (2 * sizeof(uint32_t))
+/** The requested version of the Status message which doesn't request any changes. */
+#define MESSAGE_MEMBER_LOG_NO_REQUEST 0xFFFFFFFF
+
+/** The size of the encoded event without the member's address. */
+#define MESSAGE_EVENT_HEADER_SIZE (sizeof(uint8_t) + sizeof(uint32_t) + CLUSTER_MEMBER_HEADER_SIZE)
+
+/** A change of the member's state piggybacked on another message. */
+typedef struct message_event {
+    uint8_t state; /**< one of cluster_member_state_t values. */
+    uint32_t incarnation;
+    cluster_member_t member;
+    pt_sockaddr_storage address; /**< the storage of the member's address if the event was decoded. */
+} message_event_t;
+
 #define MESSAGE_HELLO_TYPE 0x01
 typedef struct message_hello {
     message_header_t header;
@@ -57,6 +120,9 @@ typedef struct message_member_list {
 typedef struct message_ack {
     message_header_t header;
     uint32_t ack_sequence_num;
+    vivaldi_coord_t coordinate; /**< only if MESSAGE_FLAG_COORDINATES is set. */
+    uint16_t zone; /**< only if MESSAGE_FLAG_ZONES is set. */
+    uint8_t bridge; /**< only if MESSAGE_FLAG_ZONES is set. */
 } message_ack_t;
 
 #define MESSAGE_DATA_TYPE 0x05
@@ -65,34 +131,223 @@ typedef struct message_data {
     vector_record_t data_version;
     uint16_t data_size;
     uint8_t *data;
+    uint8_t hops; /**< only if MESSAGE_FLAG_HOPS is set. */
+    uint64_t origin_ts; /**< only if MESSAGE_FLAG_TIMESTAMPS is set. */
+    uint64_t sent_ts; /**< only if MESSAGE_FLAG_TIMESTAMPS is set. */
 } message_data_t;
 
 #define MESSAGE_STATUS_TYPE 0x06
 typedef struct message_status {
     message_header_t header;
     vector_clock_t data_version;
+    vivaldi_coord_t coordinate; /**< only if MESSAGE_FLAG_COORDINATES is set. */
+    uint32_t member_log_version; /**< only if MESSAGE_FLAG_MEMBER_LOG is set. */
+    uint32_t member_log_request; /**< only if MESSAGE_FLAG_MEMBER_LOG is set. */
 } message_status_t;
 
+#define MESSAGE_PING_TYPE 0x07
+typedef struct message_ping {
+    message_header_t header;
+} message_ping_t;
+
+#define MESSAGE_PING_REQ_TYPE 0x08
+typedef struct message_ping_req {
+    message_header_t header;
+    cluster_member_t *target; /**< the member that should be probed on behalf of the sender. */
+} message_ping_req_t;
+
+#define MESSAGE_MEMBER_STATE_TYPE 0x09
+typedef struct message_member_state {
+    message_header_t header;
+    uint8_t state; /**< one of cluster_member_state_t values. */
+    uint32_t incarnation;
+    cluster_member_t *member;
+} message_member_state_t;
+
+#define MESSAGE_IHAVE_TYPE 0x0A
+/** An announcement of a data payload that is spread lazily. */
+typedef struct message_ihave {
+    message_header_t header;
+    vector_record_t data_version;
+} message_ihave_t;
+
+#define MESSAGE_IWANT_TYPE 0x0B
+/** A request of the announced data payload. */
+typedef struct message_iwant {
+    message_header_t header;
+    vector_record_t data_version;
+} message_iwant_t;
+
+#define MESSAGE_PRUNE_TYPE 0x0C
+/** A request to stop pushing data payloads eagerly to the sender. */
+typedef struct message_prune {
+    message_header_t header;
+} message_prune_t;
+
+#define MESSAGE_GRAFT_TYPE 0x0D
+/** A request of the missing data payload that also restores the eager push to the sender. */
+typedef struct message_graft {
+    message_header_t header;
+    vector_record_t data_version;
+} message_graft_t;
+
+#define MESSAGE_NEIGHBOR_TYPE 0x0E
+/** A request to add the sender to the active view of the recipient. */
+typedef struct message_neighbor {
+    message_header_t header;
+    uint8_t priority; /**< non-zero if the sender has no active members, so it can't be refused. */
+    cluster_member_t *this_member;
+} message_neighbor_t;
+
+#define MESSAGE_DISCONNECT_TYPE 0x0F
+/** A notification that the sender has moved the recipient to its passive view. */
+typedef struct message_disconnect {
+    message_header_t header;
+} message_disconnect_t;
+
+#define MESSAGE_FORWARD_JOIN_TYPE 0x10
+/** A random walk which introduces a newcomer to the members along the way. */
+typedef struct message_forward_join {
+    message_header_t header;
+    uint8_t ttl; /**< the number of remaining hops. */
+    cluster_member_t *member;
+} message_forward_join_t;
+
+#define MESSAGE_SHUFFLE_TYPE 0x11
+/** A random walk which carries a sample of the origin's views to refresh passive views. */
+typedef struct message_shuffle {
+    message_header_t header;
+    uint8_t ttl; /**< the number of remaining hops. */
+    cluster_member_t *origin;
+    uint16_t members_n;
+    cluster_member_t *members;
+} message_shuffle_t;
+
+#define MESSAGE_MEMBER_LOG_TYPE 0x12
+/** Changes from the sender's membership log requested by the recipient. */
+typedef struct message_member_log {
+    message_header_t header;
+    uint32_t log_version; /**< the version of the sender's log that includes these changes. */
+    uint8_t events_n;
+    message_event_t *events;
+} message_member_log_t;
+
 void message_header_init(message_header_t *header, uint8_t message_type, uint32_t sequence_number);
 
 int message_type_decode(const uint8_t *buffer, size_t buffer_size);
+
+/**
+ * Copies the header of the already encoded message into a separate buffer with
+ * the given sequence number and additional flags. The message itself is not
+ * modified, so that it can be shared by several outbound envelopes.
+ *
+ * @return the size of the header or negative value if the operation failed.
+ */
+int message_header_copy(const uint8_t *message, size_t message_size, uint32_t sequence_num, uint16_t flags,
+                        uint8_t *buffer, size_t buffer_size);
+
+/**
+ * Encodes the sent timestamp which replaces the last bytes of the already encoded
+ * message when it's sent.
+ *
+ * @return the number of replaced bytes, which is 0 if the message doesn't have
+ *         the timestamps trailer.
+ */
+size_t message_sent_ts_encode(const uint8_t *message, size_t message_size, uint64_t sent_ts, uint8_t *buffer);
+
+/**
+ * Appends the membership events trailer to the already encoded message
+ * and sets the MESSAGE_FLAG_EVENTS flag in its header.
+ *
+ * @param buffer a buffer with the encoded message.
+ * @param message_size the size of the encoded message.
+ * @param buffer_size the total size of the buffer.
+ * @return the size of the message together with the trailer or negative
+ *         value if the operation failed.
+ */
+int message_events_encode(const message_event_t *events, uint8_t events_n,
+                          uint8_t *buffer, size_t message_size, size_t buffer_size);
+
+/**
+ * Encodes only the membership events trailer, which is sent right after the message.
+ * The caller must set the MESSAGE_FLAG_EVENTS flag in the header of the message.
+ *
+ * @return the size of the trailer or negative value if the operation failed.
+ */
+int message_events_trailer_encode(const message_event_t *events, uint8_t events_n,
+                                  uint8_t *buffer, size_t buffer_size);
+
+/** The size of the encoded event. */
+size_t message_event_size(const message_event_t *event);
+
+/**
+ * Decodes the membership events trailer of the arrived message. Addresses
+ * of the decoded members are stored in the events themselves.
+ *
+ * @param events an array to store the decoded events in.
+ * @param events_n the size of the array on input, the number of decoded
+ *                 events on output.
+ * @return the size of the trailer, zero if the message has no trailer, or
+ *         negative value if the operation failed.
+ */
+int message_events_decode(const uint8_t *buffer, size_t buffer_size, message_event_t *events, uint8_t *events_n);
 int message_hello_decode(const uint8_t *buffer, size_t buffer_size, message_hello_t *result);
 int message_welcome_decode(const uint8_t *buffer, size_t buffer_size, message_welcome_t *result);
 int message_data_decode(const uint8_t *buffer, size_t buffer_size, message_data_t *result);
 int message_member_list_decode(const uint8_t *buffer, size_t buffer_size, message_member_list_t *result);
 int message_ack_decode(const uint8_t *buffer, size_t buffer_size, message_ack_t *result);
 int message_status_decode(const uint8_t *buffer, size_t buffer_size, message_status_t *result);
+int message_ping_decode(const uint8_t *buffer, size_t buffer_size, message_ping_t *result);
+int message_ping_req_decode(const uint8_t *buffer, size_t buffer_size, message_ping_req_t *result);
+int message_member_state_decode(const uint8_t *buffer, size_t buffer_size, message_member_state_t *result);
+int message_ihave_decode(const uint8_t *buffer, size_t buffer_size, message_ihave_t *result);
+int message_iwant_decode(const uint8_t *buffer, size_t buffer_size, message_iwant_t *result);
+int message_prune_decode(const uint8_t *buffer, size_t buffer_size, message_prune_t *result);
+int message_graft_decode(const uint8_t *buffer, size_t buffer_size, message_graft_t *result);
+int message_neighbor_decode(const uint8_t *buffer, size_t buffer_size, message_neighbor_t *result);
+int message_disconnect_decode(const uint8_t *buffer, size_t buffer_size, message_disconnect_t *result);
+int message_forward_join_decode(const uint8_t *buffer, size_t buffer_size, message_forward_join_t *result);
+int message_shuffle_decode(const uint8_t *buffer, size_t buffer_size, message_shuffle_t *result);
+int message_member_log_decode(const uint8_t *buffer, size_t buffer_size, message_member_log_t *result);
 
 void message_hello_destroy(const message_hello_t *msg);
 void message_welcome_destroy(const message_welcome_t *msg);
 void message_member_list_destroy(const message_member_list_t *msg);
+void message_ping_req_destroy(const message_ping_req_t *msg);
+void message_member_state_destroy(const message_member_state_t *msg);
+void message_neighbor_destroy(const message_neighbor_t *msg);
+void message_forward_join_destroy(const message_forward_join_t *msg);
+void message_shuffle_destroy(const message_shuffle_t *msg);
+void message_member_log_destroy(const message_member_log_t *msg);
 
 int message_hello_encode(const message_hello_t *msg, uint8_t *buffer, size_t buffer_size);
 int message_welcome_encode(const message_welcome_t *msg, uint8_t *buffer, size_t buffer_size);
 int message_data_encode(const message_data_t *msg, uint8_t *buffer, size_t buffer_size);
+/**
+ * Encodes the Data message without the payload bytes, so that the payload can be
+ * sent from its own buffer with scatter-gather I/O. The whole message including
+ * the payload must still fit into buffer_size.
+ *
+ * @param payload_offset the offset in the buffer at which the payload must be inserted.
+ * @return the number of encoded bytes excluding the payload or a negative value on failure.
+ */
+int message_data_encode_split(const message_data_t *msg, uint8_t *buffer, size_t buffer_size,
+                              size_t *payload_offset);
 int message_member_list_encode(const message_member_list_t *msg, uint8_t *buffer, size_t buffer_size);
 int message_ack_encode(const message_ack_t *msg, uint8_t *buffer, size_t buffer_size);
 int message_status_encode(const message_status_t *msg, uint8_t *buffer, size_t buffer_size);
+int message_ping_encode(const message_ping_t *msg, uint8_t *buffer, size_t buffer_size);
+int message_ping_req_encode(const message_ping_req_t *msg, uint8_t *buffer, size_t buffer_size);
+int message_member_state_encode(const message_member_state_t *msg, uint8_t *buffer, size_t buffer_size);
+int message_ihave_encode(const message_ihave_t *msg, uint8_t *buffer, size_t buffer_size);
+int message_iwant_encode(const message_iwant_t *msg, uint8_t *buffer, size_t buffer_size);
+int message_prune_encode(const message_prune_t *msg, uint8_t *buffer, size_t buffer_size);
+int message_graft_encode(const message_graft_t *msg, uint8_t *buffer, size_t buffer_size);
+int message_neighbor_encode(const message_neighbor_t *msg, uint8_t *buffer, size_t buffer_size);
+int message_disconnect_encode(const message_disconnect_t *msg, uint8_t *buffer, size_t buffer_size);
+int message_forward_join_encode(const message_forward_join_t *msg, uint8_t *buffer, size_t buffer_size);
+int message_shuffle_encode(const message_shuffle_t *msg, uint8_t *buffer, size_t buffer_size);
+int message_member_log_encode(const message_member_log_t *msg, uint8_t *buffer, size_t buffer_size);
 
 #ifdef  __cplusplus
 } // extern "C"
@@ -16,6 +16,9 @@
 #include "network.h"
 #include <unistd.h>
 #include <fcntl.h>
+#include <string.h>
+
+#ifndef PITTACUS_CUSTOM_PLATFORM
 
 pt_socket_fd pt_socket(int domain, int type) {
     return socket(domain, type, 0);
@@ -52,6 +55,16 @@ ssize_t pt_send_to(pt_socket_fd fd, const uint8_t *buffer, size_t buffer_size, c
     return sendto(fd, buffer, buffer_size, 0, (const struct sockaddr *) addr, addr_len);
 }
 
+ssize_t pt_send_iov(pt_socket_fd fd, const pt_iovec *iov, int iov_len, const pt_sockaddr_storage *addr, pt_socklen_t addr_len) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(struct msghdr));
+    msg.msg_name = (void *) addr;
+    msg.msg_namelen = addr_len;
+    msg.msg_iov = (pt_iovec *) iov;
+    msg.msg_iovlen = iov_len;
+    return sendmsg(fd, &msg, 0);
+}
+
 void pt_close(pt_socket_fd fd) {
     close(fd);
 }
@@ -59,3 +72,4 @@ void pt_close(pt_socket_fd fd) {
 int pt_get_sock_name(pt_socket_fd fd, pt_sockaddr_storage *addr, pt_socklen_t *addr_len) {
     return getsockname(fd, (struct sockaddr *) addr, addr_len);
 }
+#endif
@@ -19,6 +19,7 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 
 #ifdef  __cplusplus
@@ -35,6 +36,7 @@ typedef struct sockaddr pt_sockaddr;
 typedef struct sockaddr_in pt_sockaddr_in;
 typedef struct sockaddr_in6 pt_sockaddr_in6;
 typedef struct sockaddr_storage pt_sockaddr_storage;
+typedef struct iovec pt_iovec;
 
 typedef int pt_socket_fd;
 
@@ -45,6 +47,8 @@ int pt_bind(pt_socket_fd fd, const pt_sockaddr_storage *addr, pt_socklen_t addr_
 
 ssize_t pt_recv_from(pt_socket_fd fd, uint8_t *buffer, size_t buffer_size, pt_sockaddr_storage *addr, pt_socklen_t *addr_len);
 ssize_t pt_send_to(pt_socket_fd fd, const uint8_t *buffer, size_t buffer_size, const pt_sockaddr_storage *addr, pt_socklen_t addr_len);
+/** Sends a single datagram gathered from several buffers. */
+ssize_t pt_send_iov(pt_socket_fd fd, const pt_iovec *iov, int iov_len, const pt_sockaddr_storage *addr, pt_socklen_t addr_len);
 
 void pt_close(pt_socket_fd fd);
 
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "pacer.h"
+
+#define TOKEN_SCALE 1000000ULL
+
+static void token_bucket_init(token_bucket_t *bucket, uint64_t rate, uint64_t min_capacity) {
+    uint64_t capacity = rate * SEND_BURST_INTERVAL / 1000;
+    if (capacity < min_capacity) capacity = min_capacity;
+    bucket->rate = rate;
+    bucket->capacity = capacity * TOKEN_SCALE;
+    bucket->level = bucket->capacity;
+}
+
+static void token_bucket_refill(token_bucket_t *bucket, uint64_t elapsed_us) {
+    if (bucket->rate == 0) return;
+    uint64_t missing = bucket->capacity - bucket->level;
+    // Long pauses would overflow the multiplication.
+    if (elapsed_us >= missing / bucket->rate + 1) {
+        bucket->level = bucket->capacity;
+    } else {
+        bucket->level += bucket->rate * elapsed_us;
+        if (bucket->level > bucket->capacity) bucket->level = bucket->capacity;
+    }
+}
+
+static uint64_t token_bucket_deadline(const token_bucket_t *bucket, uint64_t tokens, uint64_t current_us) {
+    uint64_t required = tokens * TOKEN_SCALE;
+    // A datagram that is larger than the bucket waits until the bucket is full.
+    if (required > bucket->capacity) required = bucket->capacity;
+    if (bucket->rate == 0 || bucket->level >= required) return current_us;
+    return current_us + (required - bucket->level + bucket->rate - 1) / bucket->rate;
+}
+
+static void token_bucket_consume(token_bucket_t *bucket, uint64_t tokens) {
+    if (bucket->rate == 0) return;
+    uint64_t taken = tokens * TOKEN_SCALE;
+    bucket->level = bucket->level > taken ? bucket->level - taken : 0;
+}
+
+void pacer_init(pacer_t *pacer, uint32_t bytes_rate, uint32_t packets_rate) {
+    token_bucket_init(&pacer->bytes, bytes_rate, MESSAGE_MAX_SIZE);
+    token_bucket_init(&pacer->packets, packets_rate, 1);
+    pacer->last_us = 0;
+}
+
+uint64_t pacer_deadline(pacer_t *pacer, size_t datagram_size, uint64_t current_us) {
+    if (pacer->last_us != 0 && current_us > pacer->last_us) {
+        token_bucket_refill(&pacer->bytes, current_us - pacer->last_us);
+        token_bucket_refill(&pacer->packets, current_us - pacer->last_us);
+    }
+    if (current_us > pacer->last_us) pacer->last_us = current_us;
+
+    uint64_t bytes_deadline = token_bucket_deadline(&pacer->bytes, datagram_size, current_us);
+    uint64_t packets_deadline = token_bucket_deadline(&pacer->packets, 1, current_us);
+    return bytes_deadline > packets_deadline ? bytes_deadline : packets_deadline;
+}
+
+void pacer_consume(pacer_t *pacer, size_t datagram_size) {
+    token_bucket_consume(&pacer->bytes, datagram_size);
+    token_bucket_consume(&pacer->packets, 1);
+}
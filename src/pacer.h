@@ -0,0 +1,68 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef PITTACUS_PACER_H
+#define PITTACUS_PACER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A token bucket which is refilled at a constant rate up to its capacity.
+ * The level is kept in millionths of a token, so that it's refilled every
+ * microsecond even at low rates.
+ */
+typedef struct token_bucket {
+    uint64_t rate; /**< tokens per second. Zero means no limit. */
+    uint64_t capacity; /**< in millionths of a token. */
+    uint64_t level; /**< in millionths of a token. */
+} token_bucket_t;
+
+/**
+ * Limits both the number of bytes and the number of datagrams sent per second.
+ * Each bucket holds up to SEND_BURST_INTERVAL milliseconds worth of tokens, but
+ * at least a single datagram of the maximum size.
+ */
+typedef struct pacer {
+    token_bucket_t bytes;
+    token_bucket_t packets;
+    uint64_t last_us;
+} pacer_t;
+
+/** Initializes the pacer with full buckets. Zero rates disable the corresponding limit. */
+void pacer_init(pacer_t *pacer, uint32_t bytes_rate, uint32_t packets_rate);
+
+/**
+ * Refills the buckets and calculates the moment when a datagram of the given
+ * size can be sent.
+ *
+ * @return the time in microseconds, which is not greater than current_us
+ *         if the datagram can be sent right away.
+ */
+uint64_t pacer_deadline(pacer_t *pacer, size_t datagram_size, uint64_t current_us);
+
+/** Takes the tokens of the sent datagram from the buckets. */
+void pacer_consume(pacer_t *pacer, size_t datagram_size);
+
+#ifdef  __cplusplus
+} // extern "C"
+#endif
+
+#endif //PITTACUS_PACER_H
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "rtt_estimator.h"
+
+#define RTT_TIMEOUT_MIN_US (MESSAGE_RETRY_TIMEOUT_MIN * 1000ULL)
+#define RTT_TIMEOUT_MAX_US (MESSAGE_RETRY_INTERVAL * 1000ULL)
+
+void rtt_estimator_init(rtt_estimator_t *estimator) {
+    estimator->srtt_us = 0;
+    estimator->rttvar_us = 0;
+    estimator->samples = 0;
+}
+
+void rtt_estimator_sample(rtt_estimator_t *estimator, uint64_t rtt_us) {
+    if (estimator->samples == 0) {
+        estimator->srtt_us = rtt_us;
+        estimator->rttvar_us = rtt_us / 2;
+    } else {
+        uint64_t deviation = estimator->srtt_us > rtt_us ? estimator->srtt_us - rtt_us : rtt_us - estimator->srtt_us;
+        estimator->rttvar_us = (3 * estimator->rttvar_us + deviation) / 4;
+        estimator->srtt_us = (7 * estimator->srtt_us + rtt_us) / 8;
+    }
+    ++estimator->samples;
+}
+
+uint64_t rtt_estimator_timeout(const rtt_estimator_t *estimator, uint16_t backoff) {
+    uint64_t timeout_us = MESSAGE_RETRY_TIMEOUT_INITIAL * 1000ULL;
+    if (estimator->samples > 0) timeout_us = estimator->srtt_us + 4 * estimator->rttvar_us;
+    if (timeout_us < RTT_TIMEOUT_MIN_US) timeout_us = RTT_TIMEOUT_MIN_US;
+    for (uint16_t i = 0; i < backoff && timeout_us < RTT_TIMEOUT_MAX_US; ++i) timeout_us *= 2;
+    return timeout_us < RTT_TIMEOUT_MAX_US ? timeout_us : RTT_TIMEOUT_MAX_US;
+}
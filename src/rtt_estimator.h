@@ -0,0 +1,57 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef PITTACUS_RTT_ESTIMATOR_H
+#define PITTACUS_RTT_ESTIMATOR_H
+
+#include <stdint.h>
+#include "config.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Estimates the round trip time to a member and derives the retransmission
+ * timeout from it the same way TCP does (RFC 6298). Only acknowledgements
+ * of messages that were sent once are sampled, since it's unknown which
+ * attempt is acknowledged otherwise.
+ */
+typedef struct rtt_estimator {
+    uint64_t srtt_us; /**< the smoothed round trip time. */
+    uint64_t rttvar_us; /**< the round trip time variation. */
+    uint32_t samples;
+} rtt_estimator_t;
+
+void rtt_estimator_init(rtt_estimator_t *estimator);
+
+void rtt_estimator_sample(rtt_estimator_t *estimator, uint64_t rtt_us);
+
+/**
+ * Calculates the retransmission timeout in microseconds. The timeout doubles
+ * with each unacknowledged attempt and stays within MESSAGE_RETRY_TIMEOUT_MIN and
+ * MESSAGE_RETRY_INTERVAL. Until the first sample MESSAGE_RETRY_TIMEOUT_INITIAL is used.
+ *
+ * @param estimator the estimator instance.
+ * @param backoff the number of unacknowledged attempts.
+ * @return the timeout in microseconds.
+ */
+uint64_t rtt_estimator_timeout(const rtt_estimator_t *estimator, uint16_t backoff);
+
+#ifdef  __cplusplus
+} // extern "C"
+#endif
+
+#endif //PITTACUS_RTT_ESTIMATOR_H
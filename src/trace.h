@@ -0,0 +1,90 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef PITTACUS_TRACE_H
+#define PITTACUS_TRACE_H
+
+/**
+ * Static tracepoints of the "pittacus" USDT provider. When the library is
+ * built with PITTACUS_TRACE and <sys/sdt.h> is available, each tracepoint is
+ * compiled into a single NOP instruction plus an ELF note, guarded by the
+ * semaphore of its probe. A tracer (bpftrace, SystemTap, perf) increments the
+ * semaphore when it attaches, so probe arguments are only evaluated while
+ * somebody is listening. Otherwise tracepoints are compiled out completely.
+ *
+ * The argument layout of each probe is a part of the public contract and
+ * is documented in the "Tracing" section of README.md. New arguments may
+ * only be appended. A new probe must also be added to PT_TRACE_PROBES.
+ */
+
+#define PT_TRACE_PROBES(X) \
+    X(message__receive) \
+    X(message__dispatch) \
+    X(message__enqueue) \
+    X(message__send) \
+    X(message__retry) \
+    X(message__expire) \
+    X(message__evict) \
+    X(ack__match) \
+    X(member__add) \
+    X(member__remove) \
+    X(member__suspect) \
+    X(data__deliver)
+
+#ifdef PITTACUS_HAVE_SDT
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+/** The semaphores live in the ".probes" section, where tracers look them up by the ELF notes. */
+#define PT_TRACE_SEMAPHORE(name) pittacus_##name##_semaphore
+#define PT_TRACE_DECLARE_SEMAPHORE(name) \
+    __extension__ extern unsigned short PT_TRACE_SEMAPHORE(name) \
+        __attribute__((unused)) __attribute__((section(".probes")));
+#define PT_TRACE_DEFINE_SEMAPHORE(name) \
+    __extension__ unsigned short PT_TRACE_SEMAPHORE(name) \
+        __attribute__((unused)) __attribute__((section(".probes"))) __attribute__((visibility("hidden")));
+
+PT_TRACE_PROBES(PT_TRACE_DECLARE_SEMAPHORE)
+
+/** Whether a tracer is attached to the probe. */
+#define PT_TRACE_ENABLED(name) __builtin_expect(PT_TRACE_SEMAPHORE(name), 0)
+
+#define PT_TRACE1(name, a1) \
+    do { if (PT_TRACE_ENABLED(name)) DTRACE_PROBE1(pittacus, name, a1); } while (0)
+#define PT_TRACE2(name, a1, a2) \
+    do { if (PT_TRACE_ENABLED(name)) DTRACE_PROBE2(pittacus, name, a1, a2); } while (0)
+#define PT_TRACE3(name, a1, a2, a3) \
+    do { if (PT_TRACE_ENABLED(name)) DTRACE_PROBE3(pittacus, name, a1, a2, a3); } while (0)
+#define PT_TRACE4(name, a1, a2, a3, a4) \
+    do { if (PT_TRACE_ENABLED(name)) DTRACE_PROBE4(pittacus, name, a1, a2, a3, a4); } while (0)
+#define PT_TRACE5(name, a1, a2, a3, a4, a5) \
+    do { if (PT_TRACE_ENABLED(name)) DTRACE_PROBE5(pittacus, name, a1, a2, a3, a4, a5); } while (0)
+#define PT_TRACE6(name, a1, a2, a3, a4, a5, a6) \
+    do { if (PT_TRACE_ENABLED(name)) DTRACE_PROBE6(pittacus, name, a1, a2, a3, a4, a5, a6); } while (0)
+
+#else
+
+#define PT_TRACE_ENABLED(name) 0
+
+#define PT_TRACE1(name, a1) do {} while (0)
+#define PT_TRACE2(name, a1, a2) do {} while (0)
+#define PT_TRACE3(name, a1, a2, a3) do {} while (0)
+#define PT_TRACE4(name, a1, a2, a3, a4) do {} while (0)
+#define PT_TRACE5(name, a1, a2, a3, a4, a5) do {} while (0)
+#define PT_TRACE6(name, a1, a2, a3, a4, a5, a6) do {} while (0)
+
+#endif
+
+#endif //PITTACUS_TRACE_H
@@ -19,15 +19,25 @@
 #include <string.h>
 #include <sys/time.h>
 
+#if !defined(PITTACUS_CUSTOM_PLATFORM) && !defined(PITTACUS_CUSTOM_CLOCK)
 uint64_t pt_time() {
     struct timeval tv;
     gettimeofday(&tv, NULL);
     return tv.tv_sec * 1000LL + tv.tv_usec / 1000;
 }
 
+uint64_t pt_time_us() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+#endif
+
+#ifndef PITTACUS_CUSTOM_PLATFORM
 uint32_t pt_random() {
     return random();
 }
+#endif
 
 uint16_t uint16_decode(const uint8_t *buffer) {
     return PT_NTOHS(*(uint16_t *) buffer);
@@ -46,3 +56,12 @@ void uint32_encode(uint32_t n, uint8_t *buffer) {
     uint32_t network_n = PT_HTONL(n);
     memcpy(buffer, &network_n, sizeof(uint32_t));
 }
+
+uint64_t uint64_decode(const uint8_t *buffer) {
+    return ((uint64_t) uint32_decode(buffer) << 32) | uint32_decode(buffer + sizeof(uint32_t));
+}
+
+void uint64_encode(uint64_t n, uint8_t *buffer) {
+    uint32_encode((uint32_t) (n >> 32), buffer);
+    uint32_encode((uint32_t) n, buffer + sizeof(uint32_t));
+}
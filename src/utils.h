@@ -22,13 +22,24 @@
 extern "C" {
 #endif
 
+/**
+ * Platform primitives. When PITTACUS_CUSTOM_PLATFORM is defined, the time
+ * and randomness sources below as well as the socket primitives declared
+ * in network.h must be provided by the embedding application (see sim/).
+ * PITTACUS_CUSTOM_CLOCK replaces only the time source, so tests can drive
+ * time over real sockets.
+ */
 uint64_t pt_time();
+/** The same clock as pt_time() but with microsecond precision. */
+uint64_t pt_time_us();
 uint32_t pt_random();
 
 uint16_t uint16_decode(const uint8_t *buffer);
 void uint16_encode(uint16_t n, uint8_t *buffer);
 uint32_t uint32_decode(const uint8_t *buffer);
 void uint32_encode(uint32_t n, uint8_t *buffer);
+uint64_t uint64_decode(const uint8_t *buffer);
+void uint64_encode(uint64_t n, uint8_t *buffer);
 
 typedef enum pt_bool {
     PT_FALSE = 0,
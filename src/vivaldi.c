@@ -0,0 +1,134 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "vivaldi.h"
+#include "utils.h"
+#include "errors.h"
+
+/** The error of a new coordinate and the upper bound of the error. */
+#define VIVALDI_ERROR_MAX 1.5
+/** The share of the error estimate that is replaced by each sample. */
+#define VIVALDI_CE 0.25
+/** The share of the prediction error that the coordinate moves by with each sample. */
+#define VIVALDI_CC 0.25
+#define VIVALDI_HEIGHT_MIN 10.0
+#define VIVALDI_ZERO_THRESHOLD 1.0e-6
+/** The scale of the error on the wire. */
+#define VIVALDI_ERROR_SCALE 1000.0
+
+static double vivaldi_abs(double value) {
+    return value < 0.0 ? -value : value;
+}
+
+static double vivaldi_sqrt(double value) {
+    // Newton's method spares the dependency on libm. Starting above the root
+    // the iterations decrease monotonically until the precision is exhausted.
+    if (value <= 0.0) return 0.0;
+    double result = value > 1.0 ? value : 1.0;
+    for (int i = 0; i < 128; ++i) {
+        double next = 0.5 * (result + value / result);
+        if (next >= result) break;
+        result = next;
+    }
+    return result;
+}
+
+static double vivaldi_norm(const double *vec) {
+    double sum = 0.0;
+    for (int i = 0; i < VIVALDI_DIMENSIONS; ++i) sum += vec[i] * vec[i];
+    return vivaldi_sqrt(sum);
+}
+
+static double vivaldi_clamp(double value, double min, double max) {
+    if (value < min) return min;
+    if (value > max) return max;
+    return value;
+}
+
+void vivaldi_coord_init(vivaldi_coord_t *coord) {
+    for (int i = 0; i < VIVALDI_DIMENSIONS; ++i) coord->vec[i] = 0.0;
+    coord->height = VIVALDI_HEIGHT_MIN;
+    coord->error = VIVALDI_ERROR_MAX;
+}
+
+double vivaldi_distance(const vivaldi_coord_t *first, const vivaldi_coord_t *second) {
+    double diff[VIVALDI_DIMENSIONS];
+    for (int i = 0; i < VIVALDI_DIMENSIONS; ++i) diff[i] = first->vec[i] - second->vec[i];
+    return vivaldi_norm(diff) + first->height + second->height;
+}
+
+void vivaldi_update(vivaldi_coord_t *coord, const vivaldi_coord_t *other, uint64_t rtt_us) {
+    double rtt = rtt_us > 0 ? (double) rtt_us : 1.0;
+    double distance = vivaldi_distance(coord, other);
+
+    // Nodes with confident coordinates pull harder.
+    double total_error = coord->error + other->error;
+    if (total_error < VIVALDI_ZERO_THRESHOLD) total_error = VIVALDI_ZERO_THRESHOLD;
+    double weight = coord->error / total_error;
+    double sample_error = vivaldi_abs(distance - rtt) / rtt;
+    coord->error = VIVALDI_CE * weight * sample_error + coord->error * (1.0 - VIVALDI_CE * weight);
+    coord->error = vivaldi_clamp(coord->error, 0.0, VIVALDI_ERROR_MAX);
+
+    // Move along the line between the nodes. Coincident nodes are pushed apart in a random direction.
+    double force = VIVALDI_CC * weight * (rtt - distance);
+    double unit[VIVALDI_DIMENSIONS];
+    for (int i = 0; i < VIVALDI_DIMENSIONS; ++i) unit[i] = coord->vec[i] - other->vec[i];
+    double magnitude = vivaldi_norm(unit);
+    if (magnitude > VIVALDI_ZERO_THRESHOLD) {
+        for (int i = 0; i < VIVALDI_DIMENSIONS; ++i) unit[i] /= magnitude;
+    } else {
+        for (int i = 0; i < VIVALDI_DIMENSIONS; ++i) unit[i] = (double) (pt_random() % 2001) - 1000.0;
+        double random_magnitude = vivaldi_norm(unit);
+        for (int i = 0; i < VIVALDI_DIMENSIONS; ++i) {
+            unit[i] = random_magnitude > VIVALDI_ZERO_THRESHOLD ? unit[i] / random_magnitude : (i == 0);
+        }
+    }
+    for (int i = 0; i < VIVALDI_DIMENSIONS; ++i) coord->vec[i] += unit[i] * force;
+    if (magnitude > VIVALDI_ZERO_THRESHOLD) {
+        coord->height += (coord->height + other->height) * force / magnitude;
+        if (coord->height < VIVALDI_HEIGHT_MIN) coord->height = VIVALDI_HEIGHT_MIN;
+    }
+}
+
+int vivaldi_coord_decode(const uint8_t *buffer, size_t buffer_size, vivaldi_coord_t *result) {
+    if (buffer_size < VIVALDI_COORD_SIZE) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+    // Coordinates of different dimensions can't be compared.
+    if (buffer[0] != VIVALDI_DIMENSIONS) return PITTACUS_ERR_INVALID_MESSAGE;
+    const uint8_t *cursor = buffer + sizeof(uint8_t);
+    for (int i = 0; i < VIVALDI_DIMENSIONS; ++i) {
+        result->vec[i] = (int32_t) uint32_decode(cursor);
+        cursor += sizeof(uint32_t);
+    }
+    result->height = uint32_decode(cursor);
+    cursor += sizeof(uint32_t);
+    result->error = uint16_decode(cursor) / VIVALDI_ERROR_SCALE;
+    cursor += sizeof(uint16_t);
+    return cursor - buffer;
+}
+
+int vivaldi_coord_encode(const vivaldi_coord_t *coord, uint8_t *buffer, size_t buffer_size) {
+    if (buffer_size < VIVALDI_COORD_SIZE) return PITTACUS_ERR_BUFFER_NOT_ENOUGH;
+    buffer[0] = VIVALDI_DIMENSIONS;
+    uint8_t *cursor = buffer + sizeof(uint8_t);
+    for (int i = 0; i < VIVALDI_DIMENSIONS; ++i) {
+        uint32_encode((uint32_t) (int32_t) vivaldi_clamp(coord->vec[i], INT32_MIN, INT32_MAX), cursor);
+        cursor += sizeof(uint32_t);
+    }
+    uint32_encode((uint32_t) vivaldi_clamp(coord->height, 0.0, UINT32_MAX), cursor);
+    cursor += sizeof(uint32_t);
+    uint16_encode((uint16_t) vivaldi_clamp(coord->error * VIVALDI_ERROR_SCALE, 0.0, UINT16_MAX), cursor);
+    cursor += sizeof(uint16_t);
+    return cursor - buffer;
+}
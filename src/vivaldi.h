@@ -0,0 +1,65 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef PITTACUS_VIVALDI_H
+#define PITTACUS_VIVALDI_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/** The size of the encoded coordinate: the number of dimensions, the vector, the height and the error. */
+#define VIVALDI_COORD_SIZE (sizeof(uint8_t) + (VIVALDI_DIMENSIONS + 1) * sizeof(uint32_t) + sizeof(uint16_t))
+
+/**
+ * A Vivaldi network coordinate. The distance between two coordinates estimates
+ * the round trip time between the nodes. Like in Serf the Euclidean space is
+ * extended with a height, which models the latency of the node's access link
+ * that is paid on every path. All values are in microseconds.
+ */
+typedef struct vivaldi_coord {
+    double vec[VIVALDI_DIMENSIONS];
+    double height;
+    double error; /**< the relative error of the coordinate's predictions. */
+} vivaldi_coord_t;
+
+/** Initializes the coordinate at the origin with the maximum error. */
+void vivaldi_coord_init(vivaldi_coord_t *coord);
+
+/** Estimates the round trip time in microseconds between two nodes. */
+double vivaldi_distance(const vivaldi_coord_t *first, const vivaldi_coord_t *second);
+
+/**
+ * Moves this node's coordinate according to the round trip time measured
+ * to the node with the given coordinate.
+ *
+ * @param coord this node's coordinate.
+ * @param other the coordinate of the remote node.
+ * @param rtt_us the measured round trip time.
+ */
+void vivaldi_update(vivaldi_coord_t *coord, const vivaldi_coord_t *other, uint64_t rtt_us);
+
+int vivaldi_coord_decode(const uint8_t *buffer, size_t buffer_size, vivaldi_coord_t *result);
+int vivaldi_coord_encode(const vivaldi_coord_t *coord, uint8_t *buffer, size_t buffer_size);
+
+#ifdef  __cplusplus
+} // extern "C"
+#endif
+
+#endif //PITTACUS_VIVALDI_H
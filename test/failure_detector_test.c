@@ -0,0 +1,91 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "failure_detector.h"
+#include <assert.h>
+#include <stdint.h>
+
+#define INTERVAL_US 200000ULL
+
+void test_failure_detector_arrival() {
+    failure_detector_t detector;
+    failure_detector_init(&detector);
+    assert(!failure_detector_is_ready(&detector));
+    assert(failure_detector_phi(&detector, INTERVAL_US) == 0.0);
+    assert(failure_detector_deadline(&detector, PHI_THRESHOLD) == UINT64_MAX);
+
+    // The first arrival has no predecessor.
+    uint64_t ts = 1000000;
+    failure_detector_arrival(&detector, ts);
+    assert(detector.size == 0);
+
+    // Arrivals within a single burst are counted once.
+    failure_detector_arrival(&detector, ts + PHI_MIN_INTERVAL * 1000ULL - 1);
+    assert(detector.size == 0);
+    assert(detector.last_arrival_us == ts);
+
+    for (int i = 0; i < PHI_MIN_SAMPLES; ++i) {
+        assert(!failure_detector_is_ready(&detector));
+        ts += INTERVAL_US;
+        failure_detector_arrival(&detector, ts);
+    }
+    assert(failure_detector_is_ready(&detector));
+    assert(detector.size == PHI_MIN_SAMPLES);
+    assert(detector.intervals_sum == PHI_MIN_SAMPLES * INTERVAL_US);
+
+    // The window keeps only the latest intervals.
+    for (int i = 0; i < PHI_WINDOW_SIZE; ++i) {
+        ts += 2 * INTERVAL_US;
+        failure_detector_arrival(&detector, ts);
+    }
+    assert(detector.size == PHI_WINDOW_SIZE);
+    assert(detector.intervals_sum == PHI_WINDOW_SIZE * 2 * INTERVAL_US);
+}
+
+void test_failure_detector_phi() {
+    failure_detector_t fast;
+    failure_detector_t slow;
+    failure_detector_init(&fast);
+    failure_detector_init(&slow);
+    uint64_t ts = 0;
+    for (int i = 0; i <= PHI_MIN_SAMPLES; ++i) {
+        ts += INTERVAL_US;
+        failure_detector_arrival(&fast, ts);
+        failure_detector_arrival(&slow, ts * 10);
+    }
+
+    // Phi is growing with the silence.
+    assert(failure_detector_phi(&fast, ts) == 0.0);
+    double phi1 = failure_detector_phi(&fast, ts + INTERVAL_US);
+    double phi2 = failure_detector_phi(&fast, ts + 10 * INTERVAL_US);
+    assert(phi1 > 0.4 && phi1 < 0.5);
+    assert(phi2 > phi1);
+
+    // The same silence is much less suspicious on a slow link.
+    assert(failure_detector_phi(&slow, ts * 10 + 10 * INTERVAL_US) < phi2);
+
+    uint64_t deadline = failure_detector_deadline(&fast, PHI_THRESHOLD);
+    assert(deadline > ts);
+    assert(failure_detector_phi(&fast, deadline - 1000) < PHI_THRESHOLD);
+    assert(failure_detector_phi(&fast, deadline + 1000) >= PHI_THRESHOLD);
+    uint64_t slow_silence = failure_detector_deadline(&slow, PHI_THRESHOLD) - ts * 10;
+    assert(slow_silence > 10 * (deadline - ts) - 10 && slow_silence < 10 * (deadline - ts) + 10);
+}
+
+int main() {
+    test_failure_detector_arrival();
+    test_failure_detector_phi();
+    return 0;
+}
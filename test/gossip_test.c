@@ -0,0 +1,1043 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gossip.h"
+#include "messages.h"
+#include "config.h"
+#include "errors.h"
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+static int data_received = 0;
+static uint8_t last_data[MESSAGE_MAX_SIZE];
+static size_t last_data_size = 0;
+
+static void test_data_receiver(void *context, pittacus_gossip_t *gossip,
+                               const uint8_t *buffer, size_t buffer_size) {
+    ++data_received;
+    memcpy(last_data, buffer, buffer_size);
+    last_data_size = buffer_size;
+}
+
+static void test_data_release(void *context, const uint8_t *buffer, size_t buffer_size) {
+    ++*(int *) context;
+}
+
+/** The library is built with PITTACUS_CUSTOM_CLOCK, so time only moves when a test says so. */
+static uint64_t test_clock_us = 1000000000ULL;
+
+uint64_t pt_time() {
+    return test_clock_us / 1000;
+}
+
+uint64_t pt_time_us() {
+    return test_clock_us;
+}
+
+static void advance_clock(uint64_t us) {
+    test_clock_us += us;
+}
+
+#define LOOPBACK_LATENCY_US 100
+
+static pittacus_gossip_t *create_test_node(struct sockaddr_in *addr) {
+    memset(addr, 0, sizeof(struct sockaddr_in));
+    addr->sin_family = AF_INET;
+    inet_aton("127.0.0.1", &addr->sin_addr);
+    pittacus_addr_t self_addr = {
+        .addr = (const pt_sockaddr *) addr,
+        .addr_len = sizeof(struct sockaddr_in)
+    };
+    pittacus_gossip_t *result = pittacus_gossip_create(&self_addr, &test_data_receiver, NULL);
+    assert(result != NULL);
+    socklen_t addr_len = sizeof(struct sockaddr_in);
+    assert(getsockname(pittacus_gossip_socket_fd(result), (struct sockaddr *) addr, &addr_len) == 0);
+    return result;
+}
+
+static void exchange_messages(pittacus_gossip_t *node1, pittacus_gossip_t *node2) {
+    // Loopback delivers datagrams synchronously, so a few rounds are enough.
+    for (int i = 0; i < 5; ++i) {
+        advance_clock(LOOPBACK_LATENCY_US);
+        assert(pittacus_gossip_process_send(node1) >= 0);
+        assert(pittacus_gossip_process_send(node2) >= 0);
+        while (pittacus_gossip_process_receive(node1) != PITTACUS_ERR_READ_FAILED);
+        while (pittacus_gossip_process_receive(node2) != PITTACUS_ERR_READ_FAILED);
+    }
+}
+
+#define CAPTURED_DATAGRAMS_SIZE 8
+
+typedef struct captured_datagrams {
+    uint8_t buffers[CAPTURED_DATAGRAMS_SIZE][MESSAGE_MAX_SIZE];
+    ssize_t sizes[CAPTURED_DATAGRAMS_SIZE];
+    int size;
+} captured_datagrams_t;
+
+static void capture_datagrams(pittacus_gossip_t *recipient, captured_datagrams_t *datagrams) {
+    // Take the datagrams off the socket before the recipient processes them.
+    datagrams->size = 0;
+    while (datagrams->size < CAPTURED_DATAGRAMS_SIZE &&
+           (datagrams->sizes[datagrams->size] = recv(pittacus_gossip_socket_fd(recipient),
+                                                     datagrams->buffers[datagrams->size],
+                                                     MESSAGE_MAX_SIZE, MSG_DONTWAIT)) > 0) {
+        ++datagrams->size;
+    }
+    assert(datagrams->size > 0);
+}
+
+static void replay_datagrams(const captured_datagrams_t *datagrams, int skipped_type,
+                             pittacus_gossip_t *sender, pittacus_gossip_t *recipient,
+                             const struct sockaddr_in *recipient_addr) {
+    // The recipient sees the datagrams coming from the original sender. Datagrams of the skipped
+    // type are lost, -1 loses none.
+    for (int i = 0; i < datagrams->size; ++i) {
+        if (message_type_decode(datagrams->buffers[i], datagrams->sizes[i]) == skipped_type) continue;
+        assert(sendto(pittacus_gossip_socket_fd(sender), datagrams->buffers[i], datagrams->sizes[i], 0,
+                      (const struct sockaddr *) recipient_addr, sizeof(struct sockaddr_in)) == datagrams->sizes[i]);
+    }
+    while (pittacus_gossip_process_receive(recipient) != PITTACUS_ERR_READ_FAILED);
+}
+
+static pittacus_addr_t join_test_pair(pittacus_gossip_t *seed, struct sockaddr_in *seed_addr_in,
+                                      pittacus_gossip_t *node) {
+    if (pittacus_gossip_state(seed) != STATE_CONNECTED) assert(pittacus_gossip_join(seed, NULL, 0) == 0);
+    pittacus_addr_t seed_addr = {
+        .addr = (const pt_sockaddr *) seed_addr_in,
+        .addr_len = sizeof(struct sockaddr_in)
+    };
+    assert(pittacus_gossip_join(node, &seed_addr, 1) == 0);
+    exchange_messages(seed, node);
+    assert(pittacus_gossip_state(node) == STATE_CONNECTED);
+    return seed_addr;
+}
+
+void test_gossip_stats() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node = create_test_node(&node_addr_in);
+
+    pittacus_gossip_stats_t stats;
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.bytes_sent == 0);
+    assert(stats.bytes_received == 0);
+    assert(stats.outbound_queue_size == 0);
+    assert(stats.members_num == 0);
+
+    assert(pittacus_gossip_join(seed, NULL, 0) == 0);
+    pittacus_addr_t seed_addr = {
+        .addr = (const pt_sockaddr *) &seed_addr_in,
+        .addr_len = sizeof(struct sockaddr_in)
+    };
+    assert(pittacus_gossip_join(node, &seed_addr, 1) == 0);
+
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.outbound_queue_size == 1);
+
+    exchange_messages(seed, node);
+    assert(pittacus_gossip_state(node) == STATE_CONNECTED);
+
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_HELLO_TYPE] == 1);
+    assert(stats.messages_received[MESSAGE_WELCOME_TYPE] == 1);
+    assert(stats.members_num == 1);
+    assert(stats.outbound_queue_size == 0);
+    if (!GOSSIP_ADAPTIVE) {
+        assert(stats.fanout == MESSAGE_RUMOR_FACTOR);
+        assert(stats.tick_interval == GOSSIP_TICK_INTERVAL);
+    }
+
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.messages_received[MESSAGE_HELLO_TYPE] == 1);
+    assert(stats.messages_sent[MESSAGE_WELCOME_TYPE] == 1);
+    assert(stats.members_num == 1);
+
+    uint8_t data[] = { 0x01, 0x02, 0x03 };
+    assert(pittacus_gossip_send_data(node, data, sizeof(data)) == 0);
+    exchange_messages(seed, node);
+    assert(data_received == 1);
+
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_DATA_TYPE] == 1);
+    assert(stats.messages_received[MESSAGE_ACK_TYPE] == 1);
+    assert(stats.data_log_size == 1);
+    assert(stats.data_version_size == 1);
+    assert(stats.outbound_queue_size == 0);
+    assert(stats.retries == 0);
+    assert(stats.decode_failures == 0);
+    assert(stats.bytes_sent > 0);
+    assert(stats.bytes_received > 0);
+
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.messages_received[MESSAGE_DATA_TYPE] == 1);
+    assert(stats.messages_sent[MESSAGE_ACK_TYPE] == 1);
+    assert(stats.data_log_size == 1);
+
+    pittacus_gossip_latency_t latency;
+    assert(pittacus_gossip_latency(node, &latency) == 0);
+    assert(latency.ack_rtt.count == 1);
+    // The node receives its own payload back from the seed, but it is not new anymore.
+    assert(latency.propagation_age.count == 0);
+    assert(pittacus_gossip_latency(seed, &latency) == 0);
+    // Over the broadcast tree the payload is never pushed back to the member it came from.
+    // A postponed relay is not sent during the exchange.
+    assert(latency.ack_rtt.count == (GOSSIP_BROADCAST_TREE || DATA_RELAY_DUPLICATES ? 0 : 1));
+    if (MESSAGE_DATA_TIMESTAMPS) {
+        assert(latency.hop_latency.count == 1);
+        assert(latency.propagation_age.count == 1);
+        assert(latency.propagation_age.min >= latency.hop_latency.min);
+    } else {
+        // Without timestamps there is nothing to measure the latency with.
+        assert(latency.hop_latency.count == 0);
+        assert(latency.propagation_age.count == 0);
+    }
+
+    // Garbage is counted as a decode failure.
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(sock >= 0);
+    assert(sendto(sock, data, sizeof(data), 0, (struct sockaddr *) &seed_addr_in, sizeof(struct sockaddr_in)) > 0);
+    close(sock);
+    assert(pittacus_gossip_process_receive(seed) == PITTACUS_ERR_INVALID_MESSAGE);
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.decode_failures == 1);
+
+    pittacus_gossip_destroy(seed);
+    pittacus_gossip_destroy(node);
+}
+
+void test_gossip_probe() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node = create_test_node(&node_addr_in);
+    join_test_pair(seed, &seed_addr_in, node);
+
+    // The first probe starts immediately and the next tick is due when it times out.
+    int next_tick = pittacus_gossip_tick(node);
+    assert(next_tick > 0 && next_tick <= PROBE_TIMEOUT);
+    exchange_messages(seed, node);
+
+    pittacus_gossip_stats_t stats;
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_PING_TYPE] == 1);
+    assert(stats.members_suspected == 0);
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.messages_received[MESSAGE_PING_TYPE] == 1);
+
+    // The probe has been acknowledged, so nothing happens until the next protocol period.
+    next_tick = pittacus_gossip_tick(node);
+    assert(next_tick > PROBE_TIMEOUT && next_tick <= PROBE_INTERVAL);
+
+    // The seed goes down. The next probe fails and the seed becomes suspected.
+    pittacus_gossip_destroy(seed);
+    advance_clock(PROBE_INTERVAL * 1000ULL);
+    assert(pittacus_gossip_tick(node) >= 0);
+    assert(pittacus_gossip_process_send(node) >= 0);
+    advance_clock(PROBE_INTERVAL * 1000ULL);
+    assert(pittacus_gossip_tick(node) >= 0);
+
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_PING_TYPE] == 2);
+    assert(stats.members_suspected == 1);
+    assert(stats.members_num == 1);
+
+    pittacus_gossip_destroy(node);
+}
+
+void test_gossip_join_event() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node1_addr_in;
+    struct sockaddr_in node2_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node1 = create_test_node(&node1_addr_in);
+    pittacus_gossip_t *node2 = create_test_node(&node2_addr_in);
+    join_test_pair(seed, &seed_addr_in, node1);
+    join_test_pair(seed, &seed_addr_in, node2);
+
+    pittacus_gossip_stats_t stats;
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.members_num == 2);
+    // The newcomer is not broadcast to existing members.
+    assert(stats.messages_sent[MESSAGE_MEMBER_LIST_TYPE] == 1);
+    assert(pittacus_gossip_stats(node1, &stats) == 0);
+    assert(stats.members_num == 1);
+
+    // The join event is piggybacked on the Status messages of the next gossip round.
+    assert(pittacus_gossip_tick(seed) > 0);
+    exchange_messages(seed, node1);
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.member_events_sent > 0);
+    assert(pittacus_gossip_stats(node1, &stats) == 0);
+    assert(stats.members_num == 2);
+
+    pittacus_gossip_destroy(seed);
+    pittacus_gossip_destroy(node1);
+    pittacus_gossip_destroy(node2);
+}
+
+void test_gossip_lazy_push() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node = create_test_node(&node_addr_in);
+    join_test_pair(seed, &seed_addr_in, node);
+
+    int received_before = data_received;
+    uint8_t data[DATA_LAZY_PUSH_THRESHOLD + 1];
+    memset(data, 0xAB, sizeof(data));
+    assert(pittacus_gossip_send_data(node, data, sizeof(data)) == 0);
+    exchange_messages(seed, node);
+    assert(data_received == received_before + 1);
+
+    // The payload is announced first and then pulled by the seed.
+    pittacus_gossip_stats_t stats;
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_IHAVE_TYPE] == 1);
+    assert(stats.messages_received[MESSAGE_IWANT_TYPE] == 1);
+    assert(stats.messages_sent[MESSAGE_DATA_TYPE] == 1);
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_IWANT_TYPE] == 1);
+    assert(stats.messages_received[MESSAGE_DATA_TYPE] == 1);
+    // The seed announces the payload back, but the node already has it.
+    assert(stats.messages_sent[MESSAGE_IHAVE_TYPE] == 1);
+
+    pittacus_gossip_destroy(seed);
+    pittacus_gossip_destroy(node);
+}
+
+void test_gossip_send_datav() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node = create_test_node(&node_addr_in);
+    join_test_pair(seed, &seed_addr_in, node);
+
+    // Segments are delivered as a single payload.
+    char header[] = "header:";
+    char body[] = "body:";
+    char trailer[] = "trailer";
+    pt_iovec iov[] = {
+        { .iov_base = header, .iov_len = strlen(header) },
+        { .iov_base = body, .iov_len = strlen(body) },
+        { .iov_base = trailer, .iov_len = strlen(trailer) + 1 }
+    };
+    int received_before = data_received;
+    assert(pittacus_gossip_send_datav(node, iov, 3) == 0);
+    exchange_messages(seed, node);
+    assert(data_received == received_before + 1);
+    assert(last_data_size == strlen("header:body:trailer") + 1);
+    assert(strcmp((const char *) last_data, "header:body:trailer") == 0);
+
+    // The borrowed buffer stays in use while the data log refers to it.
+    int released = 0;
+    uint8_t borrowed[] = { 0x01, 0x02, 0x03, 0x04 };
+    assert(pittacus_gossip_send_data_borrowed(node, borrowed, sizeof(borrowed),
+                                              &test_data_release, &released) == 0);
+    exchange_messages(seed, node);
+    assert(data_received == received_before + 2);
+    assert(last_data_size == sizeof(borrowed));
+    assert(memcmp(last_data, borrowed, sizeof(borrowed)) == 0);
+    assert(released == 0);
+
+    // The next payload of the same originator supersedes the borrowed one.
+    assert(pittacus_gossip_send_data(node, borrowed, sizeof(borrowed)) == 0);
+    assert(released == 1);
+    exchange_messages(seed, node);
+    assert(data_received == received_before + 3);
+
+    // The buffer is released even if it wasn't accepted.
+    uint8_t too_large[MESSAGE_MAX_SIZE];
+    assert(pittacus_gossip_send_data_borrowed(node, too_large, sizeof(too_large),
+                                              &test_data_release, &released) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+    assert(released == 2);
+    assert(pittacus_gossip_send_data(node, too_large, sizeof(too_large)) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+
+    assert(pittacus_gossip_send_data_borrowed(node, borrowed, sizeof(borrowed),
+                                              &test_data_release, &released) == 0);
+    pittacus_gossip_destroy(node);
+    assert(released == 3);
+    pittacus_gossip_destroy(seed);
+}
+
+void test_gossip_priorities() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node = create_test_node(&node_addr_in);
+    join_test_pair(seed, &seed_addr_in, node);
+
+    uint8_t bulk[] = { 0x01 };
+    uint8_t urgent[] = { 0x02 };
+    assert(pittacus_gossip_send_data(node, bulk, sizeof(bulk)) == 0);
+    assert(pittacus_gossip_send_data_priority(node, urgent, sizeof(urgent), PRIORITY_CONTROL) == 0);
+    assert(pittacus_gossip_send_data_priority(node, urgent, sizeof(urgent),
+                                              (pittacus_priority_t) PITTACUS_PRIORITIES) ==
+           PITTACUS_ERR_INVALID_ARGUMENT);
+
+    pittacus_gossip_stats_t stats;
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    // Announcements of the broadcast tree stay in the data lane.
+    assert(stats.outbound_lane_sizes[PRIORITY_CONTROL] == 1);
+    assert(stats.outbound_lane_sizes[PRIORITY_DATA] >= 1);
+    assert(stats.outbound_queue_size ==
+           stats.outbound_lane_sizes[PRIORITY_CONTROL] + stats.outbound_lane_sizes[PRIORITY_DATA]);
+
+    // The payload with the higher priority overtakes the earlier one.
+    assert(pittacus_gossip_send_delay(node) == 0);
+    int received_before = data_received;
+    assert(pittacus_gossip_process_send(node) >= 2);
+    // Until the payloads are acknowledged the node waits for the retry.
+    int64_t send_delay = pittacus_gossip_send_delay(node);
+    assert(send_delay > 0 && send_delay <= MESSAGE_RETRY_INTERVAL * 1000LL);
+    assert(pittacus_gossip_process_receive(seed) == 0);
+    assert(data_received == received_before + 1);
+    assert(last_data[0] == urgent[0]);
+
+    pittacus_gossip_destroy(node);
+    pittacus_gossip_destroy(seed);
+}
+
+static void test_writable_callback(void *context, pittacus_gossip_t *gossip) {
+    ++*(int *) context;
+}
+
+void test_gossip_backpressure() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node = create_test_node(&node_addr_in);
+    join_test_pair(seed, &seed_addr_in, node);
+
+    int writable = 0;
+    pittacus_gossip_set_writable_callback(node, &test_writable_callback, &writable);
+
+    // Payloads are rejected once the queue reaches the high watermark.
+    uint8_t data[] = { 0x01 };
+    int result = 0;
+    int sent = 0;
+    while (sent <= MAX_OUTPUT_MESSAGES && (result = pittacus_gossip_send_data(node, data, sizeof(data))) == 0) {
+        ++sent;
+    }
+    assert(result == PITTACUS_ERR_WOULD_BLOCK);
+    assert(sent > 0 && sent <= OUTBOUND_HIGH_WATERMARK);
+
+    int released = 0;
+    assert(pittacus_gossip_send_data_borrowed(node, data, sizeof(data),
+                                              &test_data_release, &released) == PITTACUS_ERR_WOULD_BLOCK);
+    assert(released == 1);
+
+    pittacus_gossip_stats_t stats;
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.sends_blocked == 2);
+
+    // The callback fires once the acknowledgements drain the queue.
+    assert(writable == 0);
+    exchange_messages(seed, node);
+    assert(writable == 1);
+    assert(pittacus_gossip_send_data(node, data, sizeof(data)) == 0);
+    exchange_messages(seed, node);
+    assert(writable == 1);
+
+    pittacus_gossip_destroy(node);
+    pittacus_gossip_destroy(seed);
+}
+
+void test_gossip_retransmission() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node = create_test_node(&node_addr_in);
+    pittacus_addr_t seed_addr = join_test_pair(seed, &seed_addr_in, node);
+
+    uint8_t data[] = { 0x01 };
+    assert(pittacus_gossip_send_data(node, data, sizeof(data)) == 0);
+    exchange_messages(seed, node);
+
+    // The acknowledgement of the payload has been sampled.
+    pittacus_peer_stats_t peer_stats;
+    assert(pittacus_gossip_peer_stats(node, &seed_addr, &peer_stats) == 0);
+    assert(peer_stats.rtt_samples >= 1);
+    assert(peer_stats.rto_us >= MESSAGE_RETRY_TIMEOUT_MIN * 1000ULL);
+    assert(peer_stats.rto_us < MESSAGE_RETRY_TIMEOUT_INITIAL * 1000ULL);
+
+    pittacus_addr_t unknown_addr = {
+        .addr = (const pt_sockaddr *) &node_addr_in,
+        .addr_len = sizeof(struct sockaddr_in)
+    };
+    assert(pittacus_gossip_peer_stats(node, &unknown_addr, &peer_stats) == PITTACUS_ERR_NOT_FOUND);
+
+    // The lost datagram is retransmitted as soon as the timeout derived from the round trip time expires.
+    pittacus_gossip_stats_t stats;
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    uint64_t retries_before = stats.retries;
+    int received_before = data_received;
+    data[0] = 0x02;
+    assert(pittacus_gossip_send_data(node, data, sizeof(data)) == 0);
+    assert(pittacus_gossip_process_send(node) >= 1);
+    uint8_t lost[MESSAGE_MAX_SIZE];
+    while (recv(pittacus_gossip_socket_fd(seed), lost, sizeof(lost), MSG_DONTWAIT) > 0);
+
+    int64_t send_delay = pittacus_gossip_send_delay(node);
+    assert(send_delay > 0 && send_delay < MESSAGE_RETRY_TIMEOUT_INITIAL * 1000LL);
+    advance_clock(send_delay);
+    exchange_messages(seed, node);
+    assert(data_received == received_before + 1);
+    assert(last_data[0] == 0x02);
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.retries == retries_before + 1);
+
+    pittacus_gossip_destroy(node);
+    pittacus_gossip_destroy(seed);
+}
+
+void test_gossip_coordinates() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node = create_test_node(&node_addr_in);
+    pittacus_addr_t seed_addr = join_test_pair(seed, &seed_addr_in, node);
+
+    uint64_t rtt_us = 0;
+    assert(pittacus_gossip_estimate_rtt(node, &seed_addr, &rtt_us) == PITTACUS_ERR_NOT_FOUND);
+
+    // The seed's coordinate arrives with its Status message.
+    assert(pittacus_gossip_tick(seed) > 0);
+    exchange_messages(seed, node);
+    assert(pittacus_gossip_estimate_rtt(node, &seed_addr, &rtt_us) == 0);
+    assert(rtt_us > 0);
+
+    // The node's coordinate comes back with the acknowledgement of the Status.
+    pittacus_addr_t node_addr = {
+        .addr = (const pt_sockaddr *) &node_addr_in,
+        .addr_len = sizeof(struct sockaddr_in)
+    };
+    assert(pittacus_gossip_estimate_rtt(seed, &node_addr, &rtt_us) == 0);
+    assert(rtt_us > 0);
+
+    pittacus_gossip_destroy(node);
+    pittacus_gossip_destroy(seed);
+}
+
+void test_gossip_zones() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node = create_test_node(&node_addr_in);
+
+    // The seed is the bridge of its zone.
+    assert(pittacus_gossip_set_zone(seed, 1, 1) == 0);
+    assert(pittacus_gossip_set_zone(node, CLUSTER_MEMBER_ZONE_UNKNOWN, 0) == PITTACUS_ERR_INVALID_ARGUMENT);
+    assert(pittacus_gossip_set_zone(node, 2, 0) == 0);
+
+    join_test_pair(seed, &seed_addr_in, node);
+    assert(pittacus_gossip_set_zone(node, 3, 0) == PITTACUS_ERR_BAD_STATE);
+
+    // Nobody else is in the seed's zone, so the regular round goes to the node as well
+    // as the round of the bridge.
+    assert(pittacus_gossip_tick(seed) > 0);
+    exchange_messages(seed, node);
+    pittacus_gossip_stats_t stats;
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_STATUS_TYPE] == 2);
+
+    // The node isn't a bridge.
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    uint64_t status_sent = stats.messages_sent[MESSAGE_STATUS_TYPE];
+    assert(pittacus_gossip_tick(node) > 0);
+    exchange_messages(seed, node);
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_STATUS_TYPE] == status_sent + 1);
+
+    pittacus_gossip_destroy(node);
+    pittacus_gossip_destroy(seed);
+}
+
+void test_gossip_member_log() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node = create_test_node(&node_addr_in);
+    join_test_pair(seed, &seed_addr_in, node);
+
+    // The seed has logged the join of the node. Its Status reveals the newer log
+    // version, and the node requests the changes it hasn't seen yet.
+    assert(pittacus_gossip_tick(seed) > 0);
+    exchange_messages(seed, node);
+    pittacus_gossip_stats_t stats;
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_MEMBER_LOG_TYPE] == 1);
+    assert(stats.member_log_events_sent == 1);
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.messages_received[MESSAGE_MEMBER_LOG_TYPE] == 1);
+    assert(stats.members_num == 1);
+
+    // The node is up to date now. Another round doesn't resend the log.
+    assert(pittacus_gossip_tick(seed) > 0);
+    exchange_messages(seed, node);
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_MEMBER_LOG_TYPE] == 1);
+
+    pittacus_gossip_destroy(node);
+    pittacus_gossip_destroy(seed);
+}
+
+void test_gossip_member_log_overflow() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node = create_test_node(&node_addr_in);
+    join_test_pair(seed, &seed_addr_in, node);
+
+    // More members join than the log of the seed can hold.
+    struct sockaddr_in newcomer_addr_in;
+    pittacus_gossip_t *newcomers[MEMBER_LOG_SIZE + 1];
+    for (int i = 0; i < MEMBER_LOG_SIZE + 1; ++i) {
+        newcomers[i] = create_test_node(&newcomer_addr_in);
+        join_test_pair(seed, &seed_addr_in, newcomers[i]);
+    }
+    pittacus_gossip_stats_t stats;
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    uint64_t member_lists_sent = stats.messages_sent[MESSAGE_MEMBER_LIST_TYPE];
+    uint64_t log_events_sent = stats.member_log_events_sent;
+
+    // The seed misses a payload of the node, so it answers the node's Status with its own.
+    uint8_t data[] = { 0x01 };
+    assert(pittacus_gossip_send_data(node, data, sizeof(data)) == 0);
+    assert(pittacus_gossip_process_send(node) >= 1);
+    uint8_t lost[MESSAGE_MAX_SIZE];
+    while (recv(pittacus_gossip_socket_fd(seed), lost, sizeof(lost), MSG_DONTWAIT) > 0);
+    assert(pittacus_gossip_tick(node) > 0);
+    exchange_messages(seed, node);
+
+    // The changes the node has requested are no longer in the log. The whole list
+    // of members is sent instead, followed by the latest version of the log.
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_MEMBER_LIST_TYPE] > member_lists_sent + 1);
+    assert(stats.member_log_events_sent == log_events_sent);
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.messages_received[MESSAGE_MEMBER_LOG_TYPE] == 1);
+    assert(stats.members_num == MEMBER_LOG_SIZE + 2);
+
+    // The node is up to date now and doesn't request the log again.
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    member_lists_sent = stats.messages_sent[MESSAGE_MEMBER_LIST_TYPE];
+    advance_clock(GOSSIP_TICK_INTERVAL_MAX * 1000ULL);
+    assert(pittacus_gossip_tick(node) > 0);
+    exchange_messages(seed, node);
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_MEMBER_LIST_TYPE] == member_lists_sent);
+    assert(stats.messages_sent[MESSAGE_MEMBER_LOG_TYPE] == 1);
+
+    for (int i = 0; i < MEMBER_LOG_SIZE + 1; ++i) pittacus_gossip_destroy(newcomers[i]);
+    pittacus_gossip_destroy(node);
+    pittacus_gossip_destroy(seed);
+}
+
+void test_gossip_adaptive_interval() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node = create_test_node(&node_addr_in);
+    join_test_pair(seed, &seed_addr_in, node);
+
+    // The interval doubles after each round in which nothing has changed.
+    pittacus_gossip_stats_t stats;
+    uint32_t expected_interval = GOSSIP_TICK_INTERVAL;
+    while (expected_interval < GOSSIP_TICK_INTERVAL_MAX) {
+        assert(pittacus_gossip_tick(seed) > 0);
+        assert(pittacus_gossip_tick(node) > 0);
+        exchange_messages(seed, node);
+        expected_interval *= 2;
+        assert(pittacus_gossip_stats(seed, &stats) == 0);
+        assert(stats.tick_interval == expected_interval);
+        assert(pittacus_gossip_stats(node, &stats) == 0);
+        assert(stats.tick_interval == expected_interval);
+        advance_clock(expected_interval * 1000ULL);
+    }
+
+    // Payloads that arrive by rumors don't make the nodes diverge.
+    uint8_t data[] = { 0x01 };
+    int received_before = data_received;
+    assert(pittacus_gossip_send_data(seed, data, sizeof(data)) == 0);
+    exchange_messages(seed, node);
+    assert(data_received == received_before + 1);
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.tick_interval == GOSSIP_TICK_INTERVAL_MAX);
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.tick_interval == GOSSIP_TICK_INTERVAL_MAX);
+
+    // The node misses a payload. The Status of the seed reveals it and the interval
+    // of the node drops back to the minimum.
+    data[0] = 0x02;
+    assert(pittacus_gossip_send_data(seed, data, sizeof(data)) == 0);
+    assert(pittacus_gossip_process_send(seed) >= 1);
+    uint8_t lost[MESSAGE_MAX_SIZE];
+    while (recv(pittacus_gossip_socket_fd(node), lost, sizeof(lost), MSG_DONTWAIT) > 0);
+    assert(pittacus_gossip_tick(seed) > 0);
+    exchange_messages(seed, node);
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.tick_interval == GOSSIP_TICK_INTERVAL_MIN);
+    assert(data_received == received_before + 2);
+
+    pittacus_gossip_destroy(node);
+    pittacus_gossip_destroy(seed);
+}
+
+void test_gossip_relay_suppression() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node_addr_in;
+    struct sockaddr_in peer_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node = create_test_node(&node_addr_in);
+    pittacus_gossip_t *peer = create_test_node(&peer_addr_in);
+    join_test_pair(seed, &seed_addr_in, node);
+    join_test_pair(seed, &seed_addr_in, peer);
+    exchange_messages(node, peer);
+
+    // Capture the datagrams of the node that carry the payload. The peer misses them.
+    uint8_t data[] = { 0x01 };
+    assert(pittacus_gossip_send_data(node, data, sizeof(data)) == 0);
+    assert(pittacus_gossip_process_send(node) >= 1);
+    uint8_t lost[MESSAGE_MAX_SIZE];
+    while (recv(pittacus_gossip_socket_fd(peer), lost, sizeof(lost), MSG_DONTWAIT) > 0);
+    captured_datagrams_t datagrams;
+    capture_datagrams(seed, &datagrams);
+
+    // The seed postpones the relay of the first copy to the peer.
+    pittacus_gossip_stats_t stats;
+    int received_before = data_received;
+    replay_datagrams(&datagrams, -1, node, seed, &seed_addr_in);
+    assert(data_received == received_before + 1);
+    assert(pittacus_gossip_process_send(seed) >= 0);
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_DATA_TYPE] == 0);
+    assert(stats.outbound_queue_size > 0);
+
+    // A duplicate arrives before the relay is due and cancels it.
+    replay_datagrams(&datagrams, -1, node, seed, &seed_addr_in);
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.relays_suppressed == 1);
+
+    // Nothing is relayed once the delay has passed. The peer is left to the anti-entropy.
+    advance_clock(DATA_RELAY_DELAY * 1000ULL + 1);
+    assert(pittacus_gossip_process_send(seed) >= 0);
+    while (pittacus_gossip_process_receive(peer) != PITTACUS_ERR_READ_FAILED);
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_DATA_TYPE] == 0);
+    assert(pittacus_gossip_stats(peer, &stats) == 0);
+    assert(stats.messages_received[MESSAGE_DATA_TYPE] == 0);
+
+    pittacus_gossip_destroy(peer);
+    pittacus_gossip_destroy(node);
+    pittacus_gossip_destroy(seed);
+}
+
+void test_broadcast_tree_prune() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node = create_test_node(&node_addr_in);
+    join_test_pair(seed, &seed_addr_in, node);
+
+    // The eager push of the node reaches the seed twice.
+    uint8_t data[] = { 0x01 };
+    int received_before = data_received;
+    assert(pittacus_gossip_send_data(node, data, sizeof(data)) == 0);
+    assert(pittacus_gossip_process_send(node) >= 1);
+    captured_datagrams_t datagrams;
+    capture_datagrams(seed, &datagrams);
+    replay_datagrams(&datagrams, -1, node, seed, &seed_addr_in);
+    replay_datagrams(&datagrams, -1, node, seed, &seed_addr_in);
+    exchange_messages(seed, node);
+    assert(data_received == received_before + 1);
+
+    // The duplicate prunes the link, so the next payload is only announced.
+    pittacus_gossip_stats_t stats;
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_PRUNE_TYPE] == 1);
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.messages_received[MESSAGE_PRUNE_TYPE] == 1);
+    uint64_t data_sent = stats.messages_sent[MESSAGE_DATA_TYPE];
+    uint64_t ihaves_sent = stats.messages_sent[MESSAGE_IHAVE_TYPE];
+
+    data[0] = 0x02;
+    assert(pittacus_gossip_send_data(node, data, sizeof(data)) == 0);
+    exchange_messages(seed, node);
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_DATA_TYPE] == data_sent);
+    assert(stats.messages_sent[MESSAGE_IHAVE_TYPE] == ihaves_sent + 1);
+    assert(data_received == received_before + 1);
+
+    pittacus_gossip_destroy(node);
+    pittacus_gossip_destroy(seed);
+}
+
+void test_broadcast_tree_graft() {
+    struct sockaddr_in seed_addr_in;
+    struct sockaddr_in node_addr_in;
+    pittacus_gossip_t *seed = create_test_node(&seed_addr_in);
+    pittacus_gossip_t *node = create_test_node(&node_addr_in);
+    join_test_pair(seed, &seed_addr_in, node);
+
+    // The eager push of the node is lost, but its announcement reaches the seed.
+    uint8_t data[] = { 0x01 };
+    int received_before = data_received;
+    assert(pittacus_gossip_send_data(node, data, sizeof(data)) == 0);
+    assert(pittacus_gossip_process_send(node) >= 1);
+    captured_datagrams_t datagrams;
+    capture_datagrams(seed, &datagrams);
+    replay_datagrams(&datagrams, MESSAGE_DATA_TYPE, node, seed, &seed_addr_in);
+    assert(data_received == received_before);
+
+    // The seed waits for the payload to arrive over the tree and then grafts the link to the announcer.
+    pittacus_gossip_stats_t stats;
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.messages_received[MESSAGE_IHAVE_TYPE] == 1);
+    assert(stats.messages_sent[MESSAGE_GRAFT_TYPE] == 0);
+    advance_clock(BROADCAST_TREE_GRAFT_TIMEOUT * 1000ULL);
+    assert(pittacus_gossip_tick(seed) >= 0);
+    assert(pittacus_gossip_process_send(seed) >= 1);
+    while (pittacus_gossip_process_receive(node) != PITTACUS_ERR_READ_FAILED);
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_GRAFT_TYPE] == 1);
+    assert(pittacus_gossip_stats(node, &stats) == 0);
+    assert(stats.messages_received[MESSAGE_GRAFT_TYPE] == 1);
+
+    // The node answers the graft with the payload.
+    exchange_messages(seed, node);
+    assert(data_received == received_before + 1);
+    assert(last_data_size == sizeof(data) && last_data[0] == data[0]);
+
+    // The repaired link carries the next payload eagerly.
+    data[0] = 0x02;
+    assert(pittacus_gossip_send_data(node, data, sizeof(data)) == 0);
+    exchange_messages(seed, node);
+    assert(data_received == received_before + 2);
+    assert(pittacus_gossip_stats(seed, &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_GRAFT_TYPE] == 1);
+
+    pittacus_gossip_destroy(node);
+    pittacus_gossip_destroy(seed);
+}
+
+#define PARTIAL_VIEW_CLUSTER_SIZE (ACTIVE_VIEW_SIZE + 3)
+
+static void exchange_cluster_messages(pittacus_gossip_t **nodes, int nodes_n) {
+    // Random walks take several hops, so there are more rounds than for a pair of nodes.
+    for (int i = 0; i < 2 * ACTIVE_RANDOM_WALK_LENGTH; ++i) {
+        advance_clock(LOOPBACK_LATENCY_US);
+        for (int n = 0; n < nodes_n; ++n) {
+            if (nodes[n] != NULL) assert(pittacus_gossip_process_send(nodes[n]) >= 0);
+        }
+        for (int n = 0; n < nodes_n; ++n) {
+            if (nodes[n] != NULL) while (pittacus_gossip_process_receive(nodes[n]) != PITTACUS_ERR_READ_FAILED);
+        }
+    }
+}
+
+static void add_partial_view_node(pittacus_gossip_t **nodes, struct sockaddr_in *addrs, int idx) {
+    nodes[idx] = create_test_node(&addrs[idx]);
+    if (idx == 0) {
+        assert(pittacus_gossip_join(nodes[idx], NULL, 0) == 0);
+        return;
+    }
+    pittacus_addr_t seed_addr = {
+        .addr = (const pt_sockaddr *) &addrs[0],
+        .addr_len = sizeof(struct sockaddr_in)
+    };
+    assert(pittacus_gossip_join(nodes[idx], &seed_addr, 1) == 0);
+    exchange_cluster_messages(nodes, idx + 1);
+    assert(pittacus_gossip_state(nodes[idx]) == STATE_CONNECTED);
+}
+
+static void create_partial_view_cluster(pittacus_gossip_t **nodes, struct sockaddr_in *addrs) {
+    for (int i = 0; i < PARTIAL_VIEW_CLUSTER_SIZE; ++i) add_partial_view_node(nodes, addrs, i);
+}
+
+static void validate_partial_views(pittacus_gossip_t **nodes, int nodes_n) {
+    pittacus_gossip_stats_t stats;
+    for (int n = 0; n < nodes_n; ++n) {
+        if (nodes[n] == NULL) continue;
+        assert(pittacus_gossip_stats(nodes[n], &stats) == 0);
+        assert(stats.members_num > 0 && stats.members_num <= ACTIVE_VIEW_SIZE);
+        assert(stats.passive_members_num <= PASSIVE_VIEW_SIZE);
+    }
+}
+
+static uint64_t cluster_messages_sent(pittacus_gossip_t **nodes, int nodes_n, uint8_t message_type) {
+    uint64_t result = 0;
+    pittacus_gossip_stats_t stats;
+    for (int n = 0; n < nodes_n; ++n) {
+        if (nodes[n] == NULL) continue;
+        assert(pittacus_gossip_stats(nodes[n], &stats) == 0);
+        result += stats.messages_sent[message_type];
+    }
+    return result;
+}
+
+static void destroy_cluster(pittacus_gossip_t **nodes, int nodes_n) {
+    for (int n = 0; n < nodes_n; ++n) {
+        if (nodes[n] != NULL) pittacus_gossip_destroy(nodes[n]);
+    }
+}
+
+void test_partial_view_join() {
+    struct sockaddr_in addrs[PARTIAL_VIEW_CLUSTER_SIZE];
+    pittacus_gossip_t *nodes[PARTIAL_VIEW_CLUSTER_SIZE];
+    for (int i = 0; i < 3; ++i) add_partial_view_node(nodes, addrs, i);
+
+    // The seed has a single neighbour when the third node joins. The walk ends there,
+    // since that neighbour has nobody else to forward the newcomer to.
+    pittacus_gossip_stats_t stats;
+    assert(pittacus_gossip_stats(nodes[0], &stats) == 0);
+    assert(stats.messages_sent[MESSAGE_FORWARD_JOIN_TYPE] == 1);
+    assert(pittacus_gossip_stats(nodes[1], &stats) == 0);
+    assert(stats.messages_received[MESSAGE_FORWARD_JOIN_TYPE] == 1);
+    assert(stats.messages_sent[MESSAGE_FORWARD_JOIN_TYPE] == 0);
+    assert(stats.messages_sent[MESSAGE_NEIGHBOR_TYPE] == 1);
+    for (int i = 0; i < 3; ++i) {
+        assert(pittacus_gossip_stats(nodes[i], &stats) == 0);
+        assert(stats.members_num == 2);
+    }
+
+    for (int i = 3; i < PARTIAL_VIEW_CLUSTER_SIZE; ++i) add_partial_view_node(nodes, addrs, i);
+
+    // Views stay within their bounds, and every walk has ended within its length.
+    validate_partial_views(nodes, PARTIAL_VIEW_CLUSTER_SIZE);
+    uint64_t forward_joins = cluster_messages_sent(nodes, PARTIAL_VIEW_CLUSTER_SIZE, MESSAGE_FORWARD_JOIN_TYPE);
+    assert(forward_joins > 0);
+    assert(forward_joins <= (PARTIAL_VIEW_CLUSTER_SIZE - 1) * ACTIVE_VIEW_SIZE * ACTIVE_RANDOM_WALK_LENGTH);
+    for (int n = 0; n < PARTIAL_VIEW_CLUSTER_SIZE; ++n) {
+        assert(pittacus_gossip_stats(nodes[n], &stats) == 0);
+        assert(stats.outbound_queue_size == 0);
+    }
+
+    // The seed doesn't keep every newcomer as a neighbour.
+    assert(pittacus_gossip_stats(nodes[0], &stats) == 0);
+    assert(stats.members_num == ACTIVE_VIEW_SIZE);
+    assert(stats.messages_sent[MESSAGE_DISCONNECT_TYPE] > 0);
+
+    destroy_cluster(nodes, PARTIAL_VIEW_CLUSTER_SIZE);
+}
+
+void test_partial_view_shuffle() {
+    struct sockaddr_in addrs[PARTIAL_VIEW_CLUSTER_SIZE];
+    pittacus_gossip_t *nodes[PARTIAL_VIEW_CLUSTER_SIZE];
+    create_partial_view_cluster(nodes, addrs);
+
+    uint64_t member_lists_sent = cluster_messages_sent(nodes, PARTIAL_VIEW_CLUSTER_SIZE, MESSAGE_MEMBER_LIST_TYPE);
+    advance_clock(SHUFFLE_INTERVAL * 1000ULL);
+    for (int n = 0; n < PARTIAL_VIEW_CLUSTER_SIZE; ++n) assert(pittacus_gossip_tick(nodes[n]) > 0);
+    exchange_cluster_messages(nodes, PARTIAL_VIEW_CLUSTER_SIZE);
+
+    // Each node starts a walk. A walk is forwarded at most PASSIVE_RANDOM_WALK_LENGTH - 1 times,
+    // and the node where it ends replies to the origin with a sample of its passive view.
+    pittacus_gossip_stats_t stats;
+    uint64_t shuffles_received = 0;
+    for (int n = 0; n < PARTIAL_VIEW_CLUSTER_SIZE; ++n) {
+        assert(pittacus_gossip_stats(nodes[n], &stats) == 0);
+        assert(stats.messages_sent[MESSAGE_SHUFFLE_TYPE] >= 1);
+        shuffles_received += stats.messages_received[MESSAGE_SHUFFLE_TYPE];
+    }
+    assert(shuffles_received >= PARTIAL_VIEW_CLUSTER_SIZE);
+    assert(shuffles_received <= PARTIAL_VIEW_CLUSTER_SIZE * PASSIVE_RANDOM_WALK_LENGTH);
+    assert(cluster_messages_sent(nodes, PARTIAL_VIEW_CLUSTER_SIZE, MESSAGE_MEMBER_LIST_TYPE) > member_lists_sent);
+    validate_partial_views(nodes, PARTIAL_VIEW_CLUSTER_SIZE);
+
+    destroy_cluster(nodes, PARTIAL_VIEW_CLUSTER_SIZE);
+}
+
+void test_partial_view_failure() {
+    struct sockaddr_in addrs[PARTIAL_VIEW_CLUSTER_SIZE];
+    pittacus_gossip_t *nodes[PARTIAL_VIEW_CLUSTER_SIZE];
+    create_partial_view_cluster(nodes, addrs);
+
+    // One of the active members of the seed fails. The seed has passive members as well.
+    pittacus_addr_t failed_addr = {
+        .addr = NULL,
+        .addr_len = sizeof(struct sockaddr_in)
+    };
+    pittacus_peer_stats_t peer_stats;
+    int failed = 1;
+    for (; failed < PARTIAL_VIEW_CLUSTER_SIZE; ++failed) {
+        failed_addr.addr = (const pt_sockaddr *) &addrs[failed];
+        if (pittacus_gossip_peer_stats(nodes[0], &failed_addr, &peer_stats) == 0) break;
+    }
+    assert(failed < PARTIAL_VIEW_CLUSTER_SIZE);
+    pittacus_gossip_stats_t stats;
+    assert(pittacus_gossip_stats(nodes[0], &stats) == 0);
+    assert(stats.passive_members_num > 0);
+    uint64_t promoted_before = stats.members_promoted;
+
+    pittacus_gossip_destroy(nodes[failed]);
+    nodes[failed] = NULL;
+
+    // Every neighbour probes the failed member within a round over its active view
+    // and removes it once the suspicion times out.
+    int rounds = 2 * ACTIVE_VIEW_SIZE + MEMBER_SUSPECT_TIMEOUT / PROBE_INTERVAL + 2;
+    for (int i = 0; i < rounds; ++i) {
+        advance_clock(PROBE_INTERVAL * 1000ULL);
+        for (int n = 0; n < PARTIAL_VIEW_CLUSTER_SIZE; ++n) {
+            if (nodes[n] != NULL) assert(pittacus_gossip_tick(nodes[n]) >= 0);
+        }
+        exchange_cluster_messages(nodes, PARTIAL_VIEW_CLUSTER_SIZE);
+    }
+
+    // The seed has replaced the failed member with one of its passive members.
+    assert(pittacus_gossip_stats(nodes[0], &stats) == 0);
+    assert(stats.members_removed >= 1);
+    assert(stats.members_promoted > promoted_before);
+    assert(stats.members_num == ACTIVE_VIEW_SIZE);
+    for (int n = 0; n < PARTIAL_VIEW_CLUSTER_SIZE; ++n) {
+        if (nodes[n] == NULL) continue;
+        assert(pittacus_gossip_peer_stats(nodes[n], &failed_addr, &peer_stats) == PITTACUS_ERR_NOT_FOUND);
+    }
+    validate_partial_views(nodes, PARTIAL_VIEW_CLUSTER_SIZE);
+
+    destroy_cluster(nodes, PARTIAL_VIEW_CLUSTER_SIZE);
+}
+
+int main() {
+    test_gossip_stats();
+    test_gossip_probe();
+    // With partial views a newcomer is announced by random walks instead of join events.
+    if (!GOSSIP_PARTIAL_VIEW) test_gossip_join_event();
+    // Over the broadcast tree large payloads are pushed to the tree neighbours as well.
+    if (DATA_LAZY_PUSH_THRESHOLD > 0 && !GOSSIP_BROADCAST_TREE) test_gossip_lazy_push();
+    test_gossip_send_datav();
+    test_gossip_priorities();
+    test_gossip_backpressure();
+    test_gossip_retransmission();
+    if (GOSSIP_COORDINATES) test_gossip_coordinates();
+    test_gossip_zones();
+    // Joins are logged only when each node knows the whole cluster.
+    if (GOSSIP_MEMBER_LOG && !GOSSIP_PARTIAL_VIEW) test_gossip_member_log();
+    if (GOSSIP_MEMBER_LOG && !GOSSIP_PARTIAL_VIEW) test_gossip_member_log_overflow();
+    if (GOSSIP_ADAPTIVE) test_gossip_adaptive_interval();
+    if (DATA_RELAY_DUPLICATES == 1 && !GOSSIP_BROADCAST_TREE) test_gossip_relay_suppression();
+    if (GOSSIP_BROADCAST_TREE) {
+        test_broadcast_tree_prune();
+        test_broadcast_tree_graft();
+    }
+    if (GOSSIP_PARTIAL_VIEW) {
+        test_partial_view_join();
+        test_partial_view_shuffle();
+        test_partial_view_failure();
+    }
+    return 0;
+}
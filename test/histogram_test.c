@@ -0,0 +1,101 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "histogram.h"
+#include <assert.h>
+#include <stdlib.h>
+
+void test_histogram_record() {
+    pittacus_histogram_t histogram;
+    pittacus_histogram_init(&histogram);
+    assert(histogram.count == 0);
+    assert(pittacus_histogram_percentile(&histogram, 50.0) == 0);
+    assert(pittacus_histogram_mean(&histogram) == 0.0);
+
+    // Small values are stored exactly.
+    for (uint64_t i = 0; i < PITTACUS_HISTOGRAM_SUB_BUCKETS; ++i) {
+        pittacus_histogram_record(&histogram, i);
+    }
+    assert(histogram.count == PITTACUS_HISTOGRAM_SUB_BUCKETS);
+    assert(histogram.min == 0);
+    assert(histogram.max == PITTACUS_HISTOGRAM_SUB_BUCKETS - 1);
+    assert(pittacus_histogram_percentile(&histogram, 0.0) == 0);
+    assert(pittacus_histogram_percentile(&histogram, 50.0) == 3);
+    assert(pittacus_histogram_percentile(&histogram, 100.0) == PITTACUS_HISTOGRAM_SUB_BUCKETS - 1);
+    assert(pittacus_histogram_mean(&histogram) == 3.5);
+}
+
+void test_histogram_precision() {
+    pittacus_histogram_t histogram;
+    uint64_t values[] = { 9, 100, 1000, 12345, 1000000, 123456789, 1ULL << 40 };
+    for (int i = 0; i < sizeof(values) / sizeof(uint64_t); ++i) {
+        pittacus_histogram_init(&histogram);
+        pittacus_histogram_record(&histogram, values[i]);
+        pittacus_histogram_record(&histogram, values[i] * 2);
+        uint64_t estimate = pittacus_histogram_percentile(&histogram, 50.0);
+        assert(estimate >= values[i]);
+        assert(estimate - values[i] <= values[i] / PITTACUS_HISTOGRAM_SUB_BUCKETS);
+        assert(pittacus_histogram_percentile(&histogram, 100.0) == values[i] * 2);
+    }
+
+    // Huge values end up in the last bucket.
+    pittacus_histogram_init(&histogram);
+    pittacus_histogram_record(&histogram, UINT64_MAX);
+    assert(pittacus_histogram_percentile(&histogram, 99.0) == UINT64_MAX);
+}
+
+void test_histogram_percentiles() {
+    pittacus_histogram_t histogram;
+    pittacus_histogram_init(&histogram);
+    for (uint64_t i = 1; i <= 1000; ++i) {
+        pittacus_histogram_record(&histogram, i);
+    }
+    uint64_t p50 = pittacus_histogram_percentile(&histogram, 50.0);
+    uint64_t p99 = pittacus_histogram_percentile(&histogram, 99.0);
+    assert(p50 >= 500 && p50 <= 500 + 500 / PITTACUS_HISTOGRAM_SUB_BUCKETS);
+    assert(p99 >= 990 && p99 <= 1000);
+    assert(pittacus_histogram_mean(&histogram) == 500.5);
+}
+
+void test_histogram_merge_copy() {
+    pittacus_histogram_t histogram1;
+    pittacus_histogram_t histogram2;
+    pittacus_histogram_init(&histogram1);
+    pittacus_histogram_init(&histogram2);
+    pittacus_histogram_record(&histogram1, 10);
+    pittacus_histogram_record(&histogram2, 1000);
+    pittacus_histogram_record(&histogram2, 2000);
+
+    pittacus_histogram_merge(&histogram1, &histogram2);
+    assert(histogram1.count == 3);
+    assert(histogram1.sum == 3010);
+    assert(histogram1.min == 10);
+    assert(histogram1.max == 2000);
+
+    pittacus_histogram_t copy;
+    pittacus_histogram_copy(&copy, &histogram1);
+    assert(copy.count == 3);
+    assert(copy.min == 10);
+    assert(pittacus_histogram_percentile(&copy, 100.0) == 2000);
+    assert(pittacus_histogram_percentile(&copy, 10.0) == 10);
+}
+
+int main() {
+    test_histogram_record();
+    test_histogram_precision();
+    test_histogram_percentiles();
+    test_histogram_merge_copy();
+    return 0;
+}
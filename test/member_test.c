@@ -14,10 +14,13 @@
  * limitations under the License.
  */
 #include "member.h"
+#include "errors.h"
 #include "test_utils.h"
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include <utils.h>
+#include <errors.h>
 
 void test_cluster_member_equals() {
     cluster_member_t member1;
@@ -168,10 +171,188 @@ void test_cluster_member_set_random_members() {
     cluster_member_set_destroy(&set);
 }
 
+void test_cluster_member_set_nearby_members() {
+    cluster_member_set_t set;
+    assert(cluster_member_set_init(&set) == 0);
+
+    uint16_t base_port = 1000;
+    size_t members_size = 10;
+    size_t near_size = 3;
+    cluster_member_t members[members_size];
+    for (int i = 0; i < members_size; ++i) {
+        assert(create_test_member(base_port + i, &members[i]) == 0);
+        assert(cluster_member_set_put(&set, &members[i], 1) == 0);
+    }
+    // The first members are 100 times closer than the rest.
+    for (int i = 0; i < members_size; ++i) {
+        cluster_member_t *member = set.set[i];
+        member->rtt = (rtt_estimator_t *) malloc(sizeof(rtt_estimator_t));
+        rtt_estimator_init(member->rtt);
+        rtt_estimator_sample(member->rtt, i < near_size ? 1000 : 100000);
+    }
+
+    size_t nearby_size = 2;
+    cluster_member_t *nearby[nearby_size];
+    int near_chosen = 0;
+    for (int round = 0; round < 1000; ++round) {
+        assert(cluster_member_set_nearby_members(&set, nearby, nearby_size, 0, NULL) == nearby_size);
+        assert(nearby[0] != nearby[1]);
+        for (int i = 0; i < nearby_size; ++i) {
+            assert(cluster_member_set_find_by_addr(&set, nearby[i]->address, nearby[i]->address_len) == nearby[i]);
+            if (nearby[i]->rtt->srtt_us == 1000) ++near_chosen;
+        }
+    }
+    assert(near_chosen > 1800);
+
+    // Uniformly chosen members mostly belong to the distant majority.
+    near_chosen = 0;
+    for (int round = 0; round < 1000; ++round) {
+        assert(cluster_member_set_nearby_members(&set, nearby, nearby_size, 100, NULL) == nearby_size);
+        assert(nearby[0] != nearby[1]);
+        for (int i = 0; i < nearby_size; ++i) {
+            if (nearby[i]->rtt->srtt_us == 1000) ++near_chosen;
+        }
+    }
+    assert(near_chosen < 1000);
+
+    size_t all_size = 15;
+    cluster_member_t *all[all_size];
+    assert(cluster_member_set_nearby_members(&set, all, all_size, 0, NULL) == members_size);
+
+    for (int i = 0; i < members_size; ++i) {
+        cluster_member_destroy(&members[i]);
+    }
+    cluster_member_set_destroy(&set);
+}
+
+void test_cluster_member_set_zone_members() {
+    cluster_member_set_t set;
+    assert(cluster_member_set_init(&set) == 0);
+
+    uint16_t base_port = 1000;
+    size_t members_size = 8;
+    cluster_member_t members[members_size];
+    for (int i = 0; i < members_size; ++i) {
+        assert(create_test_member(base_port + i, &members[i]) == 0);
+        // Two members per zone, the first of them is a bridge. The last zone is unknown.
+        members[i].zone = i < 6 ? i / 2 : CLUSTER_MEMBER_ZONE_UNKNOWN;
+        members[i].bridge = i % 2 == 0;
+        assert(cluster_member_set_put(&set, &members[i], 1) == 0);
+    }
+
+    cluster_member_t *chosen[members_size];
+    // Members with an unknown zone belong to every zone.
+    assert(cluster_member_set_zone_members(&set, chosen, members_size, 1, ZONE_LOCAL) == 4);
+    for (int i = 0; i < 4; ++i) assert(cluster_member_in_zone(chosen[i], 1));
+    assert(cluster_member_set_zone_members(&set, chosen, 1, 1, ZONE_LOCAL) == 1);
+    assert(cluster_member_in_zone(chosen[0], 1));
+
+    assert(cluster_member_set_zone_members(&set, chosen, members_size, 1, ZONE_REMOTE) == 4);
+    for (int i = 0; i < 4; ++i) assert(chosen[i]->zone == 0 || chosen[i]->zone == 2);
+    assert(cluster_member_set_zone_members(&set, chosen, members_size, 1, ZONE_REMOTE_BRIDGES) == 2);
+    for (int i = 0; i < 2; ++i) assert(chosen[i]->bridge && chosen[i]->zone != 1);
+
+    // A node without a zone has no remote members.
+    assert(cluster_member_set_zone_members(&set, chosen, members_size, CLUSTER_MEMBER_ZONE_UNKNOWN,
+                                           ZONE_REMOTE) == 0);
+
+    // A known member learns its zone from the later announcement.
+    cluster_member_t *unknown = cluster_member_set_find_by_addr(&set, members[7].address, members[7].address_len);
+    members[7].zone = 1;
+    assert(cluster_member_set_put(&set, &members[7], 1) == 0);
+    assert(set.size == members_size);
+    assert(unknown->zone == 1);
+
+    for (int i = 0; i < members_size; ++i) {
+        cluster_member_destroy(&members[i]);
+    }
+    cluster_member_set_destroy(&set);
+}
+
+void test_cluster_member_state_overrides() {
+    cluster_member_t member;
+    assert(create_test_member(12345, &member) == 0);
+    assert(member.state == MEMBER_ALIVE);
+    assert(member.incarnation == 0);
+
+    assert(!cluster_member_state_overrides(&member, MEMBER_ALIVE, 0));
+    assert(cluster_member_state_overrides(&member, MEMBER_SUSPECT, 0));
+    assert(cluster_member_state_overrides(&member, MEMBER_DEAD, 0));
+    assert(cluster_member_state_overrides(&member, MEMBER_ALIVE, 1));
+
+    member.state = MEMBER_SUSPECT;
+    member.incarnation = 1;
+    // Only a higher incarnation refutes the suspicion.
+    assert(!cluster_member_state_overrides(&member, MEMBER_ALIVE, 1));
+    assert(cluster_member_state_overrides(&member, MEMBER_ALIVE, 2));
+    assert(!cluster_member_state_overrides(&member, MEMBER_SUSPECT, 1));
+    assert(!cluster_member_state_overrides(&member, MEMBER_SUSPECT, 0));
+    assert(cluster_member_state_overrides(&member, MEMBER_DEAD, 1));
+    // Stale death notices are ignored.
+    assert(!cluster_member_state_overrides(&member, MEMBER_DEAD, 0));
+
+    cluster_member_destroy(&member);
+}
+
+static void validate_member_enc_dec(cluster_member_t *member, size_t expected_size) {
+    assert(cluster_member_encoded_size(member) == expected_size);
+
+    uint8_t buf[CLUSTER_MEMBER_SIZE];
+    assert(cluster_member_encode(member, buf, sizeof(buf)) == (int) expected_size);
+    assert(cluster_member_encode(member, buf, expected_size - 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+
+    cluster_member_t out_member;
+    pt_sockaddr_storage out_address;
+    assert(cluster_member_decode(buf, expected_size, &out_member, &out_address) == (int) expected_size);
+    assert(out_member.address == &out_address);
+    assert(cluster_member_equals(member, &out_member));
+    assert(cluster_member_decode(buf, expected_size - 1, &out_member, &out_address) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+}
+
+void test_cluster_member_enc_dec() {
+    cluster_member_t member;
+    assert(create_test_member(12345, &member) == 0);
+    validate_member_enc_dec(&member, CLUSTER_MEMBER_IPV4_SIZE);
+
+    // The rest of the address can't be restored from the address and the port.
+    ((pt_sockaddr_in *) member.address)->sin_zero[0] = 1;
+    validate_member_enc_dec(&member, CLUSTER_MEMBER_HEADER_SIZE + sizeof(uint8_t) + sizeof(pt_sockaddr_in));
+    cluster_member_destroy(&member);
+
+    pt_sockaddr_in6 in6;
+    memset(&in6, 0, sizeof(pt_sockaddr_in6));
+    in6.sin6_family = AF_INET6;
+    in6.sin6_port = PT_HTONS(12345);
+    in6.sin6_addr.s6_addr[15] = 1;
+    assert(cluster_member_init(&member, (const pt_sockaddr_storage *) &in6, sizeof(pt_sockaddr_in6)) == 0);
+    validate_member_enc_dec(&member, CLUSTER_MEMBER_IPV6_SIZE);
+    cluster_member_destroy(&member);
+
+    in6.sin6_scope_id = 2;
+    assert(cluster_member_init(&member, (const pt_sockaddr_storage *) &in6, sizeof(pt_sockaddr_in6)) == 0);
+    validate_member_enc_dec(&member, CLUSTER_MEMBER_HEADER_SIZE + sizeof(uint8_t) + sizeof(pt_sockaddr_in6));
+
+    // Unknown address families and oversized addresses are rejected.
+    uint8_t buf[CLUSTER_MEMBER_SIZE];
+    int encode_result = cluster_member_encode(&member, buf, sizeof(buf));
+    cluster_member_t out_member;
+    pt_sockaddr_storage out_address;
+    buf[CLUSTER_MEMBER_HEADER_SIZE - 1] = 0x05;
+    assert(cluster_member_decode(buf, encode_result, &out_member, &out_address) == PITTACUS_ERR_INVALID_MESSAGE);
+    buf[CLUSTER_MEMBER_HEADER_SIZE - 1] = 0x00;
+    buf[CLUSTER_MEMBER_HEADER_SIZE] = sizeof(pt_sockaddr_storage) + 1;
+    assert(cluster_member_decode(buf, sizeof(buf), &out_member, &out_address) == PITTACUS_ERR_INVALID_MESSAGE);
+    cluster_member_destroy(&member);
+}
+
 int main() {
     test_cluster_member_equals();
+    test_cluster_member_enc_dec();
+    test_cluster_member_state_overrides();
     test_cluster_member_set_put_remove();
     test_cluster_member_set_extension();
     test_cluster_member_set_random_members();
+    test_cluster_member_set_nearby_members();
+    test_cluster_member_set_zone_members();
     return 0;
 }
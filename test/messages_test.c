@@ -17,14 +17,16 @@
 #include "member.h"
 #include "network.h"
 #include "errors.h"
+#include "utils.h"
 #include "test_utils.h"
 #include <assert.h>
 #include <string.h>
 #include <stdint.h>
 
 void validate_headers(const message_header_t *expected, const message_header_t *actual) {
-    assert(strcmp(expected->protocol_id, actual->protocol_id) == 0);
+    assert(memcmp(expected->protocol_id, actual->protocol_id, PROTOCOL_ID_LENGTH) == 0);
     assert(expected->message_type == actual->message_type);
+    assert(expected->flags == actual->flags);
     assert(expected->sequence_num == actual->sequence_num);
 }
 
@@ -33,7 +35,8 @@ void test_message_header() {
     message_header_init(&header, MESSAGE_ACK_TYPE, 1);
     assert(header.message_type == MESSAGE_ACK_TYPE);
     assert(header.sequence_num == 1);
-    assert(strcmp(header.protocol_id, "ptcs") == 0);
+    assert(memcmp(header.protocol_id, "ptcs", PROTOCOL_ID_LENGTH - 1) == 0);
+    assert(header.protocol_id[PROTOCOL_ID_LENGTH - 1] == PROTOCOL_VERSION);
 }
 
 void test_message_hello_enc_dec() {
@@ -60,6 +63,23 @@ void test_message_hello_enc_dec() {
     assert(message_hello_encode(&msg, buf, 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
     assert(message_hello_decode(buf, 12, &out_msg) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
 
+    // The zone label follows the member.
+    msg.header.flags |= MESSAGE_FLAG_ZONES;
+    member.zone = 3;
+    member.bridge = 1;
+    int zone_encode_result = message_hello_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(zone_encode_result == encode_result + CLUSTER_MEMBER_ZONE_SIZE);
+    assert(message_hello_decode(buf, zone_encode_result, &out_msg) == zone_encode_result);
+    assert(out_msg.this_member->zone == 3);
+    assert(out_msg.this_member->bridge == 1);
+    message_hello_destroy(&out_msg);
+
+    // Without the label the zone of the member remains unknown.
+    assert(message_hello_decode(buf, encode_result, &out_msg) == encode_result);
+    assert(!(out_msg.header.flags & MESSAGE_FLAG_ZONES));
+    assert(out_msg.this_member->zone == CLUSTER_MEMBER_ZONE_UNKNOWN);
+    message_hello_destroy(&out_msg);
+
     cluster_member_destroy(&member);
 }
 
@@ -109,7 +129,8 @@ void test_message_member_list_enc_dec() {
 
     uint8_t buf[MESSAGE_MAX_SIZE];
     int encode_result = message_member_list_encode(&msg, buf, MESSAGE_MAX_SIZE);
-    assert(encode_result > 0);
+    // IPv4 members are encoded as the address and the port only.
+    assert(encode_result == sizeof(message_header_t) + sizeof(uint16_t) + 2 * CLUSTER_MEMBER_IPV4_SIZE);
 
     message_member_list_t out_msg;
     int decode_result = message_member_list_decode(buf, encode_result, &out_msg);
@@ -126,6 +147,23 @@ void test_message_member_list_enc_dec() {
     assert(message_member_list_encode(&msg, buf, 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
     assert(message_member_list_decode(buf, 12, &out_msg) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
 
+    // The zone labels follow the members in the same order.
+    msg.header.flags |= MESSAGE_FLAG_ZONES;
+    members[0].zone = 1;
+    members[1].zone = 2;
+    members[1].bridge = 1;
+    int zone_encode_result = message_member_list_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(zone_encode_result == encode_result + 2 * CLUSTER_MEMBER_ZONE_SIZE);
+    assert(message_member_list_decode(buf, zone_encode_result, &out_msg) == zone_encode_result);
+    assert(out_msg.members[0].zone == 1 && out_msg.members[0].bridge == 0);
+    assert(out_msg.members[1].zone == 2 && out_msg.members[1].bridge == 1);
+    message_member_list_destroy(&out_msg);
+
+    // Incomplete labels are ignored.
+    assert(message_member_list_decode(buf, zone_encode_result - 1, &out_msg) == encode_result);
+    assert(out_msg.members[0].zone == CLUSTER_MEMBER_ZONE_UNKNOWN);
+    message_member_list_destroy(&out_msg);
+
     cluster_member_destroy(&member1);
     cluster_member_destroy(&member2);
 }
@@ -147,8 +185,47 @@ void test_message_ack_enc_dec() {
     validate_headers(&msg.header, &out_msg.header);
     assert(msg.ack_sequence_num == out_msg.ack_sequence_num);
 
+    // The header can be copied with a different sequence number without modifying the message.
+    uint8_t message[MESSAGE_MAX_SIZE];
+    memcpy(message, buf, encode_result);
+    assert(message_header_copy(buf, encode_result, 7, MESSAGE_FLAG_TIMESTAMPS,
+                               message, sizeof(message)) == sizeof(message_header_t));
+    assert(memcmp(message + sizeof(message_header_t), buf + sizeof(message_header_t),
+                  encode_result - sizeof(message_header_t)) == 0);
+    assert(message_ack_decode(message, encode_result, &out_msg) == encode_result);
+    assert(out_msg.header.sequence_num == 7);
+    assert(out_msg.header.flags == MESSAGE_FLAG_TIMESTAMPS);
+    assert(message_ack_decode(buf, encode_result, &out_msg) == encode_result);
+    assert(out_msg.header.sequence_num == 1);
+    assert(message_header_copy(buf, encode_result, 7, 0, message, 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+
     assert(message_ack_encode(&msg, buf, 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
     assert(message_ack_decode(buf, 12, &out_msg) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+
+    // Acknowledgements of Status and Ping messages carry the coordinate of the receiver.
+    msg.header.flags |= MESSAGE_FLAG_COORDINATES;
+    vivaldi_coord_init(&msg.coordinate);
+    msg.coordinate.vec[1] = -2500.0;
+    int coord_encode_result = message_ack_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(coord_encode_result == encode_result + VIVALDI_COORD_SIZE);
+    assert(message_ack_decode(buf, coord_encode_result, &out_msg) == coord_encode_result);
+    assert(out_msg.header.flags & MESSAGE_FLAG_COORDINATES);
+    assert(out_msg.coordinate.vec[1] == -2500.0);
+    assert(out_msg.ack_sequence_num == 2);
+
+    assert(message_ack_decode(buf, coord_encode_result - 1, &out_msg) == encode_result);
+    assert(!(out_msg.header.flags & MESSAGE_FLAG_COORDINATES));
+
+    // The zone label of the sender follows the coordinate.
+    msg.header.flags |= MESSAGE_FLAG_ZONES;
+    msg.zone = 5;
+    msg.bridge = 0;
+    int zone_encode_result = message_ack_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(zone_encode_result == coord_encode_result + CLUSTER_MEMBER_ZONE_SIZE);
+    assert(message_ack_decode(buf, zone_encode_result, &out_msg) == zone_encode_result);
+    assert(out_msg.header.flags & MESSAGE_FLAG_COORDINATES);
+    assert(out_msg.header.flags & MESSAGE_FLAG_ZONES);
+    assert(out_msg.zone == 5 && out_msg.bridge == 0);
 }
 
 void test_message_data_enc_dec() {
@@ -191,6 +268,94 @@ void test_message_data_enc_dec() {
     cluster_member_destroy(&member);
 }
 
+void test_message_data_timestamps_enc_dec() {
+    message_data_t msg;
+    message_header_init(&msg.header, MESSAGE_DATA_TYPE, 1);
+    msg.header.flags |= MESSAGE_FLAG_TIMESTAMPS;
+
+    uint8_t data[] = { 0x01, 0x02, 0x03 };
+    msg.data_size = sizeof(data);
+    msg.data = data;
+    msg.data_version.member_id = 0x1234;
+    msg.data_version.sequence_number = 5;
+    msg.origin_ts = 0x0102030405060708ULL;
+    msg.sent_ts = 0x1112131415161718ULL;
+
+    uint8_t buf[MESSAGE_MAX_SIZE];
+    int encode_result = message_data_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+
+    message_data_t out_msg;
+    int decode_result = message_data_decode(buf, encode_result, &out_msg);
+    assert(decode_result == encode_result);
+    validate_headers(&msg.header, &out_msg.header);
+    assert(out_msg.data_size == sizeof(data));
+    assert(memcmp(out_msg.data, data, sizeof(data)) == 0);
+    assert(out_msg.origin_ts == msg.origin_ts);
+    assert(out_msg.sent_ts == msg.sent_ts);
+
+    // The sent timestamp replaces the end of the message when it's sent.
+    uint8_t sent_ts[sizeof(uint64_t)];
+    assert(message_sent_ts_encode(buf, encode_result, 42, sent_ts) == sizeof(uint64_t));
+    memcpy(buf + encode_result - sizeof(uint64_t), sent_ts, sizeof(uint64_t));
+    assert(message_data_decode(buf, encode_result, &out_msg) == encode_result);
+    assert(out_msg.origin_ts == msg.origin_ts);
+    assert(out_msg.sent_ts == 42);
+
+    // The trailer is required if the flag is set.
+    assert(message_data_decode(buf, encode_result - sizeof(uint64_t), &out_msg) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+
+    // Messages without the flag are not affected.
+    msg.header.flags = 0;
+    encode_result = message_data_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+    assert(message_sent_ts_encode(buf, encode_result, 42, sent_ts) == 0);
+    assert(message_data_decode(buf, encode_result, &out_msg) == encode_result);
+    assert(memcmp(out_msg.data, data, sizeof(data)) == 0);
+    assert(out_msg.sent_ts == 0);
+}
+
+void test_message_data_hops_enc_dec() {
+    message_data_t msg;
+    message_header_init(&msg.header, MESSAGE_DATA_TYPE, 1);
+    msg.header.flags |= MESSAGE_FLAG_HOPS | MESSAGE_FLAG_TIMESTAMPS;
+
+    uint8_t data[] = { 0x01, 0x02, 0x03 };
+    msg.data_size = sizeof(data);
+    msg.data = data;
+    msg.data_version.member_id = 0x1234;
+    msg.data_version.sequence_number = 5;
+    msg.hops = 7;
+    msg.origin_ts = 0x0102030405060708ULL;
+    msg.sent_ts = 0x1112131415161718ULL;
+
+    uint8_t buf[MESSAGE_MAX_SIZE];
+    int encode_result = message_data_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+
+    message_data_t out_msg;
+    assert(message_data_decode(buf, encode_result, &out_msg) == encode_result);
+    validate_headers(&msg.header, &out_msg.header);
+    assert(memcmp(out_msg.data, data, sizeof(data)) == 0);
+    assert(out_msg.hops == 7);
+    assert(out_msg.origin_ts == msg.origin_ts);
+    assert(out_msg.sent_ts == msg.sent_ts);
+
+    // The sent timestamp stays at the end of the message.
+    uint8_t sent_ts[sizeof(uint64_t)];
+    assert(message_sent_ts_encode(buf, encode_result, 42, sent_ts) == sizeof(uint64_t));
+    memcpy(buf + encode_result - sizeof(uint64_t), sent_ts, sizeof(uint64_t));
+    assert(message_data_decode(buf, encode_result, &out_msg) == encode_result);
+    assert(out_msg.hops == 7);
+    assert(out_msg.sent_ts == 42);
+
+    // The absent counter means that the message hasn't been relayed.
+    msg.header.flags = 0;
+    encode_result = message_data_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(message_data_decode(buf, encode_result, &out_msg) == encode_result);
+    assert(out_msg.hops == 0);
+}
+
 void test_message_status_enc_dec() {
     message_status_t msg;
     message_header_init(&msg.header, MESSAGE_STATUS_TYPE, 1);
@@ -229,6 +394,401 @@ void test_message_status_enc_dec() {
     assert(message_status_encode(&msg, buf, 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
     assert(message_status_decode(buf, 12, &out_msg) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
 
+    // The coordinate of the sender follows the vector clock.
+    msg.header.flags |= MESSAGE_FLAG_COORDINATES;
+    vivaldi_coord_init(&msg.coordinate);
+    msg.coordinate.vec[0] = 1500.0;
+    msg.coordinate.height = 100.0;
+    int coord_encode_result = message_status_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(coord_encode_result == encode_result + VIVALDI_COORD_SIZE);
+    assert(message_status_decode(buf, coord_encode_result, &out_msg) == coord_encode_result);
+    assert(out_msg.header.flags & MESSAGE_FLAG_COORDINATES);
+    assert(out_msg.coordinate.vec[0] == 1500.0);
+    assert(out_msg.coordinate.height == 100.0);
+    assert(out_msg.data_version.size == 2);
+
+    // A malformed coordinate is ignored.
+    assert(message_status_decode(buf, coord_encode_result - 1, &out_msg) == encode_result);
+    assert(!(out_msg.header.flags & MESSAGE_FLAG_COORDINATES));
+    assert(out_msg.data_version.size == 2);
+
+    // The membership log versions follow the coordinate.
+    msg.header.flags |= MESSAGE_FLAG_MEMBER_LOG;
+    msg.member_log_version = 7;
+    msg.member_log_request = MESSAGE_MEMBER_LOG_NO_REQUEST;
+    int log_encode_result = message_status_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(log_encode_result == coord_encode_result + MESSAGE_MEMBER_LOG_SIZE);
+    assert(message_status_decode(buf, log_encode_result, &out_msg) == log_encode_result);
+    assert(out_msg.header.flags & MESSAGE_FLAG_MEMBER_LOG);
+    assert(out_msg.member_log_version == 7);
+    assert(out_msg.member_log_request == MESSAGE_MEMBER_LOG_NO_REQUEST);
+    assert(out_msg.coordinate.vec[0] == 1500.0);
+
+    // Malformed versions are ignored.
+    assert(message_status_decode(buf, log_encode_result - 1, &out_msg) == coord_encode_result);
+    assert(!(out_msg.header.flags & MESSAGE_FLAG_MEMBER_LOG));
+    assert(out_msg.header.flags & MESSAGE_FLAG_COORDINATES);
+
+    cluster_member_destroy(&member1);
+    cluster_member_destroy(&member2);
+}
+
+void test_message_ping_enc_dec() {
+    message_ping_t msg;
+    message_header_init(&msg.header, MESSAGE_PING_TYPE, 1);
+
+    uint8_t buf[MESSAGE_MAX_SIZE];
+    int encode_result = message_ping_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+
+    message_ping_t out_msg;
+    int decode_result = message_ping_decode(buf, encode_result, &out_msg);
+    assert(decode_result == encode_result);
+    validate_headers(&msg.header, &out_msg.header);
+
+    assert(message_ping_encode(&msg, buf, 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+    assert(message_ping_decode(buf, 11, &out_msg) == PITTACUS_ERR_INVALID_MESSAGE);
+}
+
+void test_message_ping_req_enc_dec() {
+    message_ping_req_t msg;
+    message_header_init(&msg.header, MESSAGE_PING_REQ_TYPE, 1);
+
+    cluster_member_t member;
+    assert(create_test_member(12345, &member) == 0);
+    msg.target = &member;
+
+    uint8_t buf[MESSAGE_MAX_SIZE];
+    int encode_result = message_ping_req_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+
+    message_ping_req_t out_msg;
+    int decode_result = message_ping_req_decode(buf, encode_result, &out_msg);
+    assert(decode_result == encode_result);
+
+    validate_headers(&msg.header, &out_msg.header);
+    assert(cluster_member_equals(msg.target, out_msg.target));
+    message_ping_req_destroy(&out_msg);
+
+    assert(message_ping_req_encode(&msg, buf, 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+    assert(message_ping_req_decode(buf, 12, &out_msg) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+
+    cluster_member_destroy(&member);
+}
+
+void test_message_member_state_enc_dec() {
+    message_member_state_t msg;
+    message_header_init(&msg.header, MESSAGE_MEMBER_STATE_TYPE, 1);
+    msg.state = MEMBER_SUSPECT;
+    msg.incarnation = 7;
+
+    cluster_member_t member;
+    assert(create_test_member(12345, &member) == 0);
+    msg.member = &member;
+
+    uint8_t buf[MESSAGE_MAX_SIZE];
+    int encode_result = message_member_state_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+
+    message_member_state_t out_msg;
+    int decode_result = message_member_state_decode(buf, encode_result, &out_msg);
+    assert(decode_result == encode_result);
+
+    validate_headers(&msg.header, &out_msg.header);
+    assert(out_msg.state == MEMBER_SUSPECT);
+    assert(out_msg.incarnation == 7);
+    assert(cluster_member_equals(msg.member, out_msg.member));
+    message_member_state_destroy(&out_msg);
+
+    assert(message_member_state_encode(&msg, buf, 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+    assert(message_member_state_decode(buf, 12, &out_msg) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+
+    // Unknown states are rejected.
+    buf[sizeof(message_header_t)] = 0xFF;
+    assert(message_member_state_decode(buf, encode_result, &out_msg) == PITTACUS_ERR_INVALID_MESSAGE);
+
+    cluster_member_destroy(&member);
+}
+
+void test_message_events_enc_dec() {
+    message_ack_t msg;
+    message_header_init(&msg.header, MESSAGE_ACK_TYPE, 1);
+    msg.ack_sequence_num = 2;
+
+    cluster_member_t member1;
+    cluster_member_t member2;
+    assert(create_test_member(12345, &member1) == 0);
+    assert(create_test_member(12346, &member2) == 0);
+    message_event_t events[2] = {
+        { .state = MEMBER_ALIVE, .incarnation = 0, .member = member1 },
+        { .state = MEMBER_DEAD, .incarnation = 3, .member = member2 }
+    };
+
+    uint8_t buf[MESSAGE_MAX_SIZE];
+    int message_size = message_ack_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(message_size > 0);
+
+    // No events without the flag.
+    message_event_t out_events[2];
+    uint8_t out_events_n = 2;
+    assert(message_events_decode(buf, message_size, out_events, &out_events_n) == 0);
+    assert(out_events_n == 0);
+
+    int encode_result = message_events_encode(events, 2, buf, message_size, MESSAGE_MAX_SIZE);
+    assert(encode_result > message_size);
+
+    out_events_n = 2;
+    int trailer_size = message_events_decode(buf, encode_result, out_events, &out_events_n);
+    assert(trailer_size == encode_result - message_size);
+    assert(out_events_n == 2);
+    assert(out_events[0].state == MEMBER_ALIVE);
+    assert(out_events[0].incarnation == 0);
+    assert(cluster_member_equals(&out_events[0].member, &member1));
+    assert(out_events[1].state == MEMBER_DEAD);
+    assert(out_events[1].incarnation == 3);
+    assert(cluster_member_equals(&out_events[1].member, &member2));
+
+    // The message itself is decoded as usual and the flag is not reported.
+    message_ack_t out_msg;
+    assert(message_ack_decode(buf, message_size, &out_msg) == message_size);
+    validate_headers(&msg.header, &out_msg.header);
+
+    // The trailer can be encoded separately from the message.
+    uint8_t trailer[MESSAGE_MAX_SIZE];
+    int trailer_result = message_events_trailer_encode(events, 2, trailer, sizeof(trailer));
+    assert(trailer_result == trailer_size);
+    assert(memcmp(trailer, buf + message_size, trailer_size) == 0);
+    assert(message_events_trailer_encode(events, 2, trailer, 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+
+    // The number of events is limited by the caller.
+    out_events_n = 1;
+    assert(message_events_decode(buf, encode_result, out_events, &out_events_n) == PITTACUS_ERR_INVALID_MESSAGE);
+
+    // The trailer must fit into the message.
+    out_events_n = 2;
+    uint16_encode(encode_result, buf + encode_result - sizeof(uint16_t));
+    assert(message_events_decode(buf, encode_result, out_events, &out_events_n) == PITTACUS_ERR_INVALID_MESSAGE);
+
+    assert(message_events_encode(events, 2, buf, message_size, message_size + 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+
+    cluster_member_destroy(&member1);
+    cluster_member_destroy(&member2);
+}
+
+void test_message_ihave_iwant_enc_dec() {
+    message_ihave_t msg;
+    message_header_init(&msg.header, MESSAGE_IHAVE_TYPE, 1);
+    msg.data_version.member_id = 3;
+    msg.data_version.sequence_number = 4;
+
+    uint8_t buf[MESSAGE_MAX_SIZE];
+    int encode_result = message_ihave_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+
+    message_ihave_t out_msg;
+    int decode_result = message_ihave_decode(buf, encode_result, &out_msg);
+    assert(decode_result == encode_result);
+
+    validate_headers(&msg.header, &out_msg.header);
+    assert(out_msg.data_version.member_id == 3);
+    assert(out_msg.data_version.sequence_number == 4);
+
+    assert(message_ihave_encode(&msg, buf, 12) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+    assert(message_ihave_decode(buf, 12, &out_msg) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+    // The request has the same layout but a different type.
+    message_iwant_t iwant_msg;
+    assert(message_iwant_decode(buf, encode_result, &iwant_msg) == PITTACUS_ERR_INVALID_MESSAGE);
+
+    message_header_init(&iwant_msg.header, MESSAGE_IWANT_TYPE, 2);
+    vector_clock_record_copy(&iwant_msg.data_version, &msg.data_version);
+    encode_result = message_iwant_encode(&iwant_msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+
+    message_iwant_t out_iwant_msg;
+    decode_result = message_iwant_decode(buf, encode_result, &out_iwant_msg);
+    assert(decode_result == encode_result);
+    validate_headers(&iwant_msg.header, &out_iwant_msg.header);
+    assert(out_iwant_msg.data_version.member_id == 3);
+    assert(out_iwant_msg.data_version.sequence_number == 4);
+}
+
+void test_message_prune_graft_enc_dec() {
+    message_prune_t msg;
+    message_header_init(&msg.header, MESSAGE_PRUNE_TYPE, 1);
+
+    uint8_t buf[MESSAGE_MAX_SIZE];
+    int encode_result = message_prune_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+
+    message_prune_t out_msg;
+    int decode_result = message_prune_decode(buf, encode_result, &out_msg);
+    assert(decode_result == encode_result);
+    validate_headers(&msg.header, &out_msg.header);
+
+    message_graft_t graft_msg;
+    message_header_init(&graft_msg.header, MESSAGE_GRAFT_TYPE, 2);
+    graft_msg.data_version.member_id = 3;
+    graft_msg.data_version.sequence_number = 4;
+    encode_result = message_graft_encode(&graft_msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+
+    message_graft_t out_graft_msg;
+    decode_result = message_graft_decode(buf, encode_result, &out_graft_msg);
+    assert(decode_result == encode_result);
+    validate_headers(&graft_msg.header, &out_graft_msg.header);
+    assert(out_graft_msg.data_version.member_id == 3);
+    assert(out_graft_msg.data_version.sequence_number == 4);
+
+    assert(message_graft_encode(&graft_msg, buf, 12) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+    assert(message_graft_decode(buf, 12, &out_graft_msg) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+}
+
+void test_message_neighbor_disconnect_enc_dec() {
+    message_neighbor_t msg;
+    message_header_init(&msg.header, MESSAGE_NEIGHBOR_TYPE, 1);
+    msg.priority = 1;
+
+    cluster_member_t member;
+    assert(create_test_member(12345, &member) == 0);
+    msg.this_member = &member;
+
+    uint8_t buf[MESSAGE_MAX_SIZE];
+    int encode_result = message_neighbor_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+
+    message_neighbor_t out_msg;
+    int decode_result = message_neighbor_decode(buf, encode_result, &out_msg);
+    assert(decode_result == encode_result);
+
+    validate_headers(&msg.header, &out_msg.header);
+    assert(out_msg.priority == 1);
+    assert(cluster_member_equals(msg.this_member, out_msg.this_member));
+    message_neighbor_destroy(&out_msg);
+
+    assert(message_neighbor_encode(&msg, buf, 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+    assert(message_neighbor_decode(buf, 12, &out_msg) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+
+    message_disconnect_t disconnect_msg;
+    message_header_init(&disconnect_msg.header, MESSAGE_DISCONNECT_TYPE, 2);
+    encode_result = message_disconnect_encode(&disconnect_msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+
+    message_disconnect_t out_disconnect_msg;
+    decode_result = message_disconnect_decode(buf, encode_result, &out_disconnect_msg);
+    assert(decode_result == encode_result);
+    validate_headers(&disconnect_msg.header, &out_disconnect_msg.header);
+
+    cluster_member_destroy(&member);
+}
+
+void test_message_forward_join_enc_dec() {
+    message_forward_join_t msg;
+    message_header_init(&msg.header, MESSAGE_FORWARD_JOIN_TYPE, 1);
+    msg.ttl = 6;
+
+    cluster_member_t member;
+    assert(create_test_member(12345, &member) == 0);
+    msg.member = &member;
+
+    uint8_t buf[MESSAGE_MAX_SIZE];
+    int encode_result = message_forward_join_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+
+    message_forward_join_t out_msg;
+    int decode_result = message_forward_join_decode(buf, encode_result, &out_msg);
+    assert(decode_result == encode_result);
+
+    validate_headers(&msg.header, &out_msg.header);
+    assert(out_msg.ttl == 6);
+    assert(cluster_member_equals(msg.member, out_msg.member));
+    message_forward_join_destroy(&out_msg);
+
+    assert(message_forward_join_encode(&msg, buf, 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+    assert(message_forward_join_decode(buf, 12, &out_msg) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+
+    cluster_member_destroy(&member);
+}
+
+void test_message_shuffle_enc_dec() {
+    message_shuffle_t msg;
+    message_header_init(&msg.header, MESSAGE_SHUFFLE_TYPE, 1);
+    msg.ttl = 3;
+
+    cluster_member_t origin;
+    assert(create_test_member(12345, &origin) == 0);
+    msg.origin = &origin;
+    cluster_member_t member1;
+    assert(create_test_member(12346, &member1) == 0);
+    cluster_member_t member2;
+    assert(create_test_member(12347, &member2) == 0);
+    cluster_member_t members[] = { member1, member2 };
+    msg.members_n = 2;
+    msg.members = members;
+
+    uint8_t buf[MESSAGE_MAX_SIZE];
+    int encode_result = message_shuffle_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+
+    message_shuffle_t out_msg;
+    int decode_result = message_shuffle_decode(buf, encode_result, &out_msg);
+    assert(decode_result == encode_result);
+
+    validate_headers(&msg.header, &out_msg.header);
+    assert(out_msg.ttl == 3);
+    assert(cluster_member_equals(msg.origin, out_msg.origin));
+    assert(out_msg.members_n == 2);
+    for (int i = 0; i < msg.members_n; ++i) {
+        assert(cluster_member_equals(msg.members + i, out_msg.members + i));
+    }
+    message_shuffle_destroy(&out_msg);
+
+    assert(message_shuffle_encode(&msg, buf, encode_result - 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+    assert(message_shuffle_decode(buf, 12, &out_msg) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+
+    cluster_member_destroy(&origin);
+    cluster_member_destroy(&member1);
+    cluster_member_destroy(&member2);
+}
+
+void test_message_member_log_enc_dec() {
+    message_member_log_t msg;
+    message_header_init(&msg.header, MESSAGE_MEMBER_LOG_TYPE, 1);
+    msg.log_version = 12;
+
+    cluster_member_t member1;
+    cluster_member_t member2;
+    assert(create_test_member(12345, &member1) == 0);
+    assert(create_test_member(12346, &member2) == 0);
+    message_event_t events[2] = {
+        { .state = MEMBER_ALIVE, .incarnation = 0, .member = member1 },
+        { .state = MEMBER_DEAD, .incarnation = 3, .member = member2 }
+    };
+    msg.events_n = 2;
+    msg.events = events;
+
+    uint8_t buf[MESSAGE_MAX_SIZE];
+    int encode_result = message_member_log_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+
+    message_member_log_t out_msg;
+    int decode_result = message_member_log_decode(buf, encode_result, &out_msg);
+    assert(decode_result == encode_result);
+
+    validate_headers(&msg.header, &out_msg.header);
+    assert(out_msg.log_version == 12);
+    assert(out_msg.events_n == 2);
+    assert(out_msg.events[0].state == MEMBER_ALIVE);
+    assert(out_msg.events[0].incarnation == 0);
+    assert(cluster_member_equals(&out_msg.events[0].member, &member1));
+    assert(out_msg.events[1].state == MEMBER_DEAD);
+    assert(out_msg.events[1].incarnation == 3);
+    assert(cluster_member_equals(&out_msg.events[1].member, &member2));
+    message_member_log_destroy(&out_msg);
+
+    assert(message_member_log_encode(&msg, buf, encode_result - 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+    assert(message_member_log_decode(buf, 12, &out_msg) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+    assert(message_member_log_decode(buf, encode_result - 1, &out_msg) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+
     cluster_member_destroy(&member1);
     cluster_member_destroy(&member2);
 }
@@ -248,6 +808,44 @@ void test_message_invalid_message_type() {
     assert(message_ack_decode(buf, encode_result, NULL) == PITTACUS_ERR_INVALID_MESSAGE);
     assert(message_data_decode(buf, encode_result, NULL) == PITTACUS_ERR_INVALID_MESSAGE);
     assert(message_status_decode(buf, encode_result, NULL) == PITTACUS_ERR_INVALID_MESSAGE);
+    assert(message_ping_decode(buf, encode_result, NULL) == PITTACUS_ERR_INVALID_MESSAGE);
+    assert(message_ping_req_decode(buf, encode_result, NULL) == PITTACUS_ERR_INVALID_MESSAGE);
+    assert(message_member_state_decode(buf, encode_result, NULL) == PITTACUS_ERR_INVALID_MESSAGE);
+    assert(message_ihave_decode(buf, encode_result, NULL) == PITTACUS_ERR_INVALID_MESSAGE);
+    assert(message_iwant_decode(buf, encode_result, NULL) == PITTACUS_ERR_INVALID_MESSAGE);
+    assert(message_prune_decode(buf, encode_result, NULL) == PITTACUS_ERR_INVALID_MESSAGE);
+    assert(message_graft_decode(buf, encode_result, NULL) == PITTACUS_ERR_INVALID_MESSAGE);
+    assert(message_neighbor_decode(buf, encode_result, NULL) == PITTACUS_ERR_INVALID_MESSAGE);
+    assert(message_disconnect_decode(buf, encode_result, NULL) == PITTACUS_ERR_INVALID_MESSAGE);
+    assert(message_forward_join_decode(buf, encode_result, NULL) == PITTACUS_ERR_INVALID_MESSAGE);
+    assert(message_shuffle_decode(buf, encode_result, NULL) == PITTACUS_ERR_INVALID_MESSAGE);
+    assert(message_member_log_decode(buf, encode_result, NULL) == PITTACUS_ERR_INVALID_MESSAGE);
+}
+
+void test_message_protocol_version_mismatch() {
+    message_hello_t msg;
+    message_header_init(&msg.header, MESSAGE_HELLO_TYPE, 1);
+
+    cluster_member_t member;
+    assert(create_test_member(12345, &member) == 0);
+    msg.this_member = &member;
+
+    uint8_t buf[MESSAGE_MAX_SIZE];
+    int encode_result = message_hello_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+
+    // The version in the header doesn't match.
+    message_hello_t out_msg;
+    buf[PROTOCOL_ID_LENGTH - 1] = PROTOCOL_VERSION - 1;
+    assert(message_hello_decode(buf, encode_result, &out_msg) == PITTACUS_ERR_INVALID_MESSAGE);
+
+    // The version of the member doesn't match.
+    member.version = PROTOCOL_VERSION - 1;
+    encode_result = message_hello_encode(&msg, buf, MESSAGE_MAX_SIZE);
+    assert(encode_result > 0);
+    assert(message_hello_decode(buf, encode_result, &out_msg) == PITTACUS_ERR_INVALID_MESSAGE);
+
+    cluster_member_destroy(&member);
 }
 
 int main() {
@@ -257,7 +855,20 @@ int main() {
     test_message_member_list_enc_dec();
     test_message_ack_enc_dec();
     test_message_data_enc_dec();
+    test_message_data_timestamps_enc_dec();
+    test_message_data_hops_enc_dec();
     test_message_status_enc_dec();
+    test_message_ping_enc_dec();
+    test_message_ping_req_enc_dec();
+    test_message_member_state_enc_dec();
+    test_message_events_enc_dec();
+    test_message_ihave_iwant_enc_dec();
+    test_message_prune_graft_enc_dec();
+    test_message_neighbor_disconnect_enc_dec();
+    test_message_forward_join_enc_dec();
+    test_message_shuffle_enc_dec();
+    test_message_member_log_enc_dec();
     test_message_invalid_message_type();
+    test_message_protocol_version_mismatch();
     return 0;
 }
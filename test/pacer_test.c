@@ -0,0 +1,75 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "pacer.h"
+#include <assert.h>
+#include <stdint.h>
+
+#define START_US 1000000ULL
+
+void test_pacer_unlimited() {
+    pacer_t pacer;
+    pacer_init(&pacer, 0, 0);
+    for (int i = 0; i < 1000; ++i) {
+        assert(pacer_deadline(&pacer, MESSAGE_MAX_SIZE, START_US) == START_US);
+        pacer_consume(&pacer, MESSAGE_MAX_SIZE);
+    }
+}
+
+void test_pacer_packets() {
+    pacer_t pacer;
+    // 1000 datagrams per second allow bursts of SEND_BURST_INTERVAL datagrams.
+    pacer_init(&pacer, 0, 1000);
+    uint64_t burst = 1000 * SEND_BURST_INTERVAL / 1000;
+    for (uint64_t i = 0; i < burst; ++i) {
+        assert(pacer_deadline(&pacer, 1, START_US) == START_US);
+        pacer_consume(&pacer, 1);
+    }
+    // The next datagram has to wait for a single token.
+    assert(pacer_deadline(&pacer, 1, START_US) == START_US + 1000);
+    assert(pacer_deadline(&pacer, 1, START_US + 500) == START_US + 1000);
+    assert(pacer_deadline(&pacer, 1, START_US + 1000) == START_US + 1000);
+    pacer_consume(&pacer, 1);
+
+    // The bucket doesn't grow beyond its capacity after a long pause.
+    uint64_t later_us = START_US + 3600 * 1000000ULL;
+    for (uint64_t i = 0; i < burst; ++i) {
+        assert(pacer_deadline(&pacer, 1, later_us) == later_us);
+        pacer_consume(&pacer, 1);
+    }
+    assert(pacer_deadline(&pacer, 1, later_us) > later_us);
+}
+
+void test_pacer_bytes() {
+    pacer_t pacer;
+    // The bucket always fits a datagram of the maximum size.
+    pacer_init(&pacer, 1000, 0);
+    assert(pacer_deadline(&pacer, MESSAGE_MAX_SIZE, START_US) == START_US);
+    pacer_consume(&pacer, MESSAGE_MAX_SIZE);
+
+    // 1000 bytes per second is 1 byte per millisecond.
+    assert(pacer_deadline(&pacer, 100, START_US) == START_US + 100 * 1000);
+    assert(pacer_deadline(&pacer, 100, START_US + 60 * 1000) == START_US + 100 * 1000);
+    assert(pacer_deadline(&pacer, 10, START_US + 60 * 1000) == START_US + 60 * 1000);
+    pacer_consume(&pacer, 10);
+    assert(pacer_deadline(&pacer, 100, START_US + 60 * 1000) == START_US + 110 * 1000);
+}
+
+int main() {
+    test_pacer_unlimited();
+    test_pacer_packets();
+    test_pacer_bytes();
+    return 0;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "rtt_estimator.h"
+#include <assert.h>
+#include <stdint.h>
+
+void test_rtt_estimator_initial() {
+    rtt_estimator_t estimator;
+    rtt_estimator_init(&estimator);
+    assert(rtt_estimator_timeout(&estimator, 0) == MESSAGE_RETRY_TIMEOUT_INITIAL * 1000ULL);
+    assert(rtt_estimator_timeout(&estimator, 1) == MESSAGE_RETRY_TIMEOUT_INITIAL * 2000ULL);
+    // The backoff is bounded by the maximum retry interval.
+    assert(rtt_estimator_timeout(&estimator, 1000) == MESSAGE_RETRY_INTERVAL * 1000ULL);
+}
+
+void test_rtt_estimator_samples() {
+    rtt_estimator_t estimator;
+    rtt_estimator_init(&estimator);
+    rtt_estimator_sample(&estimator, 80000);
+    assert(estimator.srtt_us == 80000);
+    assert(estimator.rttvar_us == 40000);
+    assert(rtt_estimator_timeout(&estimator, 0) == 80000 + 4 * 40000);
+    assert(rtt_estimator_timeout(&estimator, 2) == 4 * (80000 + 4 * 40000));
+
+    // Stable samples shrink the variation.
+    for (int i = 0; i < 100; ++i) rtt_estimator_sample(&estimator, 40000);
+    assert(estimator.samples == 101);
+    assert(estimator.srtt_us >= 40000 && estimator.srtt_us < 41000);
+    assert(estimator.rttvar_us < 1000);
+    assert(rtt_estimator_timeout(&estimator, 0) < 45000);
+
+    // A sudden delay increases the timeout right away.
+    uint64_t timeout_us = rtt_estimator_timeout(&estimator, 0);
+    rtt_estimator_sample(&estimator, 200000);
+    assert(rtt_estimator_timeout(&estimator, 0) > timeout_us + 100000);
+}
+
+void test_rtt_estimator_min_timeout() {
+    rtt_estimator_t estimator;
+    rtt_estimator_init(&estimator);
+    // Round trips on a local network are shorter than the timer resolution of most loops.
+    rtt_estimator_sample(&estimator, 50);
+    assert(rtt_estimator_timeout(&estimator, 0) == MESSAGE_RETRY_TIMEOUT_MIN * 1000ULL);
+    assert(rtt_estimator_timeout(&estimator, 1) == MESSAGE_RETRY_TIMEOUT_MIN * 2000ULL);
+}
+
+int main() {
+    test_rtt_estimator_initial();
+    test_rtt_estimator_samples();
+    test_rtt_estimator_min_timeout();
+    return 0;
+}
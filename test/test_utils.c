@@ -14,9 +14,11 @@
  * limitations under the License.
  */
 #include "test_utils.h"
+#include <string.h>
 
 int create_test_member(uint16_t port, cluster_member_t *result) {
     pt_sockaddr_in in;
+    memset(&in, 0, sizeof(pt_sockaddr_in));
     in.sin_family = AF_INET;
     in.sin_port = PT_HTONS(port);
     inet_aton("127.0.0.1", &in.sin_addr);
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2016-2017 Iaroslav Zeigerman
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "vivaldi.h"
+#include "errors.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define NODES_NUM 16
+#define LOCAL_RTT_US 1000
+#define REMOTE_RTT_US 80000
+
+static uint64_t test_rtt(int first, int second) {
+    // Two sites of NODES_NUM / 2 nodes each.
+    return (first < NODES_NUM / 2) == (second < NODES_NUM / 2) ? LOCAL_RTT_US : REMOTE_RTT_US;
+}
+
+static double test_relative_error(double estimate, uint64_t rtt) {
+    double error = (estimate - rtt) / rtt;
+    return error < 0.0 ? -error : error;
+}
+
+void test_vivaldi_convergence() {
+    vivaldi_coord_t coords[NODES_NUM];
+    for (int i = 0; i < NODES_NUM; ++i) vivaldi_coord_init(&coords[i]);
+    assert(vivaldi_distance(&coords[0], &coords[1]) > 0.0);
+
+    srandom(1);
+    for (int round = 0; round < 20000; ++round) {
+        int first = random() % NODES_NUM;
+        int second = random() % NODES_NUM;
+        if (first == second) continue;
+        vivaldi_update(&coords[first], &coords[second], test_rtt(first, second));
+    }
+
+    // Any pair can be estimated, including pairs that have never been measured together.
+    for (int i = 0; i < NODES_NUM; ++i) {
+        for (int j = i + 1; j < NODES_NUM; ++j) {
+            double estimate = vivaldi_distance(&coords[i], &coords[j]);
+            assert(test_relative_error(estimate, test_rtt(i, j)) < (test_rtt(i, j) == REMOTE_RTT_US ? 0.05 : 0.5));
+        }
+        assert(coords[i].error < 0.5);
+    }
+}
+
+void test_vivaldi_encode_decode() {
+    vivaldi_coord_t coord;
+    vivaldi_coord_init(&coord);
+    for (int i = 0; i < VIVALDI_DIMENSIONS; ++i) coord.vec[i] = (i % 2 ? -1.0 : 1.0) * 1000.0 * (i + 1);
+    coord.height = 250.0;
+    coord.error = 0.125;
+
+    uint8_t buffer[VIVALDI_COORD_SIZE];
+    assert(vivaldi_coord_encode(&coord, buffer, sizeof(buffer) - 1) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+    assert(vivaldi_coord_encode(&coord, buffer, sizeof(buffer)) == VIVALDI_COORD_SIZE);
+
+    vivaldi_coord_t decoded;
+    assert(vivaldi_coord_decode(buffer, sizeof(buffer) - 1, &decoded) == PITTACUS_ERR_BUFFER_NOT_ENOUGH);
+    assert(vivaldi_coord_decode(buffer, sizeof(buffer), &decoded) == VIVALDI_COORD_SIZE);
+    for (int i = 0; i < VIVALDI_DIMENSIONS; ++i) assert(decoded.vec[i] == coord.vec[i]);
+    assert(decoded.height == coord.height);
+    assert(decoded.error == coord.error);
+
+    // Coordinates of a different dimensionality are rejected.
+    buffer[0] = VIVALDI_DIMENSIONS + 1;
+    assert(vivaldi_coord_decode(buffer, sizeof(buffer), &decoded) == PITTACUS_ERR_INVALID_MESSAGE);
+}
+
+int main() {
+    test_vivaldi_convergence();
+    test_vivaldi_encode_decode();
+    return 0;
+}